@@ -0,0 +1,51 @@
+#
+# Copyright (C) 2026 Sébastien Helleu <flashcode@flashtux.org>
+#
+# This file is part of WeeChat, the extensible chat client.
+#
+# WeeChat is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# WeeChat is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+# - Find LZ4
+# This module finds if liblz4 is installed and determines where
+# the include files and libraries are.
+#
+# This code sets the following variables:
+#
+#  LZ4_INCLUDE_PATH = path to where lz4.h can be found
+#  LZ4_LIBRARY = path to where liblz4.so* can be found
+
+if(LZ4_FOUND)
+  # Already in cache, be silent
+  set(LZ4_FIND_QUIETLY TRUE)
+endif()
+
+find_path(LZ4_INCLUDE_PATH
+  NAMES lz4.h lz4hc.h
+  PATHS /usr/include /usr/local/include /usr/pkg/include
+)
+
+find_library(LZ4_LIBRARY
+  NAMES lz4
+  PATHS /lib /usr/lib /usr/local/lib /usr/pkg/lib
+)
+
+if(LZ4_INCLUDE_PATH AND LZ4_LIBRARY)
+  set(LZ4_FOUND TRUE)
+endif()
+
+mark_as_advanced(
+  LZ4_INCLUDE_PATH
+  LZ4_LIBRARY
+  )
@@ -1646,7 +1646,9 @@ COMMAND_CALLBACK(debug)
 {
     struct t_config_option *ptr_option;
     struct t_weechat_plugin *ptr_plugin;
-    int debug;
+    int debug, num_events;
+    char *error, *filename;
+    long value;
 
     /* make C compiler happy */
     (void) data;
@@ -1741,6 +1743,35 @@ COMMAND_CALLBACK(debug)
         return WEECHAT_RC_OK;
     }
 
+    if (string_strcasecmp (argv[1], "loop") == 0)
+    {
+        if (argc > 2)
+        {
+            if (string_strcasecmp (argv[2], "reset") == 0)
+            {
+                debug_main_loop_reset ();
+                gui_chat_printf (NULL,
+                                 _("Main loop statistics have been reset"));
+                return WEECHAT_RC_OK;
+            }
+            if ((argc > 3) && (string_strcasecmp (argv[2], "stall") == 0))
+            {
+                error = NULL;
+                value = strtol (argv[3], &error, 10);
+                if (!error || error[0] || (value < 0))
+                    return WEECHAT_RC_ERROR;
+                debug_main_loop_stall_threshold = (int)value;
+                gui_chat_printf (NULL,
+                                 _("Main loop stall threshold: %d ms"),
+                                 debug_main_loop_stall_threshold);
+                return WEECHAT_RC_OK;
+            }
+            return WEECHAT_RC_ERROR;
+        }
+        debug_main_loop_display ();
+        return WEECHAT_RC_OK;
+    }
+
     if (string_strcasecmp (argv[1], "memory") == 0)
     {
         debug_memory ();
@@ -1773,6 +1804,79 @@ COMMAND_CALLBACK(debug)
         return WEECHAT_RC_OK;
     }
 
+    if (string_strcasecmp (argv[1], "trace") == 0)
+    {
+        if (argc < 3)
+        {
+            if (debug_trace_active)
+            {
+                gui_chat_printf (NULL,
+                                 _("Trace is recording events (file: %s)"),
+                                 debug_trace_filename);
+            }
+            else
+                gui_chat_printf (NULL, _("Trace is not recording events"));
+            return WEECHAT_RC_OK;
+        }
+        if (string_strcasecmp (argv[2], "start") == 0)
+        {
+            if (argc < 4)
+                return WEECHAT_RC_ERROR;
+            if (debug_trace_active)
+            {
+                gui_chat_printf (NULL,
+                                 _("%sTrace is already recording events"),
+                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR]);
+                return WEECHAT_RC_OK;
+            }
+            if (!debug_trace_start (argv_eol[3]))
+            {
+                gui_chat_printf (NULL,
+                                 _("%sUnable to start trace"),
+                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR]);
+                return WEECHAT_RC_OK;
+            }
+            gui_chat_printf (NULL,
+                             _("Trace started, events will be written in "
+                               "file %s"),
+                             debug_trace_filename);
+            return WEECHAT_RC_OK;
+        }
+        if (string_strcasecmp (argv[2], "stop") == 0)
+        {
+            if (!debug_trace_active)
+            {
+                gui_chat_printf (NULL,
+                                 _("%sTrace is not recording events"),
+                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR]);
+                return WEECHAT_RC_OK;
+            }
+            filename = strdup (debug_trace_filename);
+            num_events = debug_trace_stop ();
+            if (num_events < 0)
+            {
+                gui_chat_printf (NULL,
+                                 _("%sUnable to write trace file %s"),
+                                 gui_chat_prefix[GUI_CHAT_PREFIX_ERROR],
+                                 (filename) ? filename : "?");
+            }
+            else
+            {
+                gui_chat_printf (NULL,
+                                 NG_("Trace stopped, %d event written in "
+                                     "file %s",
+                                     "Trace stopped, %d events written in "
+                                     "file %s",
+                                     num_events),
+                                 num_events, (filename) ? filename : "?");
+            }
+            if (filename)
+                free (filename);
+            return WEECHAT_RC_OK;
+        }
+        return WEECHAT_RC_ERROR;
+    }
+
     if (string_strcasecmp (argv[1], "windows") == 0)
     {
         debug_windows_tree ();
@@ -6959,7 +7063,9 @@ command_init ()
            " || dump [<plugin>]"
            " || buffer|color|infolists|memory|tags|term|windows"
            " || mouse|cursor [verbose]"
-           " || hdata [free]"),
+           " || hdata [free]"
+           " || loop [reset|stall <delay>]"
+           " || trace start <file>|stop"),
         N_("     list: list plugins with debug levels\n"
            "      set: set debug level for plugin\n"
            "   plugin: name of plugin (\"core\" for WeeChat core)\n"
@@ -6975,10 +7081,20 @@ command_init ()
            "    hooks: display infos about hooks\n"
            "infolists: display infos about infolists\n"
            "     libs: display infos about external libraries used\n"
+           "     loop: display histograms of durations of main loop "
+           "iterations (by phase: timers, refreshs, fd) (with reset: reset "
+           "histograms, with stall: set delay (in milliseconds) after which "
+           "a warning is written in WeeChat log file for a slow iteration, "
+           "0 = disable)\n"
            "   memory: display infos about memory usage\n"
            "    mouse: toggle debug for mouse\n"
            "     tags: display tags for lines\n"
            "     term: display infos about terminal\n"
+           "    trace: record events of main loop, hook callbacks and display "
+           "(in memory, last 65536 events), the file is written on stop in "
+           "Chrome trace event format (JSON), which can be loaded in "
+           "chrome://tracing or Perfetto UI (path is relative to WeeChat "
+           "home)\n"
            "  windows: display windows tree"),
         "list"
         " || set %(plugins_names)|core"
@@ -6991,10 +7107,12 @@ command_init ()
         " || hooks"
         " || infolists"
         " || libs"
+        " || loop reset|stall"
         " || memory"
         " || mouse verbose"
         " || tags"
         " || term"
+        " || trace start|stop"
         " || windows",
         &command_debug, NULL);
     hook_command (
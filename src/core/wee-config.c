@@ -260,6 +260,7 @@ struct t_config_option *config_history_max_visited_buffers;
 
 /* config, network section */
 
+struct t_config_option *config_network_connection_attempt_delay;
 struct t_config_option *config_network_connection_timeout;
 struct t_config_option *config_network_gnutls_ca_file;
 struct t_config_option *config_network_gnutls_handshake_timeout;
@@ -270,8 +271,10 @@ struct t_config_option *config_network_proxy_curl;
 struct t_config_option *config_plugin_autoload;
 struct t_config_option *config_plugin_debug;
 struct t_config_option *config_plugin_extension;
+struct t_config_option *config_plugin_max_threads;
 struct t_config_option *config_plugin_path;
 struct t_config_option *config_plugin_save_config_on_unload;
+struct t_config_option *config_plugin_timer_slack;
 
 /* other */
 
@@ -3280,11 +3283,20 @@ config_weechat_init_options ()
         return 0;
     }
 
+    config_network_connection_attempt_delay = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "connection_attempt_delay", "integer",
+        N_("delay (in milliseconds) before trying next IP address of a host "
+           "while connection to previous address is still in progress; "
+           "IPv6 and IPv4 addresses are alternated and the first connected "
+           "address is used (\"Happy Eyeballs\", RFC 8305); 0 = try next "
+           "address only when connection to previous address has failed"),
+        NULL, 0, 60000, "250", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
     config_network_connection_timeout = config_file_new_option (
         weechat_config_file, ptr_section,
         "connection_timeout", "integer",
-        N_("timeout (in seconds) for connection to a remote host (made in a "
-           "child process)"),
+        N_("timeout (in seconds) for connection to a remote host (including "
+           "name resolution and handshake with proxy)"),
         NULL, 1, INT_MAX, "60", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
     config_network_gnutls_ca_file = config_file_new_option (
         weechat_config_file, ptr_section,
@@ -3339,6 +3351,13 @@ config_weechat_init_options ()
         N_("comma separated list of file name extensions for plugins"),
         NULL, 0, 0, ".so,.dll", NULL, 0, NULL, NULL,
         &config_change_plugin_extension, NULL, NULL, NULL);
+    config_plugin_max_threads = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "max_threads", "integer",
+        N_("maximum number of threads used to run functions of plugins in "
+           "background (see function hook_thread in plugin API reference); "
+           "threads are started only when needed"),
+        NULL, 1, 64, "4", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
     config_plugin_path = config_file_new_option (
         weechat_config_file, ptr_section,
         "path", "string",
@@ -3350,6 +3369,15 @@ config_weechat_init_options ()
         "save_config_on_unload", "boolean",
         N_("save configuration files when unloading plugins"),
         NULL, 0, 0, "on", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
+    config_plugin_timer_slack = config_file_new_option (
+        weechat_config_file, ptr_section,
+        "timer_slack", "integer",
+        N_("delay (in milliseconds) that timers (of core and plugins) can be "
+           "late, so that timers with close deadlines are executed in a single "
+           "wakeup (a timer is never late by more than a quarter of its "
+           "interval); this reduces the number of wakeups when WeeChat is "
+           "idle (0 = timers are executed as soon as possible)"),
+        NULL, 0, 1000, "0", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
 
     /* bars */
     ptr_section = config_file_new_section (weechat_config_file, "bar",
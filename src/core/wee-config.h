@@ -283,6 +283,7 @@ extern struct t_config_option *config_history_max_buffer_lines_number;
 extern struct t_config_option *config_history_max_commands;
 extern struct t_config_option *config_history_max_visited_buffers;
 
+extern struct t_config_option *config_network_connection_attempt_delay;
 extern struct t_config_option *config_network_connection_timeout;
 extern struct t_config_option *config_network_gnutls_ca_file;
 extern struct t_config_option *config_network_gnutls_handshake_timeout;
@@ -291,8 +292,10 @@ extern struct t_config_option *config_network_proxy_curl;
 extern struct t_config_option *config_plugin_autoload;
 extern struct t_config_option *config_plugin_debug;
 extern struct t_config_option *config_plugin_extension;
+extern struct t_config_option *config_plugin_max_threads;
 extern struct t_config_option *config_plugin_path;
 extern struct t_config_option *config_plugin_save_config_on_unload;
+extern struct t_config_option *config_plugin_timer_slack;
 
 extern int config_length_nick_prefix_suffix;
 extern int config_length_prefix_same_nick;
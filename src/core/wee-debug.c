@@ -28,7 +28,9 @@
 #include <malloc.h>
 #endif
 #include <string.h>
+#include <unistd.h>
 #include <time.h>
+#include <sys/time.h>
 #include <gcrypt.h>
 #include <curl/curl.h>
 #include <zlib.h>
@@ -38,6 +40,7 @@
 #endif
 
 #include "weechat.h"
+#include "wee-debug.h"
 #include "wee-backtrace.h"
 #include "wee-config-file.h"
 #include "wee-hashtable.h"
@@ -46,12 +49,16 @@
 #include "wee-infolist.h"
 #include "wee-list.h"
 #include "wee-log.h"
+#include "wee-memory.h"
 #include "wee-proxy.h"
 #include "wee-string.h"
+#include "wee-thread.h"
+#include "wee-util.h"
 #include "../gui/gui-bar.h"
 #include "../gui/gui-bar-item.h"
 #include "../gui/gui-buffer.h"
 #include "../gui/gui-chat.h"
+#include "../gui/gui-color.h"
 #include "../gui/gui-filter.h"
 #include "../gui/gui-hotlist.h"
 #include "../gui/gui-key.h"
@@ -63,6 +70,26 @@
 
 int debug_dump_active = 0;
 
+char *debug_main_loop_phase_string[DEBUG_MAIN_LOOP_NUM_PHASES] =
+{ "timers", "refreshs", "fd", "iteration" };
+struct t_debug_histogram debug_main_loop_histograms[DEBUG_MAIN_LOOP_NUM_PHASES];
+long long debug_main_loop_current_usec[DEBUG_MAIN_LOOP_NUM_PHASES];
+char debug_main_loop_slowest_callback[256] = "";
+long long debug_main_loop_slowest_callback_usec = 0;
+int debug_main_loop_stall_threshold = 1000; /* in ms (0 = no stall check)  */
+int debug_main_loop_stalls = 0;        /* number of stalls detected         */
+time_t debug_main_loop_last_stall = 0; /* date of last stall                */
+long long debug_main_loop_last_stall_usec = 0;
+char debug_main_loop_last_stall_callback[256] = "";
+long long debug_main_loop_last_stall_callback_usec = 0;
+
+int debug_trace_active = 0;            /* 1 if trace is recording events    */
+char *debug_trace_filename = NULL;     /* trace file (written on stop)      */
+struct timeval debug_trace_start_time; /* start time of trace               */
+struct t_debug_trace_event *debug_trace_events = NULL; /* ring buffer      */
+int debug_trace_index = 0;             /* index of next event in buffer     */
+int debug_trace_count = 0;             /* number of events in buffer        */
+
 
 /*
  * Writes dump of data to WeeChat log file.
@@ -107,6 +134,10 @@ debug_dump (int crash)
 
     proxy_print_log ();
 
+    thread_print_log ();
+
+    memory_print_log ();
+
     plugin_print_log ();
 
     log_printf ("");
@@ -241,9 +272,52 @@ debug_windows_tree ()
 void
 debug_memory ()
 {
+    struct t_memory_owner *ptr_owner;
+    struct t_memory_counter *ptr_counter;
+    long long total_bytes;
+    long total_objects;
+    int i;
 #ifdef HAVE_MALLINFO
     struct mallinfo info;
+#endif
 
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL, _("Memory counters (allocations tracked by "
+                             "WeeChat and plugins):"));
+    gui_chat_printf (NULL, "  %-24s %10s %14s %14s",
+                     _("owner/category"), _("objects"), _("bytes"),
+                     _("peak bytes"));
+    for (ptr_owner = memory_owners; ptr_owner;
+         ptr_owner = ptr_owner->next_owner)
+    {
+        gui_chat_printf (NULL, "  %s%s",
+                         GUI_COLOR(GUI_COLOR_CHAT_BUFFER),
+                         ptr_owner->name);
+        for (i = 0; i < MEMORY_NUM_CATEGORIES; i++)
+        {
+            if (ptr_owner->counters[i].bytes_max == 0)
+                continue;
+            gui_chat_printf (NULL, "    %-22s %10ld %14lld %14lld",
+                             ptr_owner->counters[i].category,
+                             ptr_owner->counters[i].objects,
+                             ptr_owner->counters[i].bytes,
+                             ptr_owner->counters[i].bytes_max);
+        }
+        for (ptr_counter = ptr_owner->custom_counters; ptr_counter;
+             ptr_counter = ptr_counter->next_counter)
+        {
+            gui_chat_printf (NULL, "    %-22s %10ld %14lld %14lld",
+                             ptr_counter->category,
+                             ptr_counter->objects,
+                             ptr_counter->bytes,
+                             ptr_counter->bytes_max);
+        }
+    }
+    memory_get_total (&total_bytes, &total_objects);
+    gui_chat_printf (NULL, "  %-24s %10ld %14lld",
+                     _("total"), total_objects, total_bytes);
+
+#ifdef HAVE_MALLINFO
     info = mallinfo ();
 
     gui_chat_printf (NULL, "");
@@ -577,6 +651,620 @@ debug_directories ()
     gui_chat_printf (NULL, "  locale: %s", LOCALEDIR);
 }
 
+/*
+ * Adds a duration (in microseconds) in a histogram.
+ */
+
+void
+debug_histogram_add (struct t_debug_histogram *histogram, long long usec)
+{
+    int bucket;
+    long long value;
+
+    if (usec < 0)
+        usec = 0;
+
+    bucket = 0;
+    value = usec >> 1;
+    while ((value > 0) && (bucket < DEBUG_HISTOGRAM_SIZE - 1))
+    {
+        bucket++;
+        value >>= 1;
+    }
+
+    histogram->count++;
+    histogram->total_usec += usec;
+    if (usec > histogram->max_usec)
+        histogram->max_usec = usec;
+    histogram->buckets[bucket]++;
+}
+
+/*
+ * Starts a phase of main loop: sets tv_phase_start to current time.
+ */
+
+void
+debug_main_loop_phase_start (enum t_debug_main_loop_phase phase,
+                             struct timeval *tv_phase_start)
+{
+    gettimeofday (tv_phase_start, NULL);
+    if (debug_trace_active)
+    {
+        debug_trace_add ('B', "core", debug_main_loop_phase_string[phase],
+                         NULL, tv_phase_start);
+    }
+}
+
+/*
+ * Ends a phase of main loop: adds time elapsed since tv_phase_start to the
+ * current iteration.
+ */
+
+void
+debug_main_loop_phase_end (enum t_debug_main_loop_phase phase,
+                           struct timeval *tv_phase_start)
+{
+    struct timeval tv_now;
+
+    gettimeofday (&tv_now, NULL);
+    if (debug_trace_active)
+        debug_trace_add ('E', NULL, NULL, NULL, &tv_now);
+    debug_main_loop_current_usec[phase] +=
+        util_timeval_diff_usec (tv_phase_start, &tv_now);
+}
+
+/*
+ * Ends a hook callback called by main loop (timer or fd): remembers the
+ * slowest callback of current iteration, to display it if the iteration is
+ * too long.
+ *
+ * Argument hook_detail is the interval for a timer and the file descriptor
+ * for a fd hook.
+ */
+
+void
+debug_main_loop_callback_end (int hook_type, struct t_weechat_plugin *plugin,
+                              int hook_detail,
+                              struct timeval *tv_callback_start)
+{
+    struct timeval tv_now;
+    long long usec;
+
+    gettimeofday (&tv_now, NULL);
+    usec = util_timeval_diff_usec (tv_callback_start, &tv_now);
+    if (usec <= debug_main_loop_slowest_callback_usec)
+        return;
+
+    debug_main_loop_slowest_callback_usec = usec;
+    snprintf (debug_main_loop_slowest_callback,
+              sizeof (debug_main_loop_slowest_callback),
+              "hook_type=%s hook_plugin=%s hook_%s=%d",
+              ((hook_type >= 0) && (hook_type < HOOK_NUM_TYPES)) ?
+              hook_type_string[hook_type] : "?",
+              plugin_get_name (plugin),
+              (hook_type == HOOK_TYPE_TIMER) ? "interval" : "fd",
+              hook_detail);
+}
+
+/*
+ * Ends an iteration of main loop: adds durations of phases in histograms
+ * and logs a warning if the iteration took more than the stall threshold.
+ */
+
+void
+debug_main_loop_iteration_end ()
+{
+    long long usec_iteration;
+    int i;
+
+    usec_iteration = 0;
+    for (i = 0; i < DEBUG_MAIN_LOOP_PHASE_ITERATION; i++)
+    {
+        usec_iteration += debug_main_loop_current_usec[i];
+    }
+    debug_main_loop_current_usec[DEBUG_MAIN_LOOP_PHASE_ITERATION] =
+        usec_iteration;
+
+    for (i = 0; i < DEBUG_MAIN_LOOP_NUM_PHASES; i++)
+    {
+        debug_histogram_add (&debug_main_loop_histograms[i],
+                             debug_main_loop_current_usec[i]);
+    }
+
+    if ((debug_main_loop_stall_threshold > 0)
+        && (usec_iteration >= (long long)debug_main_loop_stall_threshold * 1000))
+    {
+        debug_main_loop_stalls++;
+        debug_main_loop_last_stall = time (NULL);
+        debug_main_loop_last_stall_usec = usec_iteration;
+        snprintf (debug_main_loop_last_stall_callback,
+                  sizeof (debug_main_loop_last_stall_callback),
+                  "%s",
+                  (debug_main_loop_slowest_callback[0]) ?
+                  debug_main_loop_slowest_callback : "-");
+        debug_main_loop_last_stall_callback_usec =
+            debug_main_loop_slowest_callback_usec;
+        log_printf ("main loop stall: duration_ms=%lld timers_ms=%lld "
+                    "refreshs_ms=%lld fd_ms=%lld slowest_callback_ms=%lld %s",
+                    usec_iteration / 1000,
+                    debug_main_loop_current_usec[DEBUG_MAIN_LOOP_PHASE_TIMERS] / 1000,
+                    debug_main_loop_current_usec[DEBUG_MAIN_LOOP_PHASE_REFRESHS] / 1000,
+                    debug_main_loop_current_usec[DEBUG_MAIN_LOOP_PHASE_FD] / 1000,
+                    debug_main_loop_slowest_callback_usec / 1000,
+                    debug_main_loop_last_stall_callback);
+    }
+
+    for (i = 0; i < DEBUG_MAIN_LOOP_NUM_PHASES; i++)
+    {
+        debug_main_loop_current_usec[i] = 0;
+    }
+    debug_main_loop_slowest_callback_usec = 0;
+    debug_main_loop_slowest_callback[0] = '\0';
+}
+
+/*
+ * Resets histograms and stalls of main loop.
+ */
+
+void
+debug_main_loop_reset ()
+{
+    memset (debug_main_loop_histograms, 0, sizeof (debug_main_loop_histograms));
+    debug_main_loop_stalls = 0;
+    debug_main_loop_last_stall = 0;
+    debug_main_loop_last_stall_usec = 0;
+    debug_main_loop_last_stall_callback[0] = '\0';
+    debug_main_loop_last_stall_callback_usec = 0;
+}
+
+/*
+ * Displays histograms and stalls of main loop.
+ */
+
+void
+debug_main_loop_display ()
+{
+    struct t_debug_histogram *ptr_histogram;
+    char str_buckets[1024], str_bucket[64];
+    int i, j;
+
+    gui_chat_printf (NULL, "");
+    gui_chat_printf (NULL,
+                     _("Main loop (iterations: %d, stalls: %d, stall "
+                       "threshold: %d ms):"),
+                     debug_main_loop_histograms[DEBUG_MAIN_LOOP_PHASE_ITERATION].count,
+                     debug_main_loop_stalls,
+                     debug_main_loop_stall_threshold);
+    for (i = 0; i < DEBUG_MAIN_LOOP_NUM_PHASES; i++)
+    {
+        ptr_histogram = &debug_main_loop_histograms[i];
+        gui_chat_printf (NULL,
+                         "  %-9s: avg: %lld us, max: %lld us",
+                         debug_main_loop_phase_string[i],
+                         (ptr_histogram->count > 0) ?
+                         ptr_histogram->total_usec / ptr_histogram->count : 0,
+                         ptr_histogram->max_usec);
+        str_buckets[0] = '\0';
+        for (j = 0; j < DEBUG_HISTOGRAM_SIZE; j++)
+        {
+            if (ptr_histogram->buckets[j] == 0)
+                continue;
+            if (j < DEBUG_HISTOGRAM_SIZE - 1)
+            {
+                snprintf (str_bucket, sizeof (str_bucket), "%s<%lld: %d",
+                          (str_buckets[0]) ? ", " : "",
+                          1LL << (j + 1),
+                          ptr_histogram->buckets[j]);
+            }
+            else
+            {
+                snprintf (str_bucket, sizeof (str_bucket), "%s>=%lld: %d",
+                          (str_buckets[0]) ? ", " : "",
+                          1LL << j,
+                          ptr_histogram->buckets[j]);
+            }
+            strncat (str_buckets, str_bucket,
+                     sizeof (str_buckets) - strlen (str_buckets) - 1);
+        }
+        if (str_buckets[0])
+            gui_chat_printf (NULL, "             us: %s", str_buckets);
+    }
+    if (debug_main_loop_stalls > 0)
+    {
+        gui_chat_printf (NULL,
+                         _("  last stall: %s, %lld ms, slowest callback: "
+                           "%lld ms (%s)"),
+                         util_get_time_string (&debug_main_loop_last_stall),
+                         debug_main_loop_last_stall_usec / 1000,
+                         debug_main_loop_last_stall_callback_usec / 1000,
+                         debug_main_loop_last_stall_callback);
+    }
+}
+
+/*
+ * Adds histograms of main loop in an infolist (one item by phase).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+debug_main_loop_add_to_infolist (struct t_infolist *infolist)
+{
+    struct t_infolist_item *ptr_item;
+    struct t_debug_histogram *ptr_histogram;
+    char name[32];
+    int i, j;
+
+    if (!infolist)
+        return 0;
+
+    for (i = 0; i < DEBUG_MAIN_LOOP_NUM_PHASES; i++)
+    {
+        ptr_histogram = &debug_main_loop_histograms[i];
+
+        ptr_item = infolist_new_item (infolist);
+        if (!ptr_item)
+            return 0;
+
+        if (!infolist_new_var_string (ptr_item, "phase", debug_main_loop_phase_string[i]))
+            return 0;
+        if (!infolist_new_var_integer (ptr_item, "count", ptr_histogram->count))
+            return 0;
+        if (!infolist_new_var_integer (ptr_item, "total_ms", (int)(ptr_histogram->total_usec / 1000)))
+            return 0;
+        if (!infolist_new_var_integer (ptr_item, "avg_usec",
+                                       (ptr_histogram->count > 0) ?
+                                       (int)(ptr_histogram->total_usec / ptr_histogram->count) : 0))
+            return 0;
+        if (!infolist_new_var_integer (ptr_item, "max_usec", (int)ptr_histogram->max_usec))
+            return 0;
+        for (j = 0; j < DEBUG_HISTOGRAM_SIZE; j++)
+        {
+            snprintf (name, sizeof (name), "bucket_%02d", j);
+            if (!infolist_new_var_integer (ptr_item, name, ptr_histogram->buckets[j]))
+                return 0;
+        }
+        if (!infolist_new_var_integer (ptr_item, "stall_threshold", debug_main_loop_stall_threshold))
+            return 0;
+        if (!infolist_new_var_integer (ptr_item, "stalls", debug_main_loop_stalls))
+            return 0;
+        if (!infolist_new_var_time (ptr_item, "last_stall", debug_main_loop_last_stall))
+            return 0;
+        if (!infolist_new_var_integer (ptr_item, "last_stall_ms", (int)(debug_main_loop_last_stall_usec / 1000)))
+            return 0;
+        if (!infolist_new_var_string (ptr_item, "last_stall_callback", debug_main_loop_last_stall_callback))
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Adds an event in trace ring buffer (oldest event is overwritten when the
+ * buffer is full).
+ *
+ * If tv is NULL, current time is used.
+ */
+
+void
+debug_trace_add (char phase, const char *category, const char *name,
+                 const char *detail, struct timeval *tv)
+{
+    struct t_debug_trace_event *ptr_event;
+    struct timeval tv_now;
+
+    if (!tv)
+    {
+        gettimeofday (&tv_now, NULL);
+        tv = &tv_now;
+    }
+
+    ptr_event = &debug_trace_events[debug_trace_index];
+    ptr_event->time_usec = util_timeval_diff_usec (&debug_trace_start_time,
+                                                   tv);
+    ptr_event->phase = phase;
+    snprintf (ptr_event->category, sizeof (ptr_event->category),
+              "%s", (category) ? category : "");
+    snprintf (ptr_event->name, sizeof (ptr_event->name),
+              "%s", (name) ? name : "");
+    snprintf (ptr_event->detail, sizeof (ptr_event->detail),
+              "%s", (detail) ? detail : "");
+
+    debug_trace_index = (debug_trace_index + 1) % DEBUG_TRACE_MAX_EVENTS;
+    if (debug_trace_count < DEBUG_TRACE_MAX_EVENTS)
+        debug_trace_count++;
+}
+
+/*
+ * Adds a "begin" event in trace (if trace is active).
+ *
+ * Argument "detail" is optional (for example a buffer name).
+ */
+
+void
+debug_trace_begin (const char *category, const char *name, const char *detail)
+{
+    if (debug_trace_active)
+        debug_trace_add ('B', category, name, detail, NULL);
+}
+
+/*
+ * Adds an "end" event in trace (if trace is active): it ends the last event
+ * begun.
+ */
+
+void
+debug_trace_end ()
+{
+    if (debug_trace_active)
+        debug_trace_add ('E', NULL, NULL, NULL, NULL);
+}
+
+/*
+ * Adds a "begin" event for the callback of a hook in trace (if trace is
+ * active).
+ *
+ * Argument "name" is optional (for example a signal name), if NULL, the name
+ * is built with hook data (command, signal, modifier, ...).
+ */
+
+void
+debug_trace_hook_begin (struct t_hook *hook, const char *name)
+{
+    char str_name[128], str_detail[32];
+    const char *ptr_detail;
+
+    if (!debug_trace_active)
+        return;
+
+    ptr_detail = name;
+    if (!ptr_detail)
+    {
+        switch (hook->type)
+        {
+            case HOOK_TYPE_COMMAND:
+                ptr_detail = HOOK_COMMAND(hook, command);
+                break;
+            case HOOK_TYPE_COMMAND_RUN:
+                ptr_detail = HOOK_COMMAND_RUN(hook, command);
+                break;
+            case HOOK_TYPE_TIMER:
+                snprintf (str_detail, sizeof (str_detail),
+                          "%ld", HOOK_TIMER(hook, interval));
+                ptr_detail = str_detail;
+                break;
+            case HOOK_TYPE_FD:
+                snprintf (str_detail, sizeof (str_detail),
+                          "%d", HOOK_FD(hook, fd));
+                ptr_detail = str_detail;
+                break;
+            case HOOK_TYPE_PROCESS:
+                ptr_detail = HOOK_PROCESS(hook, command);
+                break;
+            case HOOK_TYPE_SIGNAL:
+                ptr_detail = HOOK_SIGNAL(hook, signal);
+                break;
+            case HOOK_TYPE_HSIGNAL:
+                ptr_detail = HOOK_HSIGNAL(hook, signal);
+                break;
+            case HOOK_TYPE_CONFIG:
+                ptr_detail = HOOK_CONFIG(hook, option);
+                break;
+            case HOOK_TYPE_MODIFIER:
+                ptr_detail = HOOK_MODIFIER(hook, modifier);
+                break;
+            default:
+                break;
+        }
+    }
+
+    snprintf (str_name, sizeof (str_name), "%s%s%s",
+              hook_type_string[hook->type],
+              (ptr_detail) ? " " : "",
+              (ptr_detail) ? ptr_detail : "");
+
+    debug_trace_add ('B', plugin_get_name (hook->plugin), str_name, NULL,
+                     NULL);
+}
+
+/*
+ * Adds an event sent by a plugin in trace (if trace is active).
+ */
+
+void
+debug_trace_plugin_event (struct t_weechat_plugin *plugin, const char *name,
+                          int begin)
+{
+    if (!debug_trace_active)
+        return;
+
+    if (begin)
+        debug_trace_add ('B', plugin_get_name (plugin), name, NULL, NULL);
+    else
+        debug_trace_add ('E', NULL, NULL, NULL, NULL);
+}
+
+/*
+ * Starts recording of events in trace.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (trace already active, not enough memory)
+ */
+
+int
+debug_trace_start (const char *filename)
+{
+    char *filename2;
+    int length;
+
+    if (debug_trace_active || !filename || !filename[0])
+        return 0;
+
+    debug_trace_events = malloc (DEBUG_TRACE_MAX_EVENTS *
+                                 sizeof (*debug_trace_events));
+    if (!debug_trace_events)
+        return 0;
+
+    filename2 = string_expand_home (filename);
+    if (filename2 && (filename2[0] != '/'))
+    {
+        /* relative path: file is in WeeChat home */
+        length = strlen (weechat_home) + 1 + strlen (filename2) + 1;
+        debug_trace_filename = malloc (length);
+        if (debug_trace_filename)
+        {
+            snprintf (debug_trace_filename, length, "%s/%s",
+                      weechat_home, filename2);
+        }
+        free (filename2);
+    }
+    else
+        debug_trace_filename = filename2;
+
+    if (!debug_trace_filename)
+    {
+        free (debug_trace_events);
+        debug_trace_events = NULL;
+        return 0;
+    }
+
+    debug_trace_index = 0;
+    debug_trace_count = 0;
+    gettimeofday (&debug_trace_start_time, NULL);
+    debug_trace_active = 1;
+
+    return 1;
+}
+
+/*
+ * Writes a string in a JSON file (with double quotes around the string).
+ */
+
+void
+debug_trace_write_json_string (FILE *file, const char *string)
+{
+    const unsigned char *ptr_string;
+
+    fputc ('"', file);
+    for (ptr_string = (const unsigned char *)string; ptr_string[0];
+         ptr_string++)
+    {
+        if ((ptr_string[0] == '"') || (ptr_string[0] == '\\'))
+            fprintf (file, "\\%c", ptr_string[0]);
+        else if (ptr_string[0] < 32)
+            fprintf (file, "\\u%04x", ptr_string[0]);
+        else
+            fputc (ptr_string[0], file);
+    }
+    fputc ('"', file);
+}
+
+/*
+ * Writes an event in trace file (Chrome trace event format).
+ */
+
+void
+debug_trace_write_event (FILE *file, int *first_event, char phase,
+                         long long time_usec, const char *category,
+                         const char *name, const char *detail)
+{
+    fprintf (file, "%s\n{\"ph\":\"%c\",\"ts\":%lld,\"pid\":%d,\"tid\":1",
+             (*first_event) ? "" : ",", phase, time_usec, (int)getpid ());
+    if (phase == 'B')
+    {
+        fprintf (file, ",\"cat\":");
+        debug_trace_write_json_string (file, category);
+        fprintf (file, ",\"name\":");
+        debug_trace_write_json_string (file, name);
+        if (detail && detail[0])
+        {
+            fprintf (file, ",\"args\":{\"detail\":");
+            debug_trace_write_json_string (file, detail);
+            fputc ('}', file);
+        }
+    }
+    fputc ('}', file);
+    *first_event = 0;
+}
+
+/*
+ * Stops recording of events and writes them in trace file, using Chrome trace
+ * event format (JSON), which can be loaded in "chrome://tracing" or
+ * Perfetto UI.
+ *
+ * Returns number of events written, -1 if error.
+ */
+
+int
+debug_trace_stop ()
+{
+    struct t_debug_trace_event *ptr_event;
+    struct timeval tv_now;
+    FILE *file;
+    int i, first_event, depth, num_events;
+    long long time_usec;
+
+    if (!debug_trace_active)
+        return -1;
+
+    debug_trace_active = 0;
+
+    gettimeofday (&tv_now, NULL);
+    time_usec = util_timeval_diff_usec (&debug_trace_start_time, &tv_now);
+
+    num_events = -1;
+    file = fopen (debug_trace_filename, "w");
+    if (file)
+    {
+        fprintf (file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+        first_event = 1;
+        depth = 0;
+        num_events = 0;
+        for (i = 0; i < debug_trace_count; i++)
+        {
+            ptr_event = &debug_trace_events[
+                (debug_trace_index - debug_trace_count + i
+                 + DEBUG_TRACE_MAX_EVENTS) % DEBUG_TRACE_MAX_EVENTS];
+            if (ptr_event->phase == 'E')
+            {
+                /* skip end of events which have been overwritten in buffer */
+                if (depth == 0)
+                    continue;
+                depth--;
+            }
+            else
+                depth++;
+            debug_trace_write_event (file, &first_event, ptr_event->phase,
+                                     ptr_event->time_usec,
+                                     ptr_event->category, ptr_event->name,
+                                     ptr_event->detail);
+            num_events++;
+        }
+        /* end events still running (for example the command /debug itself) */
+        while (depth > 0)
+        {
+            debug_trace_write_event (file, &first_event, 'E', time_usec,
+                                     NULL, NULL, NULL);
+            num_events++;
+            depth--;
+        }
+        fprintf (file, "\n]}\n");
+        fclose (file);
+    }
+
+    free (debug_trace_events);
+    debug_trace_events = NULL;
+    free (debug_trace_filename);
+    debug_trace_filename = NULL;
+    debug_trace_index = 0;
+    debug_trace_count = 0;
+
+    return num_events;
+}
+
 /*
  * Hooks signals for debug.
  */
@@ -21,6 +21,52 @@
 #define WEECHAT_DEBUG_H 1
 
 struct t_gui_window_tree;
+struct t_hook;
+struct t_weechat_plugin;
+struct t_infolist;
+struct timeval;
+
+enum t_debug_main_loop_phase
+{
+    DEBUG_MAIN_LOOP_PHASE_TIMERS = 0,  /* hook timers                       */
+    DEBUG_MAIN_LOOP_PHASE_REFRESHS,    /* refresh of screen                 */
+    DEBUG_MAIN_LOOP_PHASE_FD,          /* hook fd (keyboard, network, ...)  */
+    DEBUG_MAIN_LOOP_PHASE_ITERATION,   /* whole iteration (without wait)    */
+    /* number of main loop phases */
+    DEBUG_MAIN_LOOP_NUM_PHASES,
+};
+
+/*
+ * histogram of durations: bucket 0 is for durations < 2 microseconds, bucket
+ * N (N > 0) for durations in [2^N, 2^(N+1)[ microseconds, last bucket is for
+ * all durations >= 2^(SIZE-1) microseconds
+ */
+#define DEBUG_HISTOGRAM_SIZE 24
+
+struct t_debug_histogram
+{
+    int count;                         /* number of values added            */
+    long long total_usec;              /* sum of durations                  */
+    long long max_usec;                /* max duration                      */
+    int buckets[DEBUG_HISTOGRAM_SIZE]; /* number of values by bucket        */
+};
+
+/* max number of events in trace (ring buffer) */
+#define DEBUG_TRACE_MAX_EVENTS 65536
+
+struct t_debug_trace_event
+{
+    long long time_usec;               /* time since start of trace         */
+    char phase;                        /* 'B' (begin) or 'E' (end)          */
+    char category[15];                 /* "core", "gui" or plugin name      */
+    char name[48];                     /* name of event (empty for end)     */
+    char detail[40];                   /* detail on event (optional)        */
+};
+
+extern char *debug_main_loop_phase_string[];
+extern int debug_main_loop_stall_threshold;
+extern int debug_trace_active;
+extern char *debug_trace_filename;
 
 extern void debug_sigsegv ();
 extern void debug_windows_tree ();
@@ -29,6 +75,29 @@ extern void debug_hdata ();
 extern void debug_hooks ();
 extern void debug_infolists ();
 extern void debug_directories ();
+extern void debug_main_loop_phase_start (enum t_debug_main_loop_phase phase,
+                                         struct timeval *tv_phase_start);
+extern void debug_main_loop_phase_end (enum t_debug_main_loop_phase phase,
+                                       struct timeval *tv_phase_start);
+extern void debug_main_loop_callback_end (int hook_type,
+                                          struct t_weechat_plugin *plugin,
+                                          int hook_detail,
+                                          struct timeval *tv_callback_start);
+extern void debug_main_loop_iteration_end ();
+extern void debug_main_loop_reset ();
+extern void debug_main_loop_display ();
+extern int debug_main_loop_add_to_infolist (struct t_infolist *infolist);
+extern void debug_trace_add (char phase, const char *category,
+                             const char *name, const char *detail,
+                             struct timeval *tv);
+extern void debug_trace_begin (const char *category, const char *name,
+                               const char *detail);
+extern void debug_trace_end ();
+extern void debug_trace_hook_begin (struct t_hook *hook, const char *name);
+extern void debug_trace_plugin_event (struct t_weechat_plugin *plugin,
+                                      const char *name, int begin);
+extern int debug_trace_start (const char *filename);
+extern int debug_trace_stop ();
 extern void debug_init ();
 
 #endif /* WEECHAT_DEBUG_H */
@@ -32,6 +32,7 @@
 #include "wee-infolist.h"
 #include "wee-list.h"
 #include "wee-log.h"
+#include "wee-memory.h"
 #include "wee-string.h"
 #include "../plugins/plugin.h"
 
@@ -235,6 +236,10 @@ hashtable_new (int size,
 
         new_hashtable->callback_free_key = NULL;
         new_hashtable->callback_free_value = NULL;
+
+        memory_add (NULL, MEMORY_CATEGORY_HASHTABLES,
+                    sizeof (*new_hashtable) + (size * sizeof (*(new_hashtable->htable))),
+                    1);
     }
     return new_hashtable;
 }
@@ -296,6 +301,17 @@ hashtable_alloc_type (enum t_hashtable_type type,
     }
 }
 
+/*
+ * Returns size of a key or value allocated by hashtable (0 for a pointer,
+ * which is not allocated).
+ */
+
+int
+hashtable_alloc_size (enum t_hashtable_type type, void *pointer, int size)
+{
+    return ((type == HASHTABLE_POINTER) || !pointer) ? 0 : size;
+}
+
 /*
  * Frees space used by a key.
  */
@@ -399,10 +415,20 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
     /* replace value if item is already in hashtable */
     if (ptr_item && (hashtable->callback_keycmp (hashtable, key, ptr_item->key) == 0))
     {
+        memory_add (NULL, MEMORY_CATEGORY_HASHTABLES,
+                    -1 * hashtable_alloc_size (hashtable->type_values,
+                                               ptr_item->value,
+                                               ptr_item->value_size),
+                    0);
         hashtable_free_value (hashtable, ptr_item);
         hashtable_alloc_type (hashtable->type_values,
                               value, value_size,
                               &ptr_item->value, &ptr_item->value_size);
+        memory_add (NULL, MEMORY_CATEGORY_HASHTABLES,
+                    hashtable_alloc_size (hashtable->type_values,
+                                          ptr_item->value,
+                                          ptr_item->value_size),
+                    0);
         return ptr_item;
     }
 
@@ -441,6 +467,14 @@ hashtable_set_with_size (struct t_hashtable *hashtable,
 
     hashtable->items_count++;
 
+    memory_add (NULL, MEMORY_CATEGORY_HASHTABLES,
+                sizeof (*new_item)
+                + hashtable_alloc_size (hashtable->type_keys,
+                                        new_item->key, new_item->key_size)
+                + hashtable_alloc_size (hashtable->type_values,
+                                        new_item->value, new_item->value_size),
+                1);
+
     return new_item;
 }
 
@@ -1114,6 +1148,16 @@ hashtable_remove_item (struct t_hashtable *hashtable,
     if (!hashtable || !item)
         return;
 
+    memory_add (NULL, MEMORY_CATEGORY_HASHTABLES,
+                -1 * (long long)(sizeof (*item)
+                                 + hashtable_alloc_size (hashtable->type_keys,
+                                                         item->key,
+                                                         item->key_size)
+                                 + hashtable_alloc_size (hashtable->type_values,
+                                                         item->value,
+                                                         item->value_size)),
+                -1);
+
     /* free key and value */
     hashtable_free_value (hashtable, item);
     hashtable_free_key (hashtable, item);
@@ -1181,6 +1225,10 @@ hashtable_free (struct t_hashtable *hashtable)
         return;
 
     hashtable_remove_all (hashtable);
+    memory_add (NULL, MEMORY_CATEGORY_HASHTABLES,
+                -1 * (long long)(sizeof (*hashtable)
+                                 + (hashtable->size * sizeof (*(hashtable->htable)))),
+                -1);
     free (hashtable->htable);
     if (hashtable->keys_values)
         free (hashtable->keys_values);
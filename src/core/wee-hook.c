@@ -26,6 +26,7 @@
 
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/time.h>
@@ -35,9 +36,17 @@
 #include <signal.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <spawn.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <sys/prctl.h>
+#include <sys/timerfd.h>
+#endif
 
 #include "weechat.h"
 #include "wee-hook.h"
+#include "wee-config.h"
+#include "wee-debug.h"
 #include "wee-hashtable.h"
 #include "wee-hdata.h"
 #include "wee-infolist.h"
@@ -45,6 +54,7 @@
 #include "wee-log.h"
 #include "wee-network.h"
 #include "wee-string.h"
+#include "wee-thread.h"
 #include "wee-url.h"
 #include "wee-utf8.h"
 #include "wee-util.h"
@@ -60,18 +70,28 @@
 #include "../plugins/plugin.h"
 
 
+extern char **environ;
+
 char *hook_type_string[HOOK_NUM_TYPES] =
 { "command", "command_run", "timer", "fd", "process", "connect", "print",
   "signal", "hsignal", "config", "completion", "modifier",
-  "info", "info_hashtable", "infolist", "hdata", "focus" };
+  "info", "info_hashtable", "infolist", "hdata", "focus", "thread" };
 struct t_hook *weechat_hooks[HOOK_NUM_TYPES];     /* list of hooks          */
 struct t_hook *last_weechat_hook[HOOK_NUM_TYPES]; /* last hook              */
 int hook_exec_recursion = 0;           /* 1 when a hook is executed         */
-time_t hook_last_system_time = 0;      /* used to detect system clock skew  */
+long long hook_timer_clock_offset = 0; /* system clock - monotonic clock   */
+                                       /* (used to detect clock changes)    */
+int hook_timer_clock_watch = -1;       /* watch of system clock changes:    */
+                                       /* -1=not started, 0=not available,  */
+                                       /* 1=watching (with timerfd)         */
+int hook_timer_clock_fd = -1;          /* timerfd used to watch clock       */
+int hook_timer_slack_applied = 0;      /* timer slack applied on process    */
 int real_delete_pending = 0;           /* 1 if some hooks must be deleted   */
 
 
 void hook_process_run (struct t_hook *hook_process);
+long long hook_timer_get_clock_offset ();
+void hook_timer_clock_watch_start ();
 
 
 /*
@@ -88,7 +108,7 @@ hook_init ()
         weechat_hooks[type] = NULL;
         last_weechat_hook[type] = NULL;
     }
-    hook_last_system_time = time (NULL);
+    hook_timer_clock_offset = hook_timer_get_clock_offset ();
 }
 
 /*
@@ -774,8 +794,10 @@ hook_command_exec (struct t_gui_buffer *buffer, int any_plugin,
             {
                 /* execute the command! */
                 ptr_hook->running++;
+                debug_trace_hook_begin (ptr_hook, NULL);
                 rc = (int) (HOOK_COMMAND(ptr_hook, callback))
                     (ptr_hook->callback_data, buffer, argc, argv, argv_eol);
+                debug_trace_end ();
                 ptr_hook->running--;
                 if (rc == WEECHAT_RC_ERROR)
                     rc = 0;
@@ -885,9 +907,11 @@ hook_command_run_exec (struct t_gui_buffer *buffer, const char *command)
             if (hook_matching)
             {
                 ptr_hook->running = 1;
+                debug_trace_hook_begin (ptr_hook, NULL);
                 rc = (HOOK_COMMAND_RUN(ptr_hook, callback)) (ptr_hook->callback_data,
                                                              buffer,
                                                              ptr_command);
+                debug_trace_end ();
                 ptr_hook->running = 0;
                 if (rc == WEECHAT_RC_OK_EAT)
                 {
@@ -907,8 +931,30 @@ hook_command_run_exec (struct t_gui_buffer *buffer, const char *command)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Returns difference between system clock and monotonic clock (in
+ * microseconds).
+ *
+ * This difference changes only when system clock is changed (by user, NTP
+ * daemon, ...).
+ */
+
+long long
+hook_timer_get_clock_offset ()
+{
+    struct timeval tv_now, tv_monotonic;
+
+    gettimeofday (&tv_now, NULL);
+    util_get_time_monotonic (&tv_monotonic);
+
+    return util_timeval_diff_usec (&tv_monotonic, &tv_now);
+}
+
 /*
  * Initializes a timer hook.
+ *
+ * Alignment on second is computed with system clock, then the date of next
+ * call is converted to monotonic clock (used for all timers).
  */
 
 void
@@ -916,9 +962,14 @@ hook_timer_init (struct t_hook *hook)
 {
     time_t time_now;
     struct tm *local_time, *gm_time;
+    struct timeval tv_now, tv_monotonic;
     int local_hour, gm_hour, diff_hour;
+    long long diff_usec;
 
     gettimeofday (&HOOK_TIMER(hook, last_exec), NULL);
+    util_get_time_monotonic (&tv_monotonic);
+    tv_now.tv_sec = HOOK_TIMER(hook, last_exec).tv_sec;
+    tv_now.tv_usec = HOOK_TIMER(hook, last_exec).tv_usec;
     time_now = time (NULL);
     local_time = localtime(&time_now);
     local_hour = local_time->tm_hour;
@@ -952,14 +1003,28 @@ hook_timer_init (struct t_hook *hook)
             HOOK_TIMER(hook, last_exec).tv_sec -
             ((HOOK_TIMER(hook, last_exec).tv_sec + (diff_hour * 3600)) %
              HOOK_TIMER(hook, align_second));
+
+        /* watch changes of system clock, to keep timer aligned */
+        if (hook_timer_clock_watch < 0)
+            hook_timer_clock_watch_start ();
     }
 
-    /* init next call with date of last call */
+    /* init next call with date of last call + interval (system clock) */
     HOOK_TIMER(hook, next_exec).tv_sec = HOOK_TIMER(hook, last_exec).tv_sec;
     HOOK_TIMER(hook, next_exec).tv_usec = HOOK_TIMER(hook, last_exec).tv_usec;
-
-    /* add interval to next call date */
     util_timeval_add (&HOOK_TIMER(hook, next_exec), HOOK_TIMER(hook, interval));
+
+    /* convert next call date to monotonic clock */
+    diff_usec = util_timeval_diff_usec (&tv_now, &HOOK_TIMER(hook, next_exec))
+        + tv_monotonic.tv_usec;
+    HOOK_TIMER(hook, next_exec).tv_sec = tv_monotonic.tv_sec
+        + (diff_usec / 1000000);
+    HOOK_TIMER(hook, next_exec).tv_usec = diff_usec % 1000000;
+    if (HOOK_TIMER(hook, next_exec).tv_usec < 0)
+    {
+        HOOK_TIMER(hook, next_exec).tv_sec--;
+        HOOK_TIMER(hook, next_exec).tv_usec += 1000000;
+    }
 }
 
 /*
@@ -1006,94 +1071,245 @@ hook_timer (struct t_weechat_plugin *plugin, long interval, int align_second,
 }
 
 /*
- * Checks if system clock is older than previous call to this function (that
- * means new time is lower than in past). If yes, adjusts all timers to current
- * time.
+ * Checks if system clock has changed since previous call to this function
+ * (difference with monotonic clock has changed). If yes, reinitializes all
+ * timers aligned on a second.
+ *
+ * Other timers are not affected by changes of system clock, because they are
+ * using the monotonic clock.
  */
 
 void
 hook_timer_check_system_clock ()
 {
-    time_t now;
+    long long offset, diff_usec;
     long diff_time;
     struct t_hook *ptr_hook;
 
-    now = time (NULL);
+    offset = hook_timer_get_clock_offset ();
 
     /*
-     * check if difference with previous time is more than 10 seconds:
-     * if it is, then consider it's clock skew and reinitialize all timers
+     * check if difference with previous offset is at least 1 second:
+     * if it is, then consider the system clock has been changed and
+     * reinitialize timers aligned on a second
      */
-    diff_time = now - hook_last_system_time;
-    if ((diff_time <= -10) || (diff_time >= 10))
+    diff_usec = offset - hook_timer_clock_offset;
+    if ((diff_usec <= -1000000) || (diff_usec >= 1000000))
     {
+        diff_time = (long)(diff_usec / 1000000);
         if (weechat_debug_core >= 1)
         {
             gui_chat_printf (NULL,
                              _("System clock skew detected (%+ld seconds), "
-                               "reinitializing all timers"),
+                               "reinitializing timers aligned on a second"),
                              diff_time);
         }
 
-        /* reinitialize all timers */
+        /* reinitialize timers aligned on a second */
         for (ptr_hook = weechat_hooks[HOOK_TYPE_TIMER]; ptr_hook;
              ptr_hook = ptr_hook->next_hook)
         {
-            if (!ptr_hook->deleted)
+            if (!ptr_hook->deleted
+                && (HOOK_TIMER(ptr_hook, align_second) > 0))
+            {
                 hook_timer_init (ptr_hook);
+            }
         }
     }
 
-    hook_last_system_time = now;
+    hook_timer_clock_offset = offset;
 }
 
 /*
- * Sets time until next timeout.
+ * Arms the timerfd used to watch changes of system clock.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+hook_timer_clock_watch_arm ()
+{
+#if defined(__linux__) && defined(TFD_TIMER_CANCEL_ON_SET)
+    struct itimerspec its;
+
+    /*
+     * the timer itself is never useful (it expires in one year), the read on
+     * timerfd is cancelled (ECANCELED) as soon as system clock is changed
+     */
+    memset (&its, 0, sizeof (its));
+    its.it_value.tv_sec = time (NULL) + (365 * 24 * 3600);
+    return (timerfd_settime (hook_timer_clock_fd,
+                             TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                             &its, NULL) == 0) ? 1 : 0;
+#else
+    return 0;
+#endif /* defined(__linux__) && defined(TFD_TIMER_CANCEL_ON_SET) */
+}
+
+/*
+ * Callback for timerfd used to watch changes of system clock.
+ */
+
+int
+hook_timer_clock_watch_cb (void *data, int fd)
+{
+    uint64_t expirations;
+
+    /* make C compiler happy */
+    (void) data;
+
+    /* read fails with ECANCELED if system clock has changed */
+    if (read (fd, &expirations, sizeof (expirations)) < 0)
+    {
+        if ((errno == EAGAIN) || (errno == EINTR))
+            return WEECHAT_RC_OK;
+    }
+
+    hook_timer_check_system_clock ();
+
+    if (!hook_timer_clock_watch_arm ())
+        hook_timer_clock_watch = 0;
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Starts watch of changes of system clock (only needed for timers aligned on
+ * a second).
+ *
+ * On Linux, a timerfd is used, so that WeeChat is woken up only when the
+ * system clock is changed. On other systems (or if timerfd is not available),
+ * the system clock is checked at least every 2 seconds (see function
+ * hook_timer_time_to_next).
  */
 
 void
+hook_timer_clock_watch_start ()
+{
+    hook_timer_clock_watch = 0;
+
+#if defined(__linux__) && defined(TFD_TIMER_CANCEL_ON_SET)
+    hook_timer_clock_fd = timerfd_create (CLOCK_REALTIME,
+                                          TFD_NONBLOCK | TFD_CLOEXEC);
+    if (hook_timer_clock_fd < 0)
+        return;
+    if (!hook_timer_clock_watch_arm ()
+        || !hook_fd (NULL, hook_timer_clock_fd, 1, 0, 0,
+                     &hook_timer_clock_watch_cb, NULL))
+    {
+        close (hook_timer_clock_fd);
+        hook_timer_clock_fd = -1;
+        return;
+    }
+    hook_timer_clock_watch = 1;
+#endif /* defined(__linux__) && defined(TFD_TIMER_CANCEL_ON_SET) */
+}
+
+/*
+ * Applies timer slack (option weechat.plugin.timer_slack) on the process, so
+ * that the kernel can coalesce wakeups of WeeChat with other wakeups.
+ */
+
+void
+hook_timer_apply_slack (int slack)
+{
+    if (slack == hook_timer_slack_applied)
+        return;
+
+#if defined(__linux__) && defined(PR_SET_TIMERSLACK)
+    /* 0 restores the default timer slack of the process */
+    (void) prctl (PR_SET_TIMERSLACK, (unsigned long)slack * 1000 * 1000,
+                  0, 0, 0);
+#endif /* defined(__linux__) && defined(PR_SET_TIMERSLACK) */
+
+    hook_timer_slack_applied = slack;
+}
+
+/*
+ * Sets time until next timeout.
+ *
+ * Each timer can be delayed by the timer slack (option
+ * weechat.plugin.timer_slack, at most a quarter of timer interval), so that
+ * timers with close deadlines are executed in a single wakeup.
+ *
+ * Returns:
+ *   1: timeout is set in tv_timeout
+ *   0: no timeout (wait until some activity on file descriptors or a signal)
+ */
+
+int
 hook_timer_time_to_next (struct timeval *tv_timeout)
 {
     struct t_hook *ptr_hook;
-    int found;
-    struct timeval tv_now;
+    int found, check_clock, slack;
+    long timer_slack;
+    struct timeval tv_now, tv_deadline;
     long diff_usec;
 
     hook_timer_check_system_clock ();
 
+    slack = CONFIG_INTEGER(config_plugin_timer_slack);
+    hook_timer_apply_slack (slack);
+
     found = 0;
+    check_clock = 0;
     tv_timeout->tv_sec = 0;
     tv_timeout->tv_usec = 0;
 
     for (ptr_hook = weechat_hooks[HOOK_TYPE_TIMER]; ptr_hook;
          ptr_hook = ptr_hook->next_hook)
     {
-        if (!ptr_hook->deleted
-            && (!found
-                || (util_timeval_cmp (&HOOK_TIMER(ptr_hook, next_exec), tv_timeout) < 0)))
+        if (ptr_hook->deleted)
+            continue;
+        if (HOOK_TIMER(ptr_hook, align_second) > 0)
+            check_clock = 1;
+        tv_deadline.tv_sec = HOOK_TIMER(ptr_hook, next_exec).tv_sec;
+        tv_deadline.tv_usec = HOOK_TIMER(ptr_hook, next_exec).tv_usec;
+        if (slack > 0)
+        {
+            timer_slack = HOOK_TIMER(ptr_hook, interval) / 4;
+            if (timer_slack > slack)
+                timer_slack = slack;
+            util_timeval_add (&tv_deadline, timer_slack);
+        }
+        if (!found || (util_timeval_cmp (&tv_deadline, tv_timeout) < 0))
         {
             found = 1;
-            tv_timeout->tv_sec = HOOK_TIMER(ptr_hook, next_exec).tv_sec;
-            tv_timeout->tv_usec = HOOK_TIMER(ptr_hook, next_exec).tv_usec;
+            tv_timeout->tv_sec = tv_deadline.tv_sec;
+            tv_timeout->tv_usec = tv_deadline.tv_usec;
         }
     }
 
-    /* no timeout found, return 2 seconds by default */
+    /*
+     * if system clock can not be watched with a timerfd, we ensure there's a
+     * call to timers every 2 seconds max (only if some timers are aligned on
+     * a second)
+     */
+    if (check_clock && (hook_timer_clock_watch != 1))
+        check_clock = 2;
+
+    /* no timeout found */
     if (!found)
     {
-        tv_timeout->tv_sec = 2;
-        tv_timeout->tv_usec = 0;
-        return;
+        if (check_clock == 2)
+        {
+            tv_timeout->tv_sec = 2;
+            tv_timeout->tv_usec = 0;
+            return 1;
+        }
+        return 0;
     }
 
-    gettimeofday (&tv_now, NULL);
+    util_get_time_monotonic (&tv_now);
 
     /* next timeout is past date! */
     if (util_timeval_cmp (tv_timeout, &tv_now) < 0)
     {
         tv_timeout->tv_sec = 0;
         tv_timeout->tv_usec = 0;
-        return;
+        return 1;
     }
 
     tv_timeout->tv_sec = tv_timeout->tv_sec - tv_now.tv_sec;
@@ -1106,15 +1322,13 @@ hook_timer_time_to_next (struct timeval *tv_timeout)
         tv_timeout->tv_usec = 1000000 + diff_usec;
     }
 
-    /*
-     * to detect clock skew, we ensure there's a call to timers every
-     * 2 seconds max
-     */
-    if (tv_timeout->tv_sec > 2)
+    if ((check_clock == 2) && (tv_timeout->tv_sec > 2))
     {
         tv_timeout->tv_sec = 2;
         tv_timeout->tv_usec = 0;
     }
+
+    return 1;
 }
 
 /*
@@ -1124,12 +1338,14 @@ hook_timer_time_to_next (struct timeval *tv_timeout)
 void
 hook_timer_exec ()
 {
-    struct timeval tv_time;
+    struct timeval tv_time, tv_now, tv_callback;
     struct t_hook *ptr_hook, *next_hook;
+    int interval;
 
     hook_timer_check_system_clock ();
 
-    gettimeofday (&tv_time, NULL);
+    util_get_time_monotonic (&tv_time);
+    gettimeofday (&tv_now, NULL);
 
     hook_exec_start ();
 
@@ -1144,15 +1360,21 @@ hook_timer_exec ()
                                   &tv_time) <= 0))
         {
             ptr_hook->running = 1;
+            interval = HOOK_TIMER(ptr_hook, interval);
+            gettimeofday (&tv_callback, NULL);
+            debug_trace_hook_begin (ptr_hook, NULL);
             (void) (HOOK_TIMER(ptr_hook, callback))
                 (ptr_hook->callback_data,
                  (HOOK_TIMER(ptr_hook, remaining_calls) > 0) ?
                   HOOK_TIMER(ptr_hook, remaining_calls) - 1 : -1);
+            debug_trace_end ();
+            debug_main_loop_callback_end (HOOK_TYPE_TIMER, ptr_hook->plugin,
+                                          interval, &tv_callback);
             ptr_hook->running = 0;
             if (!ptr_hook->deleted)
             {
-                HOOK_TIMER(ptr_hook, last_exec).tv_sec = tv_time.tv_sec;
-                HOOK_TIMER(ptr_hook, last_exec).tv_usec = tv_time.tv_usec;
+                HOOK_TIMER(ptr_hook, last_exec).tv_sec = tv_now.tv_sec;
+                HOOK_TIMER(ptr_hook, last_exec).tv_usec = tv_now.tv_usec;
 
                 util_timeval_add (&HOOK_TIMER(ptr_hook, next_exec),
                                   HOOK_TIMER(ptr_hook, interval));
@@ -1173,21 +1395,26 @@ hook_timer_exec ()
 }
 
 /*
- * Searches for a fd hook in list.
+ * Searches for a fd hook in list, catching at least one of the events in
+ * "flags" (so a fd can be hooked twice: for example once for read and once
+ * for write).
  *
  * Returns pointer to hook found, NULL if not found.
  */
 
 struct t_hook *
-hook_search_fd (int fd)
+hook_search_fd (int fd, int flags)
 {
     struct t_hook *ptr_hook;
 
     for (ptr_hook = weechat_hooks[HOOK_TYPE_FD]; ptr_hook;
          ptr_hook = ptr_hook->next_hook)
     {
-        if (!ptr_hook->deleted && (HOOK_FD(ptr_hook, fd) == fd))
+        if (!ptr_hook->deleted && (HOOK_FD(ptr_hook, fd) == fd)
+            && (HOOK_FD(ptr_hook, flags) & flags))
+        {
             return ptr_hook;
+        }
     }
 
     /* fd hook not found */
@@ -1207,8 +1434,17 @@ hook_fd (struct t_weechat_plugin *plugin, int fd, int flag_read,
 {
     struct t_hook *new_hook;
     struct t_hook_fd *new_hook_fd;
+    int flags;
 
-    if ((fd < 0) || hook_search_fd (fd) || !callback)
+    flags = 0;
+    if (flag_read)
+        flags |= HOOK_FD_FLAG_READ;
+    if (flag_write)
+        flags |= HOOK_FD_FLAG_WRITE;
+    if (flag_exception)
+        flags |= HOOK_FD_FLAG_EXCEPTION;
+
+    if ((fd < 0) || hook_search_fd (fd, flags) || !callback)
         return NULL;
 
     new_hook = malloc (sizeof (*new_hook));
@@ -1227,14 +1463,8 @@ hook_fd (struct t_weechat_plugin *plugin, int fd, int flag_read,
     new_hook->hook_data = new_hook_fd;
     new_hook_fd->callback = callback;
     new_hook_fd->fd = fd;
-    new_hook_fd->flags = 0;
+    new_hook_fd->flags = flags;
     new_hook_fd->error = 0;
-    if (flag_read)
-        new_hook_fd->flags |= HOOK_FD_FLAG_READ;
-    if (flag_write)
-        new_hook_fd->flags |= HOOK_FD_FLAG_WRITE;
-    if (flag_exception)
-        new_hook_fd->flags |= HOOK_FD_FLAG_EXCEPTION;
 
     hook_add_to_list (new_hook);
 
@@ -1307,7 +1537,9 @@ hook_fd_set (fd_set *read_fds, fd_set *write_fds, fd_set *exception_fds)
 void
 hook_fd_exec (fd_set *read_fds, fd_set *write_fds, fd_set *exception_fds)
 {
+    struct timeval tv_callback;
     struct t_hook *ptr_hook, *next_hook;
+    int fd;
 
     hook_exec_start ();
 
@@ -1326,8 +1558,13 @@ hook_fd_exec (fd_set *read_fds, fd_set *write_fds, fd_set *exception_fds)
                     && (FD_ISSET(HOOK_FD(ptr_hook, fd), exception_fds)))))
         {
             ptr_hook->running = 1;
-            (void) (HOOK_FD(ptr_hook, callback)) (ptr_hook->callback_data,
-                                                  HOOK_FD(ptr_hook, fd));
+            fd = HOOK_FD(ptr_hook, fd);
+            gettimeofday (&tv_callback, NULL);
+            debug_trace_hook_begin (ptr_hook, NULL);
+            (void) (HOOK_FD(ptr_hook, callback)) (ptr_hook->callback_data, fd);
+            debug_trace_end ();
+            debug_main_loop_callback_end (HOOK_TYPE_FD, ptr_hook->plugin, fd,
+                                          &tv_callback);
             ptr_hook->running = 0;
         }
 
@@ -1396,10 +1633,12 @@ hook_process_hashtable (struct t_weechat_plugin *plugin,
     new_hook_process->child_write[HOOK_PROCESS_STDOUT] = -1;
     new_hook_process->child_write[HOOK_PROCESS_STDERR] = -1;
     new_hook_process->child_pid = 0;
+    new_hook_process->child_pidfd = -1;
     new_hook_process->hook_fd[HOOK_PROCESS_STDIN] = NULL;
     new_hook_process->hook_fd[HOOK_PROCESS_STDOUT] = NULL;
     new_hook_process->hook_fd[HOOK_PROCESS_STDERR] = NULL;
     new_hook_process->hook_timer = NULL;
+    new_hook_process->hook_pidfd = NULL;
     new_hook_process->buffer[HOOK_PROCESS_STDIN] = NULL;
     new_hook_process->buffer[HOOK_PROCESS_STDOUT] = stdout_buffer;
     new_hook_process->buffer[HOOK_PROCESS_STDERR] = stderr_buffer;
@@ -1454,6 +1693,91 @@ hook_process (struct t_weechat_plugin *plugin,
                                    callback, callback_data);
 }
 
+/*
+ * Builds arguments for command of a process hook: arguments are read in
+ * hashtable options ("arg1", "arg2", ...) if given, otherwise the command is
+ * split like the shell does.
+ *
+ * Note: result must be freed after use with function string_free_split().
+ */
+
+char **
+hook_process_get_args (struct t_hook *hook_process)
+{
+    char **exec_args, *arg0, str_arg[64];
+    const char *ptr_arg;
+    int i, num_args;
+
+    num_args = 0;
+    if (HOOK_PROCESS(hook_process, options))
+    {
+        /*
+         * count number of arguments given in the hashtable options,
+         * keys are: "arg1", "arg2", ...
+         */
+        while (1)
+        {
+            snprintf (str_arg, sizeof (str_arg), "arg%d", num_args + 1);
+            ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
+                                     str_arg);
+            if (!ptr_arg)
+                break;
+            num_args++;
+        }
+    }
+    if (num_args > 0)
+    {
+        /*
+         * if at least one argument was found in hashtable option, the
+         * "command" contains only path to binary (without arguments), and
+         * the arguments are in hashtable
+         */
+        exec_args = malloc ((num_args + 2) * sizeof (exec_args[0]));
+        if (exec_args)
+        {
+            exec_args[0] = strdup (HOOK_PROCESS(hook_process, command));
+            for (i = 1; i <= num_args; i++)
+            {
+                snprintf (str_arg, sizeof (str_arg), "arg%d", i);
+                ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
+                                         str_arg);
+                exec_args[i] = (ptr_arg) ? strdup (ptr_arg) : NULL;
+            }
+            exec_args[num_args + 1] = NULL;
+        }
+    }
+    else
+    {
+        /*
+         * if no arguments were found in hashtable, make an automatic split
+         * of command, like the shell does
+         */
+        exec_args = string_split_shell (HOOK_PROCESS(hook_process, command),
+                                        NULL);
+    }
+
+    if (exec_args)
+    {
+        arg0 = string_expand_home (exec_args[0]);
+        if (arg0)
+        {
+            free (exec_args[0]);
+            exec_args[0] = arg0;
+        }
+        if (weechat_debug_core >= 1)
+        {
+            log_printf ("hook_process, command='%s'",
+                        HOOK_PROCESS(hook_process, command));
+            for (i = 0; exec_args[i]; i++)
+            {
+                log_printf ("  args[%02d] == '%s'", i, exec_args[i]);
+            }
+        }
+    }
+
+    return exec_args;
+}
+
 /*
  * Child process for hook process: executes command and returns string result
  * into pipe for WeeChat process.
@@ -1462,9 +1786,9 @@ hook_process (struct t_weechat_plugin *plugin,
 void
 hook_process_child (struct t_hook *hook_process)
 {
-    char **exec_args, *arg0, str_arg[64];
-    const char *ptr_url, *ptr_arg;
-    int rc, i, num_args;
+    char **exec_args;
+    const char *ptr_url;
+    int rc;
     FILE *f;
 
     /* read stdin from parent, if a pipe was defined */
@@ -1534,73 +1858,9 @@ hook_process_child (struct t_hook *hook_process)
     else
     {
         /* launch command */
-        num_args = 0;
-        if (HOOK_PROCESS(hook_process, options))
-        {
-            /*
-             * count number of arguments given in the hashtable options,
-             * keys are: "arg1", "arg2", ...
-             */
-            while (1)
-            {
-                snprintf (str_arg, sizeof (str_arg), "arg%d", num_args + 1);
-                ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
-                                         str_arg);
-                if (!ptr_arg)
-                    break;
-                num_args++;
-            }
-        }
-        if (num_args > 0)
-        {
-            /*
-             * if at least one argument was found in hashtable option, the
-             * "command" contains only path to binary (without arguments), and
-             * the arguments are in hashtable
-             */
-            exec_args = malloc ((num_args + 2) * sizeof (exec_args[0]));
-            if (exec_args)
-            {
-                exec_args[0] = strdup (HOOK_PROCESS(hook_process, command));
-                for (i = 1; i <= num_args; i++)
-                {
-                    snprintf (str_arg, sizeof (str_arg), "arg%d", i);
-                    ptr_arg = hashtable_get (HOOK_PROCESS(hook_process, options),
-                                             str_arg);
-                    exec_args[i] = (ptr_arg) ? strdup (ptr_arg) : NULL;
-                }
-                exec_args[num_args + 1] = NULL;
-            }
-        }
-        else
-        {
-            /*
-             * if no arguments were found in hashtable, make an automatic split
-             * of command, like the shell does
-             */
-            exec_args = string_split_shell (HOOK_PROCESS(hook_process, command),
-                                            NULL);
-        }
-
+        exec_args = hook_process_get_args (hook_process);
         if (exec_args)
-        {
-            arg0 = string_expand_home (exec_args[0]);
-            if (arg0)
-            {
-                free (exec_args[0]);
-                exec_args[0] = arg0;
-            }
-            if (weechat_debug_core >= 1)
-            {
-                log_printf ("hook_process, command='%s'",
-                            HOOK_PROCESS(hook_process, command));
-                for (i = 0; exec_args[i]; i++)
-                {
-                    log_printf ("  args[%02d] == '%s'", i, exec_args[i]);
-                }
-            }
             execvp (exec_args[0], exec_args);
-        }
 
         /* should not be executed if execvp was OK */
         if (exec_args)
@@ -1616,6 +1876,98 @@ hook_process_child (struct t_hook *hook_process)
     _exit (rc);
 }
 
+/*
+ * Launches command of a process hook with posix_spawn (without fork of
+ * WeeChat process, which is much faster with a large memory usage).
+ *
+ * Returns:
+ *   1: OK, child process launched (pid is set)
+ *   0: error (then a fork must be used)
+ */
+
+int
+hook_process_spawn (struct t_hook *hook_process, pid_t *pid)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    char **exec_args;
+    int rc, i;
+
+    exec_args = hook_process_get_args (hook_process);
+    if (!exec_args)
+        return 0;
+
+    posix_spawn_file_actions_init (&actions);
+    posix_spawnattr_init (&attr);
+
+    /* same as setuid (getuid ()) in child process */
+    posix_spawnattr_setflags (&attr, POSIX_SPAWN_RESETIDS);
+
+    /* stdin: pipe from parent if given, otherwise "/dev/null" */
+    if (HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]) >= 0)
+    {
+        posix_spawn_file_actions_adddup2 (
+            &actions,
+            HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]),
+            STDIN_FILENO);
+    }
+    else
+    {
+        posix_spawn_file_actions_addopen (&actions, STDIN_FILENO,
+                                          "/dev/null", O_RDONLY, 0);
+    }
+
+    /* stdout/stderr: pipes to parent, or "/dev/null" in detached mode */
+    if (HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDOUT]) >= 0)
+    {
+        posix_spawn_file_actions_adddup2 (
+            &actions,
+            HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDOUT]),
+            STDOUT_FILENO);
+    }
+    else
+    {
+        posix_spawn_file_actions_addopen (&actions, STDOUT_FILENO,
+                                          "/dev/null", O_WRONLY, 0);
+    }
+    if (HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDERR]) >= 0)
+    {
+        posix_spawn_file_actions_adddup2 (
+            &actions,
+            HOOK_PROCESS(hook_process, child_write[HOOK_PROCESS_STDERR]),
+            STDERR_FILENO);
+    }
+    else
+    {
+        posix_spawn_file_actions_addopen (&actions, STDERR_FILENO,
+                                          "/dev/null", O_WRONLY, 0);
+    }
+
+    /* close pipes in child process (they have been duplicated) */
+    for (i = 0; i < 3; i++)
+    {
+        if (HOOK_PROCESS(hook_process, child_read[i]) > STDERR_FILENO)
+        {
+            posix_spawn_file_actions_addclose (
+                &actions, HOOK_PROCESS(hook_process, child_read[i]));
+        }
+        if (HOOK_PROCESS(hook_process, child_write[i]) > STDERR_FILENO)
+        {
+            posix_spawn_file_actions_addclose (
+                &actions, HOOK_PROCESS(hook_process, child_write[i]));
+        }
+    }
+
+    rc = posix_spawnp (pid, exec_args[0], &actions, &attr, exec_args,
+                       environ);
+
+    posix_spawnattr_destroy (&attr);
+    posix_spawn_file_actions_destroy (&actions);
+    string_free_split (exec_args);
+
+    return (rc == 0) ? 1 : 0;
+}
+
 /*
  * Sends buffers (stdout/stderr) to callback.
  */
@@ -1634,6 +1986,7 @@ hook_process_send_buffers (struct t_hook *hook_process, int callback_rc)
         HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDERR])[size] = '\0';
 
     /* send buffers to callback */
+    debug_trace_hook_begin (hook_process, NULL);
     (void) (HOOK_PROCESS(hook_process, callback))
         (hook_process->callback_data,
          HOOK_PROCESS(hook_process, command),
@@ -1642,6 +1995,7 @@ hook_process_send_buffers (struct t_hook *hook_process, int callback_rc)
          HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDOUT]) : NULL,
          (HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDERR]) > 0) ?
          HOOK_PROCESS(hook_process, buffer[HOOK_PROCESS_STDERR]) : NULL);
+    debug_trace_end ();
 
     /* reset size for stdout and stderr */
     HOOK_PROCESS(hook_process, buffer_size[HOOK_PROCESS_STDOUT]) = 0;
@@ -1728,6 +2082,98 @@ hook_process_child_read_stderr_cb (void *arg_hook_process, int fd)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Reads output of child process (stdout or stderr) which is still in pipe
+ * when the child has terminated (without blocking).
+ */
+
+void
+hook_process_child_read_remaining (struct t_hook *hook_process,
+                                   int index_buffer)
+{
+    char buffer[4096];
+    int fd, flags, num_read;
+
+    fd = HOOK_PROCESS(hook_process, child_read[index_buffer]);
+    if ((fd < 0) || !HOOK_PROCESS(hook_process, hook_fd[index_buffer]))
+        return;
+
+    flags = fcntl (fd, F_GETFL);
+    if (flags == -1)
+        flags = 0;
+    fcntl (fd, F_SETFL, flags | O_NONBLOCK);
+
+    while ((num_read = read (fd, buffer, sizeof (buffer) - 1)) > 0)
+    {
+        hook_process_add_to_buffer (hook_process, index_buffer,
+                                    buffer, num_read);
+    }
+}
+
+/*
+ * Ends a process hook after end of child process: sends remaining output
+ * and return code to callback, then removes the hook.
+ */
+
+void
+hook_process_child_end (struct t_hook *hook_process, int status)
+{
+    /* child has been reaped, do not kill/wait it when removing hook */
+    HOOK_PROCESS(hook_process, child_pid) = 0;
+
+    hook_process_child_read_remaining (hook_process, HOOK_PROCESS_STDOUT);
+    hook_process_child_read_remaining (hook_process, HOOK_PROCESS_STDERR);
+
+    if (WIFEXITED(status))
+    {
+        /* child terminated normally */
+        hook_process_send_buffers (hook_process, WEXITSTATUS(status));
+    }
+    else
+    {
+        /* child terminated by a signal */
+        hook_process_send_buffers (hook_process, WEECHAT_HOOK_PROCESS_ERROR);
+    }
+    unhook (hook_process);
+}
+
+/*
+ * Callback for pidfd of child process: the child has terminated.
+ */
+
+int
+hook_process_pidfd_cb (void *arg_hook_process, int fd)
+{
+    struct t_hook *hook_process;
+    pid_t pid;
+    int status;
+
+    /* make C compiler happy */
+    (void) fd;
+
+    hook_process = (struct t_hook *)arg_hook_process;
+
+    if (hook_process->deleted)
+        return WEECHAT_RC_OK;
+
+    status = 0;
+    pid = waitpid (HOOK_PROCESS(hook_process, child_pid), &status, WNOHANG);
+    if (pid > 0)
+    {
+        if (WIFEXITED(status) || WIFSIGNALED(status))
+            hook_process_child_end (hook_process, status);
+    }
+    else if (pid < 0)
+    {
+        /* child already reaped by someone else: exit status is unknown */
+        HOOK_PROCESS(hook_process, child_pid) = 0;
+        hook_process_send_buffers (hook_process, WEECHAT_HOOK_PROCESS_ERROR);
+        unhook (hook_process);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Checks if child process is still alive.
  */
@@ -1736,7 +2182,7 @@ int
 hook_process_timer_cb (void *arg_hook_process, int remaining_calls)
 {
     struct t_hook *hook_process;
-    int status, rc;
+    int status;
 
     /* make C compiler happy */
     (void) remaining_calls;
@@ -1756,29 +2202,16 @@ hook_process_timer_cb (void *arg_hook_process, int remaining_calls)
                              HOOK_PROCESS(hook_process, command),
                              ((float)HOOK_PROCESS(hook_process, timeout)) / 1000);
         }
-        kill (HOOK_PROCESS(hook_process, child_pid), SIGKILL);
-        usleep (1000);
+        /* child is killed (and waited) when the hook is removed */
         unhook (hook_process);
     }
     else
     {
-        if (waitpid (HOOK_PROCESS(hook_process, child_pid),
-                     &status, WNOHANG) > 0)
+        if ((waitpid (HOOK_PROCESS(hook_process, child_pid),
+                      &status, WNOHANG) > 0)
+            && (WIFEXITED(status) || WIFSIGNALED(status)))
         {
-            if (WIFEXITED(status))
-            {
-                /* child terminated normally */
-                rc = WEXITSTATUS(status);
-                hook_process_send_buffers (hook_process, rc);
-                unhook (hook_process);
-            }
-            else if (WIFSIGNALED(status))
-            {
-                /* child terminated by a signal */
-                hook_process_send_buffers (hook_process,
-                                           WEECHAT_HOOK_PROCESS_ERROR);
-                unhook (hook_process);
-            }
+            hook_process_child_end (hook_process, status);
         }
     }
 
@@ -1827,6 +2260,16 @@ hook_process_run (struct t_hook *hook_process)
         HOOK_PROCESS(hook_process, child_write[i]) = pipes[i][1];
     }
 
+    /*
+     * launch command with posix_spawn if possible, otherwise fork
+     * (for "url:" the child process must run WeeChat code)
+     */
+    if ((strncmp (HOOK_PROCESS(hook_process, command), "url:", 4) != 0)
+        && hook_process_spawn (hook_process, &pid))
+    {
+        goto parent;
+    }
+
     /* fork */
     switch (pid = fork ())
     {
@@ -1849,6 +2292,7 @@ hook_process_run (struct t_hook *hook_process)
             break;
     }
 
+parent:
     /* parent process */
     HOOK_PROCESS(hook_process, child_pid) = pid;
     if (HOOK_PROCESS(hook_process, child_read[HOOK_PROCESS_STDIN]) >= 0)
@@ -1887,7 +2331,37 @@ hook_process_run (struct t_hook *hook_process)
                      hook_process);
     }
 
+    /*
+     * end of child is detected with a pidfd (if supported by system),
+     * otherwise the timer checks every 100ms if the child is still alive
+     */
+#ifdef SYS_pidfd_open
+    HOOK_PROCESS(hook_process, child_pidfd) = syscall (SYS_pidfd_open, pid, 0);
+#endif
+    if (HOOK_PROCESS(hook_process, child_pidfd) >= 0)
+    {
+        HOOK_PROCESS(hook_process, hook_pidfd) =
+            hook_fd (hook_process->plugin,
+                     HOOK_PROCESS(hook_process, child_pidfd),
+                     1, 0, 0,
+                     &hook_process_pidfd_cb,
+                     hook_process);
+    }
+
     timeout = HOOK_PROCESS(hook_process, timeout);
+    if (HOOK_PROCESS(hook_process, hook_pidfd))
+    {
+        /* timer is used only for timeout */
+        if (timeout > 0)
+        {
+            HOOK_PROCESS(hook_process, hook_timer) = hook_timer (hook_process->plugin,
+                                                                 timeout, 0, 1,
+                                                                 &hook_process_timer_cb,
+                                                                 hook_process);
+        }
+        return;
+    }
+
     interval = 100;
     max_calls = 0;
     if (timeout > 0)
@@ -1928,7 +2402,8 @@ error:
 }
 
 /*
- * Hooks a connection to a peer (using fork).
+ * Hooks a connection to a peer (without fork: name resolution is made in a
+ * thread and connection is non-blocking).
  *
  * Returns pointer to new hook, NULL if error.
  */
@@ -1998,6 +2473,17 @@ hook_connect (struct t_weechat_plugin *plugin, const char *proxy,
     new_hook_connect->handshake_hook_timer = NULL;
     new_hook_connect->handshake_fd_flags = 0;
     new_hook_connect->handshake_ip_address = NULL;
+    new_hook_connect->resolve = NULL;
+    new_hook_connect->addrs = NULL;
+    new_hook_connect->num_addrs = 0;
+    new_hook_connect->index_addr = 0;
+    new_hook_connect->attempt_sock = NULL;
+    new_hook_connect->attempt_hook_fd = NULL;
+    new_hook_connect->hook_attempt_timer = NULL;
+    new_hook_connect->status = 0;
+    new_hook_connect->proxy_state = 0;
+    new_hook_connect->proxy_length = 0;
+    new_hook_connect->proxy_pos = 0;
 #ifdef HOOK_CONNECT_MAX_SOCKETS
     for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
     {
@@ -2008,7 +2494,7 @@ hook_connect (struct t_weechat_plugin *plugin, const char *proxy,
 
     hook_add_to_list (new_hook);
 
-    network_connect_with_fork (new_hook);
+    network_connect_without_fork (new_hook);
 
     return new_hook;
 }
@@ -2200,6 +2686,7 @@ hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
             {
                 /* run callback */
                 ptr_hook->running = 1;
+                debug_trace_hook_begin (ptr_hook, NULL);
                 (void) (HOOK_PRINT(ptr_hook, callback))
                     (ptr_hook->callback_data, buffer, line->data->date,
                      line->data->tags_count,
@@ -2207,6 +2694,7 @@ hook_print_exec (struct t_gui_buffer *buffer, struct t_gui_line *line)
                      (int)line->data->displayed, (int)line->data->highlight,
                      (HOOK_PRINT(ptr_hook, strip_colors)) ? prefix_no_color : line->data->prefix,
                      (HOOK_PRINT(ptr_hook, strip_colors)) ? message_no_color : line->data->message);
+                debug_trace_end ();
                 ptr_hook->running = 0;
             }
         }
@@ -2287,8 +2775,10 @@ hook_signal_send (const char *signal, const char *type_data, void *signal_data)
             && (string_match (signal, HOOK_SIGNAL(ptr_hook, signal), 0)))
         {
             ptr_hook->running = 1;
+            debug_trace_hook_begin (ptr_hook, signal);
             rc = (HOOK_SIGNAL(ptr_hook, callback))
                 (ptr_hook->callback_data, signal, type_data, signal_data);
+            debug_trace_end ();
             ptr_hook->running = 0;
 
             if (rc == WEECHAT_RC_OK_EAT)
@@ -2344,6 +2834,32 @@ hook_hsignal (struct t_weechat_plugin *plugin, const char *signal,
     return new_hook;
 }
 
+/*
+ * Checks if a hsignal is hooked (by at least one hook).
+ *
+ * Returns:
+ *   1: hsignal is hooked
+ *   0: hsignal is not hooked
+ */
+
+int
+hook_hsignal_is_hooked (const char *signal)
+{
+    struct t_hook *ptr_hook;
+
+    for (ptr_hook = weechat_hooks[HOOK_TYPE_HSIGNAL]; ptr_hook;
+         ptr_hook = ptr_hook->next_hook)
+    {
+        if (!ptr_hook->deleted
+            && string_match (signal, HOOK_HSIGNAL(ptr_hook, signal), 0))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 /*
  * Sends a hsignal (signal with hashtable).
  */
@@ -2368,8 +2884,10 @@ hook_hsignal_send (const char *signal, struct t_hashtable *hashtable)
             && (string_match (signal, HOOK_HSIGNAL(ptr_hook, signal), 0)))
         {
             ptr_hook->running = 1;
+            debug_trace_hook_begin (ptr_hook, signal);
             rc = (HOOK_HSIGNAL(ptr_hook, callback))
                 (ptr_hook->callback_data, signal, hashtable);
+            debug_trace_end ();
             ptr_hook->running = 0;
 
             if (rc == WEECHAT_RC_OK_EAT)
@@ -2448,8 +2966,10 @@ hook_config_exec (const char *option, const char *value)
                 || (string_match (option, HOOK_CONFIG(ptr_hook, option), 0))))
         {
             ptr_hook->running = 1;
+            debug_trace_hook_begin (ptr_hook, option);
             (void) (HOOK_CONFIG(ptr_hook, callback))
                 (ptr_hook->callback_data, option, value);
+            debug_trace_end ();
             ptr_hook->running = 0;
         }
 
@@ -2643,9 +3163,11 @@ hook_modifier_exec (struct t_weechat_plugin *plugin, const char *modifier,
                                    modifier) == 0))
         {
             ptr_hook->running = 1;
+            debug_trace_hook_begin (ptr_hook, NULL);
             new_msg = (HOOK_MODIFIER(ptr_hook, callback))
                 (ptr_hook->callback_data, modifier, modifier_data,
                  message_modified);
+            debug_trace_end ();
             ptr_hook->running = 0;
 
             /* empty string returned => message dropped */
@@ -3268,6 +3790,119 @@ hook_focus_get_data (struct t_hashtable *hashtable_focus1,
     return hashtable1;
 }
 
+/*
+ * Callback called in main thread when function of a thread hook has
+ * returned: sends result to callback and removes the hook.
+ */
+
+void
+hook_thread_done_cb (void *data, void *result)
+{
+    struct t_hook *hook;
+
+    hook = (struct t_hook *)data;
+
+    if (!hook_valid (hook) || hook->deleted)
+        return;
+
+    /* job is freed by thread pool after this function */
+    HOOK_THREAD(hook, job) = NULL;
+
+    hook_exec_start ();
+    hook->running = 1;
+    debug_trace_hook_begin (hook, NULL);
+    (void) (HOOK_THREAD(hook, callback)) (hook->callback_data, result,
+                                          WEECHAT_HOOK_THREAD_OK);
+    debug_trace_end ();
+    hook->running = 0;
+    hook_exec_end ();
+
+    unhook (hook);
+}
+
+/*
+ * Hooks a thread: function is called with function_arg in a thread of the
+ * pool, then callback is called in main thread with the value returned by
+ * function, and the hook is removed.
+ *
+ * Function must not use WeeChat API (it is not thread safe).
+ *
+ * Returns pointer to new hook, NULL if error.
+ */
+
+struct t_hook *
+hook_thread (struct t_weechat_plugin *plugin,
+             t_hook_thread_function *function, void *function_arg,
+             t_hook_callback_thread *callback, void *callback_data)
+{
+    struct t_hook *new_hook;
+    struct t_hook_thread *new_hook_thread;
+
+    if (!function || !callback)
+        return NULL;
+
+    new_hook = malloc (sizeof (*new_hook));
+    if (!new_hook)
+        return NULL;
+    new_hook_thread = malloc (sizeof (*new_hook_thread));
+    if (!new_hook_thread)
+    {
+        free (new_hook);
+        return NULL;
+    }
+
+    hook_init_data (new_hook, plugin, HOOK_TYPE_THREAD, HOOK_PRIORITY_DEFAULT,
+                    callback_data);
+
+    new_hook->hook_data = new_hook_thread;
+    new_hook_thread->callback = callback;
+    new_hook_thread->function = function;
+    new_hook_thread->function_arg = function_arg;
+    new_hook_thread->job = thread_submit (function, function_arg,
+                                          &hook_thread_done_cb, new_hook);
+    if (!new_hook_thread->job)
+    {
+        free (new_hook_thread);
+        free (new_hook);
+        return NULL;
+    }
+
+    hook_add_to_list (new_hook);
+
+    return new_hook;
+}
+
+/*
+ * Cancels function of a thread hook (called when hook is removed before
+ * function has returned).
+ *
+ * Callback is called with status WEECHAT_HOOK_THREAD_CANCELLED, and result
+ * returned by function if it was already running (NULL if it was not
+ * started), so that callback can free data.
+ */
+
+void
+hook_thread_cancel (struct t_hook *hook)
+{
+    struct t_thread_job *job;
+    void *result;
+
+    job = HOOK_THREAD(hook, job);
+    if (!job)
+        return;
+
+    HOOK_THREAD(hook, job) = NULL;
+    thread_cancel (job, &result);
+
+    /* hook can not be removed by callback: it is being removed */
+    hook->deleted = 1;
+    hook->running = 1;
+    (void) (HOOK_THREAD(hook, callback)) (hook->callback_data, result,
+                                          WEECHAT_HOOK_THREAD_CANCELLED);
+    hook->running = 0;
+    hook->deleted = 0;
+}
+
 /*
  * Sets a hook property (string).
  */
@@ -3436,6 +4071,10 @@ unhook (struct t_hook *hook)
                     unhook (HOOK_PROCESS(hook, hook_fd[HOOK_PROCESS_STDERR]));
                 if (HOOK_PROCESS(hook, hook_timer))
                     unhook (HOOK_PROCESS(hook, hook_timer));
+                if (HOOK_PROCESS(hook, hook_pidfd))
+                    unhook (HOOK_PROCESS(hook, hook_pidfd));
+                if (HOOK_PROCESS(hook, child_pidfd) != -1)
+                    close (HOOK_PROCESS(hook, child_pidfd));
                 if (HOOK_PROCESS(hook, child_pid) > 0)
                 {
                     kill (HOOK_PROCESS(hook, child_pid), SIGKILL);
@@ -3481,6 +4120,7 @@ unhook (struct t_hook *hook)
                     unhook (HOOK_CONNECT(hook, handshake_hook_timer));
                 if (HOOK_CONNECT(hook, handshake_ip_address))
                     free (HOOK_CONNECT(hook, handshake_ip_address));
+                network_connect_free_data (hook);
                 if (HOOK_CONNECT(hook, child_pid) > 0)
                 {
                     kill (HOOK_CONNECT(hook, child_pid), SIGKILL);
@@ -3576,6 +4216,9 @@ unhook (struct t_hook *hook)
                 if (HOOK_FOCUS(hook, area))
                     free (HOOK_FOCUS(hook, area));
                 break;
+            case HOOK_TYPE_THREAD:
+                hook_thread_cancel (hook);
+                break;
             case HOOK_NUM_TYPES:
                 /*
                  * this constant is used to count types only,
@@ -3789,6 +4432,8 @@ hook_add_to_infolist_pointer (struct t_infolist *infolist, struct t_hook *hook)
                     return 0;
                 if (!infolist_new_var_integer (ptr_item, "child_pid", HOOK_PROCESS(hook, child_pid)))
                     return 0;
+                if (!infolist_new_var_integer (ptr_item, "child_pidfd", HOOK_PROCESS(hook, child_pidfd)))
+                    return 0;
                 if (!infolist_new_var_pointer (ptr_item, "hook_fd_stdin", HOOK_PROCESS(hook, hook_fd[HOOK_PROCESS_STDIN])))
                     return 0;
                 if (!infolist_new_var_pointer (ptr_item, "hook_fd_stdout", HOOK_PROCESS(hook, hook_fd[HOOK_PROCESS_STDOUT])))
@@ -3797,6 +4442,8 @@ hook_add_to_infolist_pointer (struct t_infolist *infolist, struct t_hook *hook)
                     return 0;
                 if (!infolist_new_var_pointer (ptr_item, "hook_timer", HOOK_PROCESS(hook, hook_timer)))
                     return 0;
+                if (!infolist_new_var_pointer (ptr_item, "hook_pidfd", HOOK_PROCESS(hook, hook_pidfd)))
+                    return 0;
             }
             break;
         case HOOK_TYPE_CONNECT:
@@ -3846,6 +4493,16 @@ hook_add_to_infolist_pointer (struct t_infolist *infolist, struct t_hook *hook)
                     return 0;
                 if (!infolist_new_var_string (ptr_item, "handshake_ip_address", HOOK_CONNECT(hook, handshake_ip_address)))
                     return 0;
+                if (!infolist_new_var_pointer (ptr_item, "resolve", HOOK_CONNECT(hook, resolve)))
+                    return 0;
+                if (!infolist_new_var_integer (ptr_item, "num_addrs", HOOK_CONNECT(hook, num_addrs)))
+                    return 0;
+                if (!infolist_new_var_integer (ptr_item, "index_addr", HOOK_CONNECT(hook, index_addr)))
+                    return 0;
+                if (!infolist_new_var_pointer (ptr_item, "hook_attempt_timer", HOOK_CONNECT(hook, hook_attempt_timer)))
+                    return 0;
+                if (!infolist_new_var_integer (ptr_item, "proxy_state", HOOK_CONNECT(hook, proxy_state)))
+                    return 0;
             }
             break;
         case HOOK_TYPE_PRINT:
@@ -4025,6 +4682,23 @@ hook_add_to_infolist_pointer (struct t_infolist *infolist, struct t_hook *hook)
                     return 0;
             }
             break;
+        case HOOK_TYPE_THREAD:
+            if (!hook->deleted)
+            {
+                if (!infolist_new_var_pointer (ptr_item, "callback", HOOK_THREAD(hook, callback)))
+                    return 0;
+                if (!infolist_new_var_pointer (ptr_item, "function", HOOK_THREAD(hook, function)))
+                    return 0;
+                if (!infolist_new_var_pointer (ptr_item, "function_arg", HOOK_THREAD(hook, function_arg)))
+                    return 0;
+                if (!infolist_new_var_pointer (ptr_item, "job", HOOK_THREAD(hook, job)))
+                    return 0;
+                if (!infolist_new_var_string (ptr_item, "job_state",
+                                              (HOOK_THREAD(hook, job)) ?
+                                              thread_job_state_string[HOOK_THREAD(hook, job)->state] : ""))
+                    return 0;
+            }
+            break;
         case HOOK_NUM_TYPES:
             /*
              * this constant is used to count types only,
@@ -4221,17 +4895,8 @@ hook_print_log ()
                                     HOOK_TIMER(ptr_hook, last_exec.tv_sec),
                                     text_time);
                         log_printf ("    last_exec.tv_usec . . : %ld",   HOOK_TIMER(ptr_hook, last_exec.tv_usec));
-                        text_time[0] = '\0';
-                        seconds = HOOK_TIMER(ptr_hook, next_exec).tv_sec;
-                        local_time = localtime (&seconds);
-                        if (local_time)
-                        {
-                            strftime (text_time, sizeof (text_time),
-                                      "%d/%m/%Y %H:%M:%S", local_time);
-                        }
-                        log_printf ("    next_exec.tv_sec. . . : %ld (%s)",
-                                    HOOK_TIMER(ptr_hook, next_exec.tv_sec),
-                                    text_time);
+                        log_printf ("    next_exec.tv_sec. . . : %ld (monotonic clock)",
+                                    HOOK_TIMER(ptr_hook, next_exec.tv_sec));
                         log_printf ("    next_exec.tv_usec . . : %ld",   HOOK_TIMER(ptr_hook, next_exec.tv_usec));
                     }
                     break;
@@ -4264,10 +4929,12 @@ hook_print_log ()
                         log_printf ("    child_read[stderr]. . : %d",    HOOK_PROCESS(ptr_hook, child_read[HOOK_PROCESS_STDERR]));
                         log_printf ("    child_write[stderr] . : %d",    HOOK_PROCESS(ptr_hook, child_write[HOOK_PROCESS_STDERR]));
                         log_printf ("    child_pid . . . . . . : %d",    HOOK_PROCESS(ptr_hook, child_pid));
+                        log_printf ("    child_pidfd . . . . . : %d",    HOOK_PROCESS(ptr_hook, child_pidfd));
                         log_printf ("    hook_fd[stdin]. . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_fd[HOOK_PROCESS_STDIN]));
                         log_printf ("    hook_fd[stdout] . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_fd[HOOK_PROCESS_STDOUT]));
                         log_printf ("    hook_fd[stderr] . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_fd[HOOK_PROCESS_STDERR]));
                         log_printf ("    hook_timer. . . . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_timer));
+                        log_printf ("    hook_pidfd. . . . . . : 0x%lx", HOOK_PROCESS(ptr_hook, hook_pidfd));
                     }
                     break;
                 case HOOK_TYPE_CONNECT:
@@ -4298,6 +4965,13 @@ hook_print_log ()
                         log_printf ("    handshake_hook_timer. : 0x%lx", HOOK_CONNECT(ptr_hook, handshake_hook_timer));
                         log_printf ("    handshake_fd_flags. . : %d",    HOOK_CONNECT(ptr_hook, handshake_fd_flags));
                         log_printf ("    handshake_ip_address. : '%s'",  HOOK_CONNECT(ptr_hook, handshake_ip_address));
+                        log_printf ("    resolve . . . . . . . : 0x%lx", HOOK_CONNECT(ptr_hook, resolve));
+                        log_printf ("    num_addrs . . . . . . : %d",    HOOK_CONNECT(ptr_hook, num_addrs));
+                        log_printf ("    index_addr. . . . . . : %d",    HOOK_CONNECT(ptr_hook, index_addr));
+                        log_printf ("    attempt_sock. . . . . : 0x%lx", HOOK_CONNECT(ptr_hook, attempt_sock));
+                        log_printf ("    attempt_hook_fd . . . : 0x%lx", HOOK_CONNECT(ptr_hook, attempt_hook_fd));
+                        log_printf ("    hook_attempt_timer. . : 0x%lx", HOOK_CONNECT(ptr_hook, hook_attempt_timer));
+                        log_printf ("    proxy_state . . . . . : %d",    HOOK_CONNECT(ptr_hook, proxy_state));
 #ifdef HOOK_CONNECT_MAX_SOCKETS
                         for (i = 0; i < HOOK_CONNECT_MAX_SOCKETS; i++)
                         {
@@ -4409,6 +5083,16 @@ hook_print_log ()
                         log_printf ("    area. . . . . . . . . : '%s'",  HOOK_FOCUS(ptr_hook, area));
                     }
                     break;
+                case HOOK_TYPE_THREAD:
+                    if (!ptr_hook->deleted)
+                    {
+                        log_printf ("  thread data:");
+                        log_printf ("    callback. . . . . . . : 0x%lx", HOOK_THREAD(ptr_hook, callback));
+                        log_printf ("    function. . . . . . . : 0x%lx", HOOK_THREAD(ptr_hook, function));
+                        log_printf ("    function_arg. . . . . : 0x%lx", HOOK_THREAD(ptr_hook, function_arg));
+                        log_printf ("    job . . . . . . . . . : 0x%lx", HOOK_THREAD(ptr_hook, job));
+                    }
+                    break;
                 case HOOK_NUM_TYPES:
                     /*
                      * this constant is used to count types only,
@@ -47,6 +47,9 @@ struct t_gui_window;
 struct t_weelist;
 struct t_hashtable;
 struct t_infolist;
+struct t_network_resolve;
+struct t_thread_job;
+struct addrinfo;
 
 /* hook types */
 
@@ -69,6 +72,7 @@ enum t_hook_type
     HOOK_TYPE_INFOLIST,                /* get some info as infolist         */
     HOOK_TYPE_HDATA,                   /* get hdata pointer                 */
     HOOK_TYPE_FOCUS,                   /* focus event (mouse/key)           */
+    HOOK_TYPE_THREAD,                  /* function run in a thread          */
     /* number of hook types */
     HOOK_NUM_TYPES,
 };
@@ -111,6 +115,7 @@ enum t_hook_type
 #define HOOK_INFOLIST(hook, var) (((struct t_hook_infolist *)hook->hook_data)->var)
 #define HOOK_HDATA(hook, var) (((struct t_hook_hdata *)hook->hook_data)->var)
 #define HOOK_FOCUS(hook, var) (((struct t_hook_focus *)hook->hook_data)->var)
+#define HOOK_THREAD(hook, var) (((struct t_hook_thread *)hook->hook_data)->var)
 
 struct t_hook
 {
@@ -187,6 +192,7 @@ struct t_hook_timer
     int remaining_calls;               /* calls remaining (0 = unlimited)   */
     struct timeval last_exec;          /* last time hook was executed       */
     struct timeval next_exec;          /* next scheduled execution          */
+                                       /* (monotonic clock)                 */
 };
 
 /* hook fd */
@@ -218,8 +224,11 @@ struct t_hook_process
     int child_read[3];                 /* read stdin/out/err data from child*/
     int child_write[3];                /* write stdin/out/err data for child*/
     pid_t child_pid;                   /* pid of child process              */
+    int child_pidfd;                   /* pidfd of child (-1 if unsupported)*/
     struct t_hook *hook_fd[3];         /* hook fd for stdin/out/err         */
     struct t_hook *hook_timer;         /* timer to check if child has died  */
+                                       /* (or for timeout if pidfd is used) */
+    struct t_hook *hook_pidfd;         /* fd hook on pidfd (end of child)   */
     char *buffer[3];                   /* buffers for child stdin/out/err   */
     int buffer_size[3];                /* size of child stdin/out/err       */
     int buffer_flush;                  /* bytes to flush output buffers     */
@@ -266,12 +275,24 @@ struct t_hook_connect
     int child_recv;                    /* to read data from child socket    */
     int child_send;                    /* to write data to child socket     */
     pid_t child_pid;                   /* pid of child process (connecting) */
-    struct t_hook *hook_child_timer;   /* timer for child process timeout   */
+    struct t_hook *hook_child_timer;   /* timer for connection timeout      */
     struct t_hook *hook_fd;            /* pointer to fd hook                */
     struct t_hook *handshake_hook_fd;  /* fd hook for handshake             */
     struct t_hook *handshake_hook_timer; /* timer for handshake timeout     */
     int handshake_fd_flags;            /* socket flags saved for handshake  */
     char *handshake_ip_address;        /* ip address (used for handshake)   */
+    struct t_network_resolve *resolve; /* name resolution (in a thread)     */
+    struct addrinfo **addrs;           /* IP addresses to try (sorted)      */
+    int num_addrs;                     /* number of IP addresses            */
+    int index_addr;                    /* index of next IP address to try   */
+    int *attempt_sock;                 /* sockets of connection attempts    */
+    struct t_hook **attempt_hook_fd;   /* fd hooks of connection attempts   */
+    struct t_hook *hook_attempt_timer; /* timer to start next attempt       */
+    int status;                        /* status if all IP addresses fail   */
+    int proxy_state;                   /* state of handshake with proxy     */
+    unsigned char proxy_buffer[1024];  /* data sent to/received from proxy  */
+    int proxy_length;                  /* length to send/receive            */
+    int proxy_pos;                     /* length already sent/received      */
 #ifdef HOOK_CONNECT_MAX_SOCKETS
     int sock_v4[HOOK_CONNECT_MAX_SOCKETS];  /* IPv4 sockets for connecting  */
     int sock_v6[HOOK_CONNECT_MAX_SOCKETS];  /* IPv6 sockets for connecting  */
@@ -425,6 +446,20 @@ struct t_hook_focus
     char *area;                         /* "chat" or bar item name          */
 };
 
+/* hook thread */
+
+typedef void *(t_hook_thread_function)(void *arg);
+typedef int (t_hook_callback_thread)(void *data, void *result, int status);
+
+struct t_hook_thread
+{
+    t_hook_callback_thread *callback;   /* thread callback (main thread)    */
+    t_hook_thread_function *function;   /* function run in a thread         */
+    void *function_arg;                 /* argument for function            */
+    struct t_thread_job *job;           /* job in thread pool (NULL when    */
+                                        /* callback has been called)        */
+};
+
 /* hook variables */
 
 extern char *hook_type_string[];
@@ -457,7 +492,7 @@ extern struct t_hook *hook_timer (struct t_weechat_plugin *plugin,
                                   int max_calls,
                                   t_hook_callback_timer *callback,
                                   void *callback_data);
-extern void hook_timer_time_to_next (struct timeval *tv_timeout);
+extern int hook_timer_time_to_next (struct timeval *tv_timeout);
 extern void hook_timer_exec ();
 extern struct t_hook *hook_fd (struct t_weechat_plugin *plugin, int fd,
                                int flag_read, int flag_write,
@@ -518,6 +553,7 @@ extern struct t_hook *hook_hsignal (struct t_weechat_plugin *plugin,
                                     const char *signal,
                                     t_hook_callback_hsignal *callback,
                                     void *callback_data);
+extern int hook_hsignal_is_hooked (const char *signal);
 extern int hook_hsignal_send (const char *signal,
                               struct t_hashtable *hashtable);
 extern struct t_hook *hook_config (struct t_weechat_plugin *plugin,
@@ -590,6 +626,11 @@ extern struct t_hook *hook_focus (struct t_weechat_plugin *plugin,
                                   void *callback_data);
 extern struct t_hashtable *hook_focus_get_data (struct t_hashtable *hashtable_focus1,
                                                 struct t_hashtable *hashtable_focus2);
+extern struct t_hook *hook_thread (struct t_weechat_plugin *plugin,
+                                   t_hook_thread_function *function,
+                                   void *function_arg,
+                                   t_hook_callback_thread *callback,
+                                   void *callback_data);
 extern void hook_set (struct t_hook *hook, const char *property,
                       const char *value);
 extern void unhook (struct t_hook *hook);
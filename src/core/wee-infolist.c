@@ -28,6 +28,7 @@
 
 #include "weechat.h"
 #include "wee-log.h"
+#include "wee-memory.h"
 #include "wee-string.h"
 #include "wee-infolist.h"
 
@@ -36,6 +37,42 @@ struct t_infolist *weechat_infolists = NULL;
 struct t_infolist *last_weechat_infolist = NULL;
 
 
+/*
+ * Returns size of memory allocated for a variable.
+ */
+
+int
+infolist_var_memory_size (struct t_infolist_var *var)
+{
+    int size;
+
+    size = sizeof (*var);
+    if (var->name)
+        size += strlen (var->name) + 1;
+    if (var->value)
+    {
+        switch (var->type)
+        {
+            case INFOLIST_INTEGER:
+                size += sizeof (int);
+                break;
+            case INFOLIST_STRING:
+                size += strlen ((const char *)var->value) + 1;
+                break;
+            case INFOLIST_BUFFER:
+                size += var->size;
+                break;
+            case INFOLIST_TIME:
+                size += sizeof (time_t);
+                break;
+            case INFOLIST_POINTER:
+                break;
+        }
+    }
+
+    return size;
+}
+
 /*
  * Creates a new infolist.
  *
@@ -62,6 +99,9 @@ infolist_new (struct t_weechat_plugin *plugin)
         else
             weechat_infolists = new_infolist;
         last_weechat_infolist = new_infolist;
+
+        memory_add (NULL, MEMORY_CATEGORY_INFOLISTS,
+                    sizeof (*new_infolist), 1);
     }
 
     return new_infolist;
@@ -119,6 +159,8 @@ infolist_new_item (struct t_infolist *infolist)
         else
             infolist->items = new_item;
         infolist->last_item = new_item;
+
+        memory_add (NULL, MEMORY_CATEGORY_INFOLISTS, sizeof (*new_item), 1);
     }
 
     return new_item;
@@ -155,6 +197,9 @@ infolist_new_var_integer (struct t_infolist_item *item,
         else
             item->vars = new_var;
         item->last_var = new_var;
+
+        memory_add (NULL, MEMORY_CATEGORY_INFOLISTS,
+                    infolist_var_memory_size (new_var), 1);
     }
 
     return new_var;
@@ -189,6 +234,9 @@ infolist_new_var_string (struct t_infolist_item *item,
         else
             item->vars = new_var;
         item->last_var = new_var;
+
+        memory_add (NULL, MEMORY_CATEGORY_INFOLISTS,
+                    infolist_var_memory_size (new_var), 1);
     }
 
     return new_var;
@@ -223,6 +271,9 @@ infolist_new_var_pointer (struct t_infolist_item *item,
         else
             item->vars = new_var;
         item->last_var = new_var;
+
+        memory_add (NULL, MEMORY_CATEGORY_INFOLISTS,
+                    infolist_var_memory_size (new_var), 1);
     }
 
     return new_var;
@@ -260,6 +311,9 @@ infolist_new_var_buffer (struct t_infolist_item *item,
         else
             item->vars = new_var;
         item->last_var = new_var;
+
+        memory_add (NULL, MEMORY_CATEGORY_INFOLISTS,
+                    infolist_var_memory_size (new_var), 1);
     }
 
     return new_var;
@@ -296,6 +350,9 @@ infolist_new_var_time (struct t_infolist_item *item,
         else
             item->vars = new_var;
         item->last_var = new_var;
+
+        memory_add (NULL, MEMORY_CATEGORY_INFOLISTS,
+                    infolist_var_memory_size (new_var), 1);
     }
 
     return new_var;
@@ -425,6 +482,9 @@ infolist_fields (struct t_infolist *infolist)
             strcat (infolist->ptr_item->fields, ",");
     }
 
+    memory_add (NULL, MEMORY_CATEGORY_INFOLISTS,
+                strlen (infolist->ptr_item->fields) + 1, 0);
+
     return infolist->ptr_item->fields;
 }
 
@@ -598,6 +658,9 @@ infolist_var_free (struct t_infolist_item *item,
     if (var->next_var)
         (var->next_var)->prev_var = var->prev_var;
 
+    memory_add (NULL, MEMORY_CATEGORY_INFOLISTS,
+                -1 * infolist_var_memory_size (var), -1);
+
     /* free data */
     if (var->name)
         free (var->name);
@@ -645,7 +708,14 @@ infolist_item_free (struct t_infolist *infolist,
         infolist_var_free (item, item->vars);
     }
     if (item->fields)
+    {
+        memory_add (NULL, MEMORY_CATEGORY_INFOLISTS,
+                    -1 * (long long)(strlen (item->fields) + 1), 0);
         free (item->fields);
+    }
+
+    memory_add (NULL, MEMORY_CATEGORY_INFOLISTS,
+                -1 * (long long)sizeof (*item), -1);
 
     free (item);
 
@@ -681,6 +751,9 @@ infolist_free (struct t_infolist *infolist)
         infolist_item_free (infolist, infolist->items);
     }
 
+    memory_add (NULL, MEMORY_CATEGORY_INFOLISTS,
+                -1 * (long long)sizeof (*infolist), -1);
+
     free (infolist);
 
     weechat_infolists = new_weechat_infolists;
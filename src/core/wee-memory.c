@@ -0,0 +1,416 @@
+/*
+ * wee-memory.c - accounting of memory allocated by WeeChat and plugins
+ *
+ * Copyright (C) 2026 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Counters are maintained at allocation sites (lines, nicklist, hashtables,
+ * infolists, ...) and grouped by owner: "core", a plugin name, or
+ * "plugin/script" for buffers created by a script.
+ *
+ * Counters may be updated by functions running in threads (hashtables), so
+ * the update of bytes/objects is atomic; the peak is approximate.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "weechat.h"
+#include "wee-memory.h"
+#include "wee-infolist.h"
+#include "wee-log.h"
+
+
+char *memory_category_string[MEMORY_NUM_CATEGORIES] =
+{ "lines", "line_strings", "nicklist", "hashtables", "infolists" };
+
+struct t_memory_owner memory_owner_core =
+{
+    MEMORY_OWNER_CORE,
+    {
+        { "lines", 0, 0, 0, NULL },
+        { "line_strings", 0, 0, 0, NULL },
+        { "nicklist", 0, 0, 0, NULL },
+        { "hashtables", 0, 0, 0, NULL },
+        { "infolists", 0, 0, 0, NULL },
+    },
+    NULL,
+    NULL,
+    NULL,
+};
+
+struct t_memory_owner *memory_owners = &memory_owner_core;
+struct t_memory_owner *last_memory_owner = &memory_owner_core;
+
+
+/*
+ * Searches an owner by name.
+ *
+ * Returns pointer to owner found, NULL if not found.
+ */
+
+struct t_memory_owner *
+memory_owner_search (const char *name)
+{
+    struct t_memory_owner *ptr_owner;
+
+    if (!name || !name[0])
+        return NULL;
+
+    for (ptr_owner = memory_owners; ptr_owner;
+         ptr_owner = ptr_owner->next_owner)
+    {
+        if (strcmp (ptr_owner->name, name) == 0)
+            return ptr_owner;
+    }
+
+    /* owner not found */
+    return NULL;
+}
+
+/*
+ * Gets an owner by name, creates it if not found (owners are never freed
+ * before exit, so pointers can be kept in buffers).
+ *
+ * Returns pointer to owner, core owner if name is NULL/empty or if not enough
+ * memory.
+ */
+
+struct t_memory_owner *
+memory_owner_get (const char *name)
+{
+    struct t_memory_owner *ptr_owner, *new_owner;
+    int i;
+
+    if (!name || !name[0])
+        return &memory_owner_core;
+
+    ptr_owner = memory_owner_search (name);
+    if (ptr_owner)
+        return ptr_owner;
+
+    new_owner = malloc (sizeof (*new_owner));
+    if (!new_owner)
+        return &memory_owner_core;
+
+    new_owner->name = strdup (name);
+    if (!new_owner->name)
+    {
+        free (new_owner);
+        return &memory_owner_core;
+    }
+    for (i = 0; i < MEMORY_NUM_CATEGORIES; i++)
+    {
+        new_owner->counters[i].category = memory_category_string[i];
+        new_owner->counters[i].objects = 0;
+        new_owner->counters[i].bytes = 0;
+        new_owner->counters[i].bytes_max = 0;
+        new_owner->counters[i].next_counter = NULL;
+    }
+    new_owner->custom_counters = NULL;
+
+    new_owner->prev_owner = last_memory_owner;
+    new_owner->next_owner = NULL;
+    last_memory_owner->next_owner = new_owner;
+    last_memory_owner = new_owner;
+
+    return new_owner;
+}
+
+/*
+ * Adds bytes/objects to a counter (values can be negative).
+ */
+
+void
+memory_counter_add (struct t_memory_counter *counter,
+                    long long bytes, long objects)
+{
+    long long new_bytes;
+
+    new_bytes = __sync_add_and_fetch (&counter->bytes, bytes);
+    (void) __sync_add_and_fetch (&counter->objects, objects);
+    if (new_bytes > counter->bytes_max)
+        counter->bytes_max = new_bytes;
+}
+
+/*
+ * Adds bytes/objects to a core category of an owner (values can be
+ * negative, to free memory).
+ */
+
+void
+memory_add (struct t_memory_owner *owner, enum t_memory_category category,
+            long long bytes, long objects)
+{
+    if ((category < 0) || (category >= MEMORY_NUM_CATEGORIES))
+        return;
+
+    memory_counter_add (
+        &((owner) ? owner : &memory_owner_core)->counters[category],
+        bytes, objects);
+}
+
+/*
+ * Adds bytes/objects to a category of an owner (values can be negative, to
+ * free memory).
+ *
+ * The category can be one of the core categories or any other name (for
+ * example "irc_raw"); counter is created on first use.
+ */
+
+void
+memory_add_custom (struct t_memory_owner *owner, const char *category,
+                   long long bytes, long objects)
+{
+    struct t_memory_counter *ptr_counter, *new_counter;
+    int i;
+
+    if (!category || !category[0])
+        return;
+
+    if (!owner)
+        owner = &memory_owner_core;
+
+    for (i = 0; i < MEMORY_NUM_CATEGORIES; i++)
+    {
+        if (strcmp (memory_category_string[i], category) == 0)
+        {
+            memory_counter_add (&owner->counters[i], bytes, objects);
+            return;
+        }
+    }
+
+    for (ptr_counter = owner->custom_counters; ptr_counter;
+         ptr_counter = ptr_counter->next_counter)
+    {
+        if (strcmp (ptr_counter->category, category) == 0)
+        {
+            memory_counter_add (ptr_counter, bytes, objects);
+            return;
+        }
+    }
+
+    new_counter = malloc (sizeof (*new_counter));
+    if (!new_counter)
+        return;
+    new_counter->category = strdup (category);
+    if (!new_counter->category)
+    {
+        free (new_counter);
+        return;
+    }
+    new_counter->objects = 0;
+    new_counter->bytes = 0;
+    new_counter->bytes_max = 0;
+    new_counter->next_counter = owner->custom_counters;
+    owner->custom_counters = new_counter;
+
+    memory_counter_add (new_counter, bytes, objects);
+}
+
+/*
+ * Computes total of bytes/objects for all owners and categories.
+ */
+
+void
+memory_get_total (long long *bytes, long *objects)
+{
+    struct t_memory_owner *ptr_owner;
+    struct t_memory_counter *ptr_counter;
+    int i;
+
+    *bytes = 0;
+    *objects = 0;
+
+    for (ptr_owner = memory_owners; ptr_owner;
+         ptr_owner = ptr_owner->next_owner)
+    {
+        for (i = 0; i < MEMORY_NUM_CATEGORIES; i++)
+        {
+            *bytes += ptr_owner->counters[i].bytes;
+            *objects += ptr_owner->counters[i].objects;
+        }
+        for (ptr_counter = ptr_owner->custom_counters; ptr_counter;
+             ptr_counter = ptr_counter->next_counter)
+        {
+            *bytes += ptr_counter->bytes;
+            *objects += ptr_counter->objects;
+        }
+    }
+}
+
+/*
+ * Adds a counter in an infolist.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+memory_counter_add_to_infolist (struct t_infolist *infolist,
+                                struct t_memory_owner *owner,
+                                struct t_memory_counter *counter)
+{
+    struct t_infolist_item *ptr_item;
+    char value[64];
+
+    ptr_item = infolist_new_item (infolist);
+    if (!ptr_item)
+        return 0;
+
+    if (!infolist_new_var_string (ptr_item, "owner", owner->name))
+        return 0;
+    if (!infolist_new_var_string (ptr_item, "category", counter->category))
+        return 0;
+    /* bytes are strings because they can exceed an integer */
+    snprintf (value, sizeof (value), "%lld", counter->bytes);
+    if (!infolist_new_var_string (ptr_item, "bytes", value))
+        return 0;
+    snprintf (value, sizeof (value), "%lld", counter->bytes_max);
+    if (!infolist_new_var_string (ptr_item, "bytes_max", value))
+        return 0;
+    snprintf (value, sizeof (value), "%ld", counter->objects);
+    if (!infolist_new_var_string (ptr_item, "objects", value))
+        return 0;
+
+    return 1;
+}
+
+/*
+ * Adds all counters in an infolist (counters never used are skipped).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+memory_add_to_infolist (struct t_infolist *infolist)
+{
+    struct t_memory_owner *ptr_owner;
+    struct t_memory_counter *ptr_counter;
+    int i;
+
+    if (!infolist)
+        return 0;
+
+    for (ptr_owner = memory_owners; ptr_owner;
+         ptr_owner = ptr_owner->next_owner)
+    {
+        for (i = 0; i < MEMORY_NUM_CATEGORIES; i++)
+        {
+            if (ptr_owner->counters[i].bytes_max == 0)
+                continue;
+            if (!memory_counter_add_to_infolist (infolist, ptr_owner,
+                                                 &ptr_owner->counters[i]))
+                return 0;
+        }
+        for (ptr_counter = ptr_owner->custom_counters; ptr_counter;
+             ptr_counter = ptr_counter->next_counter)
+        {
+            if (!memory_counter_add_to_infolist (infolist, ptr_owner,
+                                                 ptr_counter))
+                return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Prints memory counters in WeeChat log file (usually for crash dump).
+ */
+
+void
+memory_print_log ()
+{
+    struct t_memory_owner *ptr_owner;
+    struct t_memory_counter *ptr_counter;
+    int i;
+
+    log_printf ("");
+    log_printf ("[memory counters]");
+    for (ptr_owner = memory_owners; ptr_owner;
+         ptr_owner = ptr_owner->next_owner)
+    {
+        log_printf ("  owner '%s' (addr:0x%lx)",
+                    ptr_owner->name, ptr_owner);
+        for (i = 0; i < MEMORY_NUM_CATEGORIES; i++)
+        {
+            log_printf ("    %-16s: objects:%ld, bytes:%lld, bytes_max:%lld",
+                        ptr_owner->counters[i].category,
+                        ptr_owner->counters[i].objects,
+                        ptr_owner->counters[i].bytes,
+                        ptr_owner->counters[i].bytes_max);
+        }
+        for (ptr_counter = ptr_owner->custom_counters; ptr_counter;
+             ptr_counter = ptr_counter->next_counter)
+        {
+            log_printf ("    %-16s: objects:%ld, bytes:%lld, bytes_max:%lld",
+                        ptr_counter->category,
+                        ptr_counter->objects,
+                        ptr_counter->bytes,
+                        ptr_counter->bytes_max);
+        }
+    }
+}
+
+/*
+ * Frees all owners and counters (at exit).
+ */
+
+void
+memory_end ()
+{
+    struct t_memory_owner *ptr_owner, *ptr_next_owner;
+    struct t_memory_counter *ptr_counter, *ptr_next_counter;
+
+    ptr_owner = memory_owners;
+    while (ptr_owner)
+    {
+        ptr_next_owner = ptr_owner->next_owner;
+
+        ptr_counter = ptr_owner->custom_counters;
+        while (ptr_counter)
+        {
+            ptr_next_counter = ptr_counter->next_counter;
+            free (ptr_counter->category);
+            free (ptr_counter);
+            ptr_counter = ptr_next_counter;
+        }
+        ptr_owner->custom_counters = NULL;
+
+        if (ptr_owner != &memory_owner_core)
+        {
+            free (ptr_owner->name);
+            free (ptr_owner);
+        }
+
+        ptr_owner = ptr_next_owner;
+    }
+
+    memory_owner_core.next_owner = NULL;
+    memory_owners = &memory_owner_core;
+    last_memory_owner = &memory_owner_core;
+}
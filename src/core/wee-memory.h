@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_MEMORY_H
+#define WEECHAT_MEMORY_H 1
+
+#define MEMORY_OWNER_CORE "core"
+
+struct t_infolist;
+
+enum t_memory_category
+{
+    MEMORY_CATEGORY_LINES = 0,         /* lines/line data in buffers        */
+    MEMORY_CATEGORY_LINE_STRINGS,      /* strings in lines (message, ...)   */
+    MEMORY_CATEGORY_NICKLIST,          /* nicks and groups in nicklists     */
+    MEMORY_CATEGORY_HASHTABLES,        /* hashtables and their items        */
+    MEMORY_CATEGORY_INFOLISTS,         /* infolists, items and variables    */
+    /* number of memory categories */
+    MEMORY_NUM_CATEGORIES,
+};
+
+struct t_memory_counter
+{
+    char *category;                    /* category name                     */
+    long objects;                      /* number of objects allocated       */
+    long long bytes;                   /* number of bytes allocated         */
+    long long bytes_max;               /* peak of bytes allocated           */
+    struct t_memory_counter *next_counter; /* link to next counter          */
+};
+
+struct t_memory_owner
+{
+    char *name;                        /* "core", plugin or plugin/script   */
+    struct t_memory_counter counters[MEMORY_NUM_CATEGORIES]; /* core cat.   */
+    struct t_memory_counter *custom_counters; /* categories added by plugins*/
+    struct t_memory_owner *prev_owner; /* link to previous owner            */
+    struct t_memory_owner *next_owner; /* link to next owner                */
+};
+
+/* memory variables */
+
+extern char *memory_category_string[];
+extern struct t_memory_owner memory_owner_core;
+extern struct t_memory_owner *memory_owners;
+
+/* memory functions */
+
+extern struct t_memory_owner *memory_owner_search (const char *name);
+extern struct t_memory_owner *memory_owner_get (const char *name);
+extern void memory_add (struct t_memory_owner *owner,
+                        enum t_memory_category category,
+                        long long bytes, long objects);
+extern void memory_add_custom (struct t_memory_owner *owner,
+                               const char *category,
+                               long long bytes, long objects);
+extern void memory_get_total (long long *bytes, long *objects);
+extern int memory_add_to_infolist (struct t_infolist *infolist);
+extern void memory_print_log ();
+extern void memory_end ();
+
+#endif /* WEECHAT_MEMORY_H */
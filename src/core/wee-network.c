@@ -69,6 +69,10 @@ int network_init_gnutls_ok = 0;
 gnutls_certificate_credentials_t gnutls_xcred; /* GnuTLS client credentials */
 #endif
 
+int network_connect_fd_cb (void *arg_hook_connect, int fd);
+int network_connect_attempt_timer_cb (void *arg_hook_connect,
+                                      int remaining_calls);
+
 
 /*
  * Initializes gcrypt.
@@ -732,6 +736,186 @@ error:
     return -1;
 }
 
+/*
+ * Sorts IP addresses found for a peer, before trying to connect.
+ *
+ * Groups of addresses (by family) are rotated according to the retry count:
+ * it indicates that something is wrong with whichever group of servers is
+ * being tried first after connecting, so start at a different offset to
+ * increase the chance of success; addresses are shuffled in each group.
+ *
+ * This function is called in main process (after asynchronous resolution) and
+ * in child process: random numbers are seeded in weechat_init and in
+ * network_connect_child.
+ *
+ * Returns an array of pointers to addresses (in res_remote) with
+ * *num_hosts entries, NULL if no address was found (*num_hosts == 0) or if
+ * there is not enough memory (*num_hosts > 0).
+ *
+ * Note: result must be freed after use.
+ */
+
+struct addrinfo **
+network_connect_sort_addresses (struct addrinfo *res_remote, int retry,
+                                int *num_hosts)
+{
+    struct addrinfo *ptr_res, **res_reorder;
+    int rand_num, i, num_groups, tmp_num_groups, tmp_host, last_af;
+
+    /*
+     * count all the groups of hosts by tracking family, e.g.
+     * 0 = [2001:db8::1, 2001:db8::2,
+     * 1 =  192.0.2.1, 192.0.2.2,
+     * 2 =  2002:c000:201::1, 2002:c000:201::2]
+     */
+    last_af = AF_UNSPEC;
+    num_groups = 0;
+    *num_hosts = 0;
+    for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
+    {
+        if (ptr_res->ai_family != last_af)
+            if (last_af != AF_UNSPEC)
+                num_groups++;
+
+        (*num_hosts)++;
+        last_af = ptr_res->ai_family;
+    }
+    if (last_af != AF_UNSPEC)
+        num_groups++;
+
+    if (num_groups == 0)
+    {
+        /* no IP addresses found (all AF_UNSPEC) */
+        *num_hosts = 0;
+        return NULL;
+    }
+
+    res_reorder = malloc (sizeof (*res_reorder) * (*num_hosts));
+    if (!res_reorder)
+        return NULL;
+
+    /* reorder groups */
+    retry %= num_groups;
+    i = 0;
+
+    last_af = AF_UNSPEC;
+    tmp_num_groups = 0;
+    tmp_host = i; /* start of current group */
+
+    /* top of list */
+    for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
+    {
+        if (ptr_res->ai_family != last_af)
+        {
+            if (last_af != AF_UNSPEC)
+                tmp_num_groups++;
+
+            tmp_host = i;
+        }
+
+        if (tmp_num_groups >= retry)
+        {
+            /* shuffle while adding */
+            rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
+            if (rand_num == i)
+                res_reorder[i++] = ptr_res;
+            else
+            {
+                res_reorder[i++] = res_reorder[rand_num];
+                res_reorder[rand_num] = ptr_res;
+            }
+        }
+
+        last_af = ptr_res->ai_family;
+    }
+
+    last_af = AF_UNSPEC;
+    tmp_num_groups = 0;
+    tmp_host = i; /* start of current group */
+
+    /* remainder of list */
+    for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
+    {
+        if (ptr_res->ai_family != last_af)
+        {
+            if (last_af != AF_UNSPEC)
+                tmp_num_groups++;
+
+            tmp_host = i;
+        }
+
+        if (tmp_num_groups < retry)
+        {
+            /* shuffle while adding */
+            rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
+            if (rand_num == i)
+                res_reorder[i++] = ptr_res;
+            else
+            {
+                res_reorder[i++] = res_reorder[rand_num];
+                res_reorder[rand_num] = ptr_res;
+            }
+        }
+        else
+            break;
+
+        last_af = ptr_res->ai_family;
+    }
+
+    return res_reorder;
+}
+
+/*
+ * Interleaves IP addresses by family: family of first address is kept first,
+ * then families alternate (for example IPv6, IPv4, IPv6, IPv4, ...), as
+ * described in RFC 8305 ("Happy Eyeballs").
+ */
+
+void
+network_connect_interleave_addresses (struct addrinfo **addrs, int num_addrs)
+{
+    struct addrinfo **first, **others;
+    int i, num_first, num_others, index_first, index_others;
+
+    if (!addrs || (num_addrs < 3))
+        return;
+
+    first = malloc (sizeof (*first) * num_addrs);
+    others = malloc (sizeof (*others) * num_addrs);
+    if (!first || !others)
+    {
+        if (first)
+            free (first);
+        if (others)
+            free (others);
+        return;
+    }
+
+    num_first = 0;
+    num_others = 0;
+    for (i = 0; i < num_addrs; i++)
+    {
+        if (addrs[i]->ai_family == addrs[0]->ai_family)
+            first[num_first++] = addrs[i];
+        else
+            others[num_others++] = addrs[i];
+    }
+
+    i = 0;
+    index_first = 0;
+    index_others = 0;
+    while ((index_first < num_first) || (index_others < num_others))
+    {
+        if (index_first < num_first)
+            addrs[i++] = first[index_first++];
+        if (index_others < num_others)
+            addrs[i++] = others[index_others++];
+    }
+
+    free (first);
+    free (others);
+}
+
 /*
  * Connects to peer in a child process.
  */
@@ -757,15 +941,8 @@ network_connect_child (struct t_hook *hook_connect)
     struct iovec iov[1];
     char iov_data[1] = { 0 };
 #endif
-    /*
-     * indicates that something is wrong with whichever group of
-     * servers is being tried first after connecting, so start at
-     * a different offset to increase the chance of success
-     */
-    int retry, rand_num, i;
-    int num_groups, tmp_num_groups, num_hosts, tmp_host;
+    int i, num_hosts;
     struct addrinfo **res_reorder;
-    int last_af;
     struct timeval tv_time;
 
     res_local = NULL;
@@ -920,114 +1097,16 @@ network_connect_child (struct t_hook *hook_connect)
 
     /* res_local != NULL now indicates that bind() is required */
 
-    /*
-     * count all the groups of hosts by tracking family, e.g.
-     * 0 = [2001:db8::1, 2001:db8::2,
-     * 1 =  192.0.2.1, 192.0.2.2,
-     * 2 =  2002:c000:201::1, 2002:c000:201::2]
-     */
-    last_af = AF_UNSPEC;
-    num_groups = 0;
-    num_hosts = 0;
-    for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
-    {
-        if (ptr_res->ai_family != last_af)
-            if (last_af != AF_UNSPEC)
-                num_groups++;
-
-        num_hosts++;
-        last_af = ptr_res->ai_family;
-    }
-    if (last_af != AF_UNSPEC)
-        num_groups++;
-
-    res_reorder = malloc (sizeof (*res_reorder) * num_hosts);
+    res_reorder = network_connect_sort_addresses (res_remote,
+                                                  HOOK_CONNECT(hook_connect, retry),
+                                                  &num_hosts);
     if (!res_reorder)
     {
         snprintf (status_without_string, sizeof (status_without_string),
-                  "%c00000", '0' + WEECHAT_HOOK_CONNECT_MEMORY_ERROR);
-        num_written = write (HOOK_CONNECT(hook_connect, child_write),
-                             status_without_string, strlen (status_without_string));
-        (void) num_written;
-        goto end;
-    }
-
-    /* reorder groups */
-    retry = HOOK_CONNECT(hook_connect, retry);
-    if (num_groups > 0)
-    {
-        retry %= num_groups;
-        i = 0;
-
-        last_af = AF_UNSPEC;
-        tmp_num_groups = 0;
-        tmp_host = i; /* start of current group */
-
-        /* top of list */
-        for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
-        {
-            if (ptr_res->ai_family != last_af)
-            {
-                if (last_af != AF_UNSPEC)
-                    tmp_num_groups++;
-
-                tmp_host = i;
-            }
-
-            if (tmp_num_groups >= retry)
-            {
-                /* shuffle while adding */
-                rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
-                if (rand_num == i)
-                    res_reorder[i++] = ptr_res;
-                else
-                {
-                    res_reorder[i++] = res_reorder[rand_num];
-                    res_reorder[rand_num] = ptr_res;
-                }
-            }
-
-            last_af = ptr_res->ai_family;
-        }
-
-        last_af = AF_UNSPEC;
-        tmp_num_groups = 0;
-        tmp_host = i; /* start of current group */
-
-        /* remainder of list */
-        for (ptr_res = res_remote; ptr_res; ptr_res = ptr_res->ai_next)
-        {
-            if (ptr_res->ai_family != last_af)
-            {
-                if (last_af != AF_UNSPEC)
-                    tmp_num_groups++;
-
-                tmp_host = i;
-            }
-
-            if (tmp_num_groups < retry)
-            {
-                /* shuffle while adding */
-                rand_num = tmp_host + (rand() % ((i + 1) - tmp_host));
-                if (rand_num == i)
-                    res_reorder[i++] = ptr_res;
-                else
-                {
-                    res_reorder[i++] = res_reorder[rand_num];
-                    res_reorder[rand_num] = ptr_res;
-                }
-            }
-            else
-                break;
-
-            last_af = ptr_res->ai_family;
-        }
-    }
-    else
-    {
-        /* no IP addresses found (all AF_UNSPEC) */
-        snprintf (status_without_string, sizeof (status_without_string),
-                  "%c00000", '0' + WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND);
+                  "%c00000",
+                  '0' + ((num_hosts > 0) ?
+                         WEECHAT_HOOK_CONNECT_MEMORY_ERROR :
+                         WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND));
         num_written = write (HOOK_CONNECT(hook_connect, child_write),
                              status_without_string, strlen (status_without_string));
         (void) num_written;
@@ -1263,7 +1342,7 @@ int
 network_connect_gnutls_handshake_fd_cb (void *arg_hook_connect, int fd)
 {
     struct t_hook *hook_connect;
-    int rc, direction, flags;
+    int rc, direction, flags, sock;
 
     /* make C compiler happy */
     (void) fd;
@@ -1318,10 +1397,12 @@ network_connect_gnutls_handshake_fd_cb (void *arg_hook_connect, int fd)
         }
 #endif
         unhook (HOOK_CONNECT(hook_connect, handshake_hook_fd));
+        sock = HOOK_CONNECT(hook_connect, sock);
+        HOOK_CONNECT(hook_connect, sock) = -1;
         (void) (HOOK_CONNECT(hook_connect, callback))
                 (hook_connect->callback_data,
                  WEECHAT_HOOK_CONNECT_OK, 0,
-                 HOOK_CONNECT(hook_connect, sock),
+                 sock,
                  NULL, HOOK_CONNECT(hook_connect, handshake_ip_address));
         unhook (hook_connect);
     }
@@ -1361,6 +1442,110 @@ network_connect_gnutls_handshake_timer_cb (void *arg_hook_connect,
 }
 #endif
 
+/*
+ * Starts GnuTLS handshake on the connected socket (HOOK_CONNECT(sock)).
+ *
+ * Returns:
+ *    1: handshake in progress (it will be completed by an fd callback)
+ *    0: handshake OK
+ *   -1: error (callback has been called and hook removed)
+ */
+
+#ifdef HAVE_GNUTLS
+int
+network_connect_gnutls_handshake (struct t_hook *hook_connect,
+                                  const char *ip_address)
+{
+    int rc, direction, sock;
+
+    sock = HOOK_CONNECT(hook_connect, sock);
+
+    /*
+     * the socket needs to be non-blocking since the call to
+     * gnutls_handshake can block
+     */
+    HOOK_CONNECT(hook_connect, handshake_fd_flags) = fcntl (sock, F_GETFL);
+    if (HOOK_CONNECT(hook_connect, handshake_fd_flags) == -1)
+        HOOK_CONNECT(hook_connect, handshake_fd_flags) = 0;
+    fcntl (sock, F_SETFL,
+           HOOK_CONNECT(hook_connect, handshake_fd_flags) | O_NONBLOCK);
+    gnutls_transport_set_ptr (*HOOK_CONNECT(hook_connect, gnutls_sess),
+                              (gnutls_transport_ptr_t) ((ptrdiff_t) sock));
+    if (HOOK_CONNECT(hook_connect, gnutls_dhkey_size) > 0)
+    {
+        gnutls_dh_set_prime_bits (*HOOK_CONNECT(hook_connect, gnutls_sess),
+                                  (unsigned int) HOOK_CONNECT(hook_connect, gnutls_dhkey_size));
+    }
+    rc = gnutls_handshake (*HOOK_CONNECT(hook_connect, gnutls_sess));
+    if ((rc == GNUTLS_E_AGAIN) || (rc == GNUTLS_E_INTERRUPTED))
+    {
+        /*
+         * gnutls was unable to proceed with the handshake without
+         * blocking: non fatal error, we just have to wait for an
+         * event about handshake
+         */
+        if (HOOK_CONNECT(hook_connect, hook_fd))
+        {
+            unhook (HOOK_CONNECT(hook_connect, hook_fd));
+            HOOK_CONNECT(hook_connect, hook_fd) = NULL;
+        }
+        if (ip_address != HOOK_CONNECT(hook_connect, handshake_ip_address))
+        {
+            if (HOOK_CONNECT(hook_connect, handshake_ip_address))
+                free (HOOK_CONNECT(hook_connect, handshake_ip_address));
+            HOOK_CONNECT(hook_connect, handshake_ip_address) =
+                (ip_address) ? strdup (ip_address) : NULL;
+        }
+        direction = gnutls_record_get_direction (*HOOK_CONNECT(hook_connect, gnutls_sess));
+        HOOK_CONNECT(hook_connect, handshake_hook_fd) =
+            hook_fd (hook_connect->plugin,
+                     sock,
+                     (!direction ? 1 : 0), (direction  ? 1 : 0), 0,
+                     &network_connect_gnutls_handshake_fd_cb,
+                     hook_connect);
+        HOOK_CONNECT(hook_connect, handshake_hook_timer) =
+            hook_timer (hook_connect->plugin,
+                        CONFIG_INTEGER(config_network_gnutls_handshake_timeout) * 1000,
+                        0, 1,
+                        &network_connect_gnutls_handshake_timer_cb,
+                        hook_connect);
+        return 1;
+    }
+    else if (rc != GNUTLS_E_SUCCESS)
+    {
+        (void) (HOOK_CONNECT(hook_connect, callback))
+            (hook_connect->callback_data,
+             WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
+             rc, sock,
+             gnutls_strerror (rc),
+             ip_address);
+        unhook (hook_connect);
+        return -1;
+    }
+    fcntl (sock, F_SETFL, HOOK_CONNECT(hook_connect, handshake_fd_flags));
+#if LIBGNUTLS_VERSION_NUMBER < 0x02090a
+    /*
+     * gnutls only has the gnutls_certificate_set_verify_function()
+     * function since version 2.9.10. We need to call our verify
+     * function manually after the handshake for old gnutls versions
+     */
+    if (hook_connect_gnutls_verify_certificates (*HOOK_CONNECT(hook_connect, gnutls_sess)) != 0)
+    {
+        (void) (HOOK_CONNECT(hook_connect, callback))
+            (hook_connect->callback_data,
+             WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
+             rc, sock,
+             "Error in the certificate.",
+             ip_address);
+        unhook (hook_connect);
+        return -1;
+    }
+#endif
+
+    return 0;
+}
+#endif
+
 /*
  * Reads connection progress from child process.
  */
@@ -1373,7 +1558,7 @@ network_connect_child_read_cb (void *arg_hook_connect, int fd)
     int num_read;
     long size_msg;
 #ifdef HAVE_GNUTLS
-    int rc, direction;
+    int rc;
 #endif
     int sock;
 #ifdef HOOK_CONNECT_MAX_SOCKETS
@@ -1471,86 +1656,17 @@ network_connect_child_read_cb (void *arg_hook_connect, int fd)
 #ifdef HAVE_GNUTLS
             if (HOOK_CONNECT(hook_connect, gnutls_sess))
             {
-                /*
-                 * the socket needs to be non-blocking since the call to
-                 * gnutls_handshake can block
-                 */
-                HOOK_CONNECT(hook_connect, handshake_fd_flags) =
-                    fcntl (HOOK_CONNECT(hook_connect, sock), F_GETFL);
-                if (HOOK_CONNECT(hook_connect, handshake_fd_flags) == -1)
-                    HOOK_CONNECT(hook_connect, handshake_fd_flags) = 0;
-                fcntl (HOOK_CONNECT(hook_connect, sock), F_SETFL,
-                       HOOK_CONNECT(hook_connect, handshake_fd_flags) | O_NONBLOCK);
-                gnutls_transport_set_ptr (*HOOK_CONNECT(hook_connect, gnutls_sess),
-                                          (gnutls_transport_ptr_t) ((ptrdiff_t) HOOK_CONNECT(hook_connect, sock)));
-                if (HOOK_CONNECT(hook_connect, gnutls_dhkey_size) > 0)
-                {
-                    gnutls_dh_set_prime_bits (*HOOK_CONNECT(hook_connect, gnutls_sess),
-                                              (unsigned int) HOOK_CONNECT(hook_connect, gnutls_dhkey_size));
-                }
-                rc = gnutls_handshake (*HOOK_CONNECT(hook_connect, gnutls_sess));
-                if ((rc == GNUTLS_E_AGAIN) || (rc == GNUTLS_E_INTERRUPTED))
-                {
-                    /*
-                     * gnutls was unable to proceed with the handshake without
-                     * blocking: non fatal error, we just have to wait for an
-                     * event about handshake
-                     */
-                    unhook (HOOK_CONNECT(hook_connect, hook_fd));
-                    HOOK_CONNECT(hook_connect, hook_fd) = NULL;
-                    direction = gnutls_record_get_direction (*HOOK_CONNECT(hook_connect, gnutls_sess));
-                    HOOK_CONNECT(hook_connect, handshake_ip_address) = cb_ip_address;
-                    HOOK_CONNECT(hook_connect, handshake_hook_fd) =
-                        hook_fd (hook_connect->plugin,
-                                 HOOK_CONNECT(hook_connect, sock),
-                                 (!direction ? 1 : 0), (direction  ? 1 : 0), 0,
-                                 &network_connect_gnutls_handshake_fd_cb,
-                                 hook_connect);
-                    HOOK_CONNECT(hook_connect, handshake_hook_timer) =
-                        hook_timer (hook_connect->plugin,
-                                    CONFIG_INTEGER(config_network_gnutls_handshake_timeout) * 1000,
-                                    0, 1,
-                                    &network_connect_gnutls_handshake_timer_cb,
-                                    hook_connect);
-                    return WEECHAT_RC_OK;
-                }
-                else if (rc != GNUTLS_E_SUCCESS)
-                {
-                    (void) (HOOK_CONNECT(hook_connect, callback))
-                        (hook_connect->callback_data,
-                         WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
-                         rc, sock,
-                         gnutls_strerror (rc),
-                         cb_ip_address);
-                    unhook (hook_connect);
-                    if (cb_ip_address)
-                        free (cb_ip_address);
-                    return WEECHAT_RC_OK;
-                }
-                fcntl (HOOK_CONNECT(hook_connect, sock), F_SETFL,
-                       HOOK_CONNECT(hook_connect, handshake_fd_flags));
-#if LIBGNUTLS_VERSION_NUMBER < 0x02090a
-                /*
-                 * gnutls only has the gnutls_certificate_set_verify_function()
-                 * function since version 2.9.10. We need to call our verify
-                 * function manually after the handshake for old gnutls versions
-                 */
-                if (hook_connect_gnutls_verify_certificates (*HOOK_CONNECT(hook_connect, gnutls_sess)) != 0)
+                rc = network_connect_gnutls_handshake (hook_connect,
+                                                       cb_ip_address);
+                if (rc != 0)
                 {
-                    (void) (HOOK_CONNECT(hook_connect, callback))
-                        (hook_connect->callback_data,
-                         WEECHAT_HOOK_CONNECT_GNUTLS_HANDSHAKE_ERROR,
-                         rc, sock,
-                         "Error in the certificate.",
-                         cb_ip_address);
-                    unhook (hook_connect);
                     if (cb_ip_address)
                         free (cb_ip_address);
                     return WEECHAT_RC_OK;
                 }
-#endif
             }
 #endif
+            HOOK_CONNECT(hook_connect, sock) = -1;
         }
         else
         {
@@ -1602,25 +1718,20 @@ network_connect_child_read_cb (void *arg_hook_connect, int fd)
 }
 
 /*
- * Connects with fork (called by hook_connect() only!).
+ * Initializes GnuTLS session for a connection (if SSL is asked).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error (callback has been called and hook removed)
  */
 
-void
-network_connect_with_fork (struct t_hook *hook_connect)
-{
-    int child_pipe[2], rc;
-#ifdef HOOK_CONNECT_MAX_SOCKETS
-    int i;
-#else
-    int child_socket[2];
-#endif
 #ifdef HAVE_GNUTLS
+int
+network_connect_gnutls_init (struct t_hook *hook_connect)
+{
+    int rc;
     const char *pos_error;
-#endif
-    pid_t pid;
 
-#ifdef HAVE_GNUTLS
-    /* initialize GnuTLS if SSL asked */
     if (HOOK_CONNECT(hook_connect, gnutls_sess))
     {
         if (gnutls_init (HOOK_CONNECT(hook_connect, gnutls_sess), GNUTLS_CLIENT) != GNUTLS_E_SUCCESS)
@@ -1630,7 +1741,7 @@ network_connect_with_fork (struct t_hook *hook_connect)
                  WEECHAT_HOOK_CONNECT_GNUTLS_INIT_ERROR,
                  0, -1, NULL, NULL);
             unhook (hook_connect);
-            return;
+            return 0;
         }
         rc = gnutls_priority_set_direct (*HOOK_CONNECT(hook_connect, gnutls_sess),
                                          HOOK_CONNECT(hook_connect, gnutls_priorities),
@@ -1642,14 +1753,46 @@ network_connect_with_fork (struct t_hook *hook_connect)
                  WEECHAT_HOOK_CONNECT_GNUTLS_INIT_ERROR,
                  0, -1, _("invalid priorities"), NULL);
             unhook (hook_connect);
-            return;
+            return 0;
         }
         gnutls_credentials_set (*HOOK_CONNECT(hook_connect, gnutls_sess),
                                 GNUTLS_CRD_CERTIFICATE,
                                 gnutls_xcred);
         gnutls_transport_set_ptr (*HOOK_CONNECT(hook_connect, gnutls_sess),
                                   (gnutls_transport_ptr_t) ((unsigned long) HOOK_CONNECT(hook_connect, sock)));
+        /* let caller set session data (to resume a previous session) */
+        if (HOOK_CONNECT(hook_connect, gnutls_cb))
+        {
+            (void) (HOOK_CONNECT(hook_connect, gnutls_cb))
+                (hook_connect->callback_data,
+                 *HOOK_CONNECT(hook_connect, gnutls_sess), NULL, 0,
+                 NULL, 0, NULL,
+                 WEECHAT_HOOK_CONNECT_GNUTLS_CB_INIT_SESSION);
+        }
     }
+
+    return 1;
+}
+#endif
+
+/*
+ * Connects with fork (called by hook_connect() only!).
+ */
+
+void
+network_connect_with_fork (struct t_hook *hook_connect)
+{
+    int child_pipe[2], rc;
+#ifdef HOOK_CONNECT_MAX_SOCKETS
+    int i;
+#else
+    int child_socket[2];
+#endif
+    pid_t pid;
+
+#ifdef HAVE_GNUTLS
+    if (!network_connect_gnutls_init (hook_connect))
+        return;
 #endif
 
     /* create pipe for child process */
@@ -1726,3 +1869,1108 @@ network_connect_with_fork (struct t_hook *hook_connect)
                                                    &network_connect_child_read_cb,
                                                    hook_connect);
 }
+
+/*
+ * Frees a name resolution.
+ */
+
+void
+network_resolve_free (struct t_network_resolve *resolve)
+{
+    if (!resolve)
+        return;
+
+    if (resolve->pipe_read != -1)
+        close (resolve->pipe_read);
+    if (resolve->pipe_write != -1)
+        close (resolve->pipe_write);
+    if (resolve->address)
+        free (resolve->address);
+    if (resolve->port)
+        free (resolve->port);
+    if (resolve->local_hostname)
+        free (resolve->local_hostname);
+    if (resolve->socks4_address)
+        free (resolve->socks4_address);
+    if (resolve->res_remote)
+        freeaddrinfo (resolve->res_remote);
+    if (resolve->res_local)
+        freeaddrinfo (resolve->res_local);
+    if (resolve->res_socks4)
+        freeaddrinfo (resolve->res_socks4);
+    pthread_mutex_destroy (&resolve->mutex);
+
+    free (resolve);
+}
+
+/*
+ * Resolves names for a connection (function running in a thread).
+ *
+ * When resolution is done, one byte is written in pipe to wake up main
+ * thread (which reads results), unless the connect hook has been removed in
+ * the meantime: then the resolution is freed by this thread.
+ */
+
+void *
+network_resolve_thread (void *arg_resolve)
+{
+    struct t_network_resolve *resolve;
+    struct addrinfo hints;
+    int abandoned, pipe_write, num_written;
+
+    resolve = (struct t_network_resolve *)arg_resolve;
+
+    memset (&hints, 0, sizeof (hints));
+    hints.ai_family = resolve->family;
+    hints.ai_socktype = SOCK_STREAM;
+#ifdef AI_ADDRCONFIG
+    hints.ai_flags = AI_ADDRCONFIG;
+#endif
+    resolve->rc_remote = getaddrinfo (resolve->address, resolve->port,
+                                      &hints, &resolve->res_remote);
+
+    if ((resolve->rc_remote == 0) && resolve->local_hostname)
+    {
+        hints.ai_family = AF_UNSPEC;
+        resolve->rc_local = getaddrinfo (resolve->local_hostname, NULL,
+                                         &hints, &resolve->res_local);
+    }
+
+    if ((resolve->rc_remote == 0) && resolve->socks4_address)
+    {
+        /* socks4 proxy needs the IPv4 address of peer */
+        hints.ai_family = AF_INET;
+        hints.ai_flags = 0;
+        resolve->rc_socks4 = getaddrinfo (resolve->socks4_address, NULL,
+                                          &hints, &resolve->res_socks4);
+    }
+
+    pthread_mutex_lock (&resolve->mutex);
+    resolve->done = 1;
+    abandoned = resolve->abandoned;
+    pipe_write = resolve->pipe_write;
+    resolve->pipe_write = -1;
+    pthread_mutex_unlock (&resolve->mutex);
+
+    /* resolve must not be used after this point, unless abandoned */
+    if (abandoned)
+    {
+        close (pipe_write);
+        network_resolve_free (resolve);
+    }
+    else
+    {
+        num_written = write (pipe_write, "1", 1);
+        (void) num_written;
+        close (pipe_write);
+    }
+
+    return NULL;
+}
+
+/*
+ * Ends a connection without fork with an error.
+ */
+
+void
+network_connect_error (struct t_hook *hook_connect, int status,
+                       const char *error)
+{
+    (void) (HOOK_CONNECT(hook_connect, callback))
+        (hook_connect->callback_data, status, 0, -1, error, NULL);
+    unhook (hook_connect);
+}
+
+/*
+ * Sets state of handshake with proxy: builds data to send or sets length
+ * of data to receive.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+network_connect_proxy_set_state (struct t_hook *hook_connect, int state)
+{
+    struct t_proxy *ptr_proxy;
+    struct addrinfo *res_socks4;
+    char authbuf[128], authbuf_base64[512], *username, *password;
+    unsigned char *buffer;
+    unsigned short port;
+    int length, username_len, password_len, address_len;
+
+    ptr_proxy = proxy_search (HOOK_CONNECT(hook_connect, proxy));
+    if (!ptr_proxy)
+        return 0;
+
+    buffer = HOOK_CONNECT(hook_connect, proxy_buffer);
+    length = 0;
+
+    switch (state)
+    {
+        case NETWORK_PROXY_STATE_HTTP_REQUEST:
+            if (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_USERNAME])
+                && CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_USERNAME])[0])
+            {
+                /* authentication */
+                username = eval_expression (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_USERNAME]),
+                                            NULL, NULL, NULL);
+                if (!username)
+                    return 0;
+                password = eval_expression (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_PASSWORD]),
+                                            NULL, NULL, NULL);
+                if (!password)
+                {
+                    free (username);
+                    return 0;
+                }
+                snprintf (authbuf, sizeof (authbuf), "%s:%s", username, password);
+                free (username);
+                free (password);
+                string_encode_base64 (authbuf, strlen (authbuf), authbuf_base64);
+                length = snprintf ((char *)buffer,
+                                   sizeof (HOOK_CONNECT(hook_connect, proxy_buffer)),
+                                   "CONNECT %s:%d HTTP/1.0\r\n"
+                                   "Proxy-Authorization: Basic %s\r\n\r\n",
+                                   HOOK_CONNECT(hook_connect, address),
+                                   HOOK_CONNECT(hook_connect, port),
+                                   authbuf_base64);
+            }
+            else
+            {
+                /* no authentication */
+                length = snprintf ((char *)buffer,
+                                   sizeof (HOOK_CONNECT(hook_connect, proxy_buffer)),
+                                   "CONNECT %s:%d HTTP/1.0\r\n\r\n",
+                                   HOOK_CONNECT(hook_connect, address),
+                                   HOOK_CONNECT(hook_connect, port));
+            }
+            if (length >= (int)sizeof (HOOK_CONNECT(hook_connect, proxy_buffer)))
+                return 0;
+            break;
+        case NETWORK_PROXY_STATE_HTTP_RESPONSE:
+            /* headers are read until an empty line */
+            length = sizeof (HOOK_CONNECT(hook_connect, proxy_buffer)) - 1;
+            break;
+        case NETWORK_PROXY_STATE_SOCKS4_REQUEST:
+            res_socks4 = HOOK_CONNECT(hook_connect, resolve)->res_socks4;
+            if ((HOOK_CONNECT(hook_connect, resolve)->rc_socks4 != 0)
+                || !res_socks4)
+            {
+                return 0;
+            }
+            username = eval_expression (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_USERNAME]),
+                                        NULL, NULL, NULL);
+            if (!username)
+                return 0;
+            username_len = strlen (username);
+            if (username_len > 127)
+                username_len = 127;
+            buffer[0] = 4;   /* version 4 */
+            buffer[1] = 1;   /* command: 1 for connect */
+            port = htons (HOOK_CONNECT(hook_connect, port));
+            memcpy (buffer + 2, &port, 2);
+            memcpy (buffer + 4,
+                    &(((struct sockaddr_in *)res_socks4->ai_addr)->sin_addr),
+                    4);
+            memcpy (buffer + 8, username, username_len);
+            buffer[8 + username_len] = '\0';
+            free (username);
+            length = 8 + username_len + 1;
+            break;
+        case NETWORK_PROXY_STATE_SOCKS4_RESPONSE:
+            length = 8;
+            break;
+        case NETWORK_PROXY_STATE_SOCKS5_GREETING:
+            buffer[0] = 5;   /* version 5 */
+            buffer[1] = 1;   /* number of methods */
+            buffer[2] = (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_USERNAME])
+                         && CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_USERNAME])[0]) ?
+                2 : 0;       /* with (2) or without (0) authentication */
+            length = 3;
+            break;
+        case NETWORK_PROXY_STATE_SOCKS5_METHOD:
+            length = 2;
+            break;
+        case NETWORK_PROXY_STATE_SOCKS5_AUTH:
+            /* authentication as in RFC 1929 */
+            username = eval_expression (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_USERNAME]),
+                                        NULL, NULL, NULL);
+            if (!username)
+                return 0;
+            password = eval_expression (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_PASSWORD]),
+                                        NULL, NULL, NULL);
+            if (!password)
+            {
+                free (username);
+                return 0;
+            }
+            username_len = strlen (username);
+            if (username_len > 255)
+                username_len = 255;
+            password_len = strlen (password);
+            if (password_len > 255)
+                password_len = 255;
+            buffer[0] = 1;
+            buffer[1] = (unsigned char) username_len;
+            memcpy (buffer + 2, username, username_len);
+            buffer[2 + username_len] = (unsigned char) password_len;
+            memcpy (buffer + 3 + username_len, password, password_len);
+            free (username);
+            free (password);
+            length = 3 + username_len + password_len;
+            break;
+        case NETWORK_PROXY_STATE_SOCKS5_AUTH_STATUS:
+            length = 2;
+            break;
+        case NETWORK_PROXY_STATE_SOCKS5_REQUEST:
+            address_len = strlen (HOOK_CONNECT(hook_connect, address));
+            if (address_len > 255)
+                return 0;
+            buffer[0] = 5;   /* version 5 */
+            buffer[1] = 1;   /* command: 1 for connect */
+            buffer[2] = 0;   /* reserved */
+            buffer[3] = 3;   /* address type: ipv4 (1), domainname (3), ipv6 (4) */
+            buffer[4] = (unsigned char) address_len;
+            memcpy (buffer + 5, HOOK_CONNECT(hook_connect, address), address_len);
+            port = htons (HOOK_CONNECT(hook_connect, port));
+            memcpy (buffer + 5 + address_len, &port, 2);
+            length = 5 + address_len + 2;
+            break;
+        case NETWORK_PROXY_STATE_SOCKS5_REPLY:
+            length = 4;
+            break;
+        case NETWORK_PROXY_STATE_SOCKS5_ADDRESS_LENGTH:
+            length = 1;
+            break;
+        case NETWORK_PROXY_STATE_SOCKS5_ADDRESS:
+            /* length is set by caller (it depends on address type) */
+            length = 0;
+            break;
+    }
+
+    HOOK_CONNECT(hook_connect, proxy_state) = state;
+    HOOK_CONNECT(hook_connect, proxy_length) = length;
+    HOOK_CONNECT(hook_connect, proxy_pos) = 0;
+
+    return 1;
+}
+
+/*
+ * Checks data received from proxy and goes to next state of handshake.
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+network_connect_proxy_received (struct t_hook *hook_connect)
+{
+    struct t_proxy *ptr_proxy;
+    unsigned char *buffer;
+
+    ptr_proxy = proxy_search (HOOK_CONNECT(hook_connect, proxy));
+    if (!ptr_proxy)
+        return 0;
+
+    buffer = HOOK_CONNECT(hook_connect, proxy_buffer);
+
+    switch (HOOK_CONNECT(hook_connect, proxy_state))
+    {
+        case NETWORK_PROXY_STATE_HTTP_RESPONSE:
+            /* success result must be like: "HTTP/1.0 200 OK" */
+            if ((HOOK_CONNECT(hook_connect, proxy_pos) < 12)
+                || memcmp (buffer, "HTTP/", 5) || memcmp (buffer + 9, "200", 3))
+            {
+                return 0;
+            }
+            return network_connect_proxy_set_state (hook_connect,
+                                                    NETWORK_PROXY_STATE_DONE);
+        case NETWORK_PROXY_STATE_SOCKS4_RESPONSE:
+            if ((buffer[0] != 0) || (buffer[1] != 90))
+                return 0;
+            return network_connect_proxy_set_state (hook_connect,
+                                                    NETWORK_PROXY_STATE_DONE);
+        case NETWORK_PROXY_STATE_SOCKS5_METHOD:
+            if (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_USERNAME])
+                && CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_USERNAME])[0])
+            {
+                /* socks version must be 5 and method 2 (authentication) */
+                if ((buffer[0] != 5) || (buffer[1] != 2))
+                    return 0;
+                return network_connect_proxy_set_state (hook_connect,
+                                                        NETWORK_PROXY_STATE_SOCKS5_AUTH);
+            }
+            /* socks version must be 5 and method 0 (no authentication) */
+            if ((buffer[0] != 5) || (buffer[1] != 0))
+                return 0;
+            return network_connect_proxy_set_state (hook_connect,
+                                                    NETWORK_PROXY_STATE_SOCKS5_REQUEST);
+        case NETWORK_PROXY_STATE_SOCKS5_AUTH_STATUS:
+            /* buffer[1] = auth state, must be 0 for success */
+            if (buffer[1] != 0)
+                return 0;
+            return network_connect_proxy_set_state (hook_connect,
+                                                    NETWORK_PROXY_STATE_SOCKS5_REQUEST);
+        case NETWORK_PROXY_STATE_SOCKS5_REPLY:
+            if ((buffer[0] != 5) || (buffer[1] != 0))
+                return 0;
+            /* buffer[3] = address type (bound address is ignored) */
+            switch (buffer[3])
+            {
+                case 1:
+                    /* ipv4: address of 4 bytes and port of 2 bytes */
+                    if (!network_connect_proxy_set_state (hook_connect,
+                                                          NETWORK_PROXY_STATE_SOCKS5_ADDRESS))
+                        return 0;
+                    HOOK_CONNECT(hook_connect, proxy_length) = 6;
+                    return 1;
+                case 3:
+                    /* domainname: length of address, then address + port */
+                    return network_connect_proxy_set_state (hook_connect,
+                                                            NETWORK_PROXY_STATE_SOCKS5_ADDRESS_LENGTH);
+                case 4:
+                    /* ipv6: address of 16 bytes and port of 2 bytes */
+                    if (!network_connect_proxy_set_state (hook_connect,
+                                                          NETWORK_PROXY_STATE_SOCKS5_ADDRESS))
+                        return 0;
+                    HOOK_CONNECT(hook_connect, proxy_length) = 18;
+                    return 1;
+            }
+            return 0;
+        case NETWORK_PROXY_STATE_SOCKS5_ADDRESS_LENGTH:
+            if (!network_connect_proxy_set_state (hook_connect,
+                                                  NETWORK_PROXY_STATE_SOCKS5_ADDRESS))
+                return 0;
+            HOOK_CONNECT(hook_connect, proxy_length) = buffer[0] + 2;
+            return 1;
+        case NETWORK_PROXY_STATE_SOCKS5_ADDRESS:
+            return network_connect_proxy_set_state (hook_connect,
+                                                    NETWORK_PROXY_STATE_DONE);
+    }
+
+    return 0;
+}
+
+/*
+ * Sends/receives data for handshake with proxy, without blocking.
+ *
+ * Returns:
+ *    1: handshake OK
+ *    0: handshake in progress (waiting for socket to be ready)
+ *   -1: error
+ */
+
+int
+network_connect_proxy_io (struct t_hook *hook_connect)
+{
+    unsigned char *buffer;
+    int sock, state, num, length;
+
+    sock = HOOK_CONNECT(hook_connect, sock);
+    buffer = HOOK_CONNECT(hook_connect, proxy_buffer);
+
+    while (1)
+    {
+        state = HOOK_CONNECT(hook_connect, proxy_state);
+        if (state == NETWORK_PROXY_STATE_DONE)
+            return 1;
+
+        length = HOOK_CONNECT(hook_connect, proxy_length) -
+            HOOK_CONNECT(hook_connect, proxy_pos);
+
+        switch (state)
+        {
+            case NETWORK_PROXY_STATE_HTTP_REQUEST:
+            case NETWORK_PROXY_STATE_SOCKS4_REQUEST:
+            case NETWORK_PROXY_STATE_SOCKS5_GREETING:
+            case NETWORK_PROXY_STATE_SOCKS5_AUTH:
+            case NETWORK_PROXY_STATE_SOCKS5_REQUEST:
+                num = send (sock,
+                            buffer + HOOK_CONNECT(hook_connect, proxy_pos),
+                            length, 0);
+                if (num < 0)
+                {
+                    if ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                        || (errno == EINTR))
+                        return 0;
+                    return -1;
+                }
+                HOOK_CONNECT(hook_connect, proxy_pos) += num;
+                if (num < length)
+                    return 0;
+                /* all data sent, next state is an answer from proxy */
+                if (!network_connect_proxy_set_state (hook_connect, state + 1))
+                    return -1;
+                break;
+            default:
+                /*
+                 * HTTP headers are read byte by byte, so that no data sent
+                 * by peer after the headers is lost
+                 */
+                num = recv (sock,
+                            buffer + HOOK_CONNECT(hook_connect, proxy_pos),
+                            (state == NETWORK_PROXY_STATE_HTTP_RESPONSE) ?
+                            1 : length,
+                            0);
+                if (num == 0)
+                    return -1;
+                if (num < 0)
+                {
+                    if ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                        || (errno == EINTR))
+                        return 0;
+                    return -1;
+                }
+                HOOK_CONNECT(hook_connect, proxy_pos) += num;
+                if (state == NETWORK_PROXY_STATE_HTTP_RESPONSE)
+                {
+                    if ((HOOK_CONNECT(hook_connect, proxy_pos) < 4)
+                        || (memcmp (buffer + HOOK_CONNECT(hook_connect, proxy_pos) - 4,
+                                    "\r\n\r\n", 4) != 0))
+                    {
+                        if (num == length)
+                            return -1;
+                        break;
+                    }
+                }
+                else if (num < length)
+                    break;
+                if (!network_connect_proxy_received (hook_connect))
+                    return -1;
+                break;
+        }
+    }
+
+    /* never executed */
+    return -1;
+}
+
+/*
+ * Ends a connection without fork: starts the GnuTLS handshake if needed and
+ * calls the connect callback.
+ */
+
+void
+network_connect_done (struct t_hook *hook_connect)
+{
+    int sock;
+#ifdef HAVE_GNUTLS
+    int rc;
+#endif
+
+    if (HOOK_CONNECT(hook_connect, hook_fd))
+    {
+        unhook (HOOK_CONNECT(hook_connect, hook_fd));
+        HOOK_CONNECT(hook_connect, hook_fd) = NULL;
+    }
+
+#ifdef HAVE_GNUTLS
+    if (HOOK_CONNECT(hook_connect, gnutls_sess))
+    {
+        rc = network_connect_gnutls_handshake (
+            hook_connect, HOOK_CONNECT(hook_connect, handshake_ip_address));
+        if (rc != 0)
+            return;
+    }
+#endif
+
+    /* the socket now belongs to the caller */
+    sock = HOOK_CONNECT(hook_connect, sock);
+    HOOK_CONNECT(hook_connect, sock) = -1;
+
+    (void) (HOOK_CONNECT(hook_connect, callback))
+        (hook_connect->callback_data,
+         WEECHAT_HOOK_CONNECT_OK, 0, sock, NULL,
+         HOOK_CONNECT(hook_connect, handshake_ip_address));
+    unhook (hook_connect);
+}
+
+/*
+ * Called when the socket of a connection without fork is connected (to peer
+ * or proxy).
+ */
+
+void
+network_connect_connected (struct t_hook *hook_connect,
+                           struct addrinfo *ptr_res)
+{
+    struct t_proxy *ptr_proxy;
+    char remote_address[NI_MAXHOST + 1];
+    int state;
+
+    if (getnameinfo (ptr_res->ai_addr, ptr_res->ai_addrlen,
+                     remote_address, sizeof (remote_address),
+                     NULL, 0, NI_NUMERICHOST) == 0)
+    {
+        HOOK_CONNECT(hook_connect, handshake_ip_address) = strdup (remote_address);
+    }
+
+    if (!HOOK_CONNECT(hook_connect, proxy)
+        || !HOOK_CONNECT(hook_connect, proxy)[0])
+    {
+        network_connect_done (hook_connect);
+        return;
+    }
+
+    /* start handshake with proxy */
+    ptr_proxy = proxy_search (HOOK_CONNECT(hook_connect, proxy));
+    state = NETWORK_PROXY_STATE_NONE;
+    if (ptr_proxy)
+    {
+        switch (CONFIG_INTEGER(ptr_proxy->options[PROXY_OPTION_TYPE]))
+        {
+            case PROXY_TYPE_HTTP:
+                state = NETWORK_PROXY_STATE_HTTP_REQUEST;
+                break;
+            case PROXY_TYPE_SOCKS4:
+                state = NETWORK_PROXY_STATE_SOCKS4_REQUEST;
+                break;
+            case PROXY_TYPE_SOCKS5:
+                state = NETWORK_PROXY_STATE_SOCKS5_GREETING;
+                break;
+        }
+    }
+    if ((state == NETWORK_PROXY_STATE_NONE)
+        || !network_connect_proxy_set_state (hook_connect, state))
+    {
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_PROXY_ERROR, NULL);
+        return;
+    }
+    if (HOOK_CONNECT(hook_connect, hook_fd))
+    {
+        HOOK_FD(HOOK_CONNECT(hook_connect, hook_fd), flags) =
+            HOOK_FD_FLAG_WRITE;
+    }
+    else
+    {
+        HOOK_CONNECT(hook_connect, hook_fd) = hook_fd (hook_connect->plugin,
+                                                       HOOK_CONNECT(hook_connect, sock),
+                                                       0, 1, 0,
+                                                       &network_connect_fd_cb,
+                                                       hook_connect);
+    }
+}
+
+/*
+ * Closes all connection attempts in progress (connection without fork),
+ * except the attempt with index "index_keep" (-1 to close all attempts).
+ */
+
+void
+network_connect_close_attempts (struct t_hook *hook_connect, int index_keep)
+{
+    int i;
+
+    if (HOOK_CONNECT(hook_connect, hook_attempt_timer))
+    {
+        unhook (HOOK_CONNECT(hook_connect, hook_attempt_timer));
+        HOOK_CONNECT(hook_connect, hook_attempt_timer) = NULL;
+    }
+
+    if (!HOOK_CONNECT(hook_connect, attempt_sock))
+        return;
+
+    for (i = 0; i < HOOK_CONNECT(hook_connect, num_addrs); i++)
+    {
+        if (i == index_keep)
+            continue;
+        if (HOOK_CONNECT(hook_connect, attempt_hook_fd)[i])
+        {
+            unhook (HOOK_CONNECT(hook_connect, attempt_hook_fd)[i]);
+            HOOK_CONNECT(hook_connect, attempt_hook_fd)[i] = NULL;
+        }
+        if (HOOK_CONNECT(hook_connect, attempt_sock)[i] != -1)
+        {
+            close (HOOK_CONNECT(hook_connect, attempt_sock)[i]);
+            HOOK_CONNECT(hook_connect, attempt_sock)[i] = -1;
+        }
+    }
+}
+
+/*
+ * Uses the socket of a connection attempt which succeeded (connection
+ * without fork): other attempts are closed.
+ */
+
+void
+network_connect_attempt_success (struct t_hook *hook_connect, int index_attempt)
+{
+    network_connect_close_attempts (hook_connect, index_attempt);
+
+    HOOK_CONNECT(hook_connect, sock) =
+        HOOK_CONNECT(hook_connect, attempt_sock)[index_attempt];
+    HOOK_CONNECT(hook_connect, hook_fd) =
+        HOOK_CONNECT(hook_connect, attempt_hook_fd)[index_attempt];
+    HOOK_CONNECT(hook_connect, attempt_sock)[index_attempt] = -1;
+    HOOK_CONNECT(hook_connect, attempt_hook_fd)[index_attempt] = NULL;
+
+    network_connect_connected (
+        hook_connect, HOOK_CONNECT(hook_connect, addrs)[index_attempt]);
+}
+
+/*
+ * Starts a connection attempt to next IP address (connection without fork),
+ * starting at HOOK_CONNECT(index_addr).
+ *
+ * The connect is non-blocking: the end of connection is detected by an fd
+ * hook on socket (ready for write). If the connection is still in progress
+ * after the connection attempt delay, next IP address is tried in parallel
+ * and the first connected socket is used (RFC 8305, "Happy Eyeballs").
+ *
+ * If there is no more IP address to try and no attempt in progress, the
+ * connection fails.
+ */
+
+void
+network_connect_next_address (struct t_hook *hook_connect)
+{
+    struct addrinfo *ptr_res, *ptr_loc, *res_local;
+    int index_attempt, sock, set, flags, rc, i;
+
+    res_local = HOOK_CONNECT(hook_connect, resolve)->res_local;
+
+    while (HOOK_CONNECT(hook_connect, index_addr) < HOOK_CONNECT(hook_connect, num_addrs))
+    {
+        index_attempt = HOOK_CONNECT(hook_connect, index_addr);
+        HOOK_CONNECT(hook_connect, index_addr)++;
+        ptr_res = HOOK_CONNECT(hook_connect, addrs)[index_attempt];
+
+        /* create a socket */
+        sock = socket (ptr_res->ai_family,
+                       ptr_res->ai_socktype,
+                       ptr_res->ai_protocol);
+        if (sock < 0)
+        {
+            HOOK_CONNECT(hook_connect, status) = WEECHAT_HOOK_CONNECT_SOCKET_ERROR;
+            continue;
+        }
+
+        /* set SO_REUSEADDR option for socket */
+        set = 1;
+        setsockopt (sock, SOL_SOCKET, SO_REUSEADDR, (void *) &set, sizeof (set));
+
+        /* set SO_KEEPALIVE option for socket */
+        set = 1;
+        setsockopt (sock, SOL_SOCKET, SO_KEEPALIVE, (void *) &set, sizeof (set));
+
+        /* set flag O_NONBLOCK on socket */
+        flags = fcntl (sock, F_GETFL);
+        if (flags == -1)
+            flags = 0;
+        fcntl (sock, F_SETFL, flags | O_NONBLOCK);
+
+        if (res_local)
+        {
+            /* bind local hostname/IP if asked by user */
+            rc = -1;
+            for (ptr_loc = res_local; ptr_loc; ptr_loc = ptr_loc->ai_next)
+            {
+                if (ptr_loc->ai_family != ptr_res->ai_family)
+                    continue;
+                rc = bind (sock, ptr_loc->ai_addr, ptr_loc->ai_addrlen);
+                if (rc == 0)
+                    break;
+            }
+            if (rc < 0)
+            {
+                HOOK_CONNECT(hook_connect, status) = WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR;
+                close (sock);
+                continue;
+            }
+        }
+
+        HOOK_CONNECT(hook_connect, attempt_sock)[index_attempt] = sock;
+
+        /* connect to peer */
+        if (connect (sock, ptr_res->ai_addr, ptr_res->ai_addrlen) == 0)
+        {
+            network_connect_attempt_success (hook_connect, index_attempt);
+            return;
+        }
+        if (errno == EINPROGRESS)
+        {
+            /* wait for socket to be ready for write */
+            HOOK_CONNECT(hook_connect, attempt_hook_fd)[index_attempt] =
+                hook_fd (hook_connect->plugin, sock, 0, 1, 0,
+                         &network_connect_fd_cb, hook_connect);
+            /* try next IP address if connection is not done after delay */
+            if ((HOOK_CONNECT(hook_connect, index_addr) < HOOK_CONNECT(hook_connect, num_addrs))
+                && (CONFIG_INTEGER(config_network_connection_attempt_delay) > 0))
+            {
+                HOOK_CONNECT(hook_connect, hook_attempt_timer) =
+                    hook_timer (hook_connect->plugin,
+                                CONFIG_INTEGER(config_network_connection_attempt_delay),
+                                0, 1,
+                                &network_connect_attempt_timer_cb,
+                                hook_connect);
+            }
+            return;
+        }
+
+        HOOK_CONNECT(hook_connect, status) = WEECHAT_HOOK_CONNECT_CONNECTION_REFUSED;
+        close (sock);
+        HOOK_CONNECT(hook_connect, attempt_sock)[index_attempt] = -1;
+    }
+
+    /* no more IP address to try: wait for attempts in progress (if any) */
+    for (i = 0; i < HOOK_CONNECT(hook_connect, num_addrs); i++)
+    {
+        if (HOOK_CONNECT(hook_connect, attempt_sock)[i] != -1)
+            return;
+    }
+
+    /* all IP addresses failed */
+    network_connect_error (hook_connect, HOOK_CONNECT(hook_connect, status),
+                           NULL);
+}
+
+/*
+ * Callback for timer of connection attempt delay: connection to previous IP
+ * address is still in progress, then next IP address is tried in parallel.
+ */
+
+int
+network_connect_attempt_timer_cb (void *arg_hook_connect, int remaining_calls)
+{
+    struct t_hook *hook_connect;
+
+    /* make C compiler happy */
+    (void) remaining_calls;
+
+    hook_connect = (struct t_hook *)arg_hook_connect;
+
+    HOOK_CONNECT(hook_connect, hook_attempt_timer) = NULL;
+
+    network_connect_next_address (hook_connect);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Callback for socket of a connection without fork: end of non-blocking
+ * connect, or socket ready for handshake with proxy.
+ */
+
+int
+network_connect_fd_cb (void *arg_hook_connect, int fd)
+{
+    struct t_hook *hook_connect;
+    int i, rc, value;
+    socklen_t len;
+
+    hook_connect = (struct t_hook *)arg_hook_connect;
+
+    if (HOOK_CONNECT(hook_connect, sock) == -1)
+    {
+        /* non-blocking connect of an attempt is finished: check result */
+        for (i = 0; i < HOOK_CONNECT(hook_connect, num_addrs); i++)
+        {
+            if (HOOK_CONNECT(hook_connect, attempt_sock)[i] == fd)
+                break;
+        }
+        if (i >= HOOK_CONNECT(hook_connect, num_addrs))
+            return WEECHAT_RC_OK;
+        value = 0;
+        len = sizeof (value);
+        if ((getsockopt (fd, SOL_SOCKET, SO_ERROR, &value, &len) != 0)
+            || (value != 0))
+        {
+            unhook (HOOK_CONNECT(hook_connect, attempt_hook_fd)[i]);
+            HOOK_CONNECT(hook_connect, attempt_hook_fd)[i] = NULL;
+            close (fd);
+            HOOK_CONNECT(hook_connect, attempt_sock)[i] = -1;
+            HOOK_CONNECT(hook_connect, status) = WEECHAT_HOOK_CONNECT_CONNECTION_REFUSED;
+            /* try next IP address now, without waiting for the delay */
+            if (HOOK_CONNECT(hook_connect, hook_attempt_timer))
+            {
+                unhook (HOOK_CONNECT(hook_connect, hook_attempt_timer));
+                HOOK_CONNECT(hook_connect, hook_attempt_timer) = NULL;
+            }
+            network_connect_next_address (hook_connect);
+            return WEECHAT_RC_OK;
+        }
+        network_connect_attempt_success (hook_connect, i);
+        return WEECHAT_RC_OK;
+    }
+
+    rc = network_connect_proxy_io (hook_connect);
+    if (rc < 0)
+    {
+        /* proxy fails to connect to peer */
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_PROXY_ERROR, NULL);
+    }
+    else if (rc == 0)
+    {
+        /* wait for socket to be ready */
+        switch (HOOK_CONNECT(hook_connect, proxy_state))
+        {
+            case NETWORK_PROXY_STATE_HTTP_REQUEST:
+            case NETWORK_PROXY_STATE_SOCKS4_REQUEST:
+            case NETWORK_PROXY_STATE_SOCKS5_GREETING:
+            case NETWORK_PROXY_STATE_SOCKS5_AUTH:
+            case NETWORK_PROXY_STATE_SOCKS5_REQUEST:
+                HOOK_FD(HOOK_CONNECT(hook_connect, hook_fd), flags) =
+                    HOOK_FD_FLAG_WRITE;
+                break;
+            default:
+                HOOK_FD(HOOK_CONNECT(hook_connect, hook_fd), flags) =
+                    HOOK_FD_FLAG_READ;
+                break;
+        }
+    }
+    else
+        network_connect_done (hook_connect);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Reads end of name resolution (connection without fork) and starts
+ * connection to IP addresses.
+ */
+
+int
+network_connect_resolve_cb (void *arg_hook_connect, int fd)
+{
+    struct t_hook *hook_connect;
+    struct t_network_resolve *resolve;
+    char buffer[1];
+    int num_read, num_hosts, i;
+
+    hook_connect = (struct t_hook *)arg_hook_connect;
+
+    num_read = read (fd, buffer, sizeof (buffer));
+    (void) num_read;
+
+    unhook (HOOK_CONNECT(hook_connect, hook_fd));
+    HOOK_CONNECT(hook_connect, hook_fd) = NULL;
+
+    resolve = HOOK_CONNECT(hook_connect, resolve);
+
+    if ((resolve->rc_remote != 0) || !resolve->res_remote)
+    {
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_ADDRESS_NOT_FOUND,
+                               (resolve->rc_remote != 0) ?
+                               gai_strerror (resolve->rc_remote) : NULL);
+        return WEECHAT_RC_OK;
+    }
+
+    if (resolve->local_hostname
+        && ((resolve->rc_local != 0) || !resolve->res_local))
+    {
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_LOCAL_HOSTNAME_ERROR,
+                               (resolve->rc_local != 0) ?
+                               gai_strerror (resolve->rc_local) : NULL);
+        return WEECHAT_RC_OK;
+    }
+
+    HOOK_CONNECT(hook_connect, addrs) =
+        network_connect_sort_addresses (resolve->res_remote,
+                                        HOOK_CONNECT(hook_connect, retry),
+                                        &num_hosts);
+    if (!HOOK_CONNECT(hook_connect, addrs))
+    {
+        network_connect_error (hook_connect,
+                               (num_hosts > 0) ?
+                               WEECHAT_HOOK_CONNECT_MEMORY_ERROR :
+                               WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND,
+                               NULL);
+        return WEECHAT_RC_OK;
+    }
+    network_connect_interleave_addresses (HOOK_CONNECT(hook_connect, addrs),
+                                          num_hosts);
+    HOOK_CONNECT(hook_connect, num_addrs) = num_hosts;
+    HOOK_CONNECT(hook_connect, index_addr) = 0;
+    HOOK_CONNECT(hook_connect, status) = WEECHAT_HOOK_CONNECT_IP_ADDRESS_NOT_FOUND;
+
+    HOOK_CONNECT(hook_connect, attempt_sock) =
+        malloc (sizeof (*(HOOK_CONNECT(hook_connect, attempt_sock))) * num_hosts);
+    HOOK_CONNECT(hook_connect, attempt_hook_fd) =
+        malloc (sizeof (*(HOOK_CONNECT(hook_connect, attempt_hook_fd))) * num_hosts);
+    if (!HOOK_CONNECT(hook_connect, attempt_sock)
+        || !HOOK_CONNECT(hook_connect, attempt_hook_fd))
+    {
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_MEMORY_ERROR, NULL);
+        return WEECHAT_RC_OK;
+    }
+    for (i = 0; i < num_hosts; i++)
+    {
+        HOOK_CONNECT(hook_connect, attempt_sock)[i] = -1;
+        HOOK_CONNECT(hook_connect, attempt_hook_fd)[i] = NULL;
+    }
+
+    network_connect_next_address (hook_connect);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Connects without fork (called by hook_connect() only!).
+ *
+ * Names are resolved in a thread (getaddrinfo is blocking), then connect to
+ * IP addresses and handshake with proxy are made in main thread, without
+ * blocking (using fd hooks).
+ *
+ * If the thread can not be created, the connection is made with fork.
+ */
+
+void
+network_connect_without_fork (struct t_hook *hook_connect)
+{
+    struct t_proxy *ptr_proxy;
+    struct t_network_resolve *resolve;
+    pthread_t thread;
+    pthread_attr_t attr;
+    char str_port[16];
+    int pipe_fds[2], rc;
+
+    ptr_proxy = NULL;
+    if (HOOK_CONNECT(hook_connect, proxy)
+        && HOOK_CONNECT(hook_connect, proxy)[0])
+    {
+        ptr_proxy = proxy_search (HOOK_CONNECT(hook_connect, proxy));
+        if (!ptr_proxy)
+        {
+            /* proxy not found */
+            network_connect_error (hook_connect,
+                                   WEECHAT_HOOK_CONNECT_PROXY_ERROR, NULL);
+            return;
+        }
+    }
+
+    resolve = malloc (sizeof (*resolve));
+    if (!resolve || (pipe (pipe_fds) < 0))
+    {
+        if (resolve)
+            free (resolve);
+        network_connect_error (hook_connect,
+                               WEECHAT_HOOK_CONNECT_MEMORY_ERROR, NULL);
+        return;
+    }
+    pthread_mutex_init (&resolve->mutex, NULL);
+    resolve->done = 0;
+    resolve->abandoned = 0;
+    resolve->pipe_read = pipe_fds[0];
+    resolve->pipe_write = pipe_fds[1];
+    if (ptr_proxy)
+    {
+        resolve->address = strdup (CONFIG_STRING(ptr_proxy->options[PROXY_OPTION_ADDRESS]));
+        snprintf (str_port, sizeof (str_port), "%d",
+                  CONFIG_INTEGER(ptr_proxy->options[PROXY_OPTION_PORT]));
+        resolve->family = (CONFIG_BOOLEAN(ptr_proxy->options[PROXY_OPTION_IPV6])) ?
+            AF_UNSPEC : AF_INET;
+    }
+    else
+    {
+        resolve->address = strdup (HOOK_CONNECT(hook_connect, address));
+        snprintf (str_port, sizeof (str_port), "%d",
+                  HOOK_CONNECT(hook_connect, port));
+        resolve->family = (HOOK_CONNECT(hook_connect, ipv6)) ?
+            AF_UNSPEC : AF_INET;
+    }
+    resolve->port = strdup (str_port);
+    resolve->local_hostname = (HOOK_CONNECT(hook_connect, local_hostname)
+                               && HOOK_CONNECT(hook_connect, local_hostname)[0]) ?
+        strdup (HOOK_CONNECT(hook_connect, local_hostname)) : NULL;
+    resolve->socks4_address = (ptr_proxy
+                               && (CONFIG_INTEGER(ptr_proxy->options[PROXY_OPTION_TYPE]) == PROXY_TYPE_SOCKS4)) ?
+        strdup (HOOK_CONNECT(hook_connect, address)) : NULL;
+    resolve->rc_remote = 0;
+    resolve->rc_local = 0;
+    resolve->rc_socks4 = 0;
+    resolve->res_remote = NULL;
+    resolve->res_local = NULL;
+    resolve->res_socks4 = NULL;
+
+    pthread_attr_init (&attr);
+    pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+    rc = pthread_create (&thread, &attr, &network_resolve_thread, resolve);
+    pthread_attr_destroy (&attr);
+    if (rc != 0)
+    {
+        network_resolve_free (resolve);
+        network_connect_with_fork (hook_connect);
+        return;
+    }
+    HOOK_CONNECT(hook_connect, resolve) = resolve;
+
+#ifdef HAVE_GNUTLS
+    if (!network_connect_gnutls_init (hook_connect))
+        return;
+#endif
+
+    HOOK_CONNECT(hook_connect, hook_child_timer) = hook_timer (hook_connect->plugin,
+                                                               CONFIG_INTEGER(config_network_connection_timeout) * 1000,
+                                                               0, 1,
+                                                               &network_connect_child_timer_cb,
+                                                               hook_connect);
+    HOOK_CONNECT(hook_connect, hook_fd) = hook_fd (hook_connect->plugin,
+                                                   resolve->pipe_read,
+                                                   1, 0, 0,
+                                                   &network_connect_resolve_cb,
+                                                   hook_connect);
+}
+
+/*
+ * Frees data used by a connection (called when the connect hook is removed).
+ *
+ * If name resolution is still running, it is abandoned (and freed by the
+ * thread when done).
+ */
+
+void
+network_connect_free_data (struct t_hook *hook_connect)
+{
+    struct t_network_resolve *resolve;
+    int done;
+
+    resolve = HOOK_CONNECT(hook_connect, resolve);
+    if (resolve)
+    {
+        pthread_mutex_lock (&resolve->mutex);
+        done = resolve->done;
+        if (!done)
+        {
+            resolve->abandoned = 1;
+            close (resolve->pipe_read);
+            resolve->pipe_read = -1;
+        }
+        pthread_mutex_unlock (&resolve->mutex);
+        if (done)
+            network_resolve_free (resolve);
+        HOOK_CONNECT(hook_connect, resolve) = NULL;
+    }
+
+    network_connect_close_attempts (hook_connect, -1);
+    if (HOOK_CONNECT(hook_connect, attempt_sock))
+    {
+        free (HOOK_CONNECT(hook_connect, attempt_sock));
+        HOOK_CONNECT(hook_connect, attempt_sock) = NULL;
+    }
+    if (HOOK_CONNECT(hook_connect, attempt_hook_fd))
+    {
+        free (HOOK_CONNECT(hook_connect, attempt_hook_fd));
+        HOOK_CONNECT(hook_connect, attempt_hook_fd) = NULL;
+    }
+
+    if (HOOK_CONNECT(hook_connect, addrs))
+    {
+        free (HOOK_CONNECT(hook_connect, addrs));
+        HOOK_CONNECT(hook_connect, addrs) = NULL;
+    }
+
+    /* close socket if it was not given to the caller */
+    if (HOOK_CONNECT(hook_connect, sock) != -1)
+    {
+        close (HOOK_CONNECT(hook_connect, sock));
+        HOOK_CONNECT(hook_connect, sock) = -1;
+    }
+}
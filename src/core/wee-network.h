@@ -22,8 +22,52 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <pthread.h>
 
 struct t_hook;
+struct addrinfo;
+
+/* states of handshake with a proxy (connection without fork) */
+
+enum t_network_proxy_state
+{
+    NETWORK_PROXY_STATE_NONE = 0,      /* no proxy                          */
+    NETWORK_PROXY_STATE_HTTP_REQUEST,  /* send: CONNECT                     */
+    NETWORK_PROXY_STATE_HTTP_RESPONSE, /* recv: HTTP status + headers       */
+    NETWORK_PROXY_STATE_SOCKS4_REQUEST, /* send: connect request            */
+    NETWORK_PROXY_STATE_SOCKS4_RESPONSE, /* recv: status (8 bytes)          */
+    NETWORK_PROXY_STATE_SOCKS5_GREETING, /* send: version + method          */
+    NETWORK_PROXY_STATE_SOCKS5_METHOD, /* recv: method chosen (2 bytes)     */
+    NETWORK_PROXY_STATE_SOCKS5_AUTH,   /* send: username/password           */
+    NETWORK_PROXY_STATE_SOCKS5_AUTH_STATUS, /* recv: auth status (2 bytes)  */
+    NETWORK_PROXY_STATE_SOCKS5_REQUEST, /* send: connect request            */
+    NETWORK_PROXY_STATE_SOCKS5_REPLY,  /* recv: reply (4 bytes)             */
+    NETWORK_PROXY_STATE_SOCKS5_ADDRESS_LENGTH, /* recv: length of domain    */
+    NETWORK_PROXY_STATE_SOCKS5_ADDRESS, /* recv: bound address + port       */
+    NETWORK_PROXY_STATE_DONE,          /* handshake OK                      */
+};
+
+/* name resolution for a connection, done in a thread */
+
+struct t_network_resolve
+{
+    pthread_mutex_t mutex;             /* mutex for "done" and "abandoned"  */
+    int done;                          /* 1 if resolution is done           */
+    int abandoned;                     /* 1 if connect hook was removed     */
+    int pipe_read;                     /* pipe to signal end of resolution  */
+    int pipe_write;                    /* (written by thread)               */
+    char *address;                     /* address to resolve (peer/proxy)   */
+    char *port;                        /* port of peer/proxy                */
+    int family;                        /* AF_UNSPEC or AF_INET              */
+    char *local_hostname;              /* local hostname (optional)         */
+    char *socks4_address;              /* peer address (for socks4 proxy)   */
+    int rc_remote;                     /* getaddrinfo rc for address        */
+    int rc_local;                      /* getaddrinfo rc for local hostname */
+    int rc_socks4;                     /* getaddrinfo rc for socks4 address */
+    struct addrinfo *res_remote;       /* IP addresses of peer/proxy        */
+    struct addrinfo *res_local;        /* IP addresses of local hostname    */
+    struct addrinfo *res_socks4;       /* IPv4 address of peer (socks4)     */
+};
 
 struct t_network_socks4
 {
@@ -54,5 +98,7 @@ extern int network_pass_proxy (const char *proxy, int sock,
 extern int network_connect_to (const char *proxy, struct sockaddr *address,
                                socklen_t address_length);
 extern void network_connect_with_fork (struct t_hook *hook_connect);
+extern void network_connect_without_fork (struct t_hook *hook_connect);
+extern void network_connect_free_data (struct t_hook *hook_connect);
 
 #endif /* WEECHAT_NETWORK_H */
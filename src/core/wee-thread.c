@@ -0,0 +1,510 @@
+/*
+ * wee-thread.c - pool of threads running functions in background
+ *
+ * Copyright (C) 2026 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <stdint.h>
+#endif
+
+#include "weechat.h"
+#include "wee-thread.h"
+#include "wee-config.h"
+#include "wee-hook.h"
+#include "wee-log.h"
+#include "../plugins/plugin.h"
+
+
+char *thread_job_state_string[THREAD_JOB_NUM_STATES] =
+{ "queued", "running", "done" };
+
+pthread_mutex_t thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t thread_cond_queued = PTHREAD_COND_INITIALIZER;
+pthread_cond_t thread_cond_done = PTHREAD_COND_INITIALIZER;
+
+pthread_t *thread_workers = NULL;      /* worker threads                    */
+int thread_num_workers = 0;            /* number of worker threads          */
+int thread_num_idle = 0;               /* workers waiting for a job         */
+int thread_quit = 0;                   /* 1 if workers must exit            */
+
+struct t_thread_job *thread_jobs_queued = NULL;      /* jobs to run         */
+struct t_thread_job *last_thread_job_queued = NULL;
+int thread_num_jobs_queued = 0;
+struct t_thread_job *thread_jobs_done = NULL;        /* results to send     */
+struct t_thread_job *last_thread_job_done = NULL;    /* to main thread      */
+
+int thread_wakeup_fd[2] = { -1, -1 }; /* eventfd (same fd twice) or pipe   */
+struct t_hook *thread_hook_wakeup = NULL; /* fd hook on thread_wakeup_fd[0] */
+
+int thread_jobs_submitted = 0;         /* number of jobs submitted          */
+int thread_jobs_completed = 0;         /* number of jobs done               */
+int thread_jobs_cancelled = 0;         /* number of jobs cancelled          */
+
+
+/*
+ * Adds a job at the end of a list (mutex must be locked).
+ */
+
+void
+thread_job_list_add (struct t_thread_job **jobs,
+                     struct t_thread_job **last_job,
+                     struct t_thread_job *job)
+{
+    job->prev_job = *last_job;
+    job->next_job = NULL;
+    if (*last_job)
+        (*last_job)->next_job = job;
+    else
+        *jobs = job;
+    *last_job = job;
+}
+
+/*
+ * Removes a job from a list (mutex must be locked).
+ */
+
+void
+thread_job_list_remove (struct t_thread_job **jobs,
+                        struct t_thread_job **last_job,
+                        struct t_thread_job *job)
+{
+    if (job->prev_job)
+        (job->prev_job)->next_job = job->next_job;
+    if (job->next_job)
+        (job->next_job)->prev_job = job->prev_job;
+    if (*jobs == job)
+        *jobs = job->next_job;
+    if (*last_job == job)
+        *last_job = job->prev_job;
+    job->prev_job = NULL;
+    job->next_job = NULL;
+}
+
+/*
+ * Wakes up main thread (called by a worker thread).
+ */
+
+void
+thread_wakeup_main ()
+{
+    char buffer[8];
+    int length;
+#ifdef __linux__
+    uint64_t value;
+#endif
+
+    buffer[0] = 0;
+    length = 1;
+
+#ifdef __linux__
+    if (thread_wakeup_fd[0] == thread_wakeup_fd[1])
+    {
+        value = 1;
+        memcpy (buffer, &value, sizeof (value));
+        length = sizeof (value);
+    }
+#endif
+
+    /* fd is non-blocking: if it is full, main thread will wake up anyway */
+    if (write (thread_wakeup_fd[1], buffer, length) < 0)
+    {
+        /* ignore error */
+    }
+}
+
+/*
+ * Main function of a worker thread: runs queued jobs.
+ */
+
+void *
+thread_worker (void *arg)
+{
+    struct t_thread_job *job;
+    void *result;
+
+    /* make C compiler happy */
+    (void) arg;
+
+    pthread_mutex_lock (&thread_mutex);
+
+    while (1)
+    {
+        while (!thread_jobs_queued && !thread_quit)
+        {
+            thread_num_idle++;
+            pthread_cond_wait (&thread_cond_queued, &thread_mutex);
+            thread_num_idle--;
+        }
+        if (thread_quit)
+            break;
+
+        job = thread_jobs_queued;
+        thread_job_list_remove (&thread_jobs_queued, &last_thread_job_queued,
+                                job);
+        thread_num_jobs_queued--;
+        job->state = THREAD_JOB_STATE_RUNNING;
+
+        pthread_mutex_unlock (&thread_mutex);
+        result = (job->function) (job->function_arg);
+        pthread_mutex_lock (&thread_mutex);
+
+        job->result = result;
+        job->state = THREAD_JOB_STATE_DONE;
+        thread_job_list_add (&thread_jobs_done, &last_thread_job_done, job);
+        pthread_cond_broadcast (&thread_cond_done);
+
+        thread_wakeup_main ();
+    }
+
+    pthread_mutex_unlock (&thread_mutex);
+
+    return NULL;
+}
+
+/*
+ * Starts a new worker thread (mutex must be locked).
+ *
+ * Returns:
+ *   1: OK
+ *   0: error
+ */
+
+int
+thread_worker_start ()
+{
+    pthread_t *new_workers;
+    sigset_t sigset_all, sigset_old;
+    int rc;
+
+    new_workers = realloc (thread_workers,
+                           (thread_num_workers + 1) * sizeof (*new_workers));
+    if (!new_workers)
+        return 0;
+    thread_workers = new_workers;
+
+    /* signals must be received by main thread only */
+    sigfillset (&sigset_all);
+    pthread_sigmask (SIG_SETMASK, &sigset_all, &sigset_old);
+    rc = pthread_create (&thread_workers[thread_num_workers], NULL,
+                         &thread_worker, NULL);
+    pthread_sigmask (SIG_SETMASK, &sigset_old, NULL);
+    if (rc != 0)
+        return 0;
+
+    thread_num_workers++;
+
+    return 1;
+}
+
+/*
+ * Callback called when main thread is woken up by a worker: calls the
+ * "done" callback for all jobs done.
+ */
+
+int
+thread_wakeup_cb (void *data, int fd)
+{
+    struct t_thread_job *job;
+    char buffer[64];
+
+    /* make C compiler happy */
+    (void) data;
+
+    while (read (fd, buffer, sizeof (buffer)) > 0)
+    {
+    }
+
+    /*
+     * jobs are removed one by one from list: a callback can cancel another
+     * job which is done (and then removed from list by thread_cancel)
+     */
+    while (1)
+    {
+        pthread_mutex_lock (&thread_mutex);
+        job = thread_jobs_done;
+        if (job)
+        {
+            thread_job_list_remove (&thread_jobs_done, &last_thread_job_done,
+                                    job);
+        }
+        pthread_mutex_unlock (&thread_mutex);
+
+        if (!job)
+            break;
+
+        thread_jobs_completed++;
+        if (job->callback_done)
+            (job->callback_done) (job->callback_done_data, job->result);
+        free (job);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Initializes pipe used to wake up main thread when jobs are done.
+ */
+
+void
+thread_init ()
+{
+    int i;
+
+#ifdef __linux__
+    thread_wakeup_fd[0] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    thread_wakeup_fd[1] = thread_wakeup_fd[0];
+#endif
+
+    if (thread_wakeup_fd[0] < 0)
+    {
+        if (pipe (thread_wakeup_fd) < 0)
+        {
+            thread_wakeup_fd[0] = -1;
+            thread_wakeup_fd[1] = -1;
+            return;
+        }
+        for (i = 0; i < 2; i++)
+        {
+            fcntl (thread_wakeup_fd[i], F_SETFL, O_NONBLOCK);
+            fcntl (thread_wakeup_fd[i], F_SETFD, FD_CLOEXEC);
+        }
+    }
+
+    thread_hook_wakeup = hook_fd (NULL, thread_wakeup_fd[0], 1, 0, 0,
+                                  &thread_wakeup_cb, NULL);
+}
+
+/*
+ * Submits a job: function will be called with argument function_arg in a
+ * worker thread, then callback_done will be called in main thread with
+ * callback_done_data and value returned by function.
+ *
+ * Function must not use WeeChat API (it is not thread safe).
+ *
+ * Returns pointer to new job, NULL if error.
+ */
+
+struct t_thread_job *
+thread_submit (t_thread_function *function, void *function_arg,
+               t_thread_callback_done *callback_done,
+               void *callback_done_data)
+{
+    struct t_thread_job *new_job;
+    int max_threads;
+
+    if (!function || !thread_hook_wakeup)
+        return NULL;
+
+    new_job = malloc (sizeof (*new_job));
+    if (!new_job)
+        return NULL;
+
+    new_job->function = function;
+    new_job->function_arg = function_arg;
+    new_job->callback_done = callback_done;
+    new_job->callback_done_data = callback_done_data;
+    new_job->state = THREAD_JOB_STATE_QUEUED;
+    new_job->result = NULL;
+
+    max_threads = CONFIG_INTEGER(config_plugin_max_threads);
+
+    pthread_mutex_lock (&thread_mutex);
+
+    if ((thread_num_jobs_queued >= thread_num_idle)
+        && (thread_num_workers < max_threads))
+    {
+        if (!thread_worker_start () && (thread_num_workers == 0))
+        {
+            /* no thread at all to run the job */
+            pthread_mutex_unlock (&thread_mutex);
+            free (new_job);
+            return NULL;
+        }
+    }
+
+    thread_job_list_add (&thread_jobs_queued, &last_thread_job_queued,
+                         new_job);
+    thread_num_jobs_queued++;
+    thread_jobs_submitted++;
+    pthread_cond_signal (&thread_cond_queued);
+
+    pthread_mutex_unlock (&thread_mutex);
+
+    return new_job;
+}
+
+/*
+ * Cancels a job: if it is queued, it is removed from queue, if it is
+ * running, waits for end of function. The job is freed and the "done"
+ * callback is not called.
+ *
+ * This function must not be called for a job which has been given to
+ * "done" callback (job is already freed).
+ *
+ * Returns:
+ *   1: function has been called, *result is the value it returned
+ *   0: function has not been called (*result is set to NULL)
+ */
+
+int
+thread_cancel (struct t_thread_job *job, void **result)
+{
+    int function_called;
+
+    if (result)
+        *result = NULL;
+
+    if (!job)
+        return 0;
+
+    pthread_mutex_lock (&thread_mutex);
+
+    if (job->state == THREAD_JOB_STATE_QUEUED)
+    {
+        thread_job_list_remove (&thread_jobs_queued, &last_thread_job_queued,
+                                job);
+        thread_num_jobs_queued--;
+        function_called = 0;
+    }
+    else
+    {
+        while (job->state == THREAD_JOB_STATE_RUNNING)
+        {
+            pthread_cond_wait (&thread_cond_done, &thread_mutex);
+        }
+        thread_job_list_remove (&thread_jobs_done, &last_thread_job_done,
+                                job);
+        if (result)
+            *result = job->result;
+        function_called = 1;
+    }
+
+    pthread_mutex_unlock (&thread_mutex);
+
+    thread_jobs_cancelled++;
+    free (job);
+
+    return function_called;
+}
+
+/*
+ * Stops all worker threads (running functions are waited) and frees jobs
+ * not yet run or not yet sent to main thread.
+ */
+
+void
+thread_end ()
+{
+    struct t_thread_job *job;
+    int i;
+
+    pthread_mutex_lock (&thread_mutex);
+    thread_quit = 1;
+    pthread_cond_broadcast (&thread_cond_queued);
+    pthread_mutex_unlock (&thread_mutex);
+
+    for (i = 0; i < thread_num_workers; i++)
+    {
+        pthread_join (thread_workers[i], NULL);
+    }
+    if (thread_workers)
+    {
+        free (thread_workers);
+        thread_workers = NULL;
+    }
+    thread_num_workers = 0;
+    thread_num_idle = 0;
+
+    while (thread_jobs_queued)
+    {
+        job = thread_jobs_queued;
+        thread_job_list_remove (&thread_jobs_queued, &last_thread_job_queued,
+                                job);
+        free (job);
+    }
+    thread_num_jobs_queued = 0;
+    while (thread_jobs_done)
+    {
+        job = thread_jobs_done;
+        thread_job_list_remove (&thread_jobs_done, &last_thread_job_done,
+                                job);
+        free (job);
+    }
+
+    if (thread_hook_wakeup)
+    {
+        unhook (thread_hook_wakeup);
+        thread_hook_wakeup = NULL;
+    }
+    if (thread_wakeup_fd[0] >= 0)
+        close (thread_wakeup_fd[0]);
+    if ((thread_wakeup_fd[1] >= 0)
+        && (thread_wakeup_fd[1] != thread_wakeup_fd[0]))
+    {
+        close (thread_wakeup_fd[1]);
+    }
+    thread_wakeup_fd[0] = -1;
+    thread_wakeup_fd[1] = -1;
+}
+
+/*
+ * Prints thread pool in WeeChat log file (usually for crash dump).
+ */
+
+void
+thread_print_log ()
+{
+    struct t_thread_job *ptr_job;
+
+    log_printf ("");
+    log_printf ("[threads]");
+    log_printf ("  thread_num_workers. . . : %d", thread_num_workers);
+    log_printf ("  thread_num_idle . . . . : %d", thread_num_idle);
+    log_printf ("  thread_num_jobs_queued. : %d", thread_num_jobs_queued);
+    log_printf ("  thread_jobs_submitted . : %d", thread_jobs_submitted);
+    log_printf ("  thread_jobs_completed . : %d", thread_jobs_completed);
+    log_printf ("  thread_jobs_cancelled . : %d", thread_jobs_cancelled);
+    log_printf ("  thread_wakeup_fd. . . . : %d,%d",
+                thread_wakeup_fd[0], thread_wakeup_fd[1]);
+    log_printf ("  thread_hook_wakeup. . . : 0x%lx", thread_hook_wakeup);
+
+    /* do not lock mutex: this function can be called on crash */
+    for (ptr_job = thread_jobs_queued; ptr_job; ptr_job = ptr_job->next_job)
+    {
+        log_printf ("  queued job (addr:0x%lx): function=0x%lx, "
+                    "function_arg=0x%lx",
+                    ptr_job, ptr_job->function, ptr_job->function_arg);
+    }
+    for (ptr_job = thread_jobs_done; ptr_job; ptr_job = ptr_job->next_job)
+    {
+        log_printf ("  done job (addr:0x%lx): function=0x%lx, result=0x%lx",
+                    ptr_job, ptr_job->function, ptr_job->result);
+    }
+}
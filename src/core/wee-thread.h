@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_THREAD_H
+#define WEECHAT_THREAD_H 1
+
+enum t_thread_job_state
+{
+    THREAD_JOB_STATE_QUEUED = 0,       /* waiting for a free thread         */
+    THREAD_JOB_STATE_RUNNING,          /* function running in a thread      */
+    THREAD_JOB_STATE_DONE,             /* result waiting for main thread    */
+    /* number of job states */
+    THREAD_JOB_NUM_STATES,
+};
+
+typedef void *(t_thread_function)(void *arg);
+typedef void (t_thread_callback_done)(void *data, void *result);
+
+struct t_thread_job
+{
+    t_thread_function *function;       /* function run in a thread          */
+    void *function_arg;                /* argument given to function        */
+    t_thread_callback_done *callback_done; /* called in main thread with    */
+    void *callback_done_data;          /* result of function                */
+    enum t_thread_job_state state;     /* queued/running/done               */
+    void *result;                      /* value returned by function        */
+    struct t_thread_job *prev_job;     /* link to previous job in list      */
+    struct t_thread_job *next_job;     /* link to next job in list          */
+};
+
+/* thread variables */
+
+extern char *thread_job_state_string[];
+
+/* thread functions */
+
+extern void thread_init ();
+extern struct t_thread_job *thread_submit (t_thread_function *function,
+                                           void *function_arg,
+                                           t_thread_callback_done *callback_done,
+                                           void *callback_done_data);
+extern int thread_cancel (struct t_thread_job *job, void **result);
+extern void thread_end ();
+extern void thread_print_log ();
+
+#endif /* WEECHAT_THREAD_H */
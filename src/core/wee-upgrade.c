@@ -441,6 +441,7 @@ upgrade_weechat_read_buffer (struct t_infolist *infolist)
         free (ptr_buffer->plugin_name_for_upgrade);
     ptr_buffer->plugin_name_for_upgrade =
         strdup (infolist_string (infolist, "plugin_name"));
+    gui_buffer_memory_owner_update (ptr_buffer);
 
     /* full name */
     gui_buffer_build_full_name (ptr_buffer);
@@ -500,6 +501,14 @@ upgrade_weechat_read_buffer (struct t_infolist *infolist)
     ptr_buffer->lines->first_line_not_read =
         infolist_integer (infolist, "first_line_not_read");
 
+    /* id for next line (lines read after buffer keep their id) */
+    if (infolist_search_var (infolist, "next_line_id")
+        && (infolist_integer (infolist, "next_line_id") > ptr_buffer->next_line_id))
+    {
+        ptr_buffer->next_line_id = infolist_integer (infolist,
+                                                     "next_line_id");
+    }
+
     /* time for each line */
     ptr_buffer->time_for_each_line =
         infolist_integer (infolist, "time_for_each_line");
@@ -620,6 +629,7 @@ void
 upgrade_weechat_read_buffer_line (struct t_infolist *infolist)
 {
     struct t_gui_line *new_line;
+    int next_line_id;
 
     if (!upgrade_current_buffer)
         return;
@@ -627,6 +637,7 @@ upgrade_weechat_read_buffer_line (struct t_infolist *infolist)
     switch (upgrade_current_buffer->type)
     {
         case GUI_BUFFER_TYPE_FORMATTED:
+            next_line_id = upgrade_current_buffer->next_line_id;
             new_line = gui_line_add (upgrade_current_buffer,
                                      infolist_time (infolist, "date"),
                                      infolist_time (infolist, "date_printed"),
@@ -635,6 +646,14 @@ upgrade_weechat_read_buffer_line (struct t_infolist *infolist)
                                      infolist_string (infolist, "message"));
             if (new_line)
             {
+                /* keep line id (and id for next line, saved in buffer) */
+                if (infolist_search_var (infolist, "id"))
+                {
+                    new_line->data->id = infolist_integer (infolist, "id");
+                    upgrade_current_buffer->next_line_id =
+                        (new_line->data->id >= next_line_id) ?
+                        new_line->data->id + 1 : next_line_id;
+                }
                 new_line->data->highlight = infolist_integer (infolist,
                                                               "highlight");
                 if (infolist_integer (infolist, "last_read_line"))
@@ -270,6 +270,45 @@ util_timeval_diff (struct timeval *tv1, struct timeval *tv2)
     return ((diff_usec / 1000) + (diff_sec * 1000));
 }
 
+/*
+ * Calculates difference between two timeval structures.
+ *
+ * Returns difference in microseconds.
+ */
+
+long long
+util_timeval_diff_usec (struct timeval *tv1, struct timeval *tv2)
+{
+    long long diff_sec, diff_usec;
+
+    diff_sec = tv2->tv_sec - tv1->tv_sec;
+    diff_usec = tv2->tv_usec - tv1->tv_usec;
+
+    return (diff_sec * 1000000) + diff_usec;
+}
+
+/*
+ * Gets current time with monotonic clock (not affected by changes of system
+ * clock), or system clock if monotonic clock is not available.
+ */
+
+void
+util_get_time_monotonic (struct timeval *tv)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if (clock_gettime (CLOCK_MONOTONIC, &ts) == 0)
+    {
+        tv->tv_sec = ts.tv_sec;
+        tv->tv_usec = ts.tv_nsec / 1000;
+        return;
+    }
+#endif /* defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC) */
+
+    gettimeofday (tv, NULL);
+}
+
 /*
  * Adds interval (in milliseconds) to a timeval structure.
  */
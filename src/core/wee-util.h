@@ -37,6 +37,9 @@ struct t_util_signal
 extern void util_setrlimit ();
 extern int util_timeval_cmp (struct timeval *tv1, struct timeval *tv2);
 extern long util_timeval_diff (struct timeval *tv1, struct timeval *tv2);
+extern long long util_timeval_diff_usec (struct timeval *tv1,
+                                         struct timeval *tv2);
+extern void util_get_time_monotonic (struct timeval *tv);
 extern void util_timeval_add (struct timeval *tv, long interval);
 extern char *util_get_time_string (const time_t *date);
 extern int util_signal_search (const char *name);
@@ -46,6 +46,7 @@
 #include <sys/time.h>
 #include <time.h>
 #include <signal.h>
+#include <unistd.h>
 
 #ifdef HAVE_LANGINFO_CODESET
 #include <langinfo.h>
@@ -60,10 +61,12 @@
 #include "wee-hdata.h"
 #include "wee-hook.h"
 #include "wee-log.h"
+#include "wee-memory.h"
 #include "wee-network.h"
 #include "wee-proxy.h"
 #include "wee-secure.h"
 #include "wee-string.h"
+#include "wee-thread.h"
 #include "wee-upgrade.h"
 #include "wee-utf8.h"
 #include "wee-util.h"
@@ -410,15 +413,20 @@ weechat_shutdown (int return_code, int crash)
 }
 
 /*
- * Entry point for WeeChat.
+ * Initializes WeeChat (everything before the main loop): core, GUI,
+ * configuration and plugins.
  */
 
-int
-main (int argc, char *argv[])
+void
+weechat_init (int argc, char *argv[])
 {
     weechat_first_start_time = time (NULL); /* initialize start time        */
     gettimeofday (&weechat_current_start_timeval, NULL);
 
+    /* seed random numbers (used by core and plugins, for example irc) */
+    srand ((weechat_current_start_timeval.tv_sec *
+            weechat_current_start_timeval.tv_usec) ^ getpid ());
+
     setlocale (LC_ALL, "");             /* initialize gettext               */
 #ifdef ENABLE_NLS
     bindtextdomain (PACKAGE, LOCALEDIR);
@@ -457,6 +465,7 @@ main (int argc, char *argv[])
     secure_read ();                     /* read secured data options        */
     config_weechat_read ();             /* read WeeChat options             */
     network_init_gnutls ();             /* init GnuTLS                      */
+    thread_init ();                     /* init pool of threads             */
     gui_main_init ();                   /* init WeeChat interface           */
     if (weechat_upgrading)
     {
@@ -473,11 +482,18 @@ main (int argc, char *argv[])
         gui_layout_window_apply (gui_layout_current, -1);
     if (weechat_upgrading)
         upgrade_weechat_end ();         /* remove .upgrade files + signal   */
+}
 
-    gui_main_loop ();                   /* WeeChat main loop                */
+/*
+ * Ends WeeChat (everything after the main loop) and quits the program.
+ */
 
+void
+weechat_end ()
+{
     gui_layout_store_on_exit ();        /* store layout                     */
     plugin_end ();                      /* end plugin interface(s)          */
+    thread_end ();                      /* stop threads                     */
     if (CONFIG_BOOLEAN(config_look_save_config_on_exit))
         (void) config_weechat_write (); /* save WeeChat config file         */
     (void) secure_write ();             /* save secured data                */
@@ -491,7 +507,6 @@ main (int argc, char *argv[])
     hdata_end ();                       /* end hdata                        */
     secure_end ();                      /* end secured data                 */
     string_end ();                      /* end string                       */
+    memory_end ();                      /* free memory counters             */
     weechat_shutdown (EXIT_SUCCESS, 0); /* quit WeeChat (oh no, why?)       */
-
-    return EXIT_SUCCESS;                /* make C compiler happy            */
 }
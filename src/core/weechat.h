@@ -107,5 +107,7 @@ extern int weechat_no_gcrypt;
 extern char *weechat_startup_commands;
 
 extern void weechat_shutdown (int return_code, int crash);
+extern void weechat_init (int argc, char *argv[]);
+extern void weechat_end ();
 
 #endif /* WEECHAT_H */
@@ -30,6 +30,7 @@
 
 #include "../../core/weechat.h"
 #include "../../core/wee-config.h"
+#include "../../core/wee-debug.h"
 #include "../../core/wee-eval.h"
 #include "../../core/wee-hashtable.h"
 #include "../../core/wee-hook.h"
@@ -2021,6 +2022,8 @@ gui_chat_draw (struct t_gui_buffer *buffer, int clear_chat)
     if (!gui_init_ok)
         return;
 
+    debug_trace_begin ("gui", "chat_draw", buffer->full_name);
+
     if (gui_window_bare_display)
     {
         if (gui_current_window && (gui_current_window->buffer == buffer))
@@ -2087,4 +2090,6 @@ gui_chat_draw (struct t_gui_buffer *buffer, int clear_chat)
 
 end:
     buffer->chat_refresh_needed = 0;
+
+    debug_trace_end ();
 }
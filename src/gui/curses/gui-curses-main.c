@@ -29,10 +29,12 @@
 #include <string.h>
 #include <signal.h>
 #include <time.h>
+#include <sys/time.h>
 
 #include "../../core/weechat.h"
 #include "../../core/wee-command.h"
 #include "../../core/wee-config.h"
+#include "../../core/wee-debug.h"
 #include "../../core/wee-hook.h"
 #include "../../core/wee-log.h"
 #include "../../core/wee-string.h"
@@ -70,8 +72,38 @@ int gui_term_lines = 0;                /* number of lines in terminal       */
  *
  * The result is stored in "password" with max "size" bytes (including the
  * final '\0').
+ *
+ * In headless mode, the password is read on standard input.
  */
 
+#ifdef WEECHAT_HEADLESS
+void
+gui_main_get_password (const char *prompt1, const char *prompt2,
+                       const char *prompt3,
+                       char *password, int size)
+{
+    int length;
+
+    /* make C compiler happy */
+    (void) prompt2;
+    (void) prompt3;
+
+    memset (password, '\0', size);
+
+    fprintf (stderr, "%s\n", prompt1);
+    if (!fgets (password, size, stdin))
+        return;
+
+    length = strlen (password);
+    while ((length > 0)
+           && ((password[length - 1] == '\n')
+               || (password[length - 1] == '\r')))
+    {
+        length--;
+        password[length] = '\0';
+    }
+}
+#else
 void
 gui_main_get_password (const char *prompt1, const char *prompt2,
                        const char *prompt3,
@@ -121,6 +153,7 @@ gui_main_get_password (const char *prompt1, const char *prompt2,
     refresh ();
     endwin ();
 }
+#endif /* WEECHAT_HEADLESS */
 
 /*
  * Pre-initializes GUI (called before gui_init).
@@ -304,7 +337,9 @@ gui_main_signal_sigwinch ()
 void
 gui_main_debug_libs ()
 {
-#if defined(NCURSES_VERSION) && defined(NCURSES_VERSION_PATCH)
+#ifdef WEECHAT_HEADLESS
+    gui_chat_printf (NULL, "    ncurses: (headless)");
+#elif defined(NCURSES_VERSION) && defined(NCURSES_VERSION_PATCH)
     gui_chat_printf (NULL, "    ncurses: %s (patch %d)",
                      NCURSES_VERSION, NCURSES_VERSION_PATCH);
 #else
@@ -314,8 +349,45 @@ gui_main_debug_libs ()
 
 /*
  * Refreshs for windows, buffers, bars.
+ *
+ * In headless mode, nothing is displayed: refresh flags are just reset
+ * (buffers, lines, hotlist and nicklist are still updated as usual).
  */
 
+#ifdef WEECHAT_HEADLESS
+void
+gui_main_refreshs ()
+{
+    struct t_gui_window *ptr_win;
+    struct t_gui_buffer *ptr_buffer;
+    struct t_gui_bar *ptr_bar;
+
+    gui_color_buffer_refresh_needed = 0;
+
+    /* compute size of windows (nothing is drawn) */
+    if (gui_window_refresh_needed)
+    {
+        gui_window_refresh_screen (0);
+        gui_window_refresh_needed = 0;
+    }
+
+    for (ptr_win = gui_windows; ptr_win; ptr_win = ptr_win->next_window)
+    {
+        ptr_win->refresh_needed = 0;
+    }
+
+    for (ptr_buffer = gui_buffers; ptr_buffer;
+         ptr_buffer = ptr_buffer->next_buffer)
+    {
+        ptr_buffer->chat_refresh_needed = 0;
+    }
+
+    for (ptr_bar = gui_bars; ptr_bar; ptr_bar = ptr_bar->next_bar)
+    {
+        ptr_bar->bar_refresh_needed = 0;
+    }
+}
+#else
 void
 gui_main_refreshs ()
 {
@@ -418,6 +490,7 @@ gui_main_refreshs ()
             gui_window_move_cursor ();
     }
 }
+#endif /* WEECHAT_HEADLESS */
 
 /*
  * Main loop for WeeChat with ncurses GUI.
@@ -427,7 +500,7 @@ void
 gui_main_loop ()
 {
     struct t_hook *hook_fd_keyboard;
-    struct timeval tv_timeout;
+    struct timeval tv_timeout, tv_phase;
     fd_set read_fds, write_fds, except_fds;
     int max_fd;
     int ready;
@@ -440,16 +513,30 @@ gui_main_loop ()
     /* catch SIGWINCH signal: redraw screen */
     util_catch_signal (SIGWINCH, &gui_main_signal_sigwinch);
 
+#ifdef WEECHAT_HEADLESS
+    /* no keyboard in headless mode */
+    hook_fd_keyboard = NULL;
+#else
     /* hook stdin (read keyboard) */
     hook_fd_keyboard = hook_fd (NULL, STDIN_FILENO, 1, 0, 0,
                                 &gui_key_read_cb, NULL);
+#endif
 
     gui_window_ask_refresh (1);
 
     while (!weechat_quit)
     {
         /* execute hook timers */
+        debug_main_loop_phase_start (DEBUG_MAIN_LOOP_PHASE_TIMERS, &tv_phase);
         hook_timer_exec ();
+        debug_main_loop_phase_end (DEBUG_MAIN_LOOP_PHASE_TIMERS, &tv_phase);
+
+        debug_main_loop_phase_start (DEBUG_MAIN_LOOP_PHASE_REFRESHS,
+                                     &tv_phase);
+
+        /* send batch of lines added and nicklist changes */
+        gui_line_batch_send_hsignal ();
+        gui_nicklist_batch_send_hsignal ();
 
         /* auto reset of color pairs */
         if (gui_color_pairs_auto_reset)
@@ -473,22 +560,29 @@ gui_main_loop ()
 
         gui_color_pairs_auto_reset_pending = 0;
 
+        debug_main_loop_phase_end (DEBUG_MAIN_LOOP_PHASE_REFRESHS, &tv_phase);
+
         /* wait for keyboard or network activity */
         FD_ZERO (&read_fds);
         FD_ZERO (&write_fds);
         FD_ZERO (&except_fds);
         max_fd = hook_fd_set (&read_fds, &write_fds, &except_fds);
-        hook_timer_time_to_next (&tv_timeout);
         ready = select (max_fd + 1, &read_fds, &write_fds, &except_fds,
-                        &tv_timeout);
+                        (hook_timer_time_to_next (&tv_timeout)) ?
+                        &tv_timeout : NULL);
         if (ready > 0)
         {
+            debug_main_loop_phase_start (DEBUG_MAIN_LOOP_PHASE_FD, &tv_phase);
             hook_fd_exec (&read_fds, &write_fds, &except_fds);
+            debug_main_loop_phase_end (DEBUG_MAIN_LOOP_PHASE_FD, &tv_phase);
         }
+
+        debug_main_loop_iteration_end ();
     }
 
     /* remove keyboard hook */
-    unhook (hook_fd_keyboard);
+    if (hook_fd_keyboard)
+        unhook (hook_fd_keyboard);
 }
 
 /*
@@ -565,6 +659,9 @@ gui_main_end (int clean_exit)
         /* free some variables used for chat area */
         gui_chat_end ();
 
+        /* free some variables used for lines */
+        gui_line_batch_end ();
+
         /* free some variables used for nicklist */
         gui_nicklist_end ();
 
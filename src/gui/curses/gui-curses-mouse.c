@@ -88,7 +88,9 @@ void
 gui_mouse_enable ()
 {
     gui_mouse_enabled = 1;
+#ifndef WEECHAT_HEADLESS
     fprintf (stderr, "\033[?1005h\033[?1000h\033[?1002h");
+#endif
 }
 
 /*
@@ -99,7 +101,9 @@ void
 gui_mouse_disable ()
 {
     gui_mouse_enabled = 0;
+#ifndef WEECHAT_HEADLESS
     fprintf (stderr, "\033[?1002l\033[?1000l\033[?1005l");
+#endif
 }
 
 /*
@@ -23,6 +23,7 @@
 #include "config.h"
 #endif
 
+#ifndef WEECHAT_HEADLESS
 #ifdef HAVE_NCURSESW_CURSES_H
 #ifdef __sun
 #include <ncurses/term.h>
@@ -32,6 +33,7 @@
 #else
 #include <term.h>
 #endif
+#endif /* WEECHAT_HEADLESS */
 
 
 /*
@@ -45,7 +47,7 @@
 void
 gui_term_set_eat_newline_glitch (int value)
 {
-#ifdef HAVE_EAT_NEWLINE_GLITCH
+#if defined(HAVE_EAT_NEWLINE_GLITCH) && !defined(WEECHAT_HEADLESS)
     eat_newline_glitch = value;
 #else
     /* make C compiler happy */
@@ -97,9 +97,12 @@ gui_window_get_height ()
 void
 gui_window_read_terminal_size ()
 {
+#ifndef WEECHAT_HEADLESS
     struct winsize size;
+#endif
     int new_width, new_height;
 
+#ifndef WEECHAT_HEADLESS
     if (ioctl (fileno (stdout), TIOCGWINSZ, &size) == 0)
     {
         resizeterm (size.ws_row, size.ws_col);
@@ -107,6 +110,7 @@ gui_window_read_terminal_size ()
         gui_term_lines = size.ws_row;
     }
     else
+#endif
     {
         getmaxyx (stdscr, new_height, new_width);
         gui_term_cols = new_width;
@@ -2432,7 +2436,12 @@ gui_window_set_title (const char *title)
 {
     char *new_title, *envterm, *envshell, *shell, *shellname;
 
+#ifdef WEECHAT_HEADLESS
+    /* no terminal in headless mode */
+    envterm = NULL;
+#else
     envterm = getenv ("TERM");
+#endif
     if (!envterm)
         return;
 
@@ -2502,6 +2511,11 @@ gui_window_set_title (const char *title)
 void
 gui_window_send_clipboard (const char *storage_unit, const char *text)
 {
+#ifdef WEECHAT_HEADLESS
+    /* no terminal in headless mode */
+    (void) storage_unit;
+    (void) text;
+#else
     char *text_base64;
     int length;
 
@@ -2515,6 +2529,7 @@ gui_window_send_clipboard (const char *storage_unit, const char *text)
                  text_base64);
         free (text_base64);
     }
+#endif /* WEECHAT_HEADLESS */
 }
 
 /*
@@ -2524,6 +2539,10 @@ gui_window_send_clipboard (const char *storage_unit, const char *text)
 void
 gui_window_set_bracketed_paste_mode (int enable)
 {
+#ifdef WEECHAT_HEADLESS
+    /* no terminal in headless mode */
+    (void) enable;
+#else
     char *envterm, *envtmux;
     int tmux, screen;
 
@@ -2537,6 +2556,7 @@ gui_window_set_bracketed_paste_mode (int enable)
              (screen) ? "\033P" : "",
              (enable) ? "h" : "l",
              (screen) ? "\033\\" : "");
+#endif /* WEECHAT_HEADLESS */
 }
 
 /*
@@ -22,7 +22,9 @@
 
 #include <time.h>
 
-#ifdef HAVE_NCURSESW_CURSES_H
+#ifdef WEECHAT_HEADLESS
+#include "headless/ncurses-fake.h"
+#elif HAVE_NCURSESW_CURSES_H
 #include <ncursesw/ncurses.h>
 #elif HAVE_NCURSES_H
 #include <ncurses.h>
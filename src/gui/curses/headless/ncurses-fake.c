@@ -0,0 +1,341 @@
+/*
+ * ncurses-fake.c - fake ncurses lib (for headless mode)
+ *
+ * Copyright (C) 2026 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+
+#include "ncurses-fake.h"
+
+
+WINDOW stdscr_fake = { 0, 0, 25, 80 }; /* default size of fake terminal     */
+WINDOW *stdscr = &stdscr_fake;
+int LINES = 25;
+int COLS = 80;
+int COLORS = 0;
+int COLOR_PAIRS = 0;
+
+
+WINDOW *
+initscr ()
+{
+    return stdscr;
+}
+
+int
+endwin ()
+{
+    return OK;
+}
+
+WINDOW *
+newwin (int nlines, int ncols, int begin_y, int begin_x)
+{
+    WINDOW *new_window;
+
+    /* make C compiler happy */
+    (void) begin_y;
+    (void) begin_x;
+
+    new_window = malloc (sizeof (*new_window));
+    if (!new_window)
+        return NULL;
+
+    new_window->_cury = 0;
+    new_window->_curx = 0;
+    new_window->_maxy = nlines;
+    new_window->_maxx = ncols;
+
+    return new_window;
+}
+
+int
+delwin (WINDOW *win)
+{
+    if (win && (win != stdscr))
+        free (win);
+
+    return OK;
+}
+
+int
+cbreak ()
+{
+    return OK;
+}
+
+int
+raw ()
+{
+    return OK;
+}
+
+int
+noecho ()
+{
+    return OK;
+}
+
+int
+nodelay (WINDOW *win, int bf)
+{
+    (void) win;
+    (void) bf;
+
+    return OK;
+}
+
+int
+curs_set (int visibility)
+{
+    (void) visibility;
+
+    return 1;
+}
+
+int
+has_colors ()
+{
+    return 0;
+}
+
+int
+can_change_color ()
+{
+    return 0;
+}
+
+int
+start_color ()
+{
+    return OK;
+}
+
+int
+use_default_colors ()
+{
+    return OK;
+}
+
+int
+init_pair (short pair, short f, short b)
+{
+    (void) pair;
+    (void) f;
+    (void) b;
+
+    return OK;
+}
+
+int
+resizeterm (int lines, int columns)
+{
+    LINES = lines;
+    COLS = columns;
+    stdscr->_maxy = lines;
+    stdscr->_maxx = columns;
+
+    return OK;
+}
+
+int
+wgetch (WINDOW *win)
+{
+    (void) win;
+
+    return ERR;
+}
+
+int
+wmove (WINDOW *win, int y, int x)
+{
+    if (!win)
+        return ERR;
+
+    win->_cury = y;
+    win->_curx = x;
+
+    return OK;
+}
+
+int
+waddnstr (WINDOW *win, const char *str, int n)
+{
+    (void) win;
+    (void) str;
+    (void) n;
+
+    return OK;
+}
+
+int
+mvwaddstr (WINDOW *win, int y, int x, const char *str)
+{
+    (void) str;
+
+    return wmove (win, y, x);
+}
+
+int
+mvwprintw (WINDOW *win, int y, int x, const char *fmt, ...)
+{
+    (void) fmt;
+
+    return wmove (win, y, x);
+}
+
+int
+wclear (WINDOW *win)
+{
+    (void) win;
+
+    return OK;
+}
+
+int
+werase (WINDOW *win)
+{
+    (void) win;
+
+    return OK;
+}
+
+int
+wclrtoeol (WINDOW *win)
+{
+    (void) win;
+
+    return OK;
+}
+
+int
+wclrtobot (WINDOW *win)
+{
+    (void) win;
+
+    return OK;
+}
+
+int
+wrefresh (WINDOW *win)
+{
+    (void) win;
+
+    return OK;
+}
+
+int
+wnoutrefresh (WINDOW *win)
+{
+    (void) win;
+
+    return OK;
+}
+
+int
+wattr_on (WINDOW *win, attr_t attrs, void *opts)
+{
+    (void) win;
+    (void) attrs;
+    (void) opts;
+
+    return OK;
+}
+
+int
+wattr_off (WINDOW *win, attr_t attrs, void *opts)
+{
+    (void) win;
+    (void) attrs;
+    (void) opts;
+
+    return OK;
+}
+
+int
+wattr_get (WINDOW *win, attr_t *attrs, short *pair, void *opts)
+{
+    (void) win;
+    (void) opts;
+
+    if (attrs)
+        *attrs = A_NORMAL;
+    if (pair)
+        *pair = 0;
+
+    return OK;
+}
+
+int
+wattr_set (WINDOW *win, attr_t attrs, short pair, void *opts)
+{
+    (void) win;
+    (void) attrs;
+    (void) pair;
+    (void) opts;
+
+    return OK;
+}
+
+int
+wcolor_set (WINDOW *win, short pair, void *opts)
+{
+    (void) win;
+    (void) pair;
+    (void) opts;
+
+    return OK;
+}
+
+void
+wbkgdset (WINDOW *win, chtype ch)
+{
+    (void) win;
+    (void) ch;
+}
+
+int
+mvwchgat (WINDOW *win, int y, int x, int n, attr_t attr, short color,
+          const void *opts)
+{
+    (void) n;
+    (void) attr;
+    (void) color;
+    (void) opts;
+
+    return wmove (win, y, x);
+}
+
+int
+mvwhline (WINDOW *win, int y, int x, chtype ch, int n)
+{
+    (void) ch;
+    (void) n;
+
+    return wmove (win, y, x);
+}
+
+int
+mvwvline (WINDOW *win, int y, int x, chtype ch, int n)
+{
+    (void) ch;
+    (void) n;
+
+    return wmove (win, y, x);
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2026 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef WEECHAT_NCURSES_FAKE_H
+#define WEECHAT_NCURSES_FAKE_H 1
+
+/*
+ * Fake ncurses API used to build WeeChat without terminal (headless mode):
+ * all functions do nothing, only the size of windows is kept.
+ */
+
+#define ERR (-1)
+#define OK 0
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define A_NORMAL     0
+#define A_STANDOUT   (1 << 16)
+#define A_UNDERLINE  (1 << 17)
+#define A_REVERSE    (1 << 18)
+#define A_BLINK      (1 << 19)
+#define A_DIM        (1 << 20)
+#define A_BOLD       (1 << 21)
+#define A_ITALIC     (1 << 23)
+
+#define COLOR_BLACK   0
+#define COLOR_RED     1
+#define COLOR_GREEN   2
+#define COLOR_YELLOW  3
+#define COLOR_BLUE    4
+#define COLOR_MAGENTA 5
+#define COLOR_CYAN    6
+#define COLOR_WHITE   7
+
+#define COLOR_PAIR(x) ((x) << 8)
+
+#define ACS_HLINE '-'
+#define ACS_VLINE '|'
+
+typedef unsigned int chtype;
+typedef unsigned int attr_t;
+
+struct _window
+{
+    int _cury, _curx;                   /* cursor position                  */
+    int _maxy, _maxx;                   /* size of window                   */
+};
+typedef struct _window WINDOW;
+
+#define getyx(win, y, x)                                                \
+    (y = (win) ? (win)->_cury : ERR, x = (win) ? (win)->_curx : ERR)
+#define getmaxyx(win, y, x)                                             \
+    (y = (win) ? (win)->_maxy : ERR, x = (win) ? (win)->_maxx : ERR)
+
+#define getch() wgetch(stdscr)
+#define move(y, x) wmove(stdscr, y, x)
+#define refresh() wrefresh(stdscr)
+#define clear() wclear(stdscr)
+#define waddstr(win, str) waddnstr(win, str, -1)
+#define mvaddstr(y, x, str) mvwaddstr(stdscr, y, x, str)
+#define wattron(win, attrs) wattr_on(win, attrs, NULL)
+#define wattroff(win, attrs) wattr_off(win, attrs, NULL)
+
+extern WINDOW *stdscr;
+extern int LINES, COLS;
+extern int COLORS, COLOR_PAIRS;
+
+extern WINDOW *initscr ();
+extern int endwin ();
+extern WINDOW *newwin (int nlines, int ncols, int begin_y, int begin_x);
+extern int delwin (WINDOW *win);
+extern int cbreak ();
+extern int raw ();
+extern int noecho ();
+extern int nodelay (WINDOW *win, int bf);
+extern int curs_set (int visibility);
+extern int has_colors ();
+extern int can_change_color ();
+extern int start_color ();
+extern int use_default_colors ();
+extern int init_pair (short pair, short f, short b);
+extern int resizeterm (int lines, int columns);
+extern int wgetch (WINDOW *win);
+extern int wmove (WINDOW *win, int y, int x);
+extern int waddnstr (WINDOW *win, const char *str, int n);
+extern int mvwaddstr (WINDOW *win, int y, int x, const char *str);
+extern int mvwprintw (WINDOW *win, int y, int x, const char *fmt, ...);
+extern int wclear (WINDOW *win);
+extern int werase (WINDOW *win);
+extern int wclrtoeol (WINDOW *win);
+extern int wclrtobot (WINDOW *win);
+extern int wrefresh (WINDOW *win);
+extern int wnoutrefresh (WINDOW *win);
+extern int wattr_on (WINDOW *win, attr_t attrs, void *opts);
+extern int wattr_off (WINDOW *win, attr_t attrs, void *opts);
+extern int wattr_get (WINDOW *win, attr_t *attrs, short *pair, void *opts);
+extern int wattr_set (WINDOW *win, attr_t attrs, short pair, void *opts);
+extern int wcolor_set (WINDOW *win, short pair, void *opts);
+extern void wbkgdset (WINDOW *win, chtype ch);
+extern int mvwchgat (WINDOW *win, int y, int x, int n, attr_t attr,
+                     short color, const void *opts);
+extern int mvwhline (WINDOW *win, int y, int x, chtype ch, int n);
+extern int mvwvline (WINDOW *win, int y, int x, chtype ch, int n);
+
+#endif /* WEECHAT_NCURSES_FAKE_H */
@@ -0,0 +1,44 @@
+/*
+ * main.c - entry point for Curses GUI
+ *
+ * Copyright (C) 2003-2014 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include "../../core/weechat.h"
+#include "../gui-main.h"
+
+
+/*
+ * Entry point for WeeChat.
+ */
+
+int
+main (int argc, char *argv[])
+{
+    weechat_init (argc, argv);          /* init WeeChat                     */
+    gui_main_loop ();                   /* WeeChat main loop                */
+    weechat_end ();                     /* end WeeChat and quit             */
+
+    return EXIT_SUCCESS;                /* make C compiler happy            */
+}
@@ -30,6 +30,7 @@
 
 #include "../core/weechat.h"
 #include "../core/wee-config.h"
+#include "../core/wee-debug.h"
 #include "../core/wee-eval.h"
 #include "../core/wee-hashtable.h"
 #include "../core/wee-hdata.h"
@@ -633,6 +634,8 @@ gui_bar_draw (struct t_gui_bar *bar)
     struct t_gui_window *ptr_win;
     struct t_gui_bar_window *ptr_bar_win;
 
+    debug_trace_begin ("gui", "bar_draw", bar->name);
+
     if (!CONFIG_BOOLEAN(bar->options[GUI_BAR_OPTION_HIDDEN]))
     {
         if (bar->bar_window)
@@ -657,6 +660,8 @@ gui_bar_draw (struct t_gui_bar *bar)
         }
     }
     bar->bar_refresh_needed = 0;
+
+    debug_trace_end ();
 }
 
 /*
@@ -41,6 +41,7 @@
 #include "../core/wee-infolist.h"
 #include "../core/wee-list.h"
 #include "../core/wee-log.h"
+#include "../core/wee-memory.h"
 #include "../core/wee-string.h"
 #include "../core/wee-utf8.h"
 #include "../plugins/plugin.h"
@@ -161,6 +162,42 @@ gui_buffer_build_full_name (struct t_gui_buffer *buffer)
     }
 }
 
+/*
+ * Updates owner of buffer for memory counters: plugin name, or
+ * "plugin/script" if buffer has been created by a script (local variable
+ * "script_name").
+ *
+ * Memory already counted for lines and nicklist is moved to the new owner.
+ */
+
+void
+gui_buffer_memory_owner_update (struct t_gui_buffer *buffer)
+{
+    struct t_memory_owner *ptr_owner;
+    const char *plugin_name, *script_name;
+    char name[512];
+
+    plugin_name = gui_buffer_get_plugin_name (buffer);
+    script_name = (buffer->local_variables) ?
+        hashtable_get (buffer->local_variables, "script_name") : NULL;
+    if (script_name && script_name[0])
+    {
+        snprintf (name, sizeof (name), "%s/%s", plugin_name, script_name);
+        ptr_owner = memory_owner_get (name);
+    }
+    else
+        ptr_owner = memory_owner_get (plugin_name);
+
+    if (ptr_owner == buffer->memory_owner)
+        return;
+
+    gui_line_memory_add_all (buffer, -1);
+    gui_nicklist_memory_add_all (buffer, -1);
+    buffer->memory_owner = ptr_owner;
+    gui_line_memory_add_all (buffer, 1);
+    gui_nicklist_memory_add_all (buffer, 1);
+}
+
 /*
  * Adds a new local variable in a buffer.
  */
@@ -176,6 +213,8 @@ gui_buffer_local_var_add (struct t_gui_buffer *buffer, const char *name,
 
     ptr_value = hashtable_get (buffer->local_variables, name);
     hashtable_set (buffer->local_variables, name, value);
+    if (strcmp (name, "script_name") == 0)
+        gui_buffer_memory_owner_update (buffer);
     (void) hook_signal_send ((ptr_value) ?
                              "buffer_localvar_changed" : "buffer_localvar_added",
                              WEECHAT_HOOK_SIGNAL_POINTER, buffer);
@@ -197,6 +236,8 @@ gui_buffer_local_var_remove (struct t_gui_buffer *buffer, const char *name)
     if (ptr_value)
     {
         hashtable_remove (buffer->local_variables, name);
+        if (strcmp (name, "script_name") == 0)
+            gui_buffer_memory_owner_update (buffer);
         (void) hook_signal_send ("buffer_localvar_removed",
                                  WEECHAT_HOOK_SIGNAL_POINTER, buffer);
     }
@@ -578,6 +619,7 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     /* init buffer */
     new_buffer->plugin = plugin;
     new_buffer->plugin_name_for_upgrade = NULL;
+    new_buffer->memory_owner = memory_owner_get (plugin_get_name (plugin));
 
     /* number will be set later (when inserting buffer in list) */
     gui_layout_buffer_get_number (gui_layout_current,
@@ -611,6 +653,7 @@ gui_buffer_new (struct t_weechat_plugin *plugin,
     new_buffer->own_lines = gui_lines_alloc ();
     new_buffer->mixed_lines = NULL;
     new_buffer->lines = new_buffer->own_lines;
+    new_buffer->next_line_id = 0;
     new_buffer->time_for_each_line = 1;
     new_buffer->chat_refresh_needed = 2;
 
@@ -2626,6 +2669,7 @@ gui_buffer_close (struct t_gui_buffer *buffer)
         gui_completion_free (buffer->completion);
     gui_nicklist_remove_all (buffer);
     gui_nicklist_remove_group (buffer, buffer->nicklist_root);
+    gui_nicklist_batch_remove_buffer (buffer);
     if (buffer->hotlist_max_level_nicks)
         hashtable_free (buffer->hotlist_max_level_nicks);
     gui_key_free_all (&buffer->keys, &buffer->last_key,
@@ -3946,6 +3990,7 @@ gui_buffer_hdata_buffer_cb (void *data, const char *hdata_name)
     {
         HDATA_VAR(struct t_gui_buffer, plugin, POINTER, 0, NULL, "plugin");
         HDATA_VAR(struct t_gui_buffer, plugin_name_for_upgrade, STRING, 0, NULL, NULL);
+        HDATA_VAR(struct t_gui_buffer, memory_owner, POINTER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, number, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, layout_number, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, layout_number_merge_order, INTEGER, 0, NULL, NULL);
@@ -3968,6 +4013,7 @@ gui_buffer_hdata_buffer_cb (void *data, const char *hdata_name)
         HDATA_VAR(struct t_gui_buffer, own_lines, POINTER, 0, NULL, "lines");
         HDATA_VAR(struct t_gui_buffer, mixed_lines, POINTER, 0, NULL, "lines");
         HDATA_VAR(struct t_gui_buffer, lines, POINTER, 0, NULL, "lines");
+        HDATA_VAR(struct t_gui_buffer, next_line_id, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, time_for_each_line, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, chat_refresh_needed, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_buffer, nicklist, INTEGER, 0, NULL, NULL);
@@ -4152,6 +4198,8 @@ gui_buffer_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!infolist_new_var_integer (ptr_item, "prefix_max_length", buffer->lines->prefix_max_length))
         return 0;
+    if (!infolist_new_var_integer (ptr_item, "next_line_id", buffer->next_line_id))
+        return 0;
     if (!infolist_new_var_integer (ptr_item, "time_for_each_line", buffer->time_for_each_line))
         return 0;
     if (!infolist_new_var_integer (ptr_item, "nicklist_case_sensitive", buffer->nicklist_case_sensitive))
@@ -4340,6 +4388,9 @@ gui_buffer_print_log ()
         log_printf ("  plugin. . . . . . . . . : 0x%lx ('%s')",
                     ptr_buffer->plugin, gui_buffer_get_plugin_name (ptr_buffer));
         log_printf ("  plugin_name_for_upgrade : '%s'",  ptr_buffer->plugin_name_for_upgrade);
+        log_printf ("  memory_owner. . . . . . : 0x%lx ('%s')",
+                    ptr_buffer->memory_owner,
+                    (ptr_buffer->memory_owner) ? ptr_buffer->memory_owner->name : "");
         log_printf ("  number. . . . . . . . . : %d",    ptr_buffer->number);
         log_printf ("  layout_number . . . . . : %d",    ptr_buffer->layout_number);
         log_printf ("  layout_number_merge_order: %d",    ptr_buffer->layout_number_merge_order);
@@ -4364,6 +4415,7 @@ gui_buffer_print_log ()
         log_printf ("  mixed_lines . . . . . . : 0x%lx", ptr_buffer->mixed_lines);
         gui_lines_print_log (ptr_buffer->mixed_lines);
         log_printf ("  lines . . . . . . . . . : 0x%lx", ptr_buffer->lines);
+        log_printf ("  next_line_id. . . . . . : %d",    ptr_buffer->next_line_id);
         log_printf ("  time_for_each_line. . . : %d",    ptr_buffer->time_for_each_line);
         log_printf ("  chat_refresh_needed . . : %d",    ptr_buffer->chat_refresh_needed);
         log_printf ("  nicklist. . . . . . . . : %d",    ptr_buffer->nicklist);
@@ -4471,10 +4523,11 @@ gui_buffer_print_log ()
             num--;
             tags = string_build_with_split_string ((const char **)ptr_line->data->tags_array,
                                                    ",");
-            log_printf ("       line N-%05d: y:%d, str_time:'%s', tags:'%s', "
-                        "displayed:%d, highlight:%d, refresh_needed:%d, "
-                        "prefix:'%s'",
-                        num, ptr_line->data->y, ptr_line->data->str_time,
+            log_printf ("       line N-%05d: id:%d, y:%d, str_time:'%s', "
+                        "tags:'%s', displayed:%d, highlight:%d, "
+                        "refresh_needed:%d, prefix:'%s'",
+                        num, ptr_line->data->id, ptr_line->data->y,
+                        ptr_line->data->str_time,
                         (tags) ? tags  : "",
                         (int)(ptr_line->data->displayed),
                         (int)(ptr_line->data->highlight),
@@ -26,6 +26,7 @@
 struct t_hashtable;
 struct t_gui_window;
 struct t_infolist;
+struct t_memory_owner;
 
 enum t_gui_buffer_type
 {
@@ -80,6 +81,8 @@ struct t_gui_buffer
      * loaded
      */
     char *plugin_name_for_upgrade;     /* plugin name when upgrading        */
+    struct t_memory_owner *memory_owner; /* owner for memory counters      */
+                                       /* (plugin or plugin/script)         */
 
     int number;                        /* buffer number (first is 1)        */
     int layout_number;                 /* number of buffer stored in layout */
@@ -118,6 +121,7 @@ struct t_gui_buffer
     struct t_gui_lines *mixed_lines;   /* mixed lines (if buffers merged)   */
     struct t_gui_lines *lines;         /* pointer to "own_lines" or         */
                                        /* "mixed_lines"                     */
+    int next_line_id;                  /* id for next line added in buffer  */
     int time_for_each_line;            /* time is displayed for each line?  */
     int chat_refresh_needed;           /* refresh for chat is needed ?      */
                                        /* (1=refresh, 2=erase+refresh)      */
@@ -236,6 +240,7 @@ extern char *gui_buffer_properties_set[];
 extern const char *gui_buffer_get_plugin_name (struct t_gui_buffer *buffer);
 extern const char *gui_buffer_get_short_name (struct t_gui_buffer *buffer);
 extern void gui_buffer_build_full_name (struct t_gui_buffer *buffer);
+extern void gui_buffer_memory_owner_update (struct t_gui_buffer *buffer);
 extern void gui_buffer_notify_set_all ();
 extern void gui_buffer_input_buffer_init (struct t_gui_buffer *buffer);
 extern struct t_gui_buffer *gui_buffer_new (struct t_weechat_plugin *plugin,
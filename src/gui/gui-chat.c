@@ -538,9 +538,11 @@ gui_chat_change_time_format ()
         {
             if (ptr_line->data->date != 0)
             {
+                gui_line_memory_add_strings (ptr_line->data, -1);
                 if (ptr_line->data->str_time)
                     free (ptr_line->data->str_time);
                 ptr_line->data->str_time = gui_chat_get_time_string (ptr_line->data->date);
+                gui_line_memory_add_strings (ptr_line->data, 1);
             }
         }
     }
@@ -35,6 +35,7 @@
 #include "../core/wee-hook.h"
 #include "../core/wee-infolist.h"
 #include "../core/wee-log.h"
+#include "../core/wee-memory.h"
 #include "../core/wee-string.h"
 #include "../plugins/plugin.h"
 #include "gui-line.h"
@@ -47,6 +48,14 @@
 #include "gui-window.h"
 
 
+struct t_gui_line **gui_line_batch_lines = NULL; /* lines added (batch)     */
+int gui_line_batch_size = 0;           /* size of array with lines          */
+int gui_line_batch_count = 0;          /* number of lines in batch          */
+struct t_hashtable *gui_line_batch_index = NULL; /* index of lines in batch */
+struct t_hashtable *gui_line_batch_hsignal = NULL; /* hsignal (batch)       */
+int gui_line_batch_enabled = 0;        /* 1 if batch hsignal is hooked      */
+
+
 /*
  * Allocates structure "t_gui_lines" and initializes it.
  *
@@ -120,6 +129,75 @@ gui_line_tags_free (struct t_gui_line_data *line_data)
     }
 }
 
+/*
+ * Adds (sign = 1) or removes (sign = -1) memory used by strings of a line
+ * (message, time and array of tags) in memory counters of buffer owner.
+ *
+ * Prefix and tags are shared strings, so they are not counted.
+ */
+
+void
+gui_line_memory_add_strings (struct t_gui_line_data *line_data, int sign)
+{
+    long long bytes;
+    long objects;
+
+    bytes = 0;
+    objects = 0;
+    if (line_data->message)
+    {
+        bytes += strlen (line_data->message) + 1;
+        objects++;
+    }
+    if (line_data->str_time)
+    {
+        bytes += strlen (line_data->str_time) + 1;
+        objects++;
+    }
+    if (line_data->tags_array)
+    {
+        bytes += (line_data->tags_count + 1) * sizeof (*(line_data->tags_array));
+        objects++;
+    }
+
+    memory_add (line_data->buffer->memory_owner,
+                MEMORY_CATEGORY_LINE_STRINGS, sign * bytes, sign * objects);
+}
+
+/*
+ * Adds (sign = 1) or removes (sign = -1) memory used by a line (own line of
+ * a buffer, with its data and strings) in memory counters of buffer owner.
+ */
+
+void
+gui_line_memory_add (struct t_gui_line_data *line_data, int sign)
+{
+    memory_add (line_data->buffer->memory_owner, MEMORY_CATEGORY_LINES,
+                sign * (long long)(sizeof (struct t_gui_line)
+                                   + sizeof (struct t_gui_line_data)),
+                sign);
+    gui_line_memory_add_strings (line_data, sign);
+}
+
+/*
+ * Adds (sign = 1) or removes (sign = -1) memory used by all own lines of a
+ * buffer in memory counters of buffer owner (used when the owner changes).
+ *
+ * Mixed lines are counted in "core" owner, so they are not concerned.
+ */
+
+void
+gui_line_memory_add_all (struct t_gui_buffer *buffer, int sign)
+{
+    struct t_gui_line *ptr_line;
+
+    for (ptr_line = buffer->own_lines->first_line; ptr_line;
+         ptr_line = ptr_line->next_line)
+    {
+        gui_line_memory_add (ptr_line->data, sign);
+    }
+}
+
 /*
  * Checks if prefix on line is a nick and is the same as nick on previous line.
  *
@@ -990,6 +1068,7 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
     /* free data */
     if (free_data)
     {
+        gui_line_memory_add (line->data, -1);
         if (line->data->str_time)
             free (line->data->str_time);
         gui_line_tags_free (line->data);
@@ -999,6 +1078,11 @@ gui_line_remove_from_list (struct t_gui_buffer *buffer,
             free (line->data->message);
         free (line->data);
     }
+    else
+    {
+        memory_add (NULL, MEMORY_CATEGORY_LINES,
+                    -1 * (long long)sizeof (*line), -1);
+    }
 
     /* remove line from list */
     if (line->prev_line)
@@ -1030,6 +1114,7 @@ gui_line_mixed_add (struct t_gui_lines *lines,
     {
         new_line->data = line_data;
         gui_line_add_to_list (lines, new_line);
+        memory_add (NULL, MEMORY_CATEGORY_LINES, sizeof (*new_line), 1);
     }
 }
 
@@ -1081,6 +1166,149 @@ gui_line_mixed_free_all (struct t_gui_buffer *buffer)
     }
 }
 
+/*
+ * Adds a line in batch of lines added (sent with hsignal "buffer_lines_added"
+ * on next main loop iteration).
+ */
+
+void
+gui_line_batch_add (struct t_gui_line *line)
+{
+    struct t_gui_line **new_lines;
+    int new_size;
+
+    if (!gui_line_batch_index)
+    {
+        gui_line_batch_index = hashtable_new (256,
+                                              WEECHAT_HASHTABLE_POINTER,
+                                              WEECHAT_HASHTABLE_INTEGER,
+                                              NULL,
+                                              NULL);
+        if (!gui_line_batch_index)
+            return;
+    }
+
+    if (gui_line_batch_count >= gui_line_batch_size)
+    {
+        new_size = (gui_line_batch_size == 0) ? 64 : gui_line_batch_size * 2;
+        new_lines = realloc (gui_line_batch_lines,
+                             new_size * sizeof (*new_lines));
+        if (!new_lines)
+            return;
+        gui_line_batch_lines = new_lines;
+        gui_line_batch_size = new_size;
+    }
+
+    gui_line_batch_lines[gui_line_batch_count] = line;
+    hashtable_set (gui_line_batch_index, line, &gui_line_batch_count);
+    gui_line_batch_count++;
+}
+
+/*
+ * Removes a line from batch of lines added (called when a line is freed).
+ */
+
+void
+gui_line_batch_remove (struct t_gui_line *line)
+{
+    int *ptr_index;
+
+    if (gui_line_batch_count == 0)
+        return;
+
+    ptr_index = hashtable_get (gui_line_batch_index, line);
+    if (ptr_index)
+    {
+        if ((*ptr_index >= 0) && (*ptr_index < gui_line_batch_count))
+            gui_line_batch_lines[*ptr_index] = NULL;
+        hashtable_remove (gui_line_batch_index, line);
+    }
+}
+
+/*
+ * Sends hsignal "buffer_lines_added" with lines added since last call
+ * (called once per main loop iteration).
+ *
+ * Lines are added in batch only if this hsignal is hooked (this is checked on
+ * each call).
+ */
+
+void
+gui_line_batch_send_hsignal ()
+{
+    char str_key[32], str_value[32];
+    int i, count;
+
+    count = 0;
+
+    if (gui_line_batch_enabled && (gui_line_batch_count > 0))
+    {
+        if (!gui_line_batch_hsignal)
+        {
+            gui_line_batch_hsignal = hashtable_new (256,
+                                                    WEECHAT_HASHTABLE_STRING,
+                                                    WEECHAT_HASHTABLE_STRING,
+                                                    NULL,
+                                                    NULL);
+        }
+        if (gui_line_batch_hsignal)
+        {
+            hashtable_remove_all (gui_line_batch_hsignal);
+            for (i = 0; i < gui_line_batch_count; i++)
+            {
+                if (!gui_line_batch_lines[i])
+                    continue;
+                count++;
+                snprintf (str_key, sizeof (str_key), "line%d", count);
+                snprintf (str_value, sizeof (str_value),
+                          "0x%lx", (long unsigned int)gui_line_batch_lines[i]);
+                hashtable_set (gui_line_batch_hsignal, str_key, str_value);
+            }
+            snprintf (str_value, sizeof (str_value), "%d", count);
+            hashtable_set (gui_line_batch_hsignal, "count", str_value);
+        }
+    }
+
+    /* lines added by callbacks will be sent on next call */
+    if (gui_line_batch_count > 0)
+    {
+        gui_line_batch_count = 0;
+        hashtable_remove_all (gui_line_batch_index);
+    }
+
+    if (count > 0)
+        (void) hook_hsignal_send ("buffer_lines_added", gui_line_batch_hsignal);
+
+    gui_line_batch_enabled = hook_hsignal_is_hooked ("buffer_lines_added");
+}
+
+/*
+ * Frees batch of lines added.
+ */
+
+void
+gui_line_batch_end ()
+{
+    if (gui_line_batch_lines)
+    {
+        free (gui_line_batch_lines);
+        gui_line_batch_lines = NULL;
+    }
+    gui_line_batch_size = 0;
+    gui_line_batch_count = 0;
+    if (gui_line_batch_index)
+    {
+        hashtable_free (gui_line_batch_index);
+        gui_line_batch_index = NULL;
+    }
+    if (gui_line_batch_hsignal)
+    {
+        hashtable_free (gui_line_batch_hsignal);
+        gui_line_batch_hsignal = NULL;
+    }
+    gui_line_batch_enabled = 0;
+}
+
 /*
  * Deletes a line from a buffer.
  */
@@ -1090,6 +1318,9 @@ gui_line_free (struct t_gui_buffer *buffer, struct t_gui_line *line)
 {
     struct t_gui_line *ptr_line;
 
+    /* remove line from batch of lines added (not yet sent) */
+    gui_line_batch_remove (line);
+
     /* first remove mixed line if it exists */
     if (buffer->mixed_lines)
     {
@@ -1206,6 +1437,7 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
 
     /* fill data in new line */
     new_line->data->buffer = buffer;
+    new_line->data->id = buffer->next_line_id++;
     new_line->data->y = -1;
     new_line->data->date = date;
     new_line->data->date_printed = date_printed;
@@ -1217,6 +1449,7 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
     new_line->data->prefix_length = (prefix) ?
         gui_chat_strlen_screen (prefix) : 0;
     new_line->data->message = (message) ? strdup (message) : strdup ("");
+    gui_line_memory_add (new_line->data, 1);
 
     /* get notify level and max notify level for nick in buffer */
     notify_level = gui_line_get_notify_level (new_line);
@@ -1312,6 +1545,9 @@ gui_line_add (struct t_gui_buffer *buffer, time_t date,
     (void) hook_signal_send ("buffer_line_added",
                              WEECHAT_HOOK_SIGNAL_POINTER, new_line);
 
+    if (gui_line_batch_enabled)
+        gui_line_batch_add (new_line);
+
     return new_line;
 }
 
@@ -1356,6 +1592,7 @@ gui_line_add_y (struct t_gui_buffer *buffer, int y, const char *message)
 
         /* fill data in new line */
         new_line->data->buffer = buffer;
+        new_line->data->id = y;
         new_line->data->y = y;
         new_line->data->date = 0;
         new_line->data->date_printed = 0;
@@ -1367,6 +1604,7 @@ gui_line_add_y (struct t_gui_buffer *buffer, int y, const char *message)
         new_line->data->prefix_length = 0;
         new_line->data->message = NULL;
         new_line->data->highlight = 0;
+        gui_line_memory_add (new_line->data, 1);
 
         /* add line to lines list */
         if (ptr_line)
@@ -1396,6 +1634,7 @@ gui_line_add_y (struct t_gui_buffer *buffer, int y, const char *message)
     }
 
     /* set message for line */
+    gui_line_memory_add_strings (ptr_line->data, -1);
     if (ptr_line->data->message)
     {
         /* remove line from coords if the content is changing */
@@ -1408,6 +1647,7 @@ gui_line_add_y (struct t_gui_buffer *buffer, int y, const char *message)
         free (ptr_line->data->message);
     }
     ptr_line->data->message = (message) ? strdup (message) : strdup ("");
+    gui_line_memory_add_strings (ptr_line->data, 1);
 
     /* check if line is filtered or not */
     ptr_line->data->displayed = gui_filter_check_line (ptr_line->data);
@@ -1432,9 +1672,11 @@ gui_line_clear (struct t_gui_line *line)
         string_shared_free (line->data->prefix);
     line->data->prefix = (char *)string_shared_get ("");
 
+    gui_line_memory_add_strings (line->data, -1);
     if (line->data->message)
         free (line->data->message);
     line->data->message = strdup ("");
+    gui_line_memory_add_strings (line->data, 1);
 }
 
 /*
@@ -1605,6 +1847,8 @@ gui_line_hdata_line_data_update_cb (void *data,
     rc = 0;
     update_coords = 0;
 
+    gui_line_memory_add_strings (line_data, -1);
+
     if (hashtable_has_key (hashtable, "date"))
     {
         value = hashtable_get (hashtable, "date");
@@ -1656,6 +1900,8 @@ gui_line_hdata_line_data_update_cb (void *data,
         update_coords = 1;
     }
 
+    gui_line_memory_add_strings (line_data, 1);
+
     if (rc > 0)
     {
         if (update_coords)
@@ -1689,6 +1935,7 @@ gui_line_hdata_line_data_cb (void *data, const char *hdata_name)
     if (hdata)
     {
         HDATA_VAR(struct t_gui_line_data, buffer, POINTER, 0, NULL, "buffer");
+        HDATA_VAR(struct t_gui_line_data, id, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_line_data, y, INTEGER, 0, NULL, NULL);
         HDATA_VAR(struct t_gui_line_data, date, TIME, 1, NULL, NULL);
         HDATA_VAR(struct t_gui_line_data, date_printed, TIME, 1, NULL, NULL);
@@ -1729,6 +1976,8 @@ gui_line_add_to_infolist (struct t_infolist *infolist,
     if (!ptr_item)
         return 0;
 
+    if (!infolist_new_var_integer (ptr_item, "id", line->data->id))
+        return 0;
     if (!infolist_new_var_integer (ptr_item, "y", line->data->y))
         return 0;
     if (!infolist_new_var_time (ptr_item, "date", line->data->date))
@@ -29,6 +29,8 @@ struct t_infolist;
 struct t_gui_line_data
 {
     struct t_gui_buffer *buffer;       /* pointer to buffer                 */
+    int id;                            /* line id (unique and increasing in */
+                                       /* buffer; same as y for free buffer)*/
     int y;                             /* line position (for free buffer)   */
     time_t date;                       /* date/time of line (may be past)   */
     time_t date_printed;               /* date/time when weechat print it   */
@@ -69,6 +71,10 @@ struct t_gui_lines
 
 extern struct t_gui_lines *gui_lines_alloc ();
 extern void gui_lines_free (struct t_gui_lines *lines);
+extern void gui_line_memory_add_strings (struct t_gui_line_data *line_data,
+                                         int sign);
+extern void gui_line_memory_add (struct t_gui_line_data *line_data, int sign);
+extern void gui_line_memory_add_all (struct t_gui_buffer *buffer, int sign);
 extern void gui_line_get_prefix_for_display (struct t_gui_line *line,
                                              char **prefix, int *length,
                                              char **color, int *prefix_is_nick);
@@ -99,6 +105,8 @@ extern void gui_line_compute_prefix_max_length (struct t_gui_lines *lines);
 extern void gui_line_set_prefix_same_nick (struct t_gui_line *line);
 extern void gui_line_mixed_free_buffer (struct t_gui_buffer *buffer);
 extern void gui_line_mixed_free_all (struct t_gui_buffer *buffer);
+extern void gui_line_batch_send_hsignal ();
+extern void gui_line_batch_end ();
 extern void gui_line_free (struct t_gui_buffer *buffer,
                            struct t_gui_line *line);
 extern void gui_line_free_all (struct t_gui_buffer *buffer);
@@ -40,6 +40,7 @@
 #include "../core/wee-hook.h"
 #include "../core/wee-infolist.h"
 #include "../core/wee-log.h"
+#include "../core/wee-memory.h"
 #include "../core/wee-string.h"
 #include "../core/wee-utf8.h"
 #include "../plugins/plugin.h"
@@ -50,6 +51,139 @@
 
 struct t_hashtable *gui_nicklist_hsignal = NULL;
 
+struct t_gui_nicklist_change *gui_nicklist_batch_changes = NULL;
+                                       /* nicklist changes (batch)          */
+int gui_nicklist_batch_size = 0;       /* size of array with changes        */
+int gui_nicklist_batch_count = 0;      /* number of changes in batch        */
+struct t_hashtable *gui_nicklist_batch_hsignal = NULL; /* hsignal (batch)   */
+int gui_nicklist_batch_enabled = 0;    /* 1 if batch hsignal is hooked      */
+
+
+/*
+ * Adds a change in batch of nicklist changes (sent with hsignal
+ * "nicklist_changes" on next main loop iteration).
+ *
+ * Argument "signal" must be a static string.
+ */
+
+void
+gui_nicklist_batch_add (const char *signal, struct t_gui_buffer *buffer,
+                        const char *name)
+{
+    struct t_gui_nicklist_change *new_changes;
+    int new_size;
+
+    if (gui_nicklist_batch_count >= gui_nicklist_batch_size)
+    {
+        new_size = (gui_nicklist_batch_size == 0) ?
+            64 : gui_nicklist_batch_size * 2;
+        new_changes = realloc (gui_nicklist_batch_changes,
+                               new_size * sizeof (*new_changes));
+        if (!new_changes)
+            return;
+        gui_nicklist_batch_changes = new_changes;
+        gui_nicklist_batch_size = new_size;
+    }
+
+    gui_nicklist_batch_changes[gui_nicklist_batch_count].signal = signal;
+    gui_nicklist_batch_changes[gui_nicklist_batch_count].buffer = buffer;
+    gui_nicklist_batch_changes[gui_nicklist_batch_count].name =
+        (name) ? strdup (name) : NULL;
+    gui_nicklist_batch_count++;
+}
+
+/*
+ * Removes all changes of a buffer from batch of nicklist changes (called when
+ * a buffer is closed).
+ */
+
+void
+gui_nicklist_batch_remove_buffer (struct t_gui_buffer *buffer)
+{
+    int i, j;
+
+    j = 0;
+    for (i = 0; i < gui_nicklist_batch_count; i++)
+    {
+        if (gui_nicklist_batch_changes[i].buffer == buffer)
+        {
+            if (gui_nicklist_batch_changes[i].name)
+                free (gui_nicklist_batch_changes[i].name);
+        }
+        else
+        {
+            gui_nicklist_batch_changes[j] = gui_nicklist_batch_changes[i];
+            j++;
+        }
+    }
+    gui_nicklist_batch_count = j;
+}
+
+/*
+ * Sends hsignal "nicklist_changes" with nicklist changes since last call
+ * (called once per main loop iteration).
+ *
+ * Changes are added in batch only if this hsignal is hooked (this is checked
+ * on each call).
+ */
+
+void
+gui_nicklist_batch_send_hsignal ()
+{
+    char str_key[32], str_value[32];
+    int i, count;
+
+    count = 0;
+
+    if (gui_nicklist_batch_enabled && (gui_nicklist_batch_count > 0))
+    {
+        if (!gui_nicklist_batch_hsignal)
+        {
+            gui_nicklist_batch_hsignal = hashtable_new (256,
+                                                        WEECHAT_HASHTABLE_STRING,
+                                                        WEECHAT_HASHTABLE_STRING,
+                                                        NULL,
+                                                        NULL);
+        }
+        if (gui_nicklist_batch_hsignal)
+        {
+            hashtable_remove_all (gui_nicklist_batch_hsignal);
+            for (i = 0; i < gui_nicklist_batch_count; i++)
+            {
+                count++;
+                snprintf (str_key, sizeof (str_key), "signal%d", count);
+                hashtable_set (gui_nicklist_batch_hsignal, str_key,
+                               gui_nicklist_batch_changes[i].signal);
+                snprintf (str_key, sizeof (str_key), "buffer%d", count);
+                snprintf (str_value, sizeof (str_value),
+                          "0x%lx",
+                          (long unsigned int)gui_nicklist_batch_changes[i].buffer);
+                hashtable_set (gui_nicklist_batch_hsignal, str_key, str_value);
+                snprintf (str_key, sizeof (str_key), "name%d", count);
+                hashtable_set (gui_nicklist_batch_hsignal, str_key,
+                               gui_nicklist_batch_changes[i].name);
+            }
+            snprintf (str_value, sizeof (str_value), "%d", count);
+            hashtable_set (gui_nicklist_batch_hsignal, "count", str_value);
+        }
+    }
+
+    /* changes done by callbacks will be sent on next call */
+    for (i = 0; i < gui_nicklist_batch_count; i++)
+    {
+        if (gui_nicklist_batch_changes[i].name)
+            free (gui_nicklist_batch_changes[i].name);
+    }
+    gui_nicklist_batch_count = 0;
+
+    if (count > 0)
+    {
+        (void) hook_hsignal_send ("nicklist_changes",
+                                  gui_nicklist_batch_hsignal);
+    }
+
+    gui_nicklist_batch_enabled = hook_hsignal_is_hooked ("nicklist_changes");
+}
 
 /*
  * Sends a signal when something has changed in nicklist.
@@ -62,6 +196,9 @@ gui_nicklist_send_signal (const char *signal, struct t_gui_buffer *buffer,
     char *str_args;
     int length;
 
+    if (gui_nicklist_batch_enabled && buffer)
+        gui_nicklist_batch_add (signal, buffer, arguments);
+
     if (buffer)
     {
         length = 128 + ((arguments) ? strlen (arguments) : 0) + 1 + 1;
@@ -269,6 +406,9 @@ gui_nicklist_add_group (struct t_gui_buffer *buffer,
     if (!new_group)
         return NULL;
 
+    memory_add (buffer->memory_owner, MEMORY_CATEGORY_NICKLIST,
+                sizeof (*new_group), 1);
+
     new_group->name = (char *)string_shared_get (name);
     new_group->color = (color) ? (char *)string_shared_get (color) : NULL;
     new_group->visible = visible;
@@ -442,6 +582,9 @@ gui_nicklist_add_nick (struct t_gui_buffer *buffer,
     if (!new_nick)
         return NULL;
 
+    memory_add (buffer->memory_owner, MEMORY_CATEGORY_NICKLIST,
+                sizeof (*new_nick), 1);
+
     new_nick->group = (group) ? group : buffer->nicklist_root;
     new_nick->name = (char *)string_shared_get (name);
     new_nick->color = (color) ? (char *)string_shared_get (color) : NULL;
@@ -513,6 +656,9 @@ gui_nicklist_remove_nick (struct t_gui_buffer *buffer,
             buffer->nicklist_visible_count--;
     }
 
+    memory_add (buffer->memory_owner, MEMORY_CATEGORY_NICKLIST,
+                -1 * (long long)sizeof (*nick), -1);
+
     free (nick);
 
     if (CONFIG_BOOLEAN(config_look_color_nick_offline))
@@ -587,6 +733,9 @@ gui_nicklist_remove_group (struct t_gui_buffer *buffer,
             buffer->nicklist_visible_count--;
     }
 
+    memory_add (buffer->memory_owner, MEMORY_CATEGORY_NICKLIST,
+                -1 * (long long)sizeof (*group), -1);
+
     free (group);
 
     gui_nicklist_send_signal ("nicklist_group_removed", buffer, group_removed);
@@ -618,6 +767,25 @@ gui_nicklist_remove_all (struct t_gui_buffer *buffer)
     }
 }
 
+/*
+ * Adds (sign = 1) or removes (sign = -1) memory used by nicklist of a buffer
+ * in memory counters of buffer owner (used when the owner changes).
+ */
+
+void
+gui_nicklist_memory_add_all (struct t_gui_buffer *buffer, int sign)
+{
+    long groups, nicks;
+
+    groups = buffer->nicklist_groups_count + ((buffer->nicklist_root) ? 1 : 0);
+    nicks = buffer->nicklist_nicks_count;
+
+    memory_add (buffer->memory_owner, MEMORY_CATEGORY_NICKLIST,
+                sign * (((long long)groups * sizeof (struct t_gui_nick_group))
+                        + ((long long)nicks * sizeof (struct t_gui_nick))),
+                sign * (groups + nicks));
+}
+
 /*
  * Gets next item (group or nick) of a group/nick.
  */
@@ -1341,9 +1509,30 @@ gui_nicklist_print_log (struct t_gui_nick_group *group, int indent)
 void
 gui_nicklist_end ()
 {
+    int i;
+
     if (gui_nicklist_hsignal)
     {
         hashtable_free (gui_nicklist_hsignal);
         gui_nicklist_hsignal = NULL;
     }
+
+    if (gui_nicklist_batch_changes)
+    {
+        for (i = 0; i < gui_nicklist_batch_count; i++)
+        {
+            if (gui_nicklist_batch_changes[i].name)
+                free (gui_nicklist_batch_changes[i].name);
+        }
+        free (gui_nicklist_batch_changes);
+        gui_nicklist_batch_changes = NULL;
+    }
+    gui_nicklist_batch_size = 0;
+    gui_nicklist_batch_count = 0;
+    if (gui_nicklist_batch_hsignal)
+    {
+        hashtable_free (gui_nicklist_batch_hsignal);
+        gui_nicklist_batch_hsignal = NULL;
+    }
+    gui_nicklist_batch_enabled = 0;
 }
@@ -50,6 +50,13 @@ struct t_gui_nick
     struct t_gui_nick *next_nick;      /* link to next nick                 */
 };
 
+struct t_gui_nicklist_change
+{
+    const char *signal;                /* nicklist signal (static string)   */
+    struct t_gui_buffer *buffer;       /* buffer                            */
+    char *name;                        /* name of group or nick             */
+};
+
 /* nicklist functions */
 
 extern struct t_gui_nick_group *gui_nicklist_search_group (struct t_gui_buffer *buffer,
@@ -75,6 +82,7 @@ extern void gui_nicklist_remove_group (struct t_gui_buffer *buffer,
 extern void gui_nicklist_remove_nick (struct t_gui_buffer *buffer,
                                       struct t_gui_nick *nick);
 extern void gui_nicklist_remove_all (struct t_gui_buffer *buffer);
+extern void gui_nicklist_memory_add_all (struct t_gui_buffer *buffer, int sign);
 extern void gui_nicklist_get_next_item (struct t_gui_buffer *buffer,
                                         struct t_gui_nick_group **group,
                                         struct t_gui_nick **nick);
@@ -115,6 +123,8 @@ extern struct t_hdata *gui_nicklist_hdata_nick_cb (void *data,
 extern int gui_nicklist_add_to_infolist (struct t_infolist *infolist,
                                          struct t_gui_buffer *buffer,
                                          const char *name);
+extern void gui_nicklist_batch_remove_buffer (struct t_gui_buffer *buffer);
+extern void gui_nicklist_batch_send_hsignal ();
 extern void gui_nicklist_print_log (struct t_gui_nick_group *group, int indent);
 extern void gui_nicklist_end ();
 
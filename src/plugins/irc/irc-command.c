@@ -1722,7 +1722,8 @@ irc_command_disconnect_one_server (struct t_irc_server *server,
         return 0;
 
     if ((!server->is_connected) && (!server->hook_connect)
-        && (!server->hook_fd) && (server->reconnect_start == 0))
+        && (!server->hook_fd) && (server->reconnect_start == 0)
+        && (!server->connect_pending))
     {
         weechat_printf (server->buffer,
                         _("%s%s: not connected to server \"%s\"!"),
@@ -1779,7 +1780,8 @@ irc_command_disconnect (void *data, struct t_gui_buffer *buffer, int argc,
             {
                 if ((ptr_server->is_connected) || (ptr_server->hook_connect)
                     || (ptr_server->hook_fd)
-                    || (ptr_server->reconnect_start != 0))
+                    || (ptr_server->reconnect_start != 0)
+                    || (ptr_server->connect_pending))
                 {
                     if (!irc_command_disconnect_one_server (ptr_server, reason))
                         disconnect_ok = 0;
@@ -1792,7 +1794,8 @@ irc_command_disconnect (void *data, struct t_gui_buffer *buffer, int argc,
                  ptr_server = ptr_server->next_server)
             {
                 if (!ptr_server->is_connected
-                    && (ptr_server->reconnect_start != 0))
+                    && ((ptr_server->reconnect_start != 0)
+                        || ptr_server->connect_pending))
                 {
                     if (!irc_command_disconnect_one_server (ptr_server, reason))
                         disconnect_ok = 0;
@@ -4195,7 +4198,7 @@ irc_command_saquit (void *data, struct t_gui_buffer *buffer, int argc,
 void
 irc_command_display_server (struct t_irc_server *server, int with_detail)
 {
-    char *cmd_pwd_hidden;
+    char *cmd_pwd_hidden, str_ssl[128];
     int num_channels, num_pv;
 
     if (with_detail)
@@ -4481,6 +4484,22 @@ irc_command_display_server (struct t_irc_server *server, int with_detail)
                             IRC_COLOR_CHAT_VALUE,
                             weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW]),
                             NG_("second", "seconds", weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW])));
+        /* anti_flood_burst_high */
+        if (weechat_config_option_is_null (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST_HIGH]))
+            weechat_printf (NULL, "  anti_flood_burst_high:   (%d)",
+                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST_HIGH));
+        else
+            weechat_printf (NULL, "  anti_flood_burst_high: %s%d",
+                            IRC_COLOR_CHAT_VALUE,
+                            weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST_HIGH]));
+        /* anti_flood_burst_low */
+        if (weechat_config_option_is_null (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST_LOW]))
+            weechat_printf (NULL, "  anti_flood_burst_low :   (%d)",
+                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST_LOW));
+        else
+            weechat_printf (NULL, "  anti_flood_burst_low : %s%d",
+                            IRC_COLOR_CHAT_VALUE,
+                            weechat_config_integer (server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST_LOW]));
         /* away_check */
         if (weechat_config_option_is_null (server->options[IRC_SERVER_OPTION_AWAY_CHECK]))
             weechat_printf (NULL, "  away_check . . . . . :   (%d %s)",
@@ -4530,7 +4549,15 @@ irc_command_display_server (struct t_irc_server *server, int with_detail)
         {
             num_channels = irc_server_get_channel_count (server);
             num_pv = irc_server_get_pv_count (server);
-            weechat_printf (NULL, " %s %s%s %s[%s%s%s]%s%s, %d %s, %d pv",
+            str_ssl[0] = '\0';
+            if (server->ssl_connected)
+            {
+                snprintf (str_ssl, sizeof (str_ssl),
+                          _(", SSL handshakes: %d full, %d resumed"),
+                          server->ssl_handshakes_full,
+                          server->ssl_handshakes_resumed);
+            }
+            weechat_printf (NULL, " %s %s%s %s[%s%s%s]%s%s, %d %s, %d pv%s",
                             (server->is_connected) ? "*" : " ",
                             IRC_COLOR_CHAT_SERVER,
                             server->name,
@@ -4543,7 +4570,8 @@ irc_command_display_server (struct t_irc_server *server, int with_detail)
                             (server->temp_server) ? _(" (temporary)") : "",
                             num_channels,
                             NG_("channel", "channels", num_channels),
-                            num_pv);
+                            num_pv,
+                            str_ssl);
         }
         else
         {
@@ -126,10 +126,12 @@ struct t_config_option *irc_config_color_topic_old;
 
 struct t_config_option *irc_config_network_alternate_nick;
 struct t_config_option *irc_config_network_autoreconnect_delay_growing;
+struct t_config_option *irc_config_network_autoreconnect_delay_jitter;
 struct t_config_option *irc_config_network_autoreconnect_delay_max;
 struct t_config_option *irc_config_network_ban_mask_default;
 struct t_config_option *irc_config_network_colors_receive;
 struct t_config_option *irc_config_network_colors_send;
+struct t_config_option *irc_config_network_connection_max_concurrent;
 struct t_config_option *irc_config_network_lag_check;
 struct t_config_option *irc_config_network_lag_max;
 struct t_config_option *irc_config_network_lag_min_show;
@@ -851,7 +853,10 @@ irc_config_change_network_lag_check (void *data,
          ptr_server = ptr_server->next_server)
     {
         if (ptr_server->is_connected)
+        {
             ptr_server->lag_next_check = time_next_check;
+            irc_server_timer_schedule (ptr_server);
+        }
     }
 }
 
@@ -984,6 +989,7 @@ irc_config_server_default_change_cb (void *data, struct t_config_option *option)
                             irc_server_check_away (ptr_server);
                         else
                             irc_server_remove_away (ptr_server);
+                        irc_server_timer_schedule (ptr_server);
                         break;
                 }
             }
@@ -1159,6 +1165,7 @@ irc_config_server_change_cb (void *data, struct t_config_option *option)
                         irc_server_check_away (ptr_server);
                     else
                         irc_server_remove_away (ptr_server);
+                    irc_server_timer_schedule (ptr_server);
                     break;
                 case IRC_SERVER_OPTION_NOTIFY:
                     irc_notify_new_for_server (ptr_server);
@@ -1945,6 +1952,36 @@ irc_config_server_new_option (struct t_config_file *config_file,
                 callback_change, callback_change_data,
                 NULL, NULL);
             break;
+        case IRC_SERVER_OPTION_ANTI_FLOOD_BURST_HIGH:
+            new_option = weechat_config_new_option (
+                config_file, section,
+                option_name, "integer",
+                N_("anti-flood for high priority queue: number of messages "
+                   "that can be sent in a burst before the delay of option "
+                   "\"anti_flood_prio_high\" is applied (the credit is "
+                   "refilled with millisecond precision)"),
+                NULL, 1, 100,
+                default_value, value,
+                null_value_allowed,
+                callback_check_value, callback_check_value_data,
+                callback_change, callback_change_data,
+                NULL, NULL);
+            break;
+        case IRC_SERVER_OPTION_ANTI_FLOOD_BURST_LOW:
+            new_option = weechat_config_new_option (
+                config_file, section,
+                option_name, "integer",
+                N_("anti-flood for low priority queue: number of messages "
+                   "that can be sent in a burst before the delay of option "
+                   "\"anti_flood_prio_low\" is applied (the credit is "
+                   "refilled with millisecond precision)"),
+                NULL, 1, 100,
+                default_value, value,
+                null_value_allowed,
+                callback_check_value, callback_check_value_data,
+                callback_change, callback_change_data,
+                NULL, NULL);
+            break;
         case IRC_SERVER_OPTION_AWAY_CHECK:
             new_option = weechat_config_new_option (
                 config_file, section,
@@ -2822,6 +2859,14 @@ irc_config_init ()
            "delay, 2 = delay*2 for each retry, ..)"),
         NULL, 1, 100, "2", NULL, 0, NULL, NULL,
         NULL, NULL, NULL, NULL);
+    irc_config_network_autoreconnect_delay_jitter = weechat_config_new_option (
+        irc_config_file, ptr_section,
+        "autoreconnect_delay_jitter", "integer",
+        N_("random delay added to autoreconnect delay, as percentage of "
+           "autoreconnect delay (0 = no random delay); this spreads "
+           "reconnections of servers disconnected at same time"),
+        NULL, 0, 100, "25", NULL, 0, NULL, NULL,
+        NULL, NULL, NULL, NULL);
     irc_config_network_autoreconnect_delay_max = weechat_config_new_option (
         irc_config_file, ptr_section,
         "autoreconnect_delay_max", "integer",
@@ -2850,6 +2895,14 @@ irc_config_init ()
            "optional color: b=bold, cxx=color, cxx,yy=color+background, "
            "i=italic, o=disable color/attributes, r=reverse, u=underline)"),
         NULL, 0, 0, "on", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
+    irc_config_network_connection_max_concurrent = weechat_config_new_option (
+        irc_config_file, ptr_section,
+        "connection_max_concurrent", "integer",
+        N_("maximum number of connections in progress at same time (from "
+           "connection until login accepted by server); other servers wait "
+           "for a free slot (0 = no limit)"),
+        NULL, 0, 1000, "8", NULL, 0, NULL, NULL,
+        NULL, NULL, NULL, NULL);
     irc_config_network_lag_check = weechat_config_new_option (
         irc_config_file, ptr_section,
         "lag_check", "integer",
@@ -170,10 +170,12 @@ extern struct t_config_option *irc_config_color_topic_old;
 
 extern struct t_config_option *irc_config_network_alternate_nick;
 extern struct t_config_option *irc_config_network_autoreconnect_delay_growing;
+extern struct t_config_option *irc_config_network_autoreconnect_delay_jitter;
 extern struct t_config_option *irc_config_network_autoreconnect_delay_max;
 extern struct t_config_option *irc_config_network_ban_mask_default;
 extern struct t_config_option *irc_config_network_colors_receive;
 extern struct t_config_option *irc_config_network_colors_send;
+extern struct t_config_option *irc_config_network_connection_max_concurrent;
 extern struct t_config_option *irc_config_network_lag_check;
 extern struct t_config_option *irc_config_network_lag_max;
 extern struct t_config_option *irc_config_network_lag_min_show;
@@ -317,7 +317,7 @@ irc_info_get_infolist_cb (void *data, const char *infolist_name,
             if (pointer)
             {
                 /* build list with only one server */
-                if (!irc_server_add_to_infolist (ptr_infolist, pointer))
+                if (!irc_server_add_to_infolist (ptr_infolist, pointer, 0))
                 {
                     weechat_infolist_free (ptr_infolist);
                     return NULL;
@@ -333,7 +333,7 @@ irc_info_get_infolist_cb (void *data, const char *infolist_name,
                     if (!arguments || !arguments[0]
                         || weechat_string_match (ptr_server->name, arguments, 0))
                     {
-                        if (!irc_server_add_to_infolist (ptr_infolist, ptr_server))
+                        if (!irc_server_add_to_infolist (ptr_infolist, ptr_server, 0))
                         {
                             weechat_infolist_free (ptr_infolist);
                             return NULL;
@@ -27,6 +27,7 @@
 #include "irc.h"
 #include "irc-server.h"
 #include "irc-channel.h"
+#include "irc-message.h"
 
 
 /*
@@ -400,50 +401,168 @@ irc_message_replace_vars (struct t_irc_server *server,
 }
 
 /*
- * Adds a message + arguments in hashtable.
+ * Initializes a split structure.
  */
 
 void
-irc_message_split_add (struct t_hashtable *hashtable, int number,
+irc_message_split_init (struct t_irc_message_split *split)
+{
+    split->data = NULL;
+    split->buffer = NULL;
+    split->buffer_size = 0;
+    split->buffer_length = 0;
+    split->count = 0;
+    split->items_size = IRC_MESSAGE_SPLIT_STATIC_ITEMS;
+    split->items = split->static_items;
+}
+
+/*
+ * Frees data allocated in a split structure (the structure itself is not
+ * freed).
+ */
+
+void
+irc_message_split_free (struct t_irc_message_split *split)
+{
+    if (split->buffer)
+        free (split->buffer);
+    if (split->items != split->static_items)
+        free (split->items);
+    irc_message_split_init (split);
+}
+
+/*
+ * Adds a segment in a split structure: the segment is pointing to "data"
+ * (original message, if buffer is not allocated), or to the buffer.
+ *
+ * Returns pointer to new segment, NULL if error.
+ */
+
+struct t_irc_message_split_item *
+irc_message_split_add_item (struct t_irc_message_split *split)
+{
+    struct t_irc_message_split_item *new_items;
+
+    if (split->count >= split->items_size)
+    {
+        if (split->items == split->static_items)
+        {
+            new_items = malloc (split->items_size * 2 * sizeof (*new_items));
+            if (!new_items)
+                return NULL;
+            memcpy (new_items, split->static_items,
+                    split->items_size * sizeof (*new_items));
+        }
+        else
+        {
+            new_items = realloc (split->items,
+                                 split->items_size * 2 * sizeof (*new_items));
+            if (!new_items)
+                return NULL;
+        }
+        split->items = new_items;
+        split->items_size *= 2;
+    }
+
+    split->count++;
+    return &(split->items[split->count - 1]);
+}
+
+/*
+ * Appends strings in buffer of split structure (the result is a single string
+ * ending with '\0').
+ *
+ * Returns offset of string in buffer, -1 if error.
+ */
+
+int
+irc_message_split_append (struct t_irc_message_split *split,
+                          const char *string1, const char *string2)
+{
+    int length1, length2, offset, new_size;
+    char *new_buffer;
+
+    length1 = (string1) ? strlen (string1) : 0;
+    length2 = (string2) ? strlen (string2) : 0;
+
+    if (split->buffer_length + length1 + length2 + 1 > split->buffer_size)
+    {
+        new_size = (split->buffer_size > 0) ? split->buffer_size * 2 : 1024;
+        while (split->buffer_length + length1 + length2 + 1 > new_size)
+        {
+            new_size *= 2;
+        }
+        new_buffer = realloc (split->buffer, new_size);
+        if (!new_buffer)
+            return -1;
+        split->buffer = new_buffer;
+        split->buffer_size = new_size;
+        split->data = split->buffer;
+    }
+
+    offset = split->buffer_length;
+    if (string1)
+        memcpy (split->buffer + offset, string1, length1);
+    if (string2)
+        memcpy (split->buffer + offset + length1, string2, length2);
+    split->buffer[offset + length1 + length2] = '\0';
+    split->buffer_length += length1 + length2 + 1;
+
+    return offset;
+}
+
+/*
+ * Adds a message + arguments in split structure.
+ */
+
+void
+irc_message_split_add (struct t_irc_message_split *split,
                        const char *tags, const char *message,
                        const char *arguments)
 {
-    char key[32], value[32], *buf;
-    int length;
+    struct t_irc_message_split_item *ptr_item;
+    int offset;
+
+    if (!message)
+        return;
+
+    offset = irc_message_split_append (split, tags, message);
+    if (offset < 0)
+        return;
+
+    ptr_item = irc_message_split_add_item (split);
+    if (!ptr_item)
+        return;
 
-    if (message)
+    ptr_item->msg_offset = offset;
+    ptr_item->msg_length = split->buffer_length - offset - 1;
+    ptr_item->args_offset = -1;
+    ptr_item->args_length = 0;
+
+    if (weechat_irc_plugin->debug >= 2)
+    {
+        weechat_printf (NULL,
+                        "irc_message_split_add >> msg%d='%s' (%d bytes)",
+                        split->count,
+                        split->data + ptr_item->msg_offset,
+                        ptr_item->msg_length);
+    }
+
+    if (arguments)
     {
-        length = ((tags) ? strlen (tags) : 0) + strlen (message) + 1;
-        buf = malloc (length);
-        if (buf)
+        offset = irc_message_split_append (split, arguments, NULL);
+        if (offset >= 0)
         {
-            snprintf (key, sizeof (key), "msg%d", number);
-            snprintf (buf, length, "%s%s",
-                      (tags) ? tags : "",
-                      message);
-            weechat_hashtable_set (hashtable, key, buf);
+            ptr_item->args_offset = offset;
+            ptr_item->args_length = split->buffer_length - offset - 1;
             if (weechat_irc_plugin->debug >= 2)
             {
                 weechat_printf (NULL,
-                                "irc_message_split_add >> %s='%s' (%d bytes)",
-                                key, buf, length - 1);
+                                "irc_message_split_add >> args%d='%s'",
+                                split->count, arguments);
             }
-            free (buf);
         }
     }
-    if (arguments)
-    {
-        snprintf (key, sizeof (key), "args%d", number);
-        weechat_hashtable_set (hashtable, key, arguments);
-        if (weechat_irc_plugin->debug >= 2)
-        {
-            weechat_printf (NULL,
-                            "irc_message_split_add >> %s='%s'",
-                            key, arguments);
-        }
-    }
-    snprintf (value, sizeof (value), "%d", number);
-    weechat_hashtable_set (hashtable, "count", value);
 }
 
 /*
@@ -469,7 +588,7 @@ irc_message_split_add (struct t_hashtable *hashtable, int number,
  *     arguments: "is eating"
  *     suffix   : "\01"
  *
- * Messages added to hashtable are:
+ * Messages added to split structure are:
  *   host + command + target + prefix + XXX + suffix
  * (where XXX is part of "arguments")
  *
@@ -479,7 +598,7 @@ irc_message_split_add (struct t_hashtable *hashtable, int number,
  */
 
 int
-irc_message_split_string (struct t_hashtable *hashtable,
+irc_message_split_string (struct t_irc_message_split *split,
                           const char *tags,
                           const char *host,
                           const char *command,
@@ -492,7 +611,7 @@ irc_message_split_string (struct t_hashtable *hashtable,
 {
     const char *pos, *pos_max, *pos_next, *pos_last_delim;
     char message[1024], *dup_arguments;
-    int max_length, number;
+    int max_length;
 
     max_length = 510;
     if (max_length_host >= 0)
@@ -521,8 +640,6 @@ irc_message_split_string (struct t_hashtable *hashtable,
                         max_length);
     }
 
-    number = 1;
-
     if (!arguments || !arguments[0])
     {
         snprintf (message, sizeof (message), "%s%s%s %s%s%s%s",
@@ -533,7 +650,7 @@ irc_message_split_string (struct t_hashtable *hashtable,
                   (target && target[0]) ? " " : "",
                   (prefix) ? prefix : "",
                   (suffix) ? suffix : "");
-        irc_message_split_add (hashtable, 1, tags, message, "");
+        irc_message_split_add (split, tags, message, "");
         return 1;
     }
 
@@ -565,9 +682,7 @@ irc_message_split_string (struct t_hashtable *hashtable,
                       (prefix) ? prefix : "",
                       dup_arguments,
                       (suffix) ? suffix : "");
-            irc_message_split_add (hashtable, number, tags, message,
-                                   dup_arguments);
-            number++;
+            irc_message_split_add (split, tags, message, dup_arguments);
             free (dup_arguments);
         }
         arguments = (pos == pos_last_delim) ? pos + 1 : pos;
@@ -586,17 +701,15 @@ irc_message_split_string (struct t_hashtable *hashtable,
  */
 
 int
-irc_message_split_join (struct t_hashtable *hashtable,
+irc_message_split_join (struct t_irc_message_split *split,
                         const char *tags, const char *host,
                         const char *arguments)
 {
-    int number, channels_count, keys_count, length, length_no_channel;
+    int channels_count, keys_count, length, length_no_channel;
     int length_to_add, index_channel;
     char **channels, **keys, *pos, *str;
     char msg_to_send[2048], keys_to_add[2048];
 
-    number = 1;
-
     channels = NULL;
     channels_count = 0;
     keys = NULL;
@@ -656,11 +769,8 @@ irc_message_split_join (struct t_hashtable *hashtable,
         else
         {
             strcat (msg_to_send, keys_to_add);
-            irc_message_split_add (hashtable, number,
-                                   tags,
-                                   msg_to_send,
+            irc_message_split_add (split, tags, msg_to_send,
                                    msg_to_send + length_no_channel + 1);
-            number++;
             snprintf (msg_to_send, sizeof (msg_to_send), "%s%sJOIN",
                       (host) ? host : "",
                       (host) ? " " : "");
@@ -672,9 +782,7 @@ irc_message_split_join (struct t_hashtable *hashtable,
     if (length > length_no_channel)
     {
         strcat (msg_to_send, keys_to_add);
-        irc_message_split_add (hashtable, number,
-                               tags,
-                               msg_to_send,
+        irc_message_split_add (split, tags, msg_to_send,
                                msg_to_send + length_no_channel + 1);
     }
 
@@ -696,7 +804,7 @@ irc_message_split_join (struct t_hashtable *hashtable,
  */
 
 int
-irc_message_split_privmsg_notice (struct t_hashtable *hashtable,
+irc_message_split_privmsg_notice (struct t_irc_message_split *split,
                                   char *tags, char *host, char *command,
                                   char *target, char *arguments,
                                   int max_length_host)
@@ -736,7 +844,7 @@ irc_message_split_privmsg_notice (struct t_hashtable *hashtable,
     if (!prefix[0])
         strcpy (prefix, ":");
 
-    rc = irc_message_split_string (hashtable, tags, host, command, target,
+    rc = irc_message_split_string (split, tags, host, command, target,
                                    prefix, arguments, suffix,
                                    ' ', max_length_host);
 
@@ -752,7 +860,7 @@ irc_message_split_privmsg_notice (struct t_hashtable *hashtable,
  */
 
 int
-irc_message_split_005 (struct t_hashtable *hashtable,
+irc_message_split_005 (struct t_irc_message_split *split,
                        char *tags, char *host, char *command, char *target,
                        char *arguments)
 {
@@ -775,10 +883,188 @@ irc_message_split_005 (struct t_hashtable *hashtable,
         pos[0] = '\0';
     }
 
-    return irc_message_split_string (hashtable, tags, host, command, target,
+    return irc_message_split_string (split, tags, host, command, target,
                                      NULL, arguments, suffix, ' ', -1);
 }
 
+/*
+ * Checks if the first "length" chars of a command are equal to "name"
+ * (case insensitive).
+ *
+ * Returns:
+ *   1: command is "name"
+ *   0: command is not "name"
+ */
+
+int
+irc_message_split_command_is (const char *command, int length,
+                              const char *name)
+{
+    return (((int)strlen (name) == length)
+            && (weechat_strncasecmp (command, name, length) == 0)) ? 1 : 0;
+}
+
+/*
+ * Splits an IRC message without any allocation, when the message does not
+ * need to be split (fast path for most messages sent to IRC server).
+ *
+ * The only segment added points to the message itself, so the message must
+ * not be freed before the split structure.
+ *
+ * Messages with special format (consecutive spaces between command arguments,
+ * text without ':' before it) are not handled here because the full split
+ * rebuilds them.
+ *
+ * Returns:
+ *   1: message does not need to be split (split structure filled)
+ *   0: message must be split with the full split
+ */
+
+int
+irc_message_split_fast (struct t_irc_server *server, const char *message,
+                        struct t_irc_message_split *split)
+{
+    const char *ptr_msg, *pos, *pos_command, *pos_args, *pos_text;
+    struct t_irc_message_split_item *ptr_item;
+    int length_command, length_target, length_prefix, length_suffix;
+    int length_text, max_length, max_length_nick, check_length;
+
+    ptr_msg = message;
+    if (ptr_msg[0] == '@')
+    {
+        pos = strchr (ptr_msg, ' ');
+        if (!pos)
+            return 0;
+        ptr_msg = pos + 1;
+    }
+
+    /* skip host */
+    pos = ptr_msg;
+    if (pos[0] == ':')
+    {
+        pos = strchr (pos, ' ');
+        if (!pos || (pos[1] == ' ') || !pos[1])
+            return 0;
+        pos++;
+    }
+
+    /* get command and arguments */
+    pos_command = pos;
+    pos = strchr (pos_command, ' ');
+    length_command = (pos) ? pos - pos_command : (int)strlen (pos_command);
+    if (length_command == 0)
+        return 0;
+    pos_args = NULL;
+    if (pos)
+    {
+        if (pos[1] == ' ')
+            return 0;
+        if (pos[1])
+            pos_args = pos + 1;
+    }
+
+    pos_text = pos_args;
+    length_text = (pos_args) ? (int)strlen (pos_args) : 0;
+    length_target = 0;
+    length_prefix = 0;
+    length_suffix = 0;
+    check_length = 0;
+
+    if (irc_message_split_command_is (pos_command, length_command, "005")
+        || irc_message_split_command_is (pos_command, length_command, "353"))
+    {
+        /* messages received from server, rarely split: use full split */
+        return 0;
+    }
+    else if (irc_message_split_command_is (pos_command, length_command, "join"))
+    {
+        if (strlen (ptr_msg) > 510)
+            return 0;
+    }
+    else if (irc_message_split_command_is (pos_command, length_command, "ison")
+             || irc_message_split_command_is (pos_command, length_command, "wallops")
+             || irc_message_split_command_is (pos_command, length_command, "monitor"))
+    {
+        if (!pos_args)
+            return 0;
+        if (irc_message_split_command_is (pos_command, length_command, "monitor")
+            && ((pos_args[0] == '+') || (pos_args[0] == '-'))
+            && (pos_args[1] == ' '))
+        {
+            length_prefix = 2;
+        }
+        else if (pos_args[0] == ':')
+        {
+            length_prefix = 1;
+        }
+        else
+            return 0;
+        pos_text = pos_args + length_prefix;
+        length_text -= length_prefix;
+        check_length = 1;
+    }
+    else if (irc_message_split_command_is (pos_command, length_command, "privmsg")
+             || irc_message_split_command_is (pos_command, length_command, "notice"))
+    {
+        pos = (pos_args) ? strchr (pos_args, ' ') : NULL;
+        if (pos)
+        {
+            if (pos[1] != ':')
+                return 0;
+            length_target = pos - pos_args;
+            pos_text = pos + 2;
+            length_text = strlen (pos_text);
+            length_prefix = 1;
+            /* for CTCP, prefix is ":\01xxxx " and suffix "\01" */
+            if ((length_text > 1)
+                && (pos_text[0] == '\01')
+                && (pos_text[length_text - 1] == '\01'))
+            {
+                pos = strchr (pos_text, ' ');
+                if (pos)
+                {
+                    length_prefix += pos + 1 - pos_text;
+                    length_text -= pos + 1 - pos_text;
+                    pos_text = pos + 1;
+                    length_suffix = 1;
+                    length_text--;
+                }
+            }
+            check_length = 1;
+        }
+    }
+
+    if (check_length)
+    {
+        /* same max length as in function irc_message_split_string */
+        max_length_nick = (server && (server->nick_max_length > 0)) ?
+            server->nick_max_length : 16;
+        max_length = 510 - (1 + max_length_nick + 1 + 63 + 1)
+            - (length_command + 1) - length_target - length_prefix
+            - length_suffix;
+        if ((max_length < 2) || (length_text > max_length))
+            return 0;
+    }
+
+    split->data = message;
+    ptr_item = irc_message_split_add_item (split);
+    if (!ptr_item)
+        return 0;
+    ptr_item->msg_offset = 0;
+    ptr_item->msg_length = strlen (message);
+    ptr_item->args_offset = (pos_text) ? pos_text - message : -1;
+    ptr_item->args_length = (pos_text) ? length_text : 0;
+
+    if (weechat_irc_plugin->debug >= 2)
+    {
+        weechat_printf (NULL,
+                        "irc_message_split_fast >> msg1='%s' (%d bytes)",
+                        message, ptr_item->msg_length);
+    }
+
+    return 1;
+}
+
 /*
  * Splits an IRC message about to be sent to IRC server.
  *
@@ -789,24 +1075,21 @@ irc_message_split_005 (struct t_hashtable *hashtable,
  * The split takes care about type of message to do a split at best place in
  * message.
  *
- * The hashtable returned contains keys "msg1", "msg2", ..., "msgN" with split
- * of message (these messages do not include the final "\r\n").
- *
- * Hashtable contains "args1", "args2", ..., "argsN" with split of arguments
- * only (no host/command here).
- *
- * Each message ("msgN") in hashtable has command and arguments, and then is
- * ready to be sent to IRC server.
+ * The split structure is filled with segments: each segment has a message
+ * (with tags, without the final "\r\n"), which is a string ending with '\0'
+ * (ready to be sent to IRC server), and the arguments only (no host/command
+ * here), which are not ending with '\0' (use offset and length).
  *
- * Returns hashtable with split message.
+ * If the message does not need to be split, no memory is allocated and the
+ * segment points to the message itself.
  *
- * Note: result must be freed after use.
+ * Note: irc_message_split_free must be called after use.
  */
 
-struct t_hashtable *
-irc_message_split (struct t_irc_server *server, const char *message)
+void
+irc_message_split_msg (struct t_irc_server *server, const char *message,
+                       struct t_irc_message_split *split)
 {
-    struct t_hashtable *hashtable;
     char **argv, **argv_eol, *tags, *host, *command, *arguments, target[512];
     char *pos, monitor_action[3];
     int split_ok, argc, index_args, max_length_nick, max_length_host;
@@ -820,21 +1103,19 @@ irc_message_split (struct t_irc_server *server, const char *message)
     argv = NULL;
     argv_eol = NULL;
 
+    irc_message_split_init (split);
+
     /* debug message */
     if (weechat_irc_plugin->debug >= 2)
         weechat_printf (NULL, "irc_message_split: message='%s'", message);
 
-    hashtable = weechat_hashtable_new (32,
-                                       WEECHAT_HASHTABLE_STRING,
-                                       WEECHAT_HASHTABLE_STRING,
-                                       NULL,
-                                       NULL);
-    if (!hashtable)
-        return NULL;
-
     if (!message || !message[0])
         goto end;
 
+    /* fast path: message does not need to be split */
+    if (irc_message_split_fast (server, message, split))
+        return;
+
     if (message[0] == '@')
     {
         pos = strchr (message, ' ');
@@ -882,7 +1163,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
          * ISON :nick1 nick2 nick3
          * WALLOPS :some text here
          */
-        split_ok = irc_message_split_string (hashtable, tags, host, command,
+        split_ok = irc_message_split_string (split, tags, host, command,
                                              NULL, ":",
                                              (argv_eol[index_args][0] == ':') ?
                                              argv_eol[index_args] + 1 : argv_eol[index_args],
@@ -899,14 +1180,14 @@ irc_message_split (struct t_irc_server *server, const char *message)
         {
             snprintf (monitor_action, sizeof (monitor_action),
                       "%c ", argv_eol[index_args][0]);
-            split_ok = irc_message_split_string (hashtable, tags, host, command,
+            split_ok = irc_message_split_string (split, tags, host, command,
                                                  NULL, monitor_action,
                                                  argv_eol[index_args] + 2,
                                                  NULL, ',', max_length_host);
         }
         else
         {
-            split_ok = irc_message_split_string (hashtable, tags, host, command,
+            split_ok = irc_message_split_string (split, tags, host, command,
                                                  NULL, ":",
                                                  (argv_eol[index_args][0] == ':') ?
                                                  argv_eol[index_args] + 1 : argv_eol[index_args],
@@ -919,7 +1200,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
         if (strlen (message) > 510)
         {
             /* split join if it's more than 510 bytes */
-            split_ok = irc_message_split_join (hashtable, tags, host,
+            split_ok = irc_message_split_join (split, tags, host,
                                                arguments);
         }
     }
@@ -932,7 +1213,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
          */
         if (index_args + 1 <= argc - 1)
         {
-            split_ok = irc_message_split_privmsg_notice (hashtable, tags, host,
+            split_ok = irc_message_split_privmsg_notice (split, tags, host,
                                                          command,
                                                          argv[index_args],
                                                          (argv_eol[index_args + 1][0] == ':') ?
@@ -945,7 +1226,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
         /* :server 005 nick MODES=4 CHANLIMIT=#:20 NICKLEN=16 USERLEN=10 ... */
         if (index_args + 1 <= argc - 1)
         {
-            split_ok = irc_message_split_005 (hashtable, tags, host, command,
+            split_ok = irc_message_split_005 (split, tags, host, command,
                                               argv[index_args],
                                               (argv_eol[index_args + 1][0] == ':') ?
                                               argv_eol[index_args + 1] + 1 : argv_eol[index_args + 1]);
@@ -963,7 +1244,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
             {
                 snprintf (target, sizeof (target), "%s %s",
                           argv[index_args], argv[index_args + 1]);
-                split_ok = irc_message_split_string (hashtable, tags, host,
+                split_ok = irc_message_split_string (split, tags, host,
                                                      command, target, ":",
                                                      (argv_eol[index_args + 2][0] == ':') ?
                                                      argv_eol[index_args + 2] + 1 : argv_eol[index_args + 2],
@@ -976,7 +1257,7 @@ irc_message_split (struct t_irc_server *server, const char *message)
                     snprintf (target, sizeof (target), "%s %s %s",
                               argv[index_args], argv[index_args + 1],
                               argv[index_args + 2]);
-                    split_ok = irc_message_split_string (hashtable, tags, host,
+                    split_ok = irc_message_split_string (split, tags, host,
                                                          command, target, ":",
                                                          (argv_eol[index_args + 3][0] == ':') ?
                                                          argv_eol[index_args + 3] + 1 : argv_eol[index_args + 3],
@@ -987,11 +1268,8 @@ irc_message_split (struct t_irc_server *server, const char *message)
     }
 
 end:
-    if (!split_ok
-        || (weechat_hashtable_get_integer (hashtable, "items_count") == 0))
-    {
-        irc_message_split_add (hashtable, 1, tags, message, arguments);
-    }
+    if (!split_ok || (split->count == 0))
+        irc_message_split_add (split, tags, message, arguments);
 
     if (tags)
         free (tags);
@@ -999,6 +1277,71 @@ end:
         weechat_string_free_split (argv);
     if (argv_eol)
         weechat_string_free_split (argv_eol);
+}
+
+/*
+ * Splits an IRC message about to be sent to IRC server (see function
+ * irc_message_split_msg), and returns result as a hashtable.
+ *
+ * The hashtable returned contains keys "msg1", "msg2", ..., "msgN" with split
+ * of message (these messages do not include the final "\r\n").
+ *
+ * Hashtable contains "args1", "args2", ..., "argsN" with split of arguments
+ * only (no host/command here).
+ *
+ * Each message ("msgN") in hashtable has command and arguments, and then is
+ * ready to be sent to IRC server.
+ *
+ * This function is used by info_hashtable "irc_message_split", the IRC
+ * plugin uses directly function irc_message_split_msg.
+ *
+ * Returns hashtable with split message.
+ *
+ * Note: result must be freed after use.
+ */
+
+struct t_hashtable *
+irc_message_split (struct t_irc_server *server, const char *message)
+{
+    struct t_hashtable *hashtable;
+    struct t_irc_message_split split;
+    char key[32], value[32], *args;
+    int i;
+
+    hashtable = weechat_hashtable_new (32,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       WEECHAT_HASHTABLE_STRING,
+                                       NULL,
+                                       NULL);
+    if (!hashtable)
+        return NULL;
+
+    irc_message_split_msg (server, message, &split);
+
+    for (i = 0; i < split.count; i++)
+    {
+        snprintf (key, sizeof (key), "msg%d", i + 1);
+        weechat_hashtable_set (hashtable, key,
+                               split.data + split.items[i].msg_offset);
+        if (split.items[i].args_offset >= 0)
+        {
+            args = weechat_strndup (split.data + split.items[i].args_offset,
+                                    split.items[i].args_length);
+            if (args)
+            {
+                snprintf (key, sizeof (key), "args%d", i + 1);
+                weechat_hashtable_set (hashtable, key, args);
+                free (args);
+            }
+        }
+    }
+    if (split.count > 0)
+    {
+        snprintf (value, sizeof (value), "%d", split.count);
+        weechat_hashtable_set (hashtable, "count", value);
+    }
+
+    irc_message_split_free (&split);
 
     return hashtable;
 }
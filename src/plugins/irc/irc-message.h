@@ -23,6 +23,33 @@
 struct t_irc_server;
 struct t_irc_channel;
 
+/* number of segments allocated in split structure (without malloc) */
+#define IRC_MESSAGE_SPLIT_STATIC_ITEMS 8
+
+/* segment of a split message (offsets are relative to "data" in split) */
+
+struct t_irc_message_split_item
+{
+    int msg_offset;                     /* message (with tags), ends with \0 */
+    int msg_length;                     /* length of message                 */
+    int args_offset;                    /* arguments (-1 if not set)         */
+    int args_length;                    /* length of arguments               */
+};
+
+/* IRC message split in many messages (max 512 bytes each) */
+
+struct t_irc_message_split
+{
+    const char *data;                   /* original msg or allocated buffer  */
+    char *buffer;                       /* buffer with messages/arguments    */
+    int buffer_size;                    /* allocated size for buffer         */
+    int buffer_length;                  /* used size in buffer               */
+    int count;                          /* number of segments                */
+    int items_size;                     /* allocated number of segments      */
+    struct t_irc_message_split_item *items;  /* segments                     */
+    struct t_irc_message_split_item static_items[IRC_MESSAGE_SPLIT_STATIC_ITEMS];
+};
+
 extern void irc_message_parse (struct t_irc_server *server, const char *message,
                                char **tags, char **message_without_tags,
                                char **nick, char **host, char **command,
@@ -34,6 +61,11 @@ extern const char *irc_message_get_address_from_host (const char *host);
 extern char *irc_message_replace_vars (struct t_irc_server *server,
                                        const char *channel_name,
                                        const char *string);
+extern void irc_message_split_init (struct t_irc_message_split *split);
+extern void irc_message_split_free (struct t_irc_message_split *split);
+extern void irc_message_split_msg (struct t_irc_server *server,
+                                   const char *message,
+                                   struct t_irc_message_split *split);
 extern struct t_hashtable *irc_message_split (struct t_irc_server *server,
                                               const char *message);
 
@@ -322,10 +322,9 @@ irc_notify_build_message_with_nicks (struct t_irc_server *server,
 void
 irc_notify_send_monitor (struct t_irc_server *server)
 {
-    struct t_hashtable *hashtable;
-    char *message, hash_key[32];
-    const char *str_message;
-    int num_nicks, number;
+    struct t_irc_message_split split;
+    char *message;
+    int num_nicks, i;
 
     message = irc_notify_build_message_with_nicks (server,
                                                    "MONITOR + ",
@@ -333,24 +332,14 @@ irc_notify_send_monitor (struct t_irc_server *server)
                                                    &num_nicks);
     if (message && (num_nicks > 0))
     {
-        hashtable = irc_message_split (server, message);
-        if (hashtable)
+        irc_message_split_msg (server, message, &split);
+        for (i = 0; i < split.count; i++)
         {
-            number = 1;
-            while (1)
-            {
-                snprintf (hash_key, sizeof (hash_key), "msg%d", number);
-                str_message = weechat_hashtable_get (hashtable,
-                                                     hash_key);
-                if (!str_message)
-                    break;
-                irc_server_sendf (server,
-                                  IRC_SERVER_SEND_OUTQ_PRIO_LOW,
-                                  NULL, "%s", str_message);
-                number++;
-            }
-            weechat_hashtable_free (hashtable);
+            irc_server_sendf (server,
+                              IRC_SERVER_SEND_OUTQ_PRIO_LOW,
+                              NULL, "%s", split.data + split.items[i].msg_offset);
         }
+        irc_message_split_free (&split);
     }
     if (message)
         free (message);
@@ -969,11 +958,10 @@ irc_notify_hsignal_cb (void *data, const char *signal,
 int
 irc_notify_timer_ison_cb (void *data, int remaining_calls)
 {
-    char *message, hash_key[32];
-    const char *str_message;
-    int num_nicks, number;
+    char *message;
+    int num_nicks, i;
     struct t_irc_server *ptr_server;
-    struct t_hashtable *hashtable;
+    struct t_irc_message_split split;
 
     /* make C compiler happy */
     (void) data;
@@ -992,26 +980,17 @@ irc_notify_timer_ison_cb (void *data, int remaining_calls)
                                                            &num_nicks);
             if (message && (num_nicks > 0))
             {
-                hashtable = irc_message_split (ptr_server, message);
-                if (hashtable)
+                irc_message_split_msg (ptr_server, message, &split);
+                for (i = 0; i < split.count; i++)
                 {
-                    number = 1;
-                    while (1)
-                    {
-                        snprintf (hash_key, sizeof (hash_key), "msg%d", number);
-                        str_message = weechat_hashtable_get (hashtable,
-                                                             hash_key);
-                        if (!str_message)
-                            break;
-                        irc_redirect_new (ptr_server, "ison", "notify", 1,
-                                          NULL, 0, NULL);
-                        irc_server_sendf (ptr_server,
-                                          IRC_SERVER_SEND_OUTQ_PRIO_LOW,
-                                          NULL, "%s", str_message);
-                        number++;
-                    }
-                    weechat_hashtable_free (hashtable);
+                    irc_redirect_new (ptr_server, "ison", "notify", 1,
+                                      NULL, 0, NULL);
+                    irc_server_sendf (ptr_server,
+                                      IRC_SERVER_SEND_OUTQ_PRIO_LOW,
+                                      NULL, "%s",
+                                      split.data + split.items[i].msg_offset);
                 }
+                irc_message_split_free (&split);
             }
             if (message)
                 free (message);
@@ -2237,6 +2237,7 @@ IRC_PROTOCOL_CALLBACK(001)
     /* connection to IRC server is OK! */
     server->is_connected = 1;
     server->reconnect_delay = 0;
+    irc_server_connect_pending_schedule ();
     server->monitor_time = time (NULL) + 5;
 
     if (server->hook_timer_connection)
@@ -2248,6 +2249,9 @@ IRC_PROTOCOL_CALLBACK(001)
         weechat_config_integer (irc_config_network_lag_check);
     irc_server_set_buffer_title (server);
 
+    /* send messages queued before the connection was complete */
+    irc_server_outqueue_schedule (server);
+
     /* set away message if user was away (before disconnection for example) */
     if (server->away_message && server->away_message[0])
     {
@@ -2296,6 +2300,9 @@ IRC_PROTOCOL_CALLBACK(001)
     if (server_command)
         free (server_command);
 
+    /* schedule checks on server (lag, away, autojoin, monitor, ...) */
+    irc_server_timer_schedule (server);
+
     return WEECHAT_RC_OK;
 }
 
@@ -109,6 +109,25 @@ irc_raw_open (int switch_to_buffer)
         weechat_buffer_set (irc_raw_buffer, "display", "1");
 }
 
+/*
+ * Adds (sign = 1) or removes (sign = -1) memory used by a raw message in
+ * memory counters (category "irc_raw").
+ */
+
+void
+irc_raw_message_memory_add (struct t_irc_raw_message *raw_message, int sign)
+{
+    long long bytes;
+
+    bytes = sizeof (*raw_message);
+    if (raw_message->prefix)
+        bytes += strlen (raw_message->prefix) + 1;
+    if (raw_message->message)
+        bytes += strlen (raw_message->message) + 1;
+
+    weechat_memory_add ("irc_raw", sign * bytes, sign);
+}
+
 /*
  * Frees a raw message and removes it from list.
  */
@@ -132,6 +151,8 @@ irc_raw_message_free (struct t_irc_raw_message *raw_message)
     if (raw_message->next_message)
         (raw_message->next_message)->prev_message = raw_message->prev_message;
 
+    irc_raw_message_memory_add (raw_message, -1);
+
     /* free data */
     if (raw_message->prefix)
         free (raw_message->prefix);
@@ -208,6 +229,8 @@ irc_raw_message_add_to_list (time_t date, const char *prefix,
         last_irc_raw_message = new_raw_message;
 
         irc_raw_messages_count++;
+
+        irc_raw_message_memory_add (new_raw_message, 1);
     }
 
     return new_raw_message;
@@ -613,6 +613,9 @@ irc_redirect_init_command (struct t_irc_redirect *redirect,
     redirect->assigned_to_command = 1;
     redirect->start_time = time (NULL);
 
+    /* schedule check of redirect timeout */
+    irc_server_timer_schedule (redirect->server);
+
     if (weechat_irc_plugin->debug >= 2)
     {
         weechat_printf (redirect->server->buffer,
@@ -944,6 +947,12 @@ irc_redirect_free (struct t_irc_redirect *redirect)
                 ptr_outqueue->redirect = NULL;
         }
     }
+    for (ptr_outqueue = server->outqueue_sending; ptr_outqueue;
+         ptr_outqueue = ptr_outqueue->next_outqueue)
+    {
+        if (ptr_outqueue->redirect == redirect)
+            ptr_outqueue->redirect = NULL;
+    }
 
     /* free data */
     if (redirect->pattern)
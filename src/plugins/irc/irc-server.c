@@ -35,6 +35,7 @@
 #else
 #include <sys/socket.h>
 #include <sys/time.h>
+#include <sys/uio.h>
 #endif
 #include <sys/types.h>
 #include <netdb.h>
@@ -70,6 +71,8 @@ struct t_irc_server *last_irc_server = NULL;
 struct t_irc_message *irc_recv_msgq = NULL;
 struct t_irc_message *irc_msgq_last_msg = NULL;
 
+struct t_hook *irc_server_hook_timer_connect_pending = NULL;
+
 char *irc_server_option_string[IRC_SERVER_NUM_OPTIONS] =
 { "addresses", "proxy", "ipv6",
   "ssl", "ssl_cert", "ssl_priorities", "ssl_dhkey_size", "ssl_fingerprint",
@@ -81,6 +84,7 @@ char *irc_server_option_string[IRC_SERVER_NUM_OPTIONS] =
   "command", "command_delay", "autojoin", "autorejoin", "autorejoin_delay",
   "connection_timeout",
   "anti_flood_prio_high", "anti_flood_prio_low",
+  "anti_flood_burst_high", "anti_flood_burst_low",
   "away_check", "away_check_max_nicks",
   "default_msg_kick", "default_msg_part", "default_msg_quit",
   "notify",
@@ -97,6 +101,7 @@ char *irc_server_option_default[IRC_SERVER_NUM_OPTIONS] =
   "", "0", "", "off", "30",
   "60",
   "2", "2",
+  "1", "1",
   "0", "25",
   "","WeeChat %v", "WeeChat %v",
   "",
@@ -114,6 +119,7 @@ const char *irc_server_send_default_tags = NULL;  /* default tags when       */
 
 
 void irc_server_reconnect (struct t_irc_server *server);
+void irc_server_outqueue_send (struct t_irc_server *server);
 void irc_server_free_data (struct t_irc_server *server);
 
 
@@ -955,14 +961,33 @@ irc_server_alloc (const char *name)
     new_server->current_address = NULL;
     new_server->current_ip = NULL;
     new_server->current_port = 0;
+    new_server->connect_start.tv_sec = 0;
+    new_server->connect_start.tv_usec = 0;
+    for (i = 0; i < IRC_SERVER_NUM_FAMILIES; i++)
+    {
+        new_server->connect_count[i] = 0;
+        new_server->connect_time_last[i] = 0;
+        new_server->connect_time_min[i] = 0;
+        new_server->connect_time_max[i] = 0;
+        new_server->connect_time_total[i] = 0;
+    }
     new_server->current_retry = 0;
     new_server->sock = -1;
     new_server->hook_connect = NULL;
     new_server->hook_fd = NULL;
     new_server->hook_timer_connection = NULL;
     new_server->hook_timer_sasl = NULL;
+    new_server->hook_timer_outqueue = NULL;
+    new_server->hook_fd_write = NULL;
+    new_server->hook_timer_checks = NULL;
+    new_server->timer_checks_time = 0;
     new_server->is_connected = 0;
     new_server->ssl_connected = 0;
+    new_server->ssl_session_data = NULL;
+    new_server->ssl_session_data_size = 0;
+    new_server->ssl_session_server = NULL;
+    new_server->ssl_handshakes_full = 0;
+    new_server->ssl_handshakes_resumed = 0;
     new_server->disconnected = 0;
     new_server->unterminated_message = NULL;
     new_server->nicks_count = 0;
@@ -983,6 +1008,7 @@ irc_server_alloc (const char *name)
     new_server->monitor_time = 0;
     new_server->reconnect_delay = 0;
     new_server->reconnect_start = 0;
+    new_server->connect_pending = 0;
     new_server->command_time = 0;
     new_server->reconnect_join = 0;
     new_server->disable_autojoin = 0;
@@ -997,13 +1023,19 @@ irc_server_alloc (const char *name)
     new_server->lag_last_refresh = 0;
     new_server->cmd_list_regexp = NULL;
     new_server->last_user_message = 0;
+    new_server->anti_flood_refill.tv_sec = 0;
+    new_server->anti_flood_refill.tv_usec = 0;
     new_server->last_away_check = 0;
     new_server->last_data_purge = 0;
     for (i = 0; i < IRC_SERVER_NUM_OUTQUEUES_PRIO; i++)
     {
         new_server->outqueue[i] = NULL;
         new_server->last_outqueue[i] = NULL;
+        new_server->anti_flood_credit[i] = 0;
     }
+    new_server->outqueue_sending = NULL;
+    new_server->last_outqueue_sending = NULL;
+    new_server->ssl_send_retry = 0;
     new_server->redirects = NULL;
     new_server->last_redirect = NULL;
     new_server->notify_list = NULL;
@@ -1317,6 +1349,36 @@ irc_server_apply_command_line_options (struct t_irc_server *server,
     }
 }
 
+/*
+ * Creates a message for out queue (it is not added in a queue).
+ *
+ * Returns pointer to new message, NULL if error.
+ */
+
+struct t_irc_outqueue *
+irc_server_outqueue_new (const char *command, const char *msg1,
+                         const char *msg2, int modified, const char *tags,
+                         struct t_irc_redirect *redirect)
+{
+    struct t_irc_outqueue *new_outqueue;
+
+    new_outqueue = malloc (sizeof (*new_outqueue));
+    if (!new_outqueue)
+        return NULL;
+
+    new_outqueue->command = (command) ? strdup (command) : strdup ("unknown");
+    new_outqueue->message_before_mod = (msg1) ? strdup (msg1) : NULL;
+    new_outqueue->message_after_mod = (msg2) ? strdup (msg2) : NULL;
+    new_outqueue->modified = modified;
+    new_outqueue->tags = (tags) ? strdup (tags) : NULL;
+    new_outqueue->redirect = redirect;
+    new_outqueue->sent = 0;
+    new_outqueue->prev_outqueue = NULL;
+    new_outqueue->next_outqueue = NULL;
+
+    return new_outqueue;
+}
+
 /*
  * Adds a message in out queue.
  */
@@ -1329,16 +1391,10 @@ irc_server_outqueue_add (struct t_irc_server *server, int priority,
 {
     struct t_irc_outqueue *new_outqueue;
 
-    new_outqueue = malloc (sizeof (*new_outqueue));
+    new_outqueue = irc_server_outqueue_new (command, msg1, msg2, modified,
+                                            tags, redirect);
     if (new_outqueue)
     {
-        new_outqueue->command = (command) ? strdup (command) : strdup ("unknown");
-        new_outqueue->message_before_mod = (msg1) ? strdup (msg1) : NULL;
-        new_outqueue->message_after_mod = (msg2) ? strdup (msg2) : NULL;
-        new_outqueue->modified = modified;
-        new_outqueue->tags = (tags) ? strdup (tags) : NULL;
-        new_outqueue->redirect = redirect;
-
         new_outqueue->prev_outqueue = server->last_outqueue[priority];
         new_outqueue->next_outqueue = NULL;
         if (server->outqueue[priority])
@@ -1350,17 +1406,16 @@ irc_server_outqueue_add (struct t_irc_server *server, int priority,
 }
 
 /*
- * Frees a message in out queue.
+ * Removes a message from out queue (the message is not freed).
  */
 
 void
-irc_server_outqueue_free (struct t_irc_server *server,
-                          int priority,
-                          struct t_irc_outqueue *outqueue)
+irc_server_outqueue_remove (struct t_irc_server *server,
+                            int priority,
+                            struct t_irc_outqueue *outqueue)
 {
     struct t_irc_outqueue *new_outqueue;
 
-    /* remove outqueue message */
     if (server->last_outqueue[priority] == outqueue)
         server->last_outqueue[priority] = outqueue->prev_outqueue;
     if (outqueue->prev_outqueue)
@@ -1374,7 +1429,20 @@ irc_server_outqueue_free (struct t_irc_server *server,
     if (outqueue->next_outqueue)
         (outqueue->next_outqueue)->prev_outqueue = outqueue->prev_outqueue;
 
-    /* free data */
+    outqueue->prev_outqueue = NULL;
+    outqueue->next_outqueue = NULL;
+
+    /* set new head */
+    server->outqueue[priority] = new_outqueue;
+}
+
+/*
+ * Frees data of a message removed from out queue.
+ */
+
+void
+irc_server_outqueue_free_data (struct t_irc_outqueue *outqueue)
+{
     if (outqueue->command)
         free (outqueue->command);
     if (outqueue->message_before_mod)
@@ -1384,9 +1452,19 @@ irc_server_outqueue_free (struct t_irc_server *server,
     if (outqueue->tags)
         free (outqueue->tags);
     free (outqueue);
+}
 
-    /* set new head */
-    server->outqueue[priority] = new_outqueue;
+/*
+ * Frees a message in out queue.
+ */
+
+void
+irc_server_outqueue_free (struct t_irc_server *server,
+                          int priority,
+                          struct t_irc_outqueue *outqueue)
+{
+    irc_server_outqueue_remove (server, priority, outqueue);
+    irc_server_outqueue_free_data (outqueue);
 }
 
 /*
@@ -1403,6 +1481,177 @@ irc_server_outqueue_free_all (struct t_irc_server *server, int priority)
     }
 }
 
+/*
+ * Adds a message at the end of the list of messages being written to socket.
+ */
+
+void
+irc_server_outqueue_sending_add (struct t_irc_server *server,
+                                 struct t_irc_outqueue *outqueue)
+{
+    outqueue->prev_outqueue = server->last_outqueue_sending;
+    outqueue->next_outqueue = NULL;
+    if (server->outqueue_sending)
+        server->last_outqueue_sending->next_outqueue = outqueue;
+    else
+        server->outqueue_sending = outqueue;
+    server->last_outqueue_sending = outqueue;
+}
+
+/*
+ * Removes the first message of the list of messages being written to socket
+ * (the message is not freed).
+ *
+ * Returns pointer to message removed, NULL if list is empty.
+ */
+
+struct t_irc_outqueue *
+irc_server_outqueue_sending_shift (struct t_irc_server *server)
+{
+    struct t_irc_outqueue *ptr_outqueue;
+
+    ptr_outqueue = server->outqueue_sending;
+    if (!ptr_outqueue)
+        return NULL;
+
+    server->outqueue_sending = ptr_outqueue->next_outqueue;
+    if (server->outqueue_sending)
+        (server->outqueue_sending)->prev_outqueue = NULL;
+    else
+        server->last_outqueue_sending = NULL;
+
+    ptr_outqueue->prev_outqueue = NULL;
+    ptr_outqueue->next_outqueue = NULL;
+
+    return ptr_outqueue;
+}
+
+/*
+ * Frees all messages being written to socket (messages partially written are
+ * lost: it must be called only when the socket is closed).
+ */
+
+void
+irc_server_outqueue_sending_free_all (struct t_irc_server *server)
+{
+    struct t_irc_outqueue *ptr_outqueue;
+
+    while ((ptr_outqueue = irc_server_outqueue_sending_shift (server)))
+    {
+        irc_server_outqueue_free_data (ptr_outqueue);
+    }
+
+    server->ssl_send_retry = 0;
+
+    if (server->hook_fd_write)
+    {
+        weechat_unhook (server->hook_fd_write);
+        server->hook_fd_write = NULL;
+    }
+}
+
+/*
+ * Builds a string with server address/port and SSL options, used to check
+ * that saved TLS session data can be used to resume a session.
+ *
+ * Note: result must be freed after use.
+ */
+
+char *
+irc_server_ssl_session_server (struct t_irc_server *server)
+{
+    const char *ptr_cert, *ptr_fingerprint, *ptr_priorities;
+    char *result;
+    int length;
+
+    if (!server || !server->current_address)
+        return NULL;
+
+    ptr_cert = IRC_SERVER_OPTION_STRING(server, IRC_SERVER_OPTION_SSL_CERT);
+    ptr_fingerprint = IRC_SERVER_OPTION_STRING(server,
+                                               IRC_SERVER_OPTION_SSL_FINGERPRINT);
+    ptr_priorities = IRC_SERVER_OPTION_STRING(server,
+                                              IRC_SERVER_OPTION_SSL_PRIORITIES);
+
+    length = strlen (server->current_address) + 16
+        + ((ptr_cert) ? strlen (ptr_cert) : 0)
+        + ((ptr_fingerprint) ? strlen (ptr_fingerprint) : 0)
+        + ((ptr_priorities) ? strlen (ptr_priorities) : 0)
+        + 16;
+    result = malloc (length);
+    if (!result)
+        return NULL;
+    snprintf (result, length, "%s/%d,%d,%s,%s,%s",
+              server->current_address,
+              server->current_port,
+              IRC_SERVER_OPTION_BOOLEAN(server, IRC_SERVER_OPTION_SSL_VERIFY),
+              (ptr_cert) ? ptr_cert : "",
+              (ptr_fingerprint) ? ptr_fingerprint : "",
+              (ptr_priorities) ? ptr_priorities : "");
+
+    return result;
+}
+
+/*
+ * Frees saved TLS session data of a server.
+ */
+
+void
+irc_server_ssl_session_free (struct t_irc_server *server)
+{
+    if (!server)
+        return;
+
+    if (server->ssl_session_data)
+    {
+        free (server->ssl_session_data);
+        server->ssl_session_data = NULL;
+    }
+    server->ssl_session_data_size = 0;
+    if (server->ssl_session_server)
+    {
+        free (server->ssl_session_server);
+        server->ssl_session_server = NULL;
+    }
+}
+
+#ifdef HAVE_GNUTLS
+/*
+ * Saves TLS session data of a server (before closing the connection), so that
+ * the session can be resumed on next connection (without a full handshake).
+ */
+
+void
+irc_server_ssl_session_save (struct t_irc_server *server)
+{
+    gnutls_datum_t session_data;
+
+    if (!server || !server->ssl_connected || (server->sock == -1)
+        || server->hook_connect)
+    {
+        return;
+    }
+
+    if ((gnutls_session_get_data2 (server->gnutls_sess,
+                                   &session_data) != GNUTLS_E_SUCCESS)
+        || (session_data.size == 0))
+    {
+        return;
+    }
+
+    irc_server_ssl_session_free (server);
+    server->ssl_session_data = malloc (session_data.size);
+    if (server->ssl_session_data)
+    {
+        memcpy (server->ssl_session_data, session_data.data,
+                session_data.size);
+        server->ssl_session_data_size = session_data.size;
+        server->ssl_session_server = irc_server_ssl_session_server (server);
+    }
+    gnutls_free (session_data.data);
+}
+#endif
+
 /*
  * Frees server data.
  */
@@ -1420,6 +1669,7 @@ irc_server_free_data (struct t_irc_server *server)
     {
         irc_server_outqueue_free_all (server, i);
     }
+    irc_server_outqueue_sending_free_all (server);
     irc_redirect_free_all (server);
     irc_notify_free_all (server);
     irc_channel_free_all (server);
@@ -1447,6 +1697,7 @@ irc_server_free_data (struct t_irc_server *server)
         free (server->current_address);
     if (server->current_ip)
         free (server->current_ip);
+    irc_server_ssl_session_free (server);
     if (server->hook_connect)
         weechat_unhook (server->hook_connect);
     if (server->hook_fd)
@@ -1455,6 +1706,10 @@ irc_server_free_data (struct t_irc_server *server)
         weechat_unhook (server->hook_timer_connection);
     if (server->hook_timer_sasl)
         weechat_unhook (server->hook_timer_sasl);
+    if (server->hook_timer_outqueue)
+        weechat_unhook (server->hook_timer_outqueue);
+    if (server->hook_timer_checks)
+        weechat_unhook (server->hook_timer_checks);
     if (server->unterminated_message)
         free (server->unterminated_message);
     if (server->nicks_array)
@@ -1535,6 +1790,12 @@ irc_server_free_all ()
     {
         irc_server_free (irc_servers);
     }
+
+    if (irc_server_hook_timer_connect_pending)
+    {
+        weechat_unhook (irc_server_hook_timer_connect_pending);
+        irc_server_hook_timer_connect_pending = NULL;
+    }
 }
 
 /*
@@ -1733,67 +1994,6 @@ irc_server_send_signal (struct t_irc_server *server, const char *signal,
     }
 }
 
-/*
- * Sends data to IRC server.
- *
- * Returns number of bytes sent, -1 if error.
- */
-
-int
-irc_server_send (struct t_irc_server *server, const char *buffer, int size_buf)
-{
-    int rc;
-
-    if (!server)
-    {
-        weechat_printf (NULL,
-                        _("%s%s: sending data to server: null pointer (please "
-                          "report problem to developers)"),
-                        weechat_prefix ("error"), IRC_PLUGIN_NAME);
-        return 0;
-    }
-
-    if (size_buf <= 0)
-    {
-        weechat_printf (server->buffer,
-                        _("%s%s: sending data to server: empty buffer (please "
-                          "report problem to developers)"),
-                        weechat_prefix ("error"), IRC_PLUGIN_NAME);
-        return 0;
-    }
-
-#ifdef HAVE_GNUTLS
-    if (server->ssl_connected)
-        rc = gnutls_record_send (server->gnutls_sess, buffer, size_buf);
-    else
-#endif
-        rc = send (server->sock, buffer, size_buf, 0);
-
-    if (rc < 0)
-    {
-#ifdef HAVE_GNUTLS
-        if (server->ssl_connected)
-        {
-            weechat_printf (server->buffer,
-                            _("%s%s: sending data to server: error %d %s"),
-                            weechat_prefix ("error"), IRC_PLUGIN_NAME,
-                            rc,
-                            gnutls_strerror (rc));
-        }
-        else
-#endif
-        {
-            weechat_printf (server->buffer,
-                            _("%s%s: sending data to server: error %d %s"),
-                            weechat_prefix ("error"), IRC_PLUGIN_NAME,
-                            errno,
-                            strerror (errno));
-        }
-    }
-
-    return rc;
-}
-
 /*
  * Sets default tags used when sending message.
  */
@@ -1835,89 +2035,482 @@ irc_server_get_tags_to_send (const char *tags)
 }
 
 /*
- * Sends a message from out queue.
+ * Gets anti-flood settings for a queue: delay between two messages (in
+ * milliseconds) and number of messages allowed in a burst.
  */
 
 void
-irc_server_outqueue_send (struct t_irc_server *server)
+irc_server_outqueue_get_anti_flood (struct t_irc_server *server, int priority,
+                                    long *delay, long *burst)
 {
-    time_t time_now;
-    char *pos, *tags_to_send;
-    int priority, anti_flood;
+    switch (priority)
+    {
+        case 0:
+            *delay = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH) * 1000;
+            *burst = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST_HIGH);
+            break;
+        default:
+            *delay = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW) * 1000;
+            *burst = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST_LOW);
+            break;
+    }
+    if (*burst < 1)
+        *burst = 1;
+}
+
+/*
+ * Refills anti-flood token buckets of a server, according to time elapsed
+ * since last refill.
+ *
+ * Each bucket holds a credit in milliseconds: sending a message costs the
+ * anti-flood delay of the queue, and the credit can not exceed the delay
+ * multiplied by the burst size.
+ */
+
+void
+irc_server_outqueue_refill (struct t_irc_server *server)
+{
+    struct timeval tv_now;
+    long elapsed, delay, burst;
+    int priority, full;
 
-    time_now = time (NULL);
+    gettimeofday (&tv_now, NULL);
+
+    full = (server->anti_flood_refill.tv_sec == 0);
+    elapsed = (full) ?
+        0 : weechat_util_timeval_diff (&(server->anti_flood_refill), &tv_now);
 
     /* detect if system clock has been changed (now lower than before) */
-    if (server->last_user_message > time_now)
-        server->last_user_message = time_now;
+    if (elapsed < 0)
+        elapsed = 0;
+
+    for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO; priority++)
+    {
+        irc_server_outqueue_get_anti_flood (server, priority, &delay, &burst);
+        if (full || (server->anti_flood_credit[priority] + elapsed > delay * burst))
+            server->anti_flood_credit[priority] = delay * burst;
+        else
+            server->anti_flood_credit[priority] += elapsed;
+    }
+
+    server->anti_flood_refill.tv_sec = tv_now.tv_sec;
+    server->anti_flood_refill.tv_usec = tv_now.tv_usec;
+}
+
+/*
+ * Checks if a message can be sent now in a queue (enough credit in the
+ * anti-flood bucket).
+ *
+ * Note: buckets must have been refilled before calling this function.
+ *
+ * Returns:
+ *   1: message can be sent now
+ *   0: message must wait
+ */
+
+int
+irc_server_outqueue_can_send (struct t_irc_server *server, int priority)
+{
+    long delay, burst;
+
+    irc_server_outqueue_get_anti_flood (server, priority, &delay, &burst);
+
+    return (server->anti_flood_credit[priority] >= delay) ? 1 : 0;
+}
+
+/*
+ * Consumes credit in anti-flood buckets after a message from a queue has been
+ * sent.
+ *
+ * A message sent consumes credit in all buckets, so that low priority messages
+ * wait after high priority ones (and vice versa).
+ */
+
+void
+irc_server_outqueue_consume (struct t_irc_server *server)
+{
+    long delay, burst;
+    int priority;
+
+    for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO; priority++)
+    {
+        irc_server_outqueue_get_anti_flood (server, priority, &delay, &burst);
+        server->anti_flood_credit[priority] -= delay;
+        if (server->anti_flood_credit[priority] < 0)
+            server->anti_flood_credit[priority] = 0;
+    }
+
+    server->last_user_message = time (NULL);
+}
+
+/*
+ * Callback for timer used to send queued messages when credit is available
+ * again in anti-flood buckets.
+ */
+
+int
+irc_server_outqueue_timer_cb (void *data, int remaining_calls)
+{
+    struct t_irc_server *server;
+
+    /* make C compiler happy */
+    (void) remaining_calls;
+
+    server = (struct t_irc_server *)data;
+
+    if (!server)
+        return WEECHAT_RC_ERROR;
+
+    server->hook_timer_outqueue = NULL;
+
+    if (server->is_connected)
+        irc_server_outqueue_send (server);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Schedules a timer to send queued messages as soon as there is enough credit
+ * in the anti-flood bucket of a non-empty queue.
+ */
+
+void
+irc_server_outqueue_schedule (struct t_irc_server *server)
+{
+    long delay, burst, wait, min_wait;
+    int priority;
 
+    if (server->hook_timer_outqueue)
+        return;
+
+    min_wait = -1;
     for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO; priority++)
     {
-        switch (priority)
+        if (!server->outqueue[priority])
+            continue;
+        irc_server_outqueue_get_anti_flood (server, priority, &delay, &burst);
+        wait = delay - server->anti_flood_credit[priority];
+        if (wait < 1)
+            wait = 1;
+        if ((min_wait < 0) || (wait < min_wait))
+            min_wait = wait;
+    }
+
+    if (min_wait > 0)
+    {
+        server->hook_timer_outqueue = weechat_hook_timer (
+            min_wait, 0, 1,
+            &irc_server_outqueue_timer_cb, server);
+    }
+}
+
+/*
+ * Displays a message in raw buffer, starts redirection and sends signals
+ * "irc_out" and "irc_outtags": it is called when the message has been
+ * completely written to socket.
+ */
+
+void
+irc_server_outqueue_sent (struct t_irc_server *server,
+                          struct t_irc_outqueue *outqueue)
+{
+    char *pos, *tags_to_send;
+
+    if (outqueue->message_before_mod)
+    {
+        pos = strchr (outqueue->message_before_mod, '\r');
+        if (pos)
+            pos[0] = '\0';
+        irc_raw_print (server, IRC_RAW_FLAG_SEND,
+                       outqueue->message_before_mod);
+        if (pos)
+            pos[0] = '\r';
+    }
+
+    if (!outqueue->message_after_mod)
+        return;
+
+    /* start redirection if redirect is set */
+    if (outqueue->redirect)
+    {
+        irc_redirect_init_command (outqueue->redirect,
+                                   outqueue->message_after_mod);
+    }
+
+    pos = strchr (outqueue->message_after_mod, '\r');
+    if (pos)
+        pos[0] = '\0';
+    irc_raw_print (server, IRC_RAW_FLAG_SEND |
+                   ((outqueue->modified) ? IRC_RAW_FLAG_MODIFIED : 0),
+                   outqueue->message_after_mod);
+
+    /* send signal with command sent to server */
+    irc_server_send_signal (server, "irc_out",
+                            outqueue->command,
+                            outqueue->message_after_mod,
+                            NULL);
+    tags_to_send = irc_server_get_tags_to_send (outqueue->tags);
+    irc_server_send_signal (server, "irc_outtags",
+                            outqueue->command,
+                            outqueue->message_after_mod,
+                            (tags_to_send) ? tags_to_send : "");
+    if (tags_to_send)
+        free (tags_to_send);
+
+    if (pos)
+        pos[0] = '\r';
+}
+
+/*
+ * Callback for fd hook on socket (write), used only when a message is
+ * partially written.
+ */
+
+int
+irc_server_send_cb (void *data, int fd)
+{
+    struct t_irc_server *server;
+
+    /* make C compiler happy */
+    (void) fd;
+
+    server = (struct t_irc_server *)data;
+    if (!server)
+        return WEECHAT_RC_ERROR;
+
+    irc_server_outqueue_send (server);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Writes messages being sent to socket (up to IRC_SERVER_OUTQUEUE_MAX_BATCH
+ * messages with a single call to writev, or a single TLS record if SSL is
+ * used).
+ *
+ * Messages completely written are removed from list and freed, after a call
+ * to irc_server_outqueue_sent. If some data could not be written, it is kept
+ * at the head of list and written as soon as the socket is writable.
+ *
+ * Returns:
+ *   1: OK (all data written, or the rest will be written later)
+ *   0: error (messages are lost)
+ */
+
+int
+irc_server_outqueue_write (struct t_irc_server *server)
+{
+    struct iovec iov[IRC_SERVER_OUTQUEUE_MAX_BATCH];
+    struct t_irc_outqueue *ptr_outqueue, *sent_list, *last_sent;
+    int i, count, rc, size, length;
+#ifdef HAVE_GNUTLS
+    char *buffer;
+#endif
+
+    if (server->sock == -1)
+    {
+        irc_server_outqueue_sending_free_all (server);
+        return 0;
+    }
+
+    while (server->outqueue_sending)
+    {
+        count = 0;
+        size = 0;
+        for (ptr_outqueue = server->outqueue_sending;
+             ptr_outqueue && (count < IRC_SERVER_OUTQUEUE_MAX_BATCH);
+             ptr_outqueue = ptr_outqueue->next_outqueue)
         {
-            case 0:
-                anti_flood = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH);
-                break;
-            default:
-                anti_flood = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW);
-                break;
+            iov[count].iov_base = ptr_outqueue->message_after_mod
+                + ptr_outqueue->sent;
+            iov[count].iov_len = strlen (ptr_outqueue->message_after_mod)
+                - ptr_outqueue->sent;
+            size += iov[count].iov_len;
+            count++;
         }
-        if (server->outqueue[priority]
-            && (time_now >= server->last_user_message + anti_flood))
+
+#ifdef HAVE_GNUTLS
+        if (server->ssl_connected)
         {
-            if (server->outqueue[priority]->message_before_mod)
+            /*
+             * if gnutls returns GNUTLS_E_AGAIN, it must be called again with
+             * the same data: data is kept at the head of list, and messages
+             * added meanwhile are not sent in this record
+             */
+            if ((server->ssl_send_retry > 0) && (size > server->ssl_send_retry))
+                size = server->ssl_send_retry;
+            buffer = malloc (size);
+            if (!buffer)
+                return 0;
+            length = 0;
+            for (i = 0; (i < count) && (length < size); i++)
             {
-                pos = strchr (server->outqueue[priority]->message_before_mod,
-                              '\r');
-                if (pos)
-                    pos[0] = '\0';
-                irc_raw_print (server, IRC_RAW_FLAG_SEND,
-                               server->outqueue[priority]->message_before_mod);
-                if (pos)
-                    pos[0] = '\r';
+                memcpy (buffer + length, iov[i].iov_base,
+                        (length + (int)iov[i].iov_len > size) ?
+                        (size_t)(size - length) : iov[i].iov_len);
+                length += iov[i].iov_len;
             }
-            if (server->outqueue[priority]->message_after_mod)
+            rc = gnutls_record_send (server->gnutls_sess, buffer, size);
+            free (buffer);
+            server->ssl_send_retry = 0;
+            if ((rc == GNUTLS_E_AGAIN) || (rc == GNUTLS_E_INTERRUPTED))
             {
-                pos = strchr (server->outqueue[priority]->message_after_mod,
-                              '\r');
-                if (pos)
-                    pos[0] = '\0';
-                irc_raw_print (server, IRC_RAW_FLAG_SEND |
-                               ((server->outqueue[priority]->modified) ? IRC_RAW_FLAG_MODIFIED : 0),
-                               server->outqueue[priority]->message_after_mod);
-                if (pos)
-                    pos[0] = '\r';
-
-                /* send signal with command that will be sent to server */
-                irc_server_send_signal (server, "irc_out",
-                                        server->outqueue[priority]->command,
-                                        server->outqueue[priority]->message_after_mod,
-                                        NULL);
-                tags_to_send = irc_server_get_tags_to_send (server->outqueue[priority]->tags);
-                irc_server_send_signal (server, "irc_outtags",
-                                        server->outqueue[priority]->command,
-                                        server->outqueue[priority]->message_after_mod,
-                                        (tags_to_send) ? tags_to_send : "");
-                if (tags_to_send)
-                    free (tags_to_send);
+                server->ssl_send_retry = size;
+                rc = 0;
+            }
+            else if (rc < 0)
+            {
+                weechat_printf (server->buffer,
+                                _("%s%s: sending data to server: error %d %s"),
+                                weechat_prefix ("error"), IRC_PLUGIN_NAME,
+                                rc,
+                                gnutls_strerror (rc));
+            }
+        }
+        else
+#endif
+        {
+            rc = writev (server->sock, iov, count);
+            if ((rc < 0)
+                && ((errno == EAGAIN) || (errno == EWOULDBLOCK)
+                    || (errno == EINTR)))
+            {
+                rc = 0;
+            }
+            else if (rc < 0)
+            {
+                weechat_printf (server->buffer,
+                                _("%s%s: sending data to server: error %d %s"),
+                                weechat_prefix ("error"), IRC_PLUGIN_NAME,
+                                errno,
+                                strerror (errno));
+            }
+        }
 
-                /* send command */
-                irc_server_send (server, server->outqueue[priority]->message_after_mod,
-                                 strlen (server->outqueue[priority]->message_after_mod));
-                server->last_user_message = time_now;
+        if (rc < 0)
+        {
+            irc_server_outqueue_sending_free_all (server);
+            return 0;
+        }
 
-                /* start redirection if redirect is set */
-                if (server->outqueue[priority]->redirect)
-                {
-                    irc_redirect_init_command (server->outqueue[priority]->redirect,
-                                               server->outqueue[priority]->message_after_mod);
-                }
+        /*
+         * remove messages completely written from list (the one partially
+         * written stays at the head); signals are sent after, because a
+         * callback may send other messages
+         */
+        sent_list = NULL;
+        last_sent = NULL;
+        length = rc;
+        while (server->outqueue_sending && (length > 0))
+        {
+            ptr_outqueue = server->outqueue_sending;
+            size = strlen (ptr_outqueue->message_after_mod) - ptr_outqueue->sent;
+            if (length < size)
+            {
+                ptr_outqueue->sent += length;
+                break;
             }
-            irc_server_outqueue_free (server, priority,
-                                      server->outqueue[priority]);
+            length -= size;
+            irc_server_outqueue_sending_shift (server);
+            if (last_sent)
+                last_sent->next_outqueue = ptr_outqueue;
+            else
+                sent_list = ptr_outqueue;
+            last_sent = ptr_outqueue;
+        }
+
+        while (sent_list)
+        {
+            ptr_outqueue = sent_list;
+            sent_list = sent_list->next_outqueue;
+            ptr_outqueue->next_outqueue = NULL;
+            irc_server_outqueue_sent (server, ptr_outqueue);
+            irc_server_outqueue_free_data (ptr_outqueue);
+        }
+
+        /* socket is full: wait until it is writable */
+        if (rc == 0)
             break;
+    }
+
+    if (server->outqueue_sending)
+    {
+        if (!server->hook_fd_write)
+        {
+            server->hook_fd_write = weechat_hook_fd (server->sock, 0, 1, 0,
+                                                     &irc_server_send_cb,
+                                                     server);
         }
     }
+    else if (server->hook_fd_write)
+    {
+        weechat_unhook (server->hook_fd_write);
+        server->hook_fd_write = NULL;
+    }
+
+    return 1;
+}
+
+/*
+ * Sends messages from out queues, as many as allowed by anti-flood buckets.
+ *
+ * Messages ready to be sent are coalesced in a single write to the socket
+ * (after messages partially written before, if any).
+ * If messages remain in queues, a timer is scheduled to send them as soon as
+ * credit is available again.
+ */
+
+void
+irc_server_outqueue_send (struct t_irc_server *server)
+{
+    struct t_irc_outqueue *ptr_outqueue;
+    int priority, count;
+
+    /* first write data not written before */
+    if (server->outqueue_sending)
+    {
+        irc_server_outqueue_write (server);
+        if (server->outqueue_sending)
+            return;
+    }
+
+    irc_server_outqueue_refill (server);
+
+    count = 0;
+    while (count < IRC_SERVER_OUTQUEUE_MAX_BATCH)
+    {
+        for (priority = 0; priority < IRC_SERVER_NUM_OUTQUEUES_PRIO; priority++)
+        {
+            if (server->outqueue[priority]
+                && irc_server_outqueue_can_send (server, priority))
+            {
+                break;
+            }
+        }
+        if (priority >= IRC_SERVER_NUM_OUTQUEUES_PRIO)
+            break;
+
+        ptr_outqueue = server->outqueue[priority];
+        irc_server_outqueue_remove (server, priority, ptr_outqueue);
+
+        if (ptr_outqueue->message_after_mod)
+        {
+            irc_server_outqueue_sending_add (server, ptr_outqueue);
+            count++;
+            irc_server_outqueue_consume (server);
+        }
+        else
+        {
+            irc_server_outqueue_sent (server, ptr_outqueue);
+            irc_server_outqueue_free_data (ptr_outqueue);
+        }
+    }
+
+    if (count > 0)
+        irc_server_outqueue_write (server);
+
+    if (server->is_connected)
+        irc_server_outqueue_schedule (server);
 }
 
 /*
@@ -1944,9 +2537,9 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
     const char *ptr_msg, *ptr_chan_nick;
     char *new_msg, *pos, *tags_to_send, *msg_encoded;
     char str_modifier[128], modifier_data[256];
-    int rc, queue_msg, add_to_queue, first_message, anti_flood;
-    time_t time_now;
+    int rc, queue_msg, add_to_queue, first_message;
     struct t_irc_redirect *ptr_redirect;
+    struct t_irc_outqueue *ptr_outqueue;
 
     rc = 1;
 
@@ -2003,13 +2596,6 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
 
             snprintf (buffer, sizeof (buffer), "%s\r\n", ptr_msg);
 
-            /* anti-flood: look whether we should queue outgoing message or not */
-            time_now = time (NULL);
-
-            /* detect if system clock has been changed (now lower than before) */
-            if (server->last_user_message > time_now)
-                server->last_user_message = time_now;
-
             /* get queue from flags */
             queue_msg = 0;
             if (flags & IRC_SERVER_SEND_OUTQ_PRIO_HIGH)
@@ -2017,23 +2603,16 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
             else if (flags & IRC_SERVER_SEND_OUTQ_PRIO_LOW)
                 queue_msg = 2;
 
-            switch (queue_msg - 1)
-            {
-                case 0:
-                    anti_flood = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH);
-                    break;
-                default:
-                    anti_flood = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW);
-                    break;
-            }
-
+            /* anti-flood: look whether we should queue outgoing message or not */
             add_to_queue = 0;
-            if ((queue_msg > 0)
-                && (server->outqueue[queue_msg - 1]
-                    || ((anti_flood > 0)
-                        && (time_now - server->last_user_message < anti_flood))))
+            if (queue_msg > 0)
             {
-                add_to_queue = queue_msg;
+                irc_server_outqueue_refill (server);
+                if (server->outqueue[queue_msg - 1]
+                    || !irc_server_outqueue_can_send (server, queue_msg - 1))
+                {
+                    add_to_queue = queue_msg;
+                }
             }
 
             tags_to_send = irc_server_get_tags_to_send (tags);
@@ -2052,39 +2631,35 @@ irc_server_send_one_msg (struct t_irc_server *server, int flags,
                 /* mark redirect as "used" */
                 if (ptr_redirect)
                     ptr_redirect->assigned_to_command = 1;
+                irc_server_outqueue_schedule (server);
             }
             else
             {
-                if (first_message)
-                {
-                    irc_raw_print (server, IRC_RAW_FLAG_SEND, message);
-                }
-                if (new_msg)
+                /*
+                 * write message now (after data partially written before, if
+                 * any); raw display, redirection and signals are done when
+                 * the message is completely written
+                 */
+                ptr_outqueue = irc_server_outqueue_new (
+                    command,
+                    (new_msg && first_message) ? message : NULL,
+                    buffer,
+                    (new_msg) ? 1 : 0,
+                    tags_to_send,
+                    ptr_redirect);
+                if (ptr_outqueue)
                 {
-                    irc_raw_print (server,
-                                   IRC_RAW_FLAG_SEND | IRC_RAW_FLAG_MODIFIED,
-                                   ptr_msg);
+                    /* mark redirect as "used" */
+                    if (ptr_redirect)
+                        ptr_redirect->assigned_to_command = 1;
+                    irc_server_outqueue_sending_add (server, ptr_outqueue);
+                    if (!irc_server_outqueue_write (server))
+                        rc = 0;
+                    else if (queue_msg > 0)
+                        irc_server_outqueue_consume (server);
                 }
-
-                /* send signal with command that will be sent to server */
-                irc_server_send_signal (server, "irc_out",
-                                        (command) ? command : "unknown",
-                                        ptr_msg,
-                                        NULL);
-                irc_server_send_signal (server, "irc_outtags",
-                                        (command) ? command : "unknown",
-                                        ptr_msg,
-                                        (tags_to_send) ? tags_to_send : "");
-
-                if (irc_server_send (server, buffer, strlen (buffer)) <= 0)
-                    rc = 0;
                 else
-                {
-                    if (queue_msg > 0)
-                        server->last_user_message = time_now;
-                }
-                if (ptr_redirect)
-                    irc_redirect_init_command (ptr_redirect, buffer);
+                    rc = 0;
             }
 
             if (tags_to_send)
@@ -2132,10 +2707,11 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
                   const char *format, ...)
 {
     char **items, hash_key[32], value[32], *nick, *command, *channel, *new_msg;
-    char str_modifier[128];
-    const char *str_message, *str_args;
+    char str_modifier[128], *str_args;
+    const char *str_message;
     int i, items_count, number, ret_number, rc;
-    struct t_hashtable *hashtable, *ret_hashtable;
+    struct t_irc_message_split split;
+    struct t_hashtable *ret_hashtable;
 
     if (!server)
         return NULL;
@@ -2186,47 +2762,44 @@ irc_server_sendf (struct t_irc_server *server, int flags, const char *tags,
                                     NULL);
 
             /* split message if needed (max is 512 bytes including final "\r\n") */
-            hashtable = irc_message_split (server,
-                                           (new_msg) ? new_msg : items[i]);
-            if (hashtable)
+            irc_message_split_msg (server,
+                                   (new_msg) ? new_msg : items[i],
+                                   &split);
+            for (number = 0; number < split.count; number++)
             {
-                number = 1;
-                while (1)
+                str_message = split.data + split.items[number].msg_offset;
+
+                rc = irc_server_send_one_msg (server, flags, str_message,
+                                              nick, command, channel, tags);
+                if (!rc)
+                    break;
+
+                if (ret_hashtable)
                 {
-                    snprintf (hash_key, sizeof (hash_key), "msg%d", number);
-                    str_message = weechat_hashtable_get (hashtable, hash_key);
-                    if (!str_message)
-                        break;
-                    snprintf (hash_key, sizeof (hash_key), "args%d", number);
-                    str_args = weechat_hashtable_get (hashtable, hash_key);
-
-                    rc = irc_server_send_one_msg (server, flags, str_message,
-                                                  nick, command, channel, tags);
-                    if (!rc)
-                        break;
-
-                    if (ret_hashtable)
+                    snprintf (hash_key, sizeof (hash_key), "msg%d", ret_number);
+                    weechat_hashtable_set (ret_hashtable, hash_key, str_message);
+                    if (split.items[number].args_offset >= 0)
                     {
-                        snprintf (hash_key, sizeof (hash_key), "msg%d", ret_number);
-                        weechat_hashtable_set (ret_hashtable, hash_key, str_message);
+                        str_args = weechat_strndup (split.data + split.items[number].args_offset,
+                                                    split.items[number].args_length);
                         if (str_args)
                         {
                             snprintf (hash_key, sizeof (hash_key), "args%d", ret_number);
                             weechat_hashtable_set (ret_hashtable, hash_key, str_args);
+                            free (str_args);
                         }
-                        ret_number++;
                     }
-                    number++;
-                }
-                if (ret_hashtable)
-                {
-                    snprintf (value, sizeof (value), "%d", ret_number - 1);
-                    weechat_hashtable_set (ret_hashtable, "count", value);
+                    ret_number++;
                 }
-                weechat_hashtable_free (hashtable);
-                if (!rc)
-                    break;
             }
+            if (ret_hashtable)
+            {
+                snprintf (value, sizeof (value), "%d", ret_number - 1);
+                weechat_hashtable_set (ret_hashtable, "count", value);
+            }
+            irc_message_split_free (&split);
+            if (!rc)
+                break;
         }
         if (nick)
             free (nick);
@@ -2454,6 +3027,8 @@ irc_server_msgq_flush ()
                                                &tags, NULL, &nick, &host,
                                                &command, &channel, &arguments);
 
+                            weechat_trace_begin ((command) ? command : "unknown");
+
                             /* convert charset for message */
                             if (channel
                                 && irc_channel_is_channel (irc_recv_msgq->server,
@@ -2547,6 +3122,8 @@ irc_server_msgq_flush ()
                                 }
                             }
 
+                            weechat_trace_end ();
+
                             if (new_msg2)
                                 free (new_msg2);
                             if (nick)
@@ -2785,35 +3362,156 @@ irc_server_check_join_noswitch_cb (void *data, struct t_hashtable *hashtable,
     /* make C compiler happy */
     (void) data;
 
-    if (*((time_t *)value) + (60 * 10) < time (NULL))
-        weechat_hashtable_remove (hashtable, key);
+    if (*((time_t *)value) + (60 * 10) < time (NULL))
+        weechat_hashtable_remove (hashtable, key);
+}
+
+/*
+ * Callback called for each smart filtered join of a channel: deletes old
+ * entries in the hashtable.
+ */
+
+void
+irc_server_check_join_smart_filtered_cb (void *data,
+                                         struct t_hashtable *hashtable,
+                                         const void *key, const void *value)
+{
+    int unmask_delay;
+
+    /* make C compiler happy */
+    (void) data;
+
+    unmask_delay = weechat_config_integer (irc_config_look_smart_filter_join_unmask);
+    if ((unmask_delay == 0)
+        || (*((time_t *)value) < time (NULL) - (unmask_delay * 60)))
+    {
+        weechat_hashtable_remove (hashtable, key);
+    }
+}
+
+/*
+ * Returns time of next check to perform on a server (reconnection, lag,
+ * away, autojoin, monitor, redirects, purge of data), 0 if there is nothing
+ * to check.
+ */
+
+time_t
+irc_server_timer_next_check (struct t_irc_server *server)
+{
+    struct t_irc_redirect *ptr_redirect;
+    time_t next_check, current_time, time_check;
+    int away_check;
+
+    next_check = 0;
+    current_time = time (NULL);
+
+#define IRC_SERVER_NEXT_CHECK(__time)                                   \
+    time_check = __time;                                                \
+    if ((next_check == 0) || (time_check < next_check))                 \
+        next_check = time_check;
+
+    /* reconnection pending */
+    if (!server->is_connected)
+    {
+        if (server->reconnect_start > 0)
+        {
+            IRC_SERVER_NEXT_CHECK(server->reconnect_start
+                                  + server->reconnect_delay);
+        }
+        return next_check;
+    }
+
+    /* lag check (when a ping is pending, lag is computed every second) */
+    if (server->lag_check_time.tv_sec != 0)
+    {
+        IRC_SERVER_NEXT_CHECK(current_time + 1);
+    }
+    else if (weechat_config_integer (irc_config_network_lag_check) > 0)
+    {
+        IRC_SERVER_NEXT_CHECK(server->lag_next_check);
+    }
+
+    /* away check */
+    away_check = IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK);
+    if (!server->cap_away_notify && (away_check > 0))
+    {
+        IRC_SERVER_NEXT_CHECK((server->last_away_check == 0) ?
+                              current_time :
+                              server->last_away_check + (away_check * 60));
+    }
+
+    /* autojoin (after command delay) */
+    if (server->command_time != 0)
+    {
+        IRC_SERVER_NEXT_CHECK(server->command_time +
+                              IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_COMMAND_DELAY));
+    }
+
+    /* MONITOR command */
+    if (server->monitor_time != 0)
+    {
+        IRC_SERVER_NEXT_CHECK(server->monitor_time);
+    }
+
+    /* timeout of redirects */
+    for (ptr_redirect = server->redirects; ptr_redirect;
+         ptr_redirect = ptr_redirect->next_redirect)
+    {
+        if (ptr_redirect->start_time > 0)
+        {
+            IRC_SERVER_NEXT_CHECK(ptr_redirect->start_time
+                                  + ptr_redirect->timeout + 1);
+        }
+    }
+
+    /* purge of some data (every 10 minutes) */
+    IRC_SERVER_NEXT_CHECK(server->last_data_purge + (60 * 10) + 1);
+
+#undef IRC_SERVER_NEXT_CHECK
+
+    return next_check;
 }
 
 /*
- * Callback called for each smart filtered join of a channel: deletes old
- * entries in the hashtable.
+ * Schedules the timer for checks on a server, according to the next check to
+ * perform (nothing is scheduled if there is nothing to check, for example if
+ * server is disconnected without automatic reconnection).
+ *
+ * If the timer is already scheduled before the next check, it is kept as-is
+ * (next check is computed again when timer is called).
  */
 
 void
-irc_server_check_join_smart_filtered_cb (void *data,
-                                         struct t_hashtable *hashtable,
-                                         const void *key, const void *value)
+irc_server_timer_schedule (struct t_irc_server *server)
 {
-    int unmask_delay;
+    time_t next_check, current_time;
 
-    /* make C compiler happy */
-    (void) data;
+    next_check = irc_server_timer_next_check (server);
+    if (next_check == 0)
+        return;
 
-    unmask_delay = weechat_config_integer (irc_config_look_smart_filter_join_unmask);
-    if ((unmask_delay == 0)
-        || (*((time_t *)value) < time (NULL) - (unmask_delay * 60)))
+    if (server->hook_timer_checks)
     {
-        weechat_hashtable_remove (hashtable, key);
+        if (server->timer_checks_time <= next_check)
+            return;
+        weechat_unhook (server->hook_timer_checks);
+        server->hook_timer_checks = NULL;
     }
+
+    current_time = time (NULL);
+    if (next_check <= current_time)
+        next_check = current_time + 1;
+
+    server->timer_checks_time = next_check;
+    server->hook_timer_checks = weechat_hook_timer (
+        (next_check - current_time) * 1000, 1, 1,
+        &irc_server_timer_cb, server);
 }
 
 /*
- * Timer called each second to perform some operations on servers.
+ * Timer called to perform some operations on a server; the timer is scheduled
+ * only when there is something to check (see function
+ * irc_server_timer_next_check).
  */
 
 int
@@ -2827,158 +3525,157 @@ irc_server_timer_cb (void *data, int remaining_calls)
     int away_check;
 
     /* make C compiler happy */
-    (void) data;
     (void) remaining_calls;
 
+    ptr_server = (struct t_irc_server *)data;
+    if (!ptr_server)
+        return WEECHAT_RC_ERROR;
+
+    ptr_server->hook_timer_checks = NULL;
+    ptr_server->timer_checks_time = 0;
+
     current_time = time (NULL);
 
-    for (ptr_server = irc_servers; ptr_server;
-         ptr_server = ptr_server->next_server)
+    /* check if reconnection is pending */
+    if ((!ptr_server->is_connected)
+        && (ptr_server->reconnect_start > 0)
+        && (current_time >= (ptr_server->reconnect_start + ptr_server->reconnect_delay)))
     {
-        /* check if reconnection is pending */
-        if ((!ptr_server->is_connected)
-            && (ptr_server->reconnect_start > 0)
-            && (current_time >= (ptr_server->reconnect_start + ptr_server->reconnect_delay)))
+        irc_server_reconnect (ptr_server);
+    }
+    else if (ptr_server->is_connected)
+    {
+        /* check for lag */
+        if ((weechat_config_integer (irc_config_network_lag_check) > 0)
+            && (ptr_server->lag_check_time.tv_sec == 0)
+            && (current_time >= ptr_server->lag_next_check))
         {
-            irc_server_reconnect (ptr_server);
+            irc_server_sendf (ptr_server, 0, NULL, "PING %s",
+                              (ptr_server->current_address) ?
+                              ptr_server->current_address : "weechat");
+            gettimeofday (&(ptr_server->lag_check_time), NULL);
+            ptr_server->lag = 0;
+            ptr_server->lag_last_refresh = 0;
         }
         else
         {
-            if (!ptr_server->is_connected)
-                continue;
-
-            /* send queued messages */
-            irc_server_outqueue_send (ptr_server);
-
-            /* check for lag */
-            if ((weechat_config_integer (irc_config_network_lag_check) > 0)
-                && (ptr_server->lag_check_time.tv_sec == 0)
-                && (current_time >= ptr_server->lag_next_check))
+            /* check away (only if lag check was not done) */
+            away_check = IRC_SERVER_OPTION_INTEGER(ptr_server, IRC_SERVER_OPTION_AWAY_CHECK);
+            if (!ptr_server->cap_away_notify
+                && (away_check > 0)
+                && ((ptr_server->last_away_check == 0)
+                    || (current_time >= ptr_server->last_away_check + (away_check * 60))))
             {
-                irc_server_sendf (ptr_server, 0, NULL, "PING %s",
-                                  (ptr_server->current_address) ?
-                                  ptr_server->current_address : "weechat");
-                gettimeofday (&(ptr_server->lag_check_time), NULL);
-                ptr_server->lag = 0;
-                ptr_server->lag_last_refresh = 0;
-            }
-            else
-            {
-                /* check away (only if lag check was not done) */
-                away_check = IRC_SERVER_OPTION_INTEGER(ptr_server, IRC_SERVER_OPTION_AWAY_CHECK);
-                if (!ptr_server->cap_away_notify
-                    && (away_check > 0)
-                    && ((ptr_server->last_away_check == 0)
-                        || (current_time >= ptr_server->last_away_check + (away_check * 60))))
-                {
-                    irc_server_check_away (ptr_server);
-                }
+                irc_server_check_away (ptr_server);
             }
+        }
+
+        /* check if it's time to autojoin channels (after command delay) */
+        if ((ptr_server->command_time != 0)
+            && (current_time >= ptr_server->command_time +
+                IRC_SERVER_OPTION_INTEGER(ptr_server, IRC_SERVER_OPTION_COMMAND_DELAY)))
+        {
+            irc_server_autojoin_channels (ptr_server);
+            ptr_server->command_time = 0;
+        }
+
+        /* check if it's time to send MONITOR command */
+        if ((ptr_server->monitor_time != 0)
+            && (current_time >= ptr_server->monitor_time))
+        {
+            if (ptr_server->monitor > 0)
+                irc_notify_send_monitor (ptr_server);
+            ptr_server->monitor_time = 0;
+        }
 
-            /* check if it's time to autojoin channels (after command delay) */
-            if ((ptr_server->command_time != 0)
-                && (current_time >= ptr_server->command_time +
-                    IRC_SERVER_OPTION_INTEGER(ptr_server, IRC_SERVER_OPTION_COMMAND_DELAY)))
+        /* compute lag */
+        if (ptr_server->lag_check_time.tv_sec != 0)
+        {
+            gettimeofday (&tv, NULL);
+            ptr_server->lag = (int) weechat_util_timeval_diff (&(ptr_server->lag_check_time),
+                                                               &tv);
+            /* refresh lag item if needed */
+            if (((ptr_server->lag_last_refresh == 0)
+                 || (current_time >= ptr_server->lag_last_refresh + weechat_config_integer (irc_config_network_lag_refresh_interval)))
+                && (ptr_server->lag >= weechat_config_integer (irc_config_network_lag_min_show)))
             {
-                irc_server_autojoin_channels (ptr_server);
-                ptr_server->command_time = 0;
+                ptr_server->lag_last_refresh = current_time;
+                weechat_bar_item_update ("lag");
             }
-
-            /* check if it's time to send MONITOR command */
-            if ((ptr_server->monitor_time != 0)
-                && (current_time >= ptr_server->monitor_time))
+            /* lag timeout? => disconnect */
+            if ((weechat_config_integer (irc_config_network_lag_reconnect) > 0)
+                && (ptr_server->lag >= weechat_config_integer (irc_config_network_lag_reconnect) * 1000))
             {
-                if (ptr_server->monitor > 0)
-                    irc_notify_send_monitor (ptr_server);
-                ptr_server->monitor_time = 0;
+                weechat_printf (ptr_server->buffer,
+                                _("%s%s: lag is high, reconnecting to "
+                                  "server %s%s%s"),
+                                weechat_prefix ("network"),
+                                IRC_PLUGIN_NAME,
+                                IRC_COLOR_CHAT_SERVER,
+                                ptr_server->name,
+                                IRC_COLOR_RESET);
+                irc_server_disconnect (ptr_server, 0, 1);
             }
-
-            /* compute lag */
-            if (ptr_server->lag_check_time.tv_sec != 0)
+            else
             {
-                gettimeofday (&tv, NULL);
-                ptr_server->lag = (int) weechat_util_timeval_diff (&(ptr_server->lag_check_time),
-                                                                   &tv);
-                /* refresh lag item if needed */
-                if (((ptr_server->lag_last_refresh == 0)
-                     || (current_time >= ptr_server->lag_last_refresh + weechat_config_integer (irc_config_network_lag_refresh_interval)))
-                    && (ptr_server->lag >= weechat_config_integer (irc_config_network_lag_min_show)))
+                /* stop lag counting if max lag is reached */
+                if ((weechat_config_integer (irc_config_network_lag_max) > 0)
+                    && (ptr_server->lag >= (weechat_config_integer (irc_config_network_lag_max) * 1000)))
                 {
+                    /* refresh lag item */
                     ptr_server->lag_last_refresh = current_time;
                     weechat_bar_item_update ("lag");
-                }
-                /* lag timeout? => disconnect */
-                if ((weechat_config_integer (irc_config_network_lag_reconnect) > 0)
-                    && (ptr_server->lag >= weechat_config_integer (irc_config_network_lag_reconnect) * 1000))
-                {
-                    weechat_printf (ptr_server->buffer,
-                                    _("%s%s: lag is high, reconnecting to "
-                                      "server %s%s%s"),
-                                    weechat_prefix ("network"),
-                                    IRC_PLUGIN_NAME,
-                                    IRC_COLOR_CHAT_SERVER,
-                                    ptr_server->name,
-                                    IRC_COLOR_RESET);
-                    irc_server_disconnect (ptr_server, 0, 1);
-                }
-                else
-                {
-                    /* stop lag counting if max lag is reached */
-                    if ((weechat_config_integer (irc_config_network_lag_max) > 0)
-                        && (ptr_server->lag >= (weechat_config_integer (irc_config_network_lag_max) * 1000)))
-                    {
-                        /* refresh lag item */
-                        ptr_server->lag_last_refresh = current_time;
-                        weechat_bar_item_update ("lag");
-
-                        /* schedule next lag check in 5 seconds */
-                        ptr_server->lag_check_time.tv_sec = 0;
-                        ptr_server->lag_check_time.tv_usec = 0;
-                        ptr_server->lag_next_check = time (NULL) +
-                            weechat_config_integer (irc_config_network_lag_check);
-                    }
+
+                    /* schedule next lag check in 5 seconds */
+                    ptr_server->lag_check_time.tv_sec = 0;
+                    ptr_server->lag_check_time.tv_usec = 0;
+                    ptr_server->lag_next_check = time (NULL) +
+                        weechat_config_integer (irc_config_network_lag_check);
                 }
             }
+        }
 
-            /* remove redirects if timeout occurs */
-            ptr_redirect = ptr_server->redirects;
-            while (ptr_redirect)
-            {
-                ptr_next_redirect = ptr_redirect->next_redirect;
-
-                if ((ptr_redirect->start_time > 0)
-                    && (ptr_redirect->start_time + ptr_redirect->timeout < current_time))
-                {
-                    irc_redirect_stop (ptr_redirect, "timeout");
-                }
+        /* remove redirects if timeout occurs */
+        ptr_redirect = ptr_server->redirects;
+        while (ptr_redirect)
+        {
+            ptr_next_redirect = ptr_redirect->next_redirect;
 
-                ptr_redirect = ptr_next_redirect;
+            if ((ptr_redirect->start_time > 0)
+                && (ptr_redirect->start_time + ptr_redirect->timeout < current_time))
+            {
+                irc_redirect_stop (ptr_redirect, "timeout");
             }
 
-            /* purge some data (every 10 minutes) */
-            if (current_time > ptr_server->last_data_purge + (60 * 10))
+            ptr_redirect = ptr_next_redirect;
+        }
+
+        /* purge some data (every 10 minutes) */
+        if (current_time > ptr_server->last_data_purge + (60 * 10))
+        {
+            weechat_hashtable_map (ptr_server->join_manual,
+                                   &irc_server_check_join_manual_cb,
+                                   NULL);
+            weechat_hashtable_map (ptr_server->join_noswitch,
+                                   &irc_server_check_join_noswitch_cb,
+                                   NULL);
+            for (ptr_channel = ptr_server->channels; ptr_channel;
+                 ptr_channel = ptr_channel->next_channel)
             {
-                weechat_hashtable_map (ptr_server->join_manual,
-                                       &irc_server_check_join_manual_cb,
-                                       NULL);
-                weechat_hashtable_map (ptr_server->join_noswitch,
-                                       &irc_server_check_join_noswitch_cb,
-                                       NULL);
-                for (ptr_channel = ptr_server->channels; ptr_channel;
-                     ptr_channel = ptr_channel->next_channel)
+                if (ptr_channel->join_smart_filtered)
                 {
-                    if (ptr_channel->join_smart_filtered)
-                    {
-                        weechat_hashtable_map (ptr_channel->join_smart_filtered,
-                                               &irc_server_check_join_smart_filtered_cb,
-                                               NULL);
-                    }
+                    weechat_hashtable_map (ptr_channel->join_smart_filtered,
+                                           &irc_server_check_join_smart_filtered_cb,
+                                           NULL);
                 }
-                ptr_server->last_data_purge = current_time;
             }
+            ptr_server->last_data_purge = current_time;
         }
     }
 
+    if (irc_server_valid (ptr_server))
+        irc_server_timer_schedule (ptr_server);
+
     return WEECHAT_RC_OK;
 }
 
@@ -3003,6 +3700,15 @@ irc_server_close_connection (struct t_irc_server *server)
         server->hook_timer_sasl = NULL;
     }
 
+    if (server->hook_timer_outqueue)
+    {
+        weechat_unhook (server->hook_timer_outqueue);
+        server->hook_timer_outqueue = NULL;
+    }
+
+    /* messages partially written are lost with the socket */
+    irc_server_outqueue_sending_free_all (server);
+
     if (server->hook_fd)
     {
         weechat_unhook (server->hook_fd);
@@ -3020,6 +3726,7 @@ irc_server_close_connection (struct t_irc_server *server)
         /* close SSL connection */
         if (server->ssl_connected)
         {
+            irc_server_ssl_session_save (server);
             if (server->sock != -1)
                 gnutls_bye (server->gnutls_sess, GNUTLS_SHUT_WR);
             gnutls_deinit (server->gnutls_sess);
@@ -3062,6 +3769,9 @@ irc_server_close_connection (struct t_irc_server *server)
     /* server is now disconnected */
     server->is_connected = 0;
     server->ssl_connected = 0;
+
+    /* a connection slot may be available for a pending server */
+    irc_server_connect_pending_schedule ();
 }
 
 /*
@@ -3071,7 +3781,7 @@ irc_server_close_connection (struct t_irc_server *server)
 void
 irc_server_reconnect_schedule (struct t_irc_server *server)
 {
-    int minutes, seconds;
+    int minutes, seconds, jitter, delay;
 
     if (IRC_SERVER_OPTION_BOOLEAN(server, IRC_SERVER_OPTION_AUTORECONNECT))
     {
@@ -3084,10 +3794,22 @@ irc_server_reconnect_schedule (struct t_irc_server *server)
             && (server->reconnect_delay > weechat_config_integer (irc_config_network_autoreconnect_delay_max)))
             server->reconnect_delay = weechat_config_integer (irc_config_network_autoreconnect_delay_max);
 
-        server->reconnect_start = time (NULL);
+        /*
+         * add a random delay, so that many servers disconnected at same time
+         * (for example after a network failure) do not reconnect together
+         * (the jitter is not part of the growing delay)
+         */
+        jitter = (server->reconnect_delay *
+                  weechat_config_integer (irc_config_network_autoreconnect_delay_jitter)) / 100;
+        if (jitter > 0)
+            jitter = rand () % (jitter + 1);
 
-        minutes = server->reconnect_delay / 60;
-        seconds = server->reconnect_delay % 60;
+        server->reconnect_start = time (NULL) + jitter;
+        irc_server_timer_schedule (server);
+
+        delay = server->reconnect_delay + jitter;
+        minutes = delay / 60;
+        seconds = delay % 60;
         if ((minutes > 0) && (seconds > 0))
         {
             weechat_printf (server->buffer,
@@ -3227,6 +3949,42 @@ irc_server_switch_address (struct t_irc_server *server, int connection)
     }
 }
 
+/*
+ * Adds connection time (since start of connection) in statistics of address
+ * family of IP address (IPv4 or IPv6).
+ */
+
+void
+irc_server_connect_stats_add (struct t_irc_server *server,
+                              const char *ip_address)
+{
+    struct timeval tv_now;
+    long time_ms;
+    int family;
+
+    if (!server || (server->connect_start.tv_sec == 0))
+        return;
+
+    gettimeofday (&tv_now, NULL);
+    time_ms = weechat_util_timeval_diff (&(server->connect_start), &tv_now);
+    server->connect_start.tv_sec = 0;
+    server->connect_start.tv_usec = 0;
+
+    family = (ip_address && strchr (ip_address, ':')) ?
+        IRC_SERVER_FAMILY_IPV6 : IRC_SERVER_FAMILY_IPV4;
+
+    server->connect_time_last[family] = time_ms;
+    if ((server->connect_count[family] == 0)
+        || (time_ms < server->connect_time_min[family]))
+    {
+        server->connect_time_min[family] = time_ms;
+    }
+    if (time_ms > server->connect_time_max[family])
+        server->connect_time_max[family] = time_ms;
+    server->connect_time_total[family] += time_ms;
+    server->connect_count[family]++;
+}
+
 /*
  * Reads connection status.
  */
@@ -3252,6 +4010,21 @@ irc_server_connect_cb (void *data, int status, int gnutls_rc, int sock,
             if (server->current_ip)
                 free (server->current_ip);
             server->current_ip = (ip_address) ? strdup (ip_address) : NULL;
+            irc_server_connect_stats_add (server, ip_address);
+#ifdef HAVE_GNUTLS
+            if (server->ssl_connected)
+            {
+                if (gnutls_session_is_resumed (server->gnutls_sess))
+                {
+                    server->ssl_handshakes_resumed++;
+                    weechat_printf (server->buffer,
+                                    _("%sgnutls: TLS session resumed"),
+                                    weechat_prefix ("network"));
+                }
+                else
+                    server->ssl_handshakes_full++;
+            }
+#endif
             weechat_printf (server->buffer,
                             _("%s%s: connected to %s/%d (%s)"),
                             weechat_prefix ("network"),
@@ -3682,7 +4455,7 @@ irc_server_gnutls_callback (void *data, gnutls_session_t tls_session,
     gnutls_datum_t filedatum;
     unsigned int i, cert_list_len, status;
     time_t cert_time;
-    char *cert_path0, *cert_path1, *cert_path2, *cert_str;
+    char *cert_path0, *cert_path1, *cert_path2, *cert_str, *ssl_server;
     const char *weechat_dir, *fingerprint;
     int rc, ret, fingerprint_match, hostname_match, cert_temp_init;
 #if LIBGNUTLS_VERSION_NUMBER >= 0x010706
@@ -4005,6 +4778,23 @@ irc_server_gnutls_callback (void *data, gnutls_session_t tls_session,
                 free (cert_path2);
         }
     }
+    else if (action == WEECHAT_HOOK_CONNECT_GNUTLS_CB_INIT_SESSION)
+    {
+        /* resume previous session (only with same server and options) */
+        if (server->ssl_session_data && server->ssl_session_server)
+        {
+            ssl_server = irc_server_ssl_session_server (server);
+            if (ssl_server
+                && (strcmp (ssl_server, server->ssl_session_server) == 0))
+            {
+                gnutls_session_set_data (tls_session,
+                                         server->ssl_session_data,
+                                         server->ssl_session_data_size);
+            }
+            if (ssl_server)
+                free (ssl_server);
+        }
+    }
 
 end:
     /* an error should stop the handshake unless the user doesn't care */
@@ -4021,18 +4811,46 @@ end:
 }
 #endif
 
+/*
+ * Returns number of servers with a connection in progress (connection with
+ * hook_connect or login not yet accepted by server).
+ */
+
+int
+irc_server_get_number_connecting ()
+{
+    struct t_irc_server *ptr_server;
+    int number;
+
+    number = 0;
+    for (ptr_server = irc_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        if (ptr_server->hook_connect
+            || ((ptr_server->sock != -1) && !ptr_server->is_connected))
+        {
+            number++;
+        }
+    }
+    return number;
+}
+
 /*
  * Connects to a server.
  *
+ * If too many connections are in progress (option
+ * irc.network.connection_max_concurrent), the connection is delayed until
+ * a connection slot is available.
+ *
  * Returns:
- *   1: OK
+ *   1: OK (connecting or connection pending)
  *   0: error
  */
 
 int
 irc_server_connect (struct t_irc_server *server)
 {
-    int length;
+    int length, max_connecting, num_connecting;
     char *option_name;
     struct t_config_option *proxy_type, *proxy_ipv6, *proxy_address, *proxy_port;
     const char *proxy, *str_proxy_type, *str_proxy_address;
@@ -4149,6 +4967,31 @@ irc_server_connect (struct t_irc_server *server)
         return 0;
     }
 #endif
+
+    /* close connection if opened */
+    irc_server_close_connection (server);
+
+    /* wait for a free slot if too many connections are in progress */
+    max_connecting = weechat_config_integer (irc_config_network_connection_max_concurrent);
+    if (max_connecting > 0)
+    {
+        num_connecting = irc_server_get_number_connecting ();
+        if (num_connecting >= max_connecting)
+        {
+            if (!server->connect_pending)
+            {
+                weechat_printf (server->buffer,
+                                _("%s%s: %d connections in progress, "
+                                  "connection to server delayed"),
+                                weechat_prefix ("network"),
+                                IRC_PLUGIN_NAME, num_connecting);
+            }
+            server->connect_pending = 1;
+            return 1;
+        }
+    }
+    server->connect_pending = 0;
+
     if (proxy_type)
     {
         weechat_printf (server->buffer,
@@ -4194,10 +5037,8 @@ irc_server_connect (struct t_irc_server *server)
                             " (SSL)" : "");
     }
 
-    /* close connection if opened */
-    irc_server_close_connection (server);
-
     /* init SSL if asked and connect */
+    gettimeofday (&(server->connect_start), NULL);
     server->ssl_connected = 0;
 #ifdef HAVE_GNUTLS
     if (IRC_SERVER_OPTION_BOOLEAN(server, IRC_SERVER_OPTION_SSL))
@@ -4253,6 +5094,77 @@ irc_server_reconnect (struct t_irc_server *server)
         irc_server_reconnect_schedule (server);
 }
 
+/*
+ * Callback for timer starting pending connections.
+ */
+
+int
+irc_server_connect_pending_cb (void *data, int remaining_calls)
+{
+    struct t_irc_server *ptr_server;
+    int max_connecting, num_connecting;
+
+    /* make C compiler happy */
+    (void) data;
+    (void) remaining_calls;
+
+    irc_server_hook_timer_connect_pending = NULL;
+
+    max_connecting = weechat_config_integer (irc_config_network_connection_max_concurrent);
+    num_connecting = irc_server_get_number_connecting ();
+
+    /* start pending connections, first servers first */
+    for (ptr_server = irc_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        if ((max_connecting > 0) && (num_connecting >= max_connecting))
+            break;
+        if (ptr_server->connect_pending)
+        {
+            ptr_server->connect_pending = 0;
+            if (irc_server_connect (ptr_server))
+            {
+                if (ptr_server->hook_connect)
+                    num_connecting++;
+            }
+            else
+                irc_server_reconnect_schedule (ptr_server);
+        }
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Schedules start of pending connections (if some servers are waiting for a
+ * connection slot).
+ *
+ * The connections are started by a timer (and not immediately), because this
+ * function is called when a connection is closed, possibly while connecting
+ * to another server.
+ */
+
+void
+irc_server_connect_pending_schedule ()
+{
+    struct t_irc_server *ptr_server;
+
+    if (irc_server_hook_timer_connect_pending)
+        return;
+
+    for (ptr_server = irc_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        if (ptr_server->connect_pending)
+        {
+            irc_server_hook_timer_connect_pending = weechat_hook_timer (
+                1, 0, 1,
+                &irc_server_connect_pending_cb, NULL);
+            return;
+        }
+    }
+}
+
 /*
  * Auto-connects to servers (called at startup).
  *
@@ -4323,6 +5235,7 @@ irc_server_disconnect (struct t_irc_server *server, int switch_address,
     }
 
     server->current_retry = 0;
+    server->connect_pending = 0;
 
     if (switch_address)
         irc_server_switch_address (server, 0);
@@ -4387,40 +5300,96 @@ irc_server_disconnect_all ()
 }
 
 /*
- * Autojoins (or auto-rejoins) channels.
+ * Builds the arguments of a JOIN to rejoin channels opened on server (after
+ * reconnection): channels with a key are first, so that all channels can be
+ * joined with a single JOIN (split later in messages of max 512 bytes).
+ *
+ * Note: result must be freed after use.
  */
 
-void
-irc_server_autojoin_channels (struct t_irc_server *server)
+char *
+irc_server_rejoin_arguments (struct t_irc_server *server)
 {
     struct t_irc_channel *ptr_channel;
-    char *autojoin;
+    char *arguments, *pos_keys;
+    int length, length_keys, with_key;
 
-    /* auto-join after disconnection (only rejoins opened channels) */
-    if (!server->disable_autojoin && server->reconnect_join && server->channels)
+    length = 1;
+    length_keys = 1;
+    for (ptr_channel = server->channels; ptr_channel;
+         ptr_channel = ptr_channel->next_channel)
+    {
+        if ((ptr_channel->type == IRC_CHANNEL_TYPE_CHANNEL)
+            && !ptr_channel->part)
+        {
+            length += strlen (ptr_channel->name) + 1;
+            if (ptr_channel->key)
+                length_keys += strlen (ptr_channel->key) + 1;
+        }
+    }
+    if (length == 1)
+        return NULL;
+
+    arguments = malloc (length + length_keys);
+    if (!arguments)
+        return NULL;
+    arguments[0] = '\0';
+    pos_keys = arguments + length;
+    pos_keys[0] = '\0';
+
+    /* first loop for channels with a key, second one for other channels */
+    for (with_key = 1; with_key >= 0; with_key--)
     {
         for (ptr_channel = server->channels; ptr_channel;
              ptr_channel = ptr_channel->next_channel)
         {
             if ((ptr_channel->type == IRC_CHANNEL_TYPE_CHANNEL)
-                && !ptr_channel->part)
+                && !ptr_channel->part
+                && ((ptr_channel->key) ? 1 : 0) == with_key)
             {
+                if (arguments[0])
+                    strcat (arguments, ",");
+                strcat (arguments, ptr_channel->name);
                 if (ptr_channel->key)
                 {
-                    irc_server_sendf (server,
-                                      IRC_SERVER_SEND_OUTQ_PRIO_HIGH, NULL,
-                                      "JOIN %s %s",
-                                      ptr_channel->name, ptr_channel->key);
-                }
-                else
-                {
-                    irc_server_sendf (server,
-                                      IRC_SERVER_SEND_OUTQ_PRIO_HIGH, NULL,
-                                      "JOIN %s",
-                                      ptr_channel->name);
+                    if (pos_keys[0])
+                        strcat (pos_keys, ",");
+                    strcat (pos_keys, ptr_channel->key);
                 }
             }
         }
+    }
+
+    if (pos_keys[0])
+    {
+        /* move keys just after channels */
+        length = strlen (arguments);
+        arguments[length] = ' ';
+        memmove (arguments + length + 1, pos_keys, strlen (pos_keys) + 1);
+    }
+
+    return arguments;
+}
+
+/*
+ * Autojoins (or auto-rejoins) channels.
+ */
+
+void
+irc_server_autojoin_channels (struct t_irc_server *server)
+{
+    char *autojoin, *arguments;
+
+    /* auto-join after disconnection (only rejoins opened channels) */
+    if (!server->disable_autojoin && server->reconnect_join && server->channels)
+    {
+        arguments = irc_server_rejoin_arguments (server);
+        if (arguments)
+        {
+            irc_server_sendf (server, IRC_SERVER_SEND_OUTQ_PRIO_HIGH, NULL,
+                              "JOIN %s", arguments);
+            free (arguments);
+        }
         server->reconnect_join = 0;
     }
     else
@@ -4841,14 +5810,29 @@ irc_server_hdata_server_cb (void *data, const char *hdata_name)
         WEECHAT_HDATA_VAR(struct t_irc_server, current_address, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, current_ip, STRING, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, current_port, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, connect_start, OTHER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, connect_count, INTEGER, 0, "2", NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, connect_time_last, LONG, 0, "2", NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, connect_time_min, LONG, 0, "2", NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, connect_time_max, LONG, 0, "2", NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, connect_time_total, LONG, 0, "2", NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, current_retry, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, sock, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, hook_connect, POINTER, 0, NULL, "hook");
         WEECHAT_HDATA_VAR(struct t_irc_server, hook_fd, POINTER, 0, NULL, "hook");
         WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_connection, POINTER, 0, NULL, "hook");
         WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_sasl, POINTER, 0, NULL, "hook");
+        WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_outqueue, POINTER, 0, NULL, "hook");
+        WEECHAT_HDATA_VAR(struct t_irc_server, hook_fd_write, POINTER, 0, NULL, "hook");
+        WEECHAT_HDATA_VAR(struct t_irc_server, hook_timer_checks, POINTER, 0, NULL, "hook");
+        WEECHAT_HDATA_VAR(struct t_irc_server, timer_checks_time, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, is_connected, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, ssl_connected, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, ssl_session_data, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, ssl_session_data_size, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, ssl_session_server, STRING, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, ssl_handshakes_full, INTEGER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, ssl_handshakes_resumed, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, disconnected, INTEGER, 0, NULL, NULL);
 #ifdef HAVE_GNUTLS
         WEECHAT_HDATA_VAR(struct t_irc_server, gnutls_sess, OTHER, 0, NULL, NULL);
@@ -4874,6 +5858,7 @@ irc_server_hdata_server_cb (void *data, const char *hdata_name)
         WEECHAT_HDATA_VAR(struct t_irc_server, monitor_time, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, reconnect_delay, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, reconnect_start, TIME, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, connect_pending, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, command_time, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, reconnect_join, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, disable_autojoin, INTEGER, 0, NULL, NULL);
@@ -4890,6 +5875,9 @@ irc_server_hdata_server_cb (void *data, const char *hdata_name)
         WEECHAT_HDATA_VAR(struct t_irc_server, last_data_purge, TIME, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, outqueue, POINTER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, last_outqueue, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, outqueue_sending, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, last_outqueue_sending, POINTER, 0, NULL, NULL);
+        WEECHAT_HDATA_VAR(struct t_irc_server, ssl_send_retry, INTEGER, 0, NULL, NULL);
         WEECHAT_HDATA_VAR(struct t_irc_server, redirects, POINTER, 0, NULL, "irc_redirect");
         WEECHAT_HDATA_VAR(struct t_irc_server, last_redirect, POINTER, 0, NULL, "irc_redirect");
         WEECHAT_HDATA_VAR(struct t_irc_server, notify_list, POINTER, 0, NULL, "irc_notify");
@@ -4913,6 +5901,10 @@ irc_server_hdata_server_cb (void *data, const char *hdata_name)
 /*
  * Adds a server in an infolist.
  *
+ * If upgrade == 1, the infolist is saved for /upgrade: sensitive data (like
+ * TLS session data, which contains the master secret) is added only in this
+ * case.
+ *
  * Returns:
  *   1: OK
  *   0: error
@@ -4920,9 +5912,13 @@ irc_server_hdata_server_cb (void *data, const char *hdata_name)
 
 int
 irc_server_add_to_infolist (struct t_infolist *infolist,
-                            struct t_irc_server *server)
+                            struct t_irc_server *server,
+                            int upgrade)
 {
     struct t_infolist_item *ptr_item;
+    char var_name[64];
+    const char *ptr_family;
+    int i;
 
     if (!infolist || !server)
         return 0;
@@ -5030,6 +6026,12 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
     if (!weechat_infolist_new_var_integer (ptr_item, "anti_flood_prio_low",
                                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW)))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "anti_flood_burst_high",
+                                           IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST_HIGH)))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "anti_flood_burst_low",
+                                           IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST_LOW)))
+        return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "away_check",
                                            IRC_SERVER_OPTION_INTEGER(server, IRC_SERVER_OPTION_AWAY_CHECK)))
         return 0;
@@ -5055,6 +6057,36 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "current_port", server->current_port))
         return 0;
+    for (i = 0; i < IRC_SERVER_NUM_FAMILIES; i++)
+    {
+        ptr_family = (i == IRC_SERVER_FAMILY_IPV6) ? "ipv6" : "ipv4";
+        snprintf (var_name, sizeof (var_name),
+                  "connect_%s_count", ptr_family);
+        if (!weechat_infolist_new_var_integer (ptr_item, var_name, server->connect_count[i]))
+            return 0;
+        snprintf (var_name, sizeof (var_name),
+                  "connect_%s_time_last", ptr_family);
+        if (!weechat_infolist_new_var_integer (ptr_item, var_name, (int)server->connect_time_last[i]))
+            return 0;
+        snprintf (var_name, sizeof (var_name),
+                  "connect_%s_time_min", ptr_family);
+        if (!weechat_infolist_new_var_integer (ptr_item, var_name, (int)server->connect_time_min[i]))
+            return 0;
+        snprintf (var_name, sizeof (var_name),
+                  "connect_%s_time_max", ptr_family);
+        if (!weechat_infolist_new_var_integer (ptr_item, var_name, (int)server->connect_time_max[i]))
+            return 0;
+        snprintf (var_name, sizeof (var_name),
+                  "connect_%s_time_avg", ptr_family);
+        if (!weechat_infolist_new_var_integer (ptr_item, var_name,
+                                               (server->connect_count[i] > 0) ?
+                                               (int)(server->connect_time_total[i] / server->connect_count[i]) : 0))
+            return 0;
+        snprintf (var_name, sizeof (var_name),
+                  "connect_%s_time_total", ptr_family);
+        if (!weechat_infolist_new_var_integer (ptr_item, var_name, (int)server->connect_time_total[i]))
+            return 0;
+    }
     if (!weechat_infolist_new_var_integer (ptr_item, "current_retry", server->current_retry))
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "sock", server->sock))
@@ -5063,6 +6095,17 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "ssl_connected", server->ssl_connected))
         return 0;
+    if (upgrade && server->ssl_session_data)
+    {
+        if (!weechat_infolist_new_var_buffer (ptr_item, "ssl_session_data", server->ssl_session_data, server->ssl_session_data_size))
+            return 0;
+    }
+    if (!weechat_infolist_new_var_string (ptr_item, "ssl_session_server", server->ssl_session_server))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "ssl_handshakes_full", server->ssl_handshakes_full))
+        return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "ssl_handshakes_resumed", server->ssl_handshakes_resumed))
+        return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "disconnected", server->disconnected))
         return 0;
     if (!weechat_infolist_new_var_string (ptr_item, "unterminated_message", server->unterminated_message))
@@ -5097,6 +6140,8 @@ irc_server_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_time (ptr_item, "reconnect_start", server->reconnect_start))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "connect_pending", server->connect_pending))
+        return 0;
     if (!weechat_infolist_new_var_time (ptr_item, "command_time", server->command_time))
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "reconnect_join", server->reconnect_join))
@@ -5352,6 +6397,20 @@ irc_server_print_log ()
         else
             weechat_log_printf ("  anti_flood_prio_low. : %d",
                                 weechat_config_integer (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW]));
+        /* anti_flood_burst_high */
+        if (weechat_config_option_is_null (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST_HIGH]))
+            weechat_log_printf ("  anti_flood_burst_high: null (%d)",
+                                IRC_SERVER_OPTION_INTEGER(ptr_server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST_HIGH));
+        else
+            weechat_log_printf ("  anti_flood_burst_high: %d",
+                                weechat_config_integer (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST_HIGH]));
+        /* anti_flood_burst_low */
+        if (weechat_config_option_is_null (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST_LOW]))
+            weechat_log_printf ("  anti_flood_burst_low : null (%d)",
+                                IRC_SERVER_OPTION_INTEGER(ptr_server, IRC_SERVER_OPTION_ANTI_FLOOD_BURST_LOW));
+        else
+            weechat_log_printf ("  anti_flood_burst_low : %d",
+                                weechat_config_integer (ptr_server->options[IRC_SERVER_OPTION_ANTI_FLOOD_BURST_LOW]));
         /* away_check */
         if (weechat_config_option_is_null (ptr_server->options[IRC_SERVER_OPTION_AWAY_CHECK]))
             weechat_log_printf ("  away_check . . . . . : null (%d)",
@@ -5399,14 +6458,43 @@ irc_server_print_log ()
         weechat_log_printf ("  current_address. . . : '%s'",  ptr_server->current_address);
         weechat_log_printf ("  current_ip . . . . . : '%s'",  ptr_server->current_ip);
         weechat_log_printf ("  current_port . . . . : %d",    ptr_server->current_port);
+        weechat_log_printf ("  connect_start. . . . : tv_sec:%d, tv_usec:%d",
+                            ptr_server->connect_start.tv_sec,
+                            ptr_server->connect_start.tv_usec);
+        weechat_log_printf ("  connect_count. . . . : %d/%d (IPv4/IPv6)",
+                            ptr_server->connect_count[IRC_SERVER_FAMILY_IPV4],
+                            ptr_server->connect_count[IRC_SERVER_FAMILY_IPV6]);
+        weechat_log_printf ("  connect_time_last. . : %ld/%ld",
+                            ptr_server->connect_time_last[IRC_SERVER_FAMILY_IPV4],
+                            ptr_server->connect_time_last[IRC_SERVER_FAMILY_IPV6]);
+        weechat_log_printf ("  connect_time_min . . : %ld/%ld",
+                            ptr_server->connect_time_min[IRC_SERVER_FAMILY_IPV4],
+                            ptr_server->connect_time_min[IRC_SERVER_FAMILY_IPV6]);
+        weechat_log_printf ("  connect_time_max . . : %ld/%ld",
+                            ptr_server->connect_time_max[IRC_SERVER_FAMILY_IPV4],
+                            ptr_server->connect_time_max[IRC_SERVER_FAMILY_IPV6]);
+        weechat_log_printf ("  connect_time_total . : %ld/%ld",
+                            ptr_server->connect_time_total[IRC_SERVER_FAMILY_IPV4],
+                            ptr_server->connect_time_total[IRC_SERVER_FAMILY_IPV6]);
         weechat_log_printf ("  current_retry. . . . : %d",    ptr_server->current_retry);
         weechat_log_printf ("  sock . . . . . . . . : %d",    ptr_server->sock);
         weechat_log_printf ("  hook_connect . . . . : 0x%lx", ptr_server->hook_connect);
         weechat_log_printf ("  hook_fd. . . . . . . : 0x%lx", ptr_server->hook_fd);
         weechat_log_printf ("  hook_timer_connection: 0x%lx", ptr_server->hook_timer_connection);
         weechat_log_printf ("  hook_timer_sasl. . . : 0x%lx", ptr_server->hook_timer_sasl);
+        weechat_log_printf ("  hook_timer_outqueue. : 0x%lx", ptr_server->hook_timer_outqueue);
+        weechat_log_printf ("  hook_fd_write. . . . : 0x%lx", ptr_server->hook_fd_write);
+        weechat_log_printf ("  hook_timer_checks. . : 0x%lx", ptr_server->hook_timer_checks);
+        weechat_log_printf ("  timer_checks_time. . : %ld",   ptr_server->timer_checks_time);
         weechat_log_printf ("  is_connected . . . . : %d",    ptr_server->is_connected);
         weechat_log_printf ("  ssl_connected. . . . : %d",    ptr_server->ssl_connected);
+        weechat_log_printf ("  ssl_session_data . . : 0x%lx (size: %d)",
+                            ptr_server->ssl_session_data,
+                            ptr_server->ssl_session_data_size);
+        weechat_log_printf ("  ssl_session_server . : '%s'",  ptr_server->ssl_session_server);
+        weechat_log_printf ("  ssl_handshakes . . . : %d full, %d resumed",
+                            ptr_server->ssl_handshakes_full,
+                            ptr_server->ssl_handshakes_resumed);
         weechat_log_printf ("  disconnected . . . . : %d",    ptr_server->disconnected);
 #ifdef HAVE_GNUTLS
         weechat_log_printf ("  gnutls_sess. . . . . : 0x%lx", ptr_server->gnutls_sess);
@@ -5432,6 +6520,7 @@ irc_server_print_log ()
         weechat_log_printf ("  monitor_time . . . . : %ld",   ptr_server->monitor_time);
         weechat_log_printf ("  reconnect_delay. . . : %d",    ptr_server->reconnect_delay);
         weechat_log_printf ("  reconnect_start. . . : %ld",   ptr_server->reconnect_start);
+        weechat_log_printf ("  connect_pending. . . : %d",    ptr_server->connect_pending);
         weechat_log_printf ("  command_time . . . . : %ld",   ptr_server->command_time);
         weechat_log_printf ("  reconnect_join . . . : %d",    ptr_server->reconnect_join);
         weechat_log_printf ("  disable_autojoin . . : %d",    ptr_server->disable_autojoin);
@@ -5446,6 +6535,12 @@ irc_server_print_log ()
         weechat_log_printf ("  lag_last_refresh . . : %ld",   ptr_server->lag_last_refresh);
         weechat_log_printf ("  cmd_list_regexp. . . : 0x%lx", ptr_server->cmd_list_regexp);
         weechat_log_printf ("  last_user_message. . : %ld",   ptr_server->last_user_message);
+        weechat_log_printf ("  anti_flood_credit. . : %ld/%ld",
+                            ptr_server->anti_flood_credit[0],
+                            ptr_server->anti_flood_credit[1]);
+        weechat_log_printf ("  anti_flood_refill. . : tv_sec:%d, tv_usec:%d",
+                            ptr_server->anti_flood_refill.tv_sec,
+                            ptr_server->anti_flood_refill.tv_usec);
         weechat_log_printf ("  last_away_check. . . : %ld",   ptr_server->last_away_check);
         weechat_log_printf ("  last_data_purge. . . : %ld",   ptr_server->last_data_purge);
         for (i = 0; i < IRC_SERVER_NUM_OUTQUEUES_PRIO; i++)
@@ -5453,6 +6548,9 @@ irc_server_print_log ()
             weechat_log_printf ("  outqueue[%02d] . . . . : 0x%lx", i, ptr_server->outqueue[i]);
             weechat_log_printf ("  last_outqueue[%02d]. . : 0x%lx", i, ptr_server->last_outqueue[i]);
         }
+        weechat_log_printf ("  outqueue_sending . . : 0x%lx", ptr_server->outqueue_sending);
+        weechat_log_printf ("  last_outqueue_sending: 0x%lx", ptr_server->last_outqueue_sending);
+        weechat_log_printf ("  ssl_send_retry . . . : %d",    ptr_server->ssl_send_retry);
         weechat_log_printf ("  redirects. . . . . . : 0x%lx", ptr_server->redirects);
         weechat_log_printf ("  last_redirect. . . . : 0x%lx", ptr_server->last_redirect);
         weechat_log_printf ("  notify_list. . . . . : 0x%lx", ptr_server->notify_list);
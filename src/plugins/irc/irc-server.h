@@ -64,6 +64,8 @@ enum t_irc_server_option
     IRC_SERVER_OPTION_CONNECTION_TIMEOUT,   /* timeout for connection        */
     IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_HIGH, /* anti-flood (high priority)    */
     IRC_SERVER_OPTION_ANTI_FLOOD_PRIO_LOW,  /* anti-flood (low priority)     */
+    IRC_SERVER_OPTION_ANTI_FLOOD_BURST_HIGH, /* anti-flood burst (high prio) */
+    IRC_SERVER_OPTION_ANTI_FLOOD_BURST_LOW, /* anti-flood burst (low prio)   */
     IRC_SERVER_OPTION_AWAY_CHECK,           /* delay between away checks     */
     IRC_SERVER_OPTION_AWAY_CHECK_MAX_NICKS, /* max nicks for away check      */
     IRC_SERVER_OPTION_DEFAULT_MSG_KICK,     /* default kick message          */
@@ -102,11 +104,19 @@ enum t_irc_server_option
 /* number of queues for sending messages */
 #define IRC_SERVER_NUM_OUTQUEUES_PRIO 2
 
+/* max number of queued messages sent with a single write to the socket */
+#define IRC_SERVER_OUTQUEUE_MAX_BATCH 32
+
 /* flags for irc_server_sendf() */
 #define IRC_SERVER_SEND_OUTQ_PRIO_HIGH   1
 #define IRC_SERVER_SEND_OUTQ_PRIO_LOW    2
 #define IRC_SERVER_SEND_RETURN_HASHTABLE 4
 
+/* address families for connection statistics */
+#define IRC_SERVER_FAMILY_IPV4 0
+#define IRC_SERVER_FAMILY_IPV6 1
+#define IRC_SERVER_NUM_FAMILIES 2
+
 /* casemapping (string comparisons for nicks/channels) */
 enum t_irc_server_casemapping
 {
@@ -127,6 +137,7 @@ struct t_irc_outqueue
     int modified;                         /* msg was modified by modifier(s) */
     char *tags;                           /* tags (used by Relay plugin)     */
     struct t_irc_redirect *redirect;      /* command redirection             */
+    int sent;                             /* bytes already written to socket */
     struct t_irc_outqueue *next_outqueue; /* link to next msg in queue       */
     struct t_irc_outqueue *prev_outqueue; /* link to prev msg in queue       */
 };
@@ -149,6 +160,12 @@ struct t_irc_server
     char *current_address;          /* current address                       */
     char *current_ip;               /* current IP address                    */
     int current_port;               /* current port                          */
+    struct timeval connect_start;   /* start of connection (for statistics)  */
+    int connect_count[2];           /* number of connections (IPv4/IPv6)     */
+    long connect_time_last[2];      /* last connection time (ms, IPv4/IPv6)  */
+    long connect_time_min[2];       /* min connection time (ms, IPv4/IPv6)   */
+    long connect_time_max[2];       /* max connection time (ms, IPv4/IPv6)   */
+    long connect_time_total[2];     /* sum of connection times (for average) */
     int current_retry;              /* current retry count (increment if a   */
                                     /* connected server fails in any way)    */
     int sock;                       /* socket for server                     */
@@ -156,9 +173,19 @@ struct t_irc_server
     struct t_hook *hook_fd;         /* hook for server socket                */
     struct t_hook *hook_timer_connection; /* timer for connection            */
     struct t_hook *hook_timer_sasl; /* timer for SASL authentication         */
+    struct t_hook *hook_timer_outqueue; /* timer to flush queued messages    */
+    struct t_hook *hook_fd_write;   /* hook for socket (write), only if some */
+                                    /* message is partially written          */
+    struct t_hook *hook_timer_checks; /* timer for checks (lag, away, ...)   */
+    time_t timer_checks_time;       /* time of next call to checks timer     */
     int is_connected;               /* 1 if WeeChat is connected to server   */
     int ssl_connected;              /* = 1 if connected with SSL             */
     int disconnected;               /* 1 if server has been disconnected     */
+    char *ssl_session_data;         /* TLS session data (to resume session)  */
+    int ssl_session_data_size;      /* size of TLS session data              */
+    char *ssl_session_server;       /* server/options of TLS session data    */
+    int ssl_handshakes_full;        /* number of full TLS handshakes         */
+    int ssl_handshakes_resumed;     /* number of resumed TLS handshakes      */
 #ifdef HAVE_GNUTLS
     gnutls_session_t gnutls_sess;   /* gnutls session (only if SSL is used)  */
     gnutls_x509_crt_t tls_cert;     /* certificate used if ssl_cert is set   */
@@ -186,6 +213,7 @@ struct t_irc_server
     time_t monitor_time;            /* time for monitoring nicks (on connect)*/
     int reconnect_delay;            /* current reconnect delay (growing)     */
     time_t reconnect_start;         /* this time + delay = reconnect time    */
+    int connect_pending;            /* 1 if waiting for a connection slot    */
     time_t command_time;            /* this time + command_delay = time to   */
                                     /* autojoin channels                     */
     int reconnect_join;             /* 1 if channels opened to rejoin        */
@@ -199,11 +227,17 @@ struct t_irc_server
     time_t lag_last_refresh;        /* last refresh of lag item              */
     regex_t *cmd_list_regexp;       /* compiled Regular Expression for /list */
     time_t last_user_message;       /* time of last user message (anti flood)*/
+    long anti_flood_credit[2];      /* anti-flood token bucket (credit in ms)*/
+    struct timeval anti_flood_refill; /* last refill of anti-flood buckets   */
     time_t last_away_check;         /* time of last away check on server     */
     time_t last_data_purge;         /* time of last purge (some hashtables)  */
     struct t_irc_outqueue *outqueue[2];      /* queue for outgoing messages  */
                                              /* with 2 priorities (high/low) */
     struct t_irc_outqueue *last_outqueue[2]; /* last outgoing message        */
+    struct t_irc_outqueue *outqueue_sending; /* msgs being written to socket */
+                                             /* (first one maybe partially)  */
+    struct t_irc_outqueue *last_outqueue_sending; /* last msg being written  */
+    int ssl_send_retry;                      /* TLS record size to resend    */
     struct t_irc_redirect *redirects;        /* command redirections         */
     struct t_irc_redirect *last_redirect;    /* last command redirection     */
     struct t_irc_notify *notify_list;        /* list of notify               */
@@ -295,11 +329,15 @@ extern void irc_server_msgq_flush ();
 extern void irc_server_set_buffer_title (struct t_irc_server *server);
 extern struct t_gui_buffer *irc_server_create_buffer (struct t_irc_server *server);
 extern int irc_server_connect (struct t_irc_server *server);
+extern int irc_server_get_number_connecting ();
+extern void irc_server_connect_pending_schedule ();
 extern void irc_server_auto_connect (int auto_connect);
 extern void irc_server_autojoin_channels ();
 extern int irc_server_recv_cb (void *data, int fd);
 extern int irc_server_timer_sasl_cb (void *data, int remaining_calls);
+extern void irc_server_timer_schedule (struct t_irc_server *server);
 extern int irc_server_timer_cb (void *data, int remaining_calls);
+extern void irc_server_outqueue_schedule (struct t_irc_server *server);
 extern void irc_server_outqueue_free_all (struct t_irc_server *server,
                                           int priority);
 extern int irc_server_get_channel_count (struct t_irc_server *server);
@@ -324,7 +362,8 @@ extern int irc_server_xfer_send_accept_resume_cb (void *data, const char *signal
 extern struct t_hdata *irc_server_hdata_server_cb (void *data,
                                                    const char *hdata_name);
 extern int irc_server_add_to_infolist (struct t_infolist *infolist,
-                                       struct t_irc_server *server);
+                                       struct t_irc_server *server,
+                                       int upgrade);
 extern void irc_server_print_log ();
 
 #endif /* WEECHAT_IRC_SERVER_H */
@@ -69,7 +69,7 @@ irc_upgrade_save_all_data (struct t_upgrade_file *upgrade_file)
         infolist = weechat_infolist_new ();
         if (!infolist)
             return 0;
-        if (!irc_server_add_to_infolist (infolist, ptr_server))
+        if (!irc_server_add_to_infolist (infolist, ptr_server, 1))
         {
             weechat_infolist_free (infolist);
             return 0;
@@ -287,9 +287,9 @@ irc_upgrade_read_cb (void *data,
     int flags, sock, size, i, index, nicks_count, num_items;
     long number;
     time_t join_time;
-    char *buf, option_name[64], **nicks, *nick_join, *pos, *error;
+    char *buf, option_name[64], var_name[64], **nicks, *nick_join, *pos, *error;
     char **items;
-    const char *buffer_name, *str, *nick;
+    const char *buffer_name, *str, *nick, *ptr_family;
     struct t_irc_nick *ptr_nick;
     struct t_irc_redirect *ptr_redirect;
     struct t_irc_notify *ptr_notify;
@@ -340,6 +340,25 @@ irc_upgrade_read_cb (void *data,
                     str = weechat_infolist_string (infolist, "current_ip");
                     if (str)
                         irc_upgrade_current_server->current_ip = strdup (str);
+                    for (i = 0; i < IRC_SERVER_NUM_FAMILIES; i++)
+                    {
+                        ptr_family = (i == IRC_SERVER_FAMILY_IPV6) ? "ipv6" : "ipv4";
+                        snprintf (var_name, sizeof (var_name),
+                                  "connect_%s_count", ptr_family);
+                        irc_upgrade_current_server->connect_count[i] = weechat_infolist_integer (infolist, var_name);
+                        snprintf (var_name, sizeof (var_name),
+                                  "connect_%s_time_last", ptr_family);
+                        irc_upgrade_current_server->connect_time_last[i] = weechat_infolist_integer (infolist, var_name);
+                        snprintf (var_name, sizeof (var_name),
+                                  "connect_%s_time_min", ptr_family);
+                        irc_upgrade_current_server->connect_time_min[i] = weechat_infolist_integer (infolist, var_name);
+                        snprintf (var_name, sizeof (var_name),
+                                  "connect_%s_time_max", ptr_family);
+                        irc_upgrade_current_server->connect_time_max[i] = weechat_infolist_integer (infolist, var_name);
+                        snprintf (var_name, sizeof (var_name),
+                                  "connect_%s_time_total", ptr_family);
+                        irc_upgrade_current_server->connect_time_total[i] = weechat_infolist_integer (infolist, var_name);
+                    }
                     sock = weechat_infolist_integer (infolist, "sock");
                     if (sock >= 0)
                     {
@@ -351,6 +370,21 @@ irc_upgrade_read_cb (void *data,
                     }
                     irc_upgrade_current_server->is_connected = weechat_infolist_integer (infolist, "is_connected");
                     irc_upgrade_current_server->ssl_connected = weechat_infolist_integer (infolist, "ssl_connected");
+                    buf = weechat_infolist_buffer (infolist, "ssl_session_data", &size);
+                    if (buf && (size > 0))
+                    {
+                        irc_upgrade_current_server->ssl_session_data = malloc (size);
+                        if (irc_upgrade_current_server->ssl_session_data)
+                        {
+                            memcpy (irc_upgrade_current_server->ssl_session_data, buf, size);
+                            irc_upgrade_current_server->ssl_session_data_size = size;
+                            str = weechat_infolist_string (infolist, "ssl_session_server");
+                            if (str)
+                                irc_upgrade_current_server->ssl_session_server = strdup (str);
+                        }
+                    }
+                    irc_upgrade_current_server->ssl_handshakes_full = weechat_infolist_integer (infolist, "ssl_handshakes_full");
+                    irc_upgrade_current_server->ssl_handshakes_resumed = weechat_infolist_integer (infolist, "ssl_handshakes_resumed");
                     irc_upgrade_current_server->disconnected = weechat_infolist_integer (infolist, "disconnected");
                     str = weechat_infolist_string (infolist, "unterminated_message");
                     if (str)
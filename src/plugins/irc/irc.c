@@ -53,8 +53,6 @@ WEECHAT_PLUGIN_LICENSE(WEECHAT_LICENSE);
 
 struct t_weechat_plugin *weechat_irc_plugin = NULL;
 
-struct t_hook *irc_hook_timer = NULL;
-
 int irc_signal_upgrade_received = 0;   /* signal "upgrade" received ?       */
 
 
@@ -157,6 +155,7 @@ int
 weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
 {
     int i, auto_connect, upgrading;
+    struct t_irc_server *ptr_server;
 
     weechat_plugin = plugin;
 
@@ -240,8 +239,12 @@ weechat_plugin_init (struct t_weechat_plugin *plugin, int argc, char *argv[])
         irc_server_auto_connect (auto_connect);
     }
 
-    irc_hook_timer = weechat_hook_timer (1 * 1000, 0, 0,
-                                         &irc_server_timer_cb, NULL);
+    /* schedule checks on servers (reconnection, lag, ...) */
+    for (ptr_server = irc_servers; ptr_server;
+         ptr_server = ptr_server->next_server)
+    {
+        irc_server_timer_schedule (ptr_server);
+    }
 
     return WEECHAT_RC_OK;
 }
@@ -256,9 +259,6 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
     /* make C compiler happy */
     (void) plugin;
 
-    if (irc_hook_timer)
-        weechat_unhook (irc_hook_timer);
-
     if (irc_signal_upgrade_received)
     {
         irc_config_write (1);
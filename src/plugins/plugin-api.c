@@ -36,10 +36,12 @@
 
 #include "../core/weechat.h"
 #include "../core/wee-config.h"
+#include "../core/wee-debug.h"
 #include "../core/wee-hashtable.h"
 #include "../core/wee-hook.h"
 #include "../core/wee-infolist.h"
 #include "../core/wee-input.h"
+#include "../core/wee-memory.h"
 #include "../core/wee-proxy.h"
 #include "../core/wee-string.h"
 #include "../core/wee-url.h"
@@ -277,6 +279,22 @@ plugin_api_command (struct t_weechat_plugin *plugin,
         free (command2);
 }
 
+/*
+ * Adds bytes/objects to a memory counter of plugin (values can be negative,
+ * when memory is freed).
+ */
+
+void
+plugin_api_memory_add (struct t_weechat_plugin *plugin, const char *category,
+                       long long bytes, long objects)
+{
+    if (!plugin || !category)
+        return;
+
+    memory_add_custom (memory_owner_get (plugin->name), category,
+                       bytes, objects);
+}
+
 /*
  * Modifier to decode ANSI colors.
  */
@@ -805,6 +823,32 @@ plugin_api_infolist_get_internal (void *data, const char *infolist_name,
             return ptr_infolist;
         }
     }
+    else if (string_strcasecmp (infolist_name, "main_loop") == 0)
+    {
+        ptr_infolist = infolist_new ();
+        if (ptr_infolist)
+        {
+            if (!debug_main_loop_add_to_infolist (ptr_infolist))
+            {
+                infolist_free (ptr_infolist);
+                return NULL;
+            }
+            return ptr_infolist;
+        }
+    }
+    else if (string_strcasecmp (infolist_name, "memory") == 0)
+    {
+        ptr_infolist = infolist_new ();
+        if (ptr_infolist)
+        {
+            if (!memory_add_to_infolist (ptr_infolist))
+            {
+                infolist_free (ptr_infolist);
+                return NULL;
+            }
+            return ptr_infolist;
+        }
+    }
     else if (string_strcasecmp (infolist_name, "nicklist") == 0)
     {
         /* invalid buffer pointer ? */
@@ -1259,6 +1303,18 @@ plugin_api_init ()
                    NULL,
                    NULL,
                    &plugin_api_infolist_get_internal, NULL);
+    hook_infolist (NULL, "main_loop",
+                   N_("durations of main loop iterations (histograms by "
+                      "phase) and stalls detected"),
+                   NULL,
+                   NULL,
+                   &plugin_api_infolist_get_internal, NULL);
+    hook_infolist (NULL, "memory",
+                   N_("memory counters (bytes and objects allocated) by "
+                      "owner (core, plugin or plugin/script) and category"),
+                   NULL,
+                   NULL,
+                   &plugin_api_infolist_get_internal, NULL);
     hook_infolist (NULL, "nicklist", N_("nicks in nicklist for a buffer"),
                    N_("buffer pointer"),
                    N_("nick_xxx or group_xxx to get only nick/group xxx "
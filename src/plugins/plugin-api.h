@@ -56,6 +56,11 @@ extern const char *plugin_api_color (const char *color_name);
 extern void plugin_api_command (struct t_weechat_plugin *plugin,
                                 struct t_gui_buffer *buffer, const char *command);
 
+/* memory */
+extern void plugin_api_memory_add (struct t_weechat_plugin *plugin,
+                                   const char *category,
+                                   long long bytes, long objects);
+
 /* infolist */
 extern int plugin_api_infolist_next (struct t_infolist *infolist);
 extern int plugin_api_infolist_prev (struct t_infolist *infolist);
@@ -37,6 +37,7 @@
 
 #include "../core/weechat.h"
 #include "../core/wee-config.h"
+#include "../core/wee-debug.h"
 #include "../core/wee-eval.h"
 #include "../core/wee-hashtable.h"
 #include "../core/wee-hdata.h"
@@ -566,6 +567,7 @@ plugin_load (const char *filename, int argc, char **argv)
         new_plugin->util_timeval_add = &util_timeval_add;
         new_plugin->util_get_time_string = &util_get_time_string;
         new_plugin->util_version_number = &util_version_number;
+        new_plugin->memory_add = &plugin_api_memory_add;
 
         new_plugin->list_new = &weelist_new;
         new_plugin->list_add = &weelist_add;
@@ -647,6 +649,7 @@ plugin_load (const char *filename, int argc, char **argv)
         new_plugin->printf_date_tags = &gui_chat_printf_date_tags;
         new_plugin->printf_y = &gui_chat_printf_y;
         new_plugin->log_printf = &log_printf;
+        new_plugin->trace_event = &debug_trace_plugin_event;
 
         new_plugin->hook_command = &hook_command;
         new_plugin->hook_command_run = &hook_command_run;
@@ -671,6 +674,7 @@ plugin_load (const char *filename, int argc, char **argv)
         new_plugin->hook_infolist = &hook_infolist;
         new_plugin->hook_hdata = &hook_hdata;
         new_plugin->hook_focus = &hook_focus;
+        new_plugin->hook_thread = &hook_thread;
         new_plugin->hook_set = &hook_set;
         new_plugin->unhook = &unhook;
         new_plugin->unhook_all = &unhook_all_plugin;
@@ -249,6 +249,48 @@ relay_irc_sendf (struct t_relay_client *client, const char *format, ...)
     free (vbuffer);
 }
 
+/*
+ * Sends formatted data received by a signal to client.
+ *
+ * If backlogs are being sent to client, the message is held and sent after
+ * the backlogs (so that the client receives lines in the same order as they
+ * were displayed in buffers).
+ */
+
+void
+relay_irc_sendf_live (struct t_relay_client *client, const char *format, ...)
+{
+    struct t_relay_irc_held_message *new_message;
+
+    if (!client)
+        return;
+
+    weechat_va_format (format);
+    if (!vbuffer)
+        return;
+
+    if (!RELAY_IRC_DATA(client, backlogs))
+    {
+        relay_irc_sendf (client, "%s", vbuffer);
+        free (vbuffer);
+        return;
+    }
+
+    new_message = malloc (sizeof (*new_message));
+    if (!new_message)
+    {
+        free (vbuffer);
+        return;
+    }
+    new_message->message = vbuffer;
+    new_message->next_message = NULL;
+    if (RELAY_IRC_DATA(client, last_held_message))
+        (RELAY_IRC_DATA(client, last_held_message))->next_message = new_message;
+    else
+        RELAY_IRC_DATA(client, held_messages) = new_message;
+    RELAY_IRC_DATA(client, last_held_message) = new_message;
+}
+
 /*
  * Callback for signal "irc_in2".
  *
@@ -306,10 +348,10 @@ relay_irc_signal_irc_in2_cb (void *data, const char *signal,
             && (weechat_strcasecmp (irc_command, "ping") != 0)
             && (weechat_strcasecmp (irc_command, "pong") != 0))
         {
-            relay_irc_sendf (client, ":%s %s %s",
-                             (irc_host && irc_host[0]) ? irc_host : RELAY_IRC_DATA(client, address),
-                             irc_command,
-                             irc_args);
+            relay_irc_sendf_live (client, ":%s %s %s",
+                                  (irc_host && irc_host[0]) ? irc_host : RELAY_IRC_DATA(client, address),
+                                  irc_command,
+                                  irc_args);
         }
 
         weechat_hashtable_free (hash_parsed);
@@ -451,12 +493,12 @@ relay_irc_signal_irc_outtags_cb (void *data, const char *signal,
                 host = weechat_infolist_string (infolist_nick, "host");
 
             /* send message to client */
-            relay_irc_sendf (client,
-                             ":%s%s%s %s",
-                             RELAY_IRC_DATA(client, nick),
-                             (host && host[0]) ? "!" : "",
-                             (host && host[0]) ? host : "",
-                             ptr_message);
+            relay_irc_sendf_live (client,
+                                  ":%s%s%s %s",
+                                  RELAY_IRC_DATA(client, nick),
+                                  (host && host[0]) ? "!" : "",
+                                  (host && host[0]) ? host : "",
+                                  ptr_message);
 
             if (infolist_nick)
                 weechat_infolist_free (infolist_nick);
@@ -574,6 +616,9 @@ relay_irc_hsignal_irc_redir_cb (void *data, const char *signal,
  *   - host (without colors)
  *   - message (without colors).
  *
+ * Argument self_nick is the nick on buffer (local variable "nick"), used to
+ * ignore join/part/quit from self nick (can be NULL).
+ *
  * Arguments hdata_line_data and line_data must be non NULL, the other arguments
  * can be NULL.
  *
@@ -582,7 +627,7 @@ relay_irc_hsignal_irc_redir_cb (void *data, const char *signal,
 
 void
 relay_irc_get_line_info (struct t_relay_client *client,
-                         struct t_gui_buffer *buffer,
+                         const char *self_nick,
                          struct t_hdata *hdata_line_data, void *line_data,
                          int *irc_command, int *irc_action, time_t *date,
                          const char **nick, const char **nick1,
@@ -591,8 +636,8 @@ relay_irc_get_line_info (struct t_relay_client *client,
 {
     int i, num_tags, command, action, all_tags, length;
     char str_tag[256], *pos, *pos2, *message_no_color, str_time[256];
-    const char *ptr_tag, *ptr_message, *ptr_nick, *ptr_nick1, *ptr_nick2;
-    const char *localvar_nick, *time_format;
+    const char **tags_array, *ptr_tag, *ptr_message, *ptr_nick, *ptr_nick1;
+    const char *ptr_nick2, *time_format;
     time_t msg_date;
     struct tm *tm;
 
@@ -615,13 +660,14 @@ relay_irc_get_line_info (struct t_relay_client *client,
     if (message)
         *message = NULL;
 
-    msg_date = weechat_hdata_time (hdata_line_data, line_data, "date");
     num_tags = weechat_hdata_get_var_array_size (hdata_line_data, line_data,
                                                  "tags_array");
+    tags_array = weechat_hdata_pointer (hdata_line_data, line_data,
+                                        "tags_array");
     ptr_message = weechat_hdata_pointer (hdata_line_data, line_data, "message");
 
     /* no tag found, or no message? just exit */
-    if ((num_tags <= 0) || !ptr_message)
+    if ((num_tags <= 0) || !tags_array || !ptr_message)
         return;
 
     command = -1;
@@ -629,28 +675,40 @@ relay_irc_get_line_info (struct t_relay_client *client,
     ptr_nick = NULL;
     ptr_nick1 = NULL;
     ptr_nick2 = NULL;
-    all_tags = weechat_hashtable_has_key (relay_config_hashtable_irc_backlog_tags,
-                                          "*");
+    all_tags = -1;
     for (i = 0; i < num_tags; i++)
     {
-        snprintf (str_tag, sizeof (str_tag), "%d|tags_array", i);
-        ptr_tag = weechat_hdata_string (hdata_line_data, line_data, str_tag);
-        if (ptr_tag)
+        ptr_tag = tags_array[i];
+        if (!ptr_tag)
+            continue;
+        if (strncmp (ptr_tag, "nick_", 5) == 0)
+            ptr_nick = ptr_tag + 5;
+        else if (strncmp (ptr_tag, "irc_", 4) == 0)
         {
-            if (strcmp (ptr_tag, "irc_action") == 0)
+            if (strcmp (ptr_tag + 4, "action") == 0)
                 action = 1;
-            else if (strncmp (ptr_tag, "nick_", 5) == 0)
-                ptr_nick = ptr_tag + 5;
-            else if (strncmp (ptr_tag, "irc_nick1_", 10) == 0)
+            else if (strncmp (ptr_tag + 4, "nick1_", 6) == 0)
                 ptr_nick1 = ptr_tag + 10;
-            else if (strncmp (ptr_tag, "irc_nick2_", 10) == 0)
+            else if (strncmp (ptr_tag + 4, "nick2_", 6) == 0)
                 ptr_nick2 = ptr_tag + 10;
-            else if ((command < 0)
-                     && (all_tags
-                         || (weechat_hashtable_has_key (relay_config_hashtable_irc_backlog_tags,
-                                                        ptr_tag))))
+            else if (command < 0)
             {
+                /* check tag of command first, then allowed tags (slower) */
                 command = relay_irc_search_backlog_commands_tags (ptr_tag);
+                if (command >= 0)
+                {
+                    if (all_tags < 0)
+                    {
+                        all_tags = weechat_hashtable_has_key (relay_config_hashtable_irc_backlog_tags,
+                                                              "*");
+                    }
+                    if (!all_tags
+                        && !weechat_hashtable_has_key (relay_config_hashtable_irc_backlog_tags,
+                                                       ptr_tag))
+                    {
+                        command = -1;
+                    }
+                }
             }
         }
     }
@@ -663,14 +721,15 @@ relay_irc_get_line_info (struct t_relay_client *client,
     if ((command == RELAY_IRC_CMD_JOIN) || (command == RELAY_IRC_CMD_PART)
         || (command == RELAY_IRC_CMD_QUIT))
     {
-        localvar_nick = weechat_buffer_get_string (buffer, "localvar_nick");
-        if (localvar_nick && localvar_nick[0]
-            && ptr_nick && (strcmp (ptr_nick, localvar_nick) == 0))
+        if (self_nick && self_nick[0]
+            && ptr_nick && (strcmp (ptr_nick, self_nick) == 0))
         {
             return;
         }
     }
 
+    msg_date = weechat_hdata_time (hdata_line_data, line_data, "date");
+
     /* fills variables with the line data */
     if (irc_command)
         *irc_command = command;
@@ -684,6 +743,11 @@ relay_irc_get_line_info (struct t_relay_client *client,
         *nick1 = ptr_nick1;
     if (nick2)
         *nick2 = ptr_nick2;
+
+    /* caller wants only the command: no need to strip colors */
+    if (!message && !host && !tags)
+        return;
+
     message_no_color = (ptr_message) ?
         weechat_string_remove_color (ptr_message, NULL) : NULL;
     if ((command == RELAY_IRC_CMD_PRIVMSG) && message && message_no_color)
@@ -754,70 +818,209 @@ relay_irc_get_line_info (struct t_relay_client *client,
 }
 
 /*
- * Sends channel backlog to client.
+ * Sends one line of backlog to client.
  */
 
 void
-relay_irc_send_channel_backlog (struct t_relay_client *client,
-                                const char *channel,
-                                struct t_gui_buffer *buffer)
+relay_irc_send_backlog_line (struct t_relay_client *client,
+                             const char *channel, const char *self_nick,
+                             struct t_hdata *hdata_line_data, void *line_data)
 {
-    struct t_relay_server *ptr_server;
-    void *ptr_own_lines, *ptr_line, *ptr_line_data;
-    void *ptr_hdata_line, *ptr_hdata_line_data;
     char *tags, *host, *message;
     const char *ptr_nick, *ptr_nick1, *ptr_nick2;
-    int irc_command, irc_action, count, max_number, max_minutes;
-    time_t date_min, date_min2, date;
+    int irc_command, irc_action;
+
+    relay_irc_get_line_info (client, self_nick,
+                             hdata_line_data, line_data,
+                             &irc_command,
+                             &irc_action,
+                             NULL, /* date */
+                             &ptr_nick,
+                             &ptr_nick1,
+                             &ptr_nick2,
+                             &tags,
+                             &host,
+                             &message);
+    switch (irc_command)
+    {
+        case RELAY_IRC_CMD_JOIN:
+            relay_irc_sendf (client,
+                             "%s:%s%s%s JOIN :%s",
+                             (tags) ? tags : "",
+                             ptr_nick,
+                             (host) ? "!" : "",
+                             (host) ? host : "",
+                             channel);
+            break;
+        case RELAY_IRC_CMD_PART:
+            relay_irc_sendf (client,
+                             "%s:%s%s%s PART %s",
+                             (tags) ? tags : "",
+                             ptr_nick,
+                             (host) ? "!" : "",
+                             (host) ? host : "",
+                             channel);
+            break;
+        case RELAY_IRC_CMD_QUIT:
+            relay_irc_sendf (client,
+                             "%s:%s%s%s QUIT",
+                             (tags) ? tags : "",
+                             ptr_nick,
+                             (host) ? "!" : "",
+                             (host) ? host : "");
+            break;
+        case RELAY_IRC_CMD_NICK:
+            if (ptr_nick1 && ptr_nick2)
+            {
+                relay_irc_sendf (client,
+                                 "%s:%s NICK :%s",
+                                 (tags) ? tags : "",
+                                 ptr_nick1,
+                                 ptr_nick2);
+            }
+            break;
+        case RELAY_IRC_CMD_PRIVMSG:
+            if (ptr_nick && message)
+            {
+                relay_irc_sendf (client,
+                                 "%s:%s PRIVMSG %s :%s%s%s",
+                                 (tags) ? tags : "",
+                                 ptr_nick,
+                                 channel,
+                                 (irc_action) ? "\01ACTION " : "",
+                                 message,
+                                 (irc_action) ? "\01": "");
+            }
+            break;
+        case RELAY_IRC_NUM_CMD:
+            /* make C compiler happy */
+            break;
+    }
+    if (tags)
+        free (tags);
+    if (host)
+        free (host);
+    if (message)
+        free (message);
+}
+
+/*
+ * Gets next line to send in a backlog.
+ *
+ * Line ids are increasing in a buffer and lines are freed only from the
+ * beginning of buffer (or all lines when buffer is cleared): if the first line
+ * of buffer has an id lower than or equal to the id of next line, the pointer
+ * saved in backlog is still valid, otherwise this line has been freed and the
+ * next line to send is the first line of buffer.
+ *
+ * Returns pointer to line, NULL if there is no more line in buffer.
+ */
+
+void *
+relay_irc_backlog_get_next_line (struct t_relay_irc_backlog *backlog)
+{
+    void *ptr_own_lines, *ptr_first_line, *ptr_line_data;
 
-    /* get pointer on "own_lines" in buffer */
     ptr_own_lines = weechat_hdata_pointer (weechat_hdata_get ("buffer"),
-                                           buffer, "own_lines");
+                                           backlog->buffer, "own_lines");
     if (!ptr_own_lines)
-        return;
+        return NULL;
+
+    ptr_first_line = weechat_hdata_pointer (weechat_hdata_get ("lines"),
+                                            ptr_own_lines, "first_line");
+    if (!ptr_first_line)
+        return NULL;
+
+    ptr_line_data = weechat_hdata_pointer (weechat_hdata_get ("line"),
+                                           ptr_first_line, "data");
+    if (backlog->next_line
+        && ptr_line_data
+        && (weechat_hdata_integer (weechat_hdata_get ("line_data"),
+                                   ptr_line_data, "id") <= backlog->next_line_id))
+    {
+        return backlog->next_line;
+    }
 
-    /* get pointer on "last_line" in lines */
-    ptr_line = weechat_hdata_pointer (weechat_hdata_get ("lines"),
-                                      ptr_own_lines, "last_line");
-    if (!ptr_line)
-        return;
+    return ptr_first_line;
+}
 
-    /* get hdata "line" */
-    ptr_hdata_line = weechat_hdata_get ("line");
-    if (!ptr_hdata_line)
-        return;
+/*
+ * Saves position of next line in a backlog (pointer to line and its id).
+ */
 
-    /* get hdata "line_data" */
-    ptr_hdata_line_data = weechat_hdata_get ("line_data");
-    if (!ptr_hdata_line_data)
-        return;
+void
+relay_irc_backlog_set_next_line (struct t_relay_irc_backlog *backlog,
+                                 void *line)
+{
+    void *ptr_line_data;
 
-    max_number = weechat_config_integer (relay_config_irc_backlog_max_number);
-    max_minutes = weechat_config_integer (relay_config_irc_backlog_max_minutes);
-    date_min = (max_minutes > 0) ? time (NULL) - (max_minutes * 60) : 0;
-    if (weechat_config_boolean (relay_config_irc_backlog_since_last_disconnect))
+    backlog->next_line = line;
+    if (line)
     {
-        ptr_server = relay_server_search (client->protocol_string);
-        if (ptr_server && (ptr_server->last_client_disconnect > 0))
+        ptr_line_data = weechat_hdata_pointer (weechat_hdata_get ("line"),
+                                               line, "data");
+        if (ptr_line_data)
         {
-            date_min2 = ptr_server->last_client_disconnect;
-            if (date_min2 > date_min)
-                date_min = date_min2;
+            backlog->next_line_id = weechat_hdata_integer (
+                weechat_hdata_get ("line_data"), ptr_line_data, "id");
         }
     }
+}
+
+/*
+ * Searches first line to send in a backlog: lines are read from the end of
+ * buffer, at most "max_lines" lines on each call (the search continues on
+ * next call of backlog timer).
+ *
+ * The search stops at beginning of buffer, on first message older than min
+ * date, or when the max number of messages is reached.
+ *
+ * Returns number of lines read.
+ */
+
+int
+relay_irc_backlog_search_first_line (struct t_relay_client *client,
+                                     struct t_relay_irc_backlog *backlog,
+                                     const char *self_nick,
+                                     int max_lines)
+{
+    struct t_hdata *ptr_hdata_line, *ptr_hdata_line_data;
+    void *ptr_line, *ptr_line_data, *ptr_line_read;
+    int lines, irc_command;
+    time_t date;
+
+    ptr_line = relay_irc_backlog_get_next_line (backlog);
+    if (ptr_line != backlog->next_line)
+    {
+        /* line has been freed: start from first line of buffer */
+        backlog->searching = 0;
+        relay_irc_backlog_set_next_line (backlog, ptr_line);
+        return 0;
+    }
+
+    ptr_hdata_line = weechat_hdata_get ("line");
+    ptr_hdata_line_data = weechat_hdata_get ("line_data");
 
     /*
      * loop on lines in buffer, from last to first, and stop when we have
      * reached max number of lines (or max minutes)
      */
-    count = 0;
+    lines = 0;
+    ptr_line_read = ptr_line;
     while (ptr_line)
     {
+        if (lines >= max_lines)
+        {
+            /* search will continue from this line on next call */
+            relay_irc_backlog_set_next_line (backlog, ptr_line);
+            return lines;
+        }
+        lines++;
         ptr_line_data = weechat_hdata_pointer (ptr_hdata_line,
                                                ptr_line, "data");
         if (ptr_line_data)
         {
-            relay_irc_get_line_info (client, buffer,
+            relay_irc_get_line_info (client, self_nick,
                                      ptr_hdata_line_data, ptr_line_data,
                                      &irc_command,
                                      NULL, /* irc_action */
@@ -831,112 +1034,300 @@ relay_irc_send_channel_backlog (struct t_relay_client *client,
             if (irc_command >= 0)
             {
                 /* if we have reached max minutes, exit loop */
-                if ((date_min > 0) && (date < date_min))
+                if ((backlog->date_min > 0) && (date < backlog->date_min))
                     break;
-                count++;
+                backlog->count++;
             }
             /* if we have reached max number of messages, exit loop */
-            if ((max_number > 0) && (count > max_number))
+            if ((backlog->max_number > 0)
+                && (backlog->count > backlog->max_number))
                 break;
         }
+        ptr_line_read = ptr_line;
         ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, -1);
     }
 
-    if (!ptr_line)
+    if (ptr_line)
     {
-        /* if we have reached beginning of buffer, start from first line */
-        ptr_line = weechat_hdata_pointer (weechat_hdata_get ("lines"),
-                                          ptr_own_lines, "first_line");
+        /* start from line + 1 (the current line must not be sent) */
+        ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, 1);
     }
     else
     {
-        /* start from line + 1 (the current line must not be sent) */
-        ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, 1);
+        /* if we have reached beginning of buffer, start from first line */
+        ptr_line = ptr_line_read;
     }
+    backlog->searching = 0;
+    relay_irc_backlog_set_next_line (backlog, ptr_line);
 
-    /*
-     * loop on lines from line pointer until last line of buffer, and for each
-     * irc message, sends it to client
-     */
-    while (ptr_line)
+    return lines;
+}
+
+/*
+ * Sends messages held while backlogs were sent, and removes them.
+ */
+
+void
+relay_irc_send_held_messages (struct t_relay_client *client)
+{
+    struct t_relay_irc_held_message *ptr_message;
+
+    while (RELAY_IRC_DATA(client, held_messages))
     {
-        ptr_line_data = weechat_hdata_pointer (ptr_hdata_line,
-                                               ptr_line, "data");
-        if (ptr_line_data)
+        ptr_message = RELAY_IRC_DATA(client, held_messages);
+        RELAY_IRC_DATA(client, held_messages) = ptr_message->next_message;
+        if (!RELAY_IRC_DATA(client, held_messages))
+            RELAY_IRC_DATA(client, last_held_message) = NULL;
+        if (!RELAY_CLIENT_HAS_ENDED(client))
+            relay_irc_sendf (client, "%s", ptr_message->message);
+        free (ptr_message->message);
+        free (ptr_message);
+    }
+}
+
+/*
+ * Removes first backlog of client (when it has been completely sent).
+ */
+
+void
+relay_irc_backlog_free (struct t_relay_client *client)
+{
+    struct t_relay_irc_backlog *ptr_backlog;
+
+    ptr_backlog = RELAY_IRC_DATA(client, backlogs);
+    if (!ptr_backlog)
+        return;
+
+    RELAY_IRC_DATA(client, backlogs) = ptr_backlog->next_backlog;
+    if (RELAY_IRC_DATA(client, last_backlog) == ptr_backlog)
+        RELAY_IRC_DATA(client, last_backlog) = NULL;
+
+    if (ptr_backlog->channel)
+        free (ptr_backlog->channel);
+    free (ptr_backlog);
+}
+
+/*
+ * Removes all backlogs of client (and timer used to send them), and messages
+ * held until end of backlogs.
+ */
+
+void
+relay_irc_backlog_free_all (struct t_relay_client *client)
+{
+    struct t_relay_irc_held_message *ptr_message;
+
+    while (RELAY_IRC_DATA(client, backlogs))
+    {
+        relay_irc_backlog_free (client);
+    }
+    while (RELAY_IRC_DATA(client, held_messages))
+    {
+        ptr_message = RELAY_IRC_DATA(client, held_messages);
+        RELAY_IRC_DATA(client, held_messages) = ptr_message->next_message;
+        free (ptr_message->message);
+        free (ptr_message);
+    }
+    RELAY_IRC_DATA(client, last_held_message) = NULL;
+    if (RELAY_IRC_DATA(client, hook_timer_backlog))
+    {
+        weechat_unhook (RELAY_IRC_DATA(client, hook_timer_backlog));
+        RELAY_IRC_DATA(client, hook_timer_backlog) = NULL;
+    }
+}
+
+/*
+ * Timer called to send backlogs to client: a few lines are sent on each call,
+ * so that a large backlog does not block WeeChat.
+ */
+
+int
+relay_irc_timer_backlog_cb (void *data, int remaining_calls)
+{
+    struct t_relay_client *client;
+    struct t_relay_irc_backlog *ptr_backlog;
+    struct t_hdata *ptr_hdata_buffer, *ptr_hdata_line, *ptr_hdata_line_data;
+    void *ptr_line, *ptr_line_data;
+    const char *self_nick;
+    int count, line_id;
+
+    /* make C compiler happy */
+    (void) remaining_calls;
+
+    client = (struct t_relay_client *)data;
+    if (!relay_client_valid (client))
+        return WEECHAT_RC_OK;
+
+    if (RELAY_CLIENT_HAS_ENDED(client))
+    {
+        relay_irc_backlog_free_all (client);
+        return WEECHAT_RC_OK;
+    }
+
+    ptr_hdata_buffer = weechat_hdata_get ("buffer");
+    ptr_hdata_line = weechat_hdata_get ("line");
+    ptr_hdata_line_data = weechat_hdata_get ("line_data");
+
+    count = 0;
+    while (RELAY_IRC_DATA(client, backlogs)
+           && (count < RELAY_IRC_BACKLOG_LINES_PER_CALL))
+    {
+        ptr_backlog = RELAY_IRC_DATA(client, backlogs);
+
+        /* buffer may have been closed since the backlog was requested */
+        ptr_line = NULL;
+        self_nick = NULL;
+        if (weechat_hdata_check_pointer (ptr_hdata_buffer,
+                                         weechat_hdata_get_list (ptr_hdata_buffer,
+                                                                 "gui_buffers"),
+                                         ptr_backlog->buffer))
         {
-            relay_irc_get_line_info (client, buffer,
-                                     ptr_hdata_line_data, ptr_line_data,
-                                     &irc_command,
-                                     &irc_action,
-                                     &date,
-                                     &ptr_nick,
-                                     &ptr_nick1,
-                                     &ptr_nick2,
-                                     &tags,
-                                     &host,
-                                     &message);
-            switch (irc_command)
+            self_nick = weechat_buffer_get_string (ptr_backlog->buffer,
+                                                   "localvar_nick");
+            if (ptr_backlog->searching)
             {
-                case RELAY_IRC_CMD_JOIN:
-                    relay_irc_sendf (client,
-                                     "%s:%s%s%s JOIN :%s",
-                                     (tags) ? tags : "",
-                                     ptr_nick,
-                                     (host) ? "!" : "",
-                                     (host) ? host : "",
-                                     channel);
-                    break;
-                case RELAY_IRC_CMD_PART:
-                    relay_irc_sendf (client,
-                                     "%s:%s%s%s PART %s",
-                                     (tags) ? tags : "",
-                                     ptr_nick,
-                                     (host) ? "!" : "",
-                                     (host) ? host : "",
-                                     channel);
-                case RELAY_IRC_CMD_QUIT:
-                    relay_irc_sendf (client,
-                                     "%s:%s%s%s QUIT",
-                                     (tags) ? tags : "",
-                                     ptr_nick,
-                                     (host) ? "!" : "",
-                                     (host) ? host : "");
-                    break;
-                case RELAY_IRC_CMD_NICK:
-                    if (ptr_nick1 && ptr_nick2)
-                    {
-                        relay_irc_sendf (client,
-                                         "%s:%s NICK :%s",
-                                         (tags) ? tags : "",
-                                         ptr_nick1,
-                                         ptr_nick2);
-                    }
-                    break;
-                case RELAY_IRC_CMD_PRIVMSG:
-                    if (ptr_nick && message)
-                    {
-                        relay_irc_sendf (client,
-                                         "%s:%s PRIVMSG %s :%s%s%s",
-                                         (tags) ? tags : "",
-                                         ptr_nick,
-                                         channel,
-                                         (irc_action) ? "\01ACTION " : "",
-                                         message,
-                                         (irc_action) ? "\01": "");
-                    }
-                    break;
-                case RELAY_IRC_NUM_CMD:
-                    /* make C compiler happy */
+                count += relay_irc_backlog_search_first_line (
+                    client, ptr_backlog, self_nick,
+                    RELAY_IRC_BACKLOG_LINES_PER_CALL - count);
+                if (ptr_backlog->searching)
+                    continue;
+            }
+            if (ptr_backlog->next_line)
+                ptr_line = relay_irc_backlog_get_next_line (ptr_backlog);
+        }
+
+        while (ptr_line && (count < RELAY_IRC_BACKLOG_LINES_PER_CALL))
+        {
+            ptr_line_data = weechat_hdata_pointer (ptr_hdata_line,
+                                                   ptr_line, "data");
+            if (ptr_line_data)
+            {
+                line_id = weechat_hdata_integer (ptr_hdata_line_data,
+                                                 ptr_line_data, "id");
+                if (line_id > ptr_backlog->last_line_id)
+                {
+                    /* lines added after the request are not in backlog */
+                    ptr_line = NULL;
                     break;
+                }
+                relay_irc_send_backlog_line (client, ptr_backlog->channel,
+                                             self_nick,
+                                             ptr_hdata_line_data,
+                                             ptr_line_data);
+                /* backlogs are freed if client is disconnected on error */
+                if (RELAY_CLIENT_HAS_ENDED(client))
+                    return WEECHAT_RC_OK;
             }
-            if (tags)
-                free (tags);
-            if (host)
-                free (host);
-            if (message)
-                free (message);
+            count++;
+            ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, 1);
         }
-        ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, 1);
+
+        if (ptr_line)
+        {
+            /* save position of next line to send */
+            relay_irc_backlog_set_next_line (ptr_backlog, ptr_line);
+        }
+        else
+        {
+            /* end of buffer reached: backlog completely sent */
+            relay_irc_backlog_free (client);
+        }
+    }
+
+    if (!RELAY_IRC_DATA(client, backlogs))
+    {
+        if (RELAY_IRC_DATA(client, hook_timer_backlog))
+        {
+            weechat_unhook (RELAY_IRC_DATA(client, hook_timer_backlog));
+            RELAY_IRC_DATA(client, hook_timer_backlog) = NULL;
+        }
+        relay_irc_send_held_messages (client);
+    }
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Sends channel backlog to client.
+ *
+ * The backlog is added in client and the lines are searched and sent by a
+ * timer (see function relay_irc_timer_backlog_cb), so that a large buffer
+ * does not block WeeChat.
+ */
+
+void
+relay_irc_send_channel_backlog (struct t_relay_client *client,
+                                const char *channel,
+                                struct t_gui_buffer *buffer)
+{
+    struct t_relay_server *ptr_server;
+    struct t_relay_irc_backlog *new_backlog;
+    void *ptr_own_lines, *ptr_line, *ptr_line_data;
+    int max_minutes;
+    time_t date_min, date_min2;
+
+    /* get pointer on "own_lines" in buffer */
+    ptr_own_lines = weechat_hdata_pointer (weechat_hdata_get ("buffer"),
+                                           buffer, "own_lines");
+    if (!ptr_own_lines)
+        return;
+
+    /* get pointer on "last_line" in lines */
+    ptr_line = weechat_hdata_pointer (weechat_hdata_get ("lines"),
+                                      ptr_own_lines, "last_line");
+    if (!ptr_line)
+        return;
+
+    /* lines added after this one will be sent by signals, not in backlog */
+    ptr_line_data = weechat_hdata_pointer (weechat_hdata_get ("line"),
+                                           ptr_line, "data");
+    if (!ptr_line_data)
+        return;
+
+    max_minutes = weechat_config_integer (relay_config_irc_backlog_max_minutes);
+    date_min = (max_minutes > 0) ? time (NULL) - (max_minutes * 60) : 0;
+    if (weechat_config_boolean (relay_config_irc_backlog_since_last_disconnect))
+    {
+        ptr_server = relay_server_search (client->protocol_string);
+        if (ptr_server && (ptr_server->last_client_disconnect > 0))
+        {
+            date_min2 = ptr_server->last_client_disconnect;
+            if (date_min2 > date_min)
+                date_min = date_min2;
+        }
+    }
+
+    /*
+     * add backlog in client: the first line to send is searched from the
+     * last line by the timer, then lines are sent by the timer
+     */
+    new_backlog = malloc (sizeof (*new_backlog));
+    if (!new_backlog)
+        return;
+    new_backlog->channel = strdup (channel);
+    new_backlog->buffer = buffer;
+    new_backlog->searching = 1;
+    new_backlog->max_number = weechat_config_integer (
+        relay_config_irc_backlog_max_number);
+    new_backlog->date_min = date_min;
+    new_backlog->count = 0;
+    new_backlog->next_line = ptr_line;
+    new_backlog->next_line_id = weechat_hdata_integer (
+        weechat_hdata_get ("line_data"), ptr_line_data, "id");
+    new_backlog->last_line_id = new_backlog->next_line_id;
+    new_backlog->next_backlog = NULL;
+    if (RELAY_IRC_DATA(client, last_backlog))
+        (RELAY_IRC_DATA(client, last_backlog))->next_backlog = new_backlog;
+    else
+        RELAY_IRC_DATA(client, backlogs) = new_backlog;
+    RELAY_IRC_DATA(client, last_backlog) = new_backlog;
+
+    if (!RELAY_IRC_DATA(client, hook_timer_backlog))
+    {
+        RELAY_IRC_DATA(client, hook_timer_backlog) =
+            weechat_hook_timer (1, 0, 0,
+                                &relay_irc_timer_backlog_cb,
+                                client);
     }
 }
 
@@ -1785,6 +2176,7 @@ relay_irc_close_connection (struct t_relay_client *client)
         weechat_unhook (RELAY_IRC_DATA(client, hook_hsignal_irc_redir));
         RELAY_IRC_DATA(client, hook_hsignal_irc_redir) = NULL;
     }
+    relay_irc_backlog_free_all (client);
 }
 
 /*
@@ -1814,6 +2206,11 @@ relay_irc_alloc (struct t_relay_client *client)
         RELAY_IRC_DATA(client, hook_signal_irc_outtags) = NULL;
         RELAY_IRC_DATA(client, hook_signal_irc_disc) = NULL;
         RELAY_IRC_DATA(client, hook_hsignal_irc_redir) = NULL;
+        RELAY_IRC_DATA(client, backlogs) = NULL;
+        RELAY_IRC_DATA(client, last_backlog) = NULL;
+        RELAY_IRC_DATA(client, hook_timer_backlog) = NULL;
+        RELAY_IRC_DATA(client, held_messages) = NULL;
+        RELAY_IRC_DATA(client, last_held_message) = NULL;
     }
 
     if (password)
@@ -1845,6 +2242,11 @@ relay_irc_alloc_with_infolist (struct t_relay_client *client,
         RELAY_IRC_DATA(client, connected) = weechat_infolist_integer (infolist, "connected");
         RELAY_IRC_DATA(client, server_capabilities) = weechat_infolist_integer (infolist, "server_capabilities");
         RELAY_IRC_DATA(client, hook_timer_signals_joins) = NULL;
+        RELAY_IRC_DATA(client, backlogs) = NULL;
+        RELAY_IRC_DATA(client, last_backlog) = NULL;
+        RELAY_IRC_DATA(client, hook_timer_backlog) = NULL;
+        RELAY_IRC_DATA(client, held_messages) = NULL;
+        RELAY_IRC_DATA(client, last_held_message) = NULL;
         if (RELAY_IRC_DATA(client, connected))
         {
             relay_irc_hook_signals (client);
@@ -1882,6 +2284,7 @@ relay_irc_free (struct t_relay_client *client)
             weechat_unhook (RELAY_IRC_DATA(client, hook_signal_irc_disc));
         if (RELAY_IRC_DATA(client, hook_hsignal_irc_redir))
             weechat_unhook (RELAY_IRC_DATA(client, hook_hsignal_irc_redir));
+        relay_irc_backlog_free_all (client);
 
         free (client->protocol_data);
 
@@ -1926,6 +2329,8 @@ relay_irc_add_to_infolist (struct t_infolist_item *item,
         return 0;
     if (!weechat_infolist_new_var_pointer (item, "hook_hsignal_irc_redir", RELAY_IRC_DATA(client, hook_hsignal_irc_redir)))
         return 0;
+    if (!weechat_infolist_new_var_pointer (item, "hook_timer_backlog", RELAY_IRC_DATA(client, hook_timer_backlog)))
+        return 0;
 
     return 1;
 }
@@ -1950,5 +2355,10 @@ relay_irc_print_log (struct t_relay_client *client)
         weechat_log_printf ("    hook_signal_irc_outtags : 0x%lx", RELAY_IRC_DATA(client, hook_signal_irc_outtags));
         weechat_log_printf ("    hook_signal_irc_disc. . : 0x%lx", RELAY_IRC_DATA(client, hook_signal_irc_disc));
         weechat_log_printf ("    hook_hsignal_irc_redir. : 0x%lx", RELAY_IRC_DATA(client, hook_hsignal_irc_redir));
+        weechat_log_printf ("    backlogs. . . . . . . . : 0x%lx", RELAY_IRC_DATA(client, backlogs));
+        weechat_log_printf ("    last_backlog. . . . . . : 0x%lx", RELAY_IRC_DATA(client, last_backlog));
+        weechat_log_printf ("    hook_timer_backlog. . . : 0x%lx", RELAY_IRC_DATA(client, hook_timer_backlog));
+        weechat_log_printf ("    held_messages . . . . . : 0x%lx", RELAY_IRC_DATA(client, held_messages));
+        weechat_log_printf ("    last_held_message . . . : 0x%lx", RELAY_IRC_DATA(client, last_held_message));
     }
 }
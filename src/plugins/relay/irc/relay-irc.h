@@ -25,6 +25,36 @@ struct t_relay_client;
 #define RELAY_IRC_DATA(client, var)                              \
     (((struct t_relay_irc_data *)client->protocol_data)->var)
 
+/*
+ * max number of lines read in buffer on each call of backlog timer (to search
+ * first line of backlog, or to send lines)
+ */
+#define RELAY_IRC_BACKLOG_LINES_PER_CALL 100
+
+struct t_relay_irc_backlog
+{
+    char *channel;                     /* channel (or nick for private)     */
+    struct t_gui_buffer *buffer;       /* buffer with lines to send         */
+    int searching;                     /* 1 if first line to send is being  */
+                                       /* searched (from end of buffer)     */
+    int max_number;                    /* max number of messages to send    */
+    time_t date_min;                   /* min date of messages to send      */
+    int count;                         /* messages found during search      */
+    void *next_line;                   /* next line to send (or to read     */
+                                       /* during search), checked before    */
+                                       /* use: it may have been freed       */
+    int next_line_id;                  /* id of next line                   */
+    int last_line_id;                  /* id of last line to send           */
+    struct t_relay_irc_backlog *next_backlog; /* link to next backlog       */
+};
+
+struct t_relay_irc_held_message
+{
+    char *message;                     /* message received by signal, held  */
+                                       /* until backlogs are sent           */
+    struct t_relay_irc_held_message *next_message; /* link to next message  */
+};
+
 struct t_relay_irc_data
 {
     char *address;                     /* client address (used when sending */
@@ -42,6 +72,12 @@ struct t_relay_irc_data
     struct t_hook *hook_signal_irc_outtags; /* signal "irc_outtags"         */
     struct t_hook *hook_signal_irc_disc;    /* signal "irc_disconnected"    */
     struct t_hook *hook_hsignal_irc_redir;  /* hsignal "irc_redirection_..."*/
+    struct t_relay_irc_backlog *backlogs;      /* backlogs to send          */
+    struct t_relay_irc_backlog *last_backlog;  /* last backlog to send      */
+    struct t_hook *hook_timer_backlog;      /* timer to send backlogs       */
+    struct t_relay_irc_held_message *held_messages; /* messages to send     */
+                                                    /* after backlogs       */
+    struct t_relay_irc_held_message *last_held_message; /* last message     */
 };
 
 enum t_relay_irc_command
@@ -28,6 +28,7 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #ifdef HAVE_GNUTLS
 #include <gnutls/gnutls.h>
@@ -217,6 +218,7 @@ relay_client_handshake_timer_cb (void *data, int remaining_calls)
         /* handshake OK, set status to "connected" */
         weechat_unhook (client->hook_timer_handshake);
         client->hook_timer_handshake = NULL;
+        client->ssl_resumed = gnutls_session_is_resumed (client->gnutls_sess) ? 1 : 0;
         relay_client_set_status (client, RELAY_STATUS_CONNECTED);
         return WEECHAT_RC_OK;
     }
@@ -431,7 +433,8 @@ int
 relay_client_recv_cb (void *arg_client, int fd)
 {
     struct t_relay_client *client;
-    static char buffer[4096], decoded[4096 + 1];
+    static char buffer[4096];
+    unsigned char *decoded;
     const char *ptr_buffer;
     int num_read, rc;
     unsigned long long decoded_length;
@@ -456,6 +459,7 @@ relay_client_recv_cb (void *arg_client, int fd)
     {
         buffer[num_read] = '\0';
         ptr_buffer = buffer;
+        decoded = NULL;
 
         /*
          * if we are receiving the first message from client, check if it looks
@@ -484,9 +488,10 @@ relay_client_recv_cb (void *arg_client, int fd)
         if (client->websocket == 2)
         {
             /* websocket used, decode message */
-            rc = relay_websocket_decode_frame ((unsigned char *)buffer,
+            rc = relay_websocket_decode_frame (client,
+                                               (unsigned char *)buffer,
                                                (unsigned long long)num_read,
-                                               (unsigned char *)decoded,
+                                               &decoded,
                                                &decoded_length);
             if (decoded_length == 0)
             {
@@ -500,10 +505,12 @@ relay_client_recv_cb (void *arg_client, int fd)
                  *   Pong
                  *   frame is not expected."
                  */
+                free (decoded);
                 return WEECHAT_RC_OK;
             }
             if (!rc)
             {
+                free (decoded);
                 /* error when decoding frame: close connection */
                 weechat_printf_tags (NULL, "relay_client",
                                      _("%s%s: error decoding websocket frame "
@@ -515,7 +522,7 @@ relay_client_recv_cb (void *arg_client, int fd)
                 relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
                 return WEECHAT_RC_OK;
             }
-            ptr_buffer = decoded;
+            ptr_buffer = (char *)decoded;
         }
 
         if ((client->websocket == 1)
@@ -529,6 +536,8 @@ relay_client_recv_cb (void *arg_client, int fd)
             /* receive buffer as-is (binary data) */
             /* currently, all supported protocols receive only text, no binary */
         }
+        if (decoded)
+            free (decoded);
         relay_buffer_refresh (NULL);
     }
     else
@@ -577,32 +586,151 @@ relay_client_recv_cb (void *arg_client, int fd)
 }
 
 /*
- * Adds a message in out queue.
+ * Creates a data for out queue, using "data" (which must have been allocated
+ * with malloc, and is freed when the last reference on data is removed).
+ *
+ * The data is returned with one reference (for the caller), which must be
+ * removed with relay_client_outqueue_data_unref.
+ *
+ * Returns pointer to new data, NULL if error (then "data" is freed).
+ */
+
+struct t_relay_client_outqueue_data *
+relay_client_outqueue_data_new (char *data, int size)
+{
+    struct t_relay_client_outqueue_data *new_data;
+
+    if (!data)
+        return NULL;
+
+    new_data = malloc (sizeof (*new_data));
+    if (!new_data)
+    {
+        free (data);
+        return NULL;
+    }
+
+    new_data->data = data;
+    new_data->size = size;
+    new_data->refcount = 1;
+    new_data->deflated = NULL;
+
+    weechat_memory_add ("relay_queue",
+                        (long long)(sizeof (*new_data) + size), 1);
+
+    return new_data;
+}
+
+/*
+ * Creates a data for out queue with a copy of buffers, skipping the first
+ * "offset" bytes.
+ *
+ * Returns pointer to new data, NULL if error.
+ */
+
+struct t_relay_client_outqueue_data *
+relay_client_outqueue_data_new_copy (const struct iovec *buffers,
+                                     int num_buffers, int offset)
+{
+    char *data;
+    int i, size, length;
+
+    size = -offset;
+    for (i = 0; i < num_buffers; i++)
+    {
+        size += buffers[i].iov_len;
+    }
+    if (size <= 0)
+        return NULL;
+
+    data = malloc (size);
+    if (!data)
+        return NULL;
+
+    size = 0;
+    for (i = 0; i < num_buffers; i++)
+    {
+        length = buffers[i].iov_len;
+        if (offset >= length)
+        {
+            offset -= length;
+            continue;
+        }
+        memcpy (data + size, (char *)buffers[i].iov_base + offset,
+                length - offset);
+        size += length - offset;
+        offset = 0;
+    }
+
+    return relay_client_outqueue_data_new (data, size);
+}
+
+/*
+ * Removes a reference on a data for out queue, and frees it if it was the
+ * last reference.
+ */
+
+void
+relay_client_outqueue_data_unref (struct t_relay_client_outqueue_data *data)
+{
+    if (!data)
+        return;
+
+    data->refcount--;
+    if (data->refcount > 0)
+        return;
+
+    weechat_memory_add ("relay_queue",
+                        -1 * (long long)(sizeof (*data) + data->size), -1);
+
+    relay_client_outqueue_data_unref (data->deflated);
+    free (data->data);
+    free (data);
+}
+
+/*
+ * Adds (sign = 1) or removes (sign = -1) memory used by a message in out
+ * queue in memory counters (category "relay_queue").
+ *
+ * Data of message is not counted here (it can be shared by many clients):
+ * it is counted when the data is created.
+ */
+
+void
+relay_client_outqueue_memory_add (struct t_relay_client_outqueue *outqueue,
+                                  int sign)
+{
+    weechat_memory_add ("relay_queue",
+                        sign * (long long)(sizeof (*outqueue)
+                                           + outqueue->raw_size[0]
+                                           + outqueue->raw_size[1]),
+                        sign);
+}
+
+/*
+ * Adds a message in out queue: a reference is added on data, which is sent
+ * starting at "offset".
  */
 
 void
 relay_client_outqueue_add (struct t_relay_client *client,
-                           const char *data, int data_size,
+                           struct t_relay_client_outqueue_data *data,
+                           int offset,
                            int raw_flags[2], const char *raw_message[2],
                            int raw_size[2])
 {
     struct t_relay_client_outqueue *new_outqueue;
     int i;
 
-    if (!client || !data || (data_size <= 0))
+    if (!client || !data || (offset >= data->size))
         return;
 
     new_outqueue = malloc (sizeof (*new_outqueue));
     if (new_outqueue)
     {
-        new_outqueue->data = malloc (data_size);
-        if (!new_outqueue->data)
-        {
-            free (new_outqueue);
-            return;
-        }
-        memcpy (new_outqueue->data, data, data_size);
-        new_outqueue->data_size = data_size;
+        data->refcount++;
+        new_outqueue->data = data;
+        new_outqueue->offset = offset;
         for (i = 0; i < 2; i++)
         {
             new_outqueue->raw_flags[i] = 0;
@@ -628,6 +756,71 @@ relay_client_outqueue_add (struct t_relay_client *client,
         else
             client->outqueue = new_outqueue;
         client->last_outqueue = new_outqueue;
+
+        /* send out queue as soon as the socket is writable */
+        if (!client->hook_fd_write && (client->sock >= 0))
+        {
+            client->hook_fd_write = weechat_hook_fd (client->sock,
+                                                     0, 1, 0,
+                                                     &relay_client_send_cb,
+                                                     client);
+        }
+
+        client->outqueue_size += data->size - offset;
+
+        relay_client_outqueue_memory_add (new_outqueue, 1);
+    }
+}
+
+/*
+ * Adds buffers of a message in out queue, skipping the first "offset" bytes
+ * (already sent).
+ *
+ * The last buffer contains data of message, and the first one (if there are
+ * two buffers) is the websocket frame header.
+ *
+ * If "shared_data" is not NULL, it is the data of message (last buffer): a
+ * reference is added on it (no copy). Otherwise buffers are copied.
+ */
+
+void
+relay_client_outqueue_add_buffers (struct t_relay_client *client,
+                                   struct t_relay_client_outqueue_data *shared_data,
+                                   const struct iovec *buffers,
+                                   int num_buffers, int offset,
+                                   int raw_flags[2], const char *raw_message[2],
+                                   int raw_size[2])
+{
+    struct t_relay_client_outqueue_data *new_data;
+
+    if (shared_data)
+    {
+        if (num_buffers > 1)
+        {
+            if (offset < (int)buffers[0].iov_len)
+            {
+                /* copy the end of websocket frame header */
+                new_data = relay_client_outqueue_data_new_copy (buffers, 1,
+                                                                offset);
+                relay_client_outqueue_add (client, new_data, 0,
+                                           raw_flags, raw_message, raw_size);
+                relay_client_outqueue_data_unref (new_data);
+                raw_message = NULL;
+                offset = 0;
+            }
+            else
+                offset -= buffers[0].iov_len;
+        }
+        relay_client_outqueue_add (client, shared_data, offset,
+                                   raw_flags, raw_message, raw_size);
+    }
+    else
+    {
+        new_data = relay_client_outqueue_data_new_copy (buffers, num_buffers,
+                                                        offset);
+        relay_client_outqueue_add (client, new_data, 0,
+                                   raw_flags, raw_message, raw_size);
+        relay_client_outqueue_data_unref (new_data);
     }
 }
 
@@ -655,9 +848,12 @@ relay_client_outqueue_free (struct t_relay_client *client,
     if (outqueue->next_outqueue)
         (outqueue->next_outqueue)->prev_outqueue = outqueue->prev_outqueue;
 
+    client->outqueue_size -= outqueue->data->size - outqueue->offset;
+
+    relay_client_outqueue_memory_add (outqueue, -1);
+
     /* free data */
-    if (outqueue->data)
-        free (outqueue->data);
+    relay_client_outqueue_data_unref (outqueue->data);
     if (outqueue->raw_message[0])
         free (outqueue->raw_message[0]);
     if (outqueue->raw_message[1])
@@ -679,31 +875,309 @@ relay_client_outqueue_free_all (struct t_relay_client *client)
     {
         relay_client_outqueue_free (client, client->outqueue);
     }
+
+    if (client->hook_fd_write)
+    {
+        weechat_unhook (client->hook_fd_write);
+        client->hook_fd_write = NULL;
+    }
 }
 
 /*
- * Sends data to client (adds in out queue if it's impossible to send now).
+ * Checks if "size" bytes can be added in out queue of client, according to
+ * option relay.network.max_outqueue_size.
  *
- * If "message_raw_buffer" is not NULL, it is used for display in raw buffer
- * and replaces display of data, which is default.
+ * If the queue is full, the message is dropped or the client is disconnected
+ * (according to option relay.network.outqueue_full_action).
+ *
+ * Returns:
+ *   1: out queue is full (message must not be sent)
+ *   0: message can be added in out queue
+ */
+
+int
+relay_client_outqueue_full (struct t_relay_client *client, int size)
+{
+    unsigned long long max_size;
+
+    max_size = (unsigned long long)weechat_config_integer (
+        relay_config_network_max_outqueue_size) * 1024;
+    if ((max_size == 0)
+        || ((unsigned long long)client->outqueue_size + size <= max_size))
+    {
+        return 0;
+    }
+
+    /*
+     * messages compressed with the deflate stream of client (WeeChat protocol
+     * or websocket with context takeover) or using strings sent before
+     * (protocol version 2) can not be dropped (the client would not be able
+     * to decode next messages)
+     */
+    if ((weechat_config_integer (relay_config_network_outqueue_full_action) == RELAY_CLIENT_OUTQUEUE_FULL_DROP)
+        && !RELAY_WEECHAT_CLIENT_STATEFUL(client)
+        && !RELAY_WEBSOCKET_DEFLATE_CONTEXT(client))
+    {
+        client->outqueue_dropped++;
+        return 1;
+    }
+
+    weechat_printf_tags (NULL, "relay_client",
+                         _("%s%s: client %s%s%s does not read data fast "
+                           "enough (%lu bytes waiting), disconnecting"),
+                         weechat_prefix ("error"),
+                         RELAY_PLUGIN_NAME,
+                         RELAY_COLOR_CHAT_CLIENT,
+                         client->desc,
+                         RELAY_COLOR_CHAT,
+                         client->outqueue_size);
+    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+
+    return 1;
+}
+
+/*
+ * Sends buffers to client: with SSL, only the first buffer is sent (in one
+ * record), otherwise all buffers are sent with a single call to writev.
+ *
+ * Returns number of bytes sent, a negative value if error (gnutls error with
+ * SSL, -1 with errno set otherwise).
+ */
+
+int
+relay_client_send_buffers (struct t_relay_client *client,
+                           const struct iovec *buffers, int num_buffers)
+{
+#ifdef HAVE_GNUTLS
+    if (client->ssl)
+    {
+        return gnutls_record_send (client->gnutls_sess,
+                                   buffers[0].iov_base, buffers[0].iov_len);
+    }
+#endif
+
+    return writev (client->sock, buffers, num_buffers);
+}
+
+/*
+ * Checks error returned when sending data to client: if the socket would
+ * block, data will be sent later, otherwise an error is displayed and client
+ * is disconnected.
+ *
+ * Returns:
+ *   1: data must be sent later
+ *   0: error (client has been disconnected)
+ */
+
+int
+relay_client_send_check_error (struct t_relay_client *client, int num_sent)
+{
+#ifdef HAVE_GNUTLS
+    if (client->ssl)
+    {
+        if ((num_sent == GNUTLS_E_AGAIN) || (num_sent == GNUTLS_E_INTERRUPTED))
+            return 1;
+        weechat_printf_tags (NULL, "relay_client",
+                             _("%s%s: sending data to client %s%s%s: "
+                               "error %d %s"),
+                             weechat_prefix ("error"),
+                             RELAY_PLUGIN_NAME,
+                             RELAY_COLOR_CHAT_CLIENT,
+                             client->desc,
+                             RELAY_COLOR_CHAT,
+                             num_sent,
+                             gnutls_strerror (num_sent));
+        relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+        return 0;
+    }
+#else
+    /* make C compiler happy */
+    (void) num_sent;
+#endif
+
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+        return 1;
+    weechat_printf_tags (NULL, "relay_client",
+                         _("%s%s: sending data to client %s%s%s: "
+                           "error %d %s"),
+                         weechat_prefix ("error"),
+                         RELAY_PLUGIN_NAME,
+                         RELAY_COLOR_CHAT_CLIENT,
+                         client->desc,
+                         RELAY_COLOR_CHAT,
+                         errno,
+                         strerror (errno));
+    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
+    return 0;
+}
+
+/*
+ * Displays raw messages of a message in out queue and removes them from
+ * message (so that they are displayed only one time, even if message is sent
+ * in many chunks).
+ */
+
+void
+relay_client_outqueue_print_raw (struct t_relay_client *client,
+                                 struct t_relay_client_outqueue *outqueue)
+{
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        if (outqueue->raw_message[i])
+        {
+            relay_raw_print (client, outqueue->raw_flags[i],
+                             outqueue->raw_message[i], outqueue->raw_size[i]);
+            weechat_memory_add ("relay_queue", -1 * outqueue->raw_size[i], 0);
+            outqueue->raw_flags[i] = 0;
+            free (outqueue->raw_message[i]);
+            outqueue->raw_message[i] = NULL;
+            outqueue->raw_size[i] = 0;
+        }
+    }
+}
+
+/*
+ * Sends messages in out queue of client: many messages are sent at once (with
+ * a single call to writev), until the socket would block.
+ */
+
+void
+relay_client_outqueue_flush (struct t_relay_client *client)
+{
+    struct t_relay_client_outqueue *ptr_outqueue;
+    struct iovec buffers[RELAY_CLIENT_OUTQUEUE_MAX_BUFFERS];
+    int num_buffers, max_buffers, num_sent, size, length, i, sent;
+
+    max_buffers = RELAY_CLIENT_OUTQUEUE_MAX_BUFFERS;
+#ifdef HAVE_GNUTLS
+    if (client->ssl)
+        max_buffers = 1;
+#endif
+
+    sent = 0;
+
+    while (client->outqueue)
+    {
+        num_buffers = 0;
+        size = 0;
+        for (ptr_outqueue = client->outqueue;
+             ptr_outqueue && (num_buffers < max_buffers);
+             ptr_outqueue = ptr_outqueue->next_outqueue)
+        {
+            buffers[num_buffers].iov_base = ptr_outqueue->data->data
+                + ptr_outqueue->offset;
+            buffers[num_buffers].iov_len = ptr_outqueue->data->size
+                - ptr_outqueue->offset;
+            size += buffers[num_buffers].iov_len;
+            num_buffers++;
+        }
+
+        num_sent = relay_client_send_buffers (client, buffers, num_buffers);
+        if (num_sent < 0)
+        {
+            /* retry later this client's queue (or client disconnected) */
+            relay_client_send_check_error (client, num_sent);
+            break;
+        }
+
+        if (num_sent > 0)
+        {
+            client->bytes_sent += num_sent;
+            sent = 1;
+        }
+
+        /* remove messages sent (or update offset for a partial send) */
+        length = num_sent;
+        for (i = 0; i < num_buffers; i++)
+        {
+            ptr_outqueue = client->outqueue;
+            if ((i > 0) && (length == 0))
+                break;
+            relay_client_outqueue_print_raw (client, ptr_outqueue);
+            if (length >= (int)buffers[i].iov_len)
+            {
+                /* whole data sent, remove outqueue */
+                length -= buffers[i].iov_len;
+                relay_client_outqueue_free (client, ptr_outqueue);
+            }
+            else
+            {
+                ptr_outqueue->offset += length;
+                client->outqueue_size -= length;
+                length = 0;
+            }
+        }
+
+        /* some data was not sent: stop sending data from outqueue */
+        if (num_sent < size)
+            break;
+    }
+
+    if (sent)
+        relay_buffer_refresh (NULL);
+
+    if (!client->outqueue && client->hook_fd_write)
+    {
+        weechat_unhook (client->hook_fd_write);
+        client->hook_fd_write = NULL;
+    }
+}
+
+/*
+ * Callback for fd hook on socket (write), used only when out queue of client
+ * is not empty.
+ */
+
+int
+relay_client_send_cb (void *arg_client, int fd)
+{
+    struct t_relay_client *client;
+
+    /* make C compiler happy */
+    (void) fd;
+
+    client = (struct t_relay_client *)arg_client;
+
+    if (client->sock >= 0)
+        relay_client_outqueue_flush (client);
+
+    return WEECHAT_RC_OK;
+}
+
+/*
+ * Sends a message to client (adds it in out queue if it's impossible to send
+ * it now).
+ *
+ * If "shared_data" is not NULL, it contains the message ("data" and
+ * "data_size" are then its data and size) and it is added in out queue
+ * without copy.
  *
  * Returns number of bytes sent to client, -1 if error.
  */
 
 int
-relay_client_send (struct t_relay_client *client, const char *data,
-                   int data_size, const char *message_raw_buffer)
+relay_client_send_message (struct t_relay_client *client,
+                           struct t_relay_client_outqueue_data *shared_data,
+                           const char *data, int data_size,
+                           const char *message_raw_buffer)
 {
-    int num_sent, raw_size[2], raw_flags[2], i;
+    int num_sent, raw_size[2], raw_flags[2], i, num_buffers, size, offset;
+    int deflated;
+    unsigned char frame_header[RELAY_WEBSOCKET_FRAME_HEADER_MAX];
     char *websocket_frame;
     unsigned long long length_frame;
-    const char *ptr_data, *raw_msg[2];
+    const char *raw_msg[2];
+    struct iovec buffers[2];
+    struct t_relay_client_outqueue_data *deflated_data;
 
     if (client->sock < 0)
         return -1;
 
-    ptr_data = data;
     websocket_frame = NULL;
+    deflated_data = NULL;
+    deflated = 0;
 
     /* set raw messages */
     for (i = 0; i < 2; i++)
@@ -754,38 +1228,73 @@ relay_client_send (struct t_relay_client *client, const char *data,
         }
     }
 
+    num_buffers = 0;
+
     /* if websocket is initialized, encode data in a websocket frame */
     if (client->websocket == 2)
     {
-        websocket_frame = relay_websocket_encode_frame (client, data, data_size,
-                                                        &length_frame);
-        if (websocket_frame)
+        /* compress data with extension "permessage-deflate" */
+        if (relay_websocket_deflate_message_allowed (client))
+        {
+            deflated_data = relay_websocket_deflate_message (client,
+                                                             shared_data,
+                                                             data, data_size);
+            if (deflated_data)
+            {
+                data = deflated_data->data;
+                data_size = deflated_data->size;
+                shared_data = deflated_data;
+                deflated = 1;
+            }
+        }
+        if (client->ssl)
+        {
+            /* with SSL, the whole frame is sent in one record */
+            websocket_frame = relay_websocket_encode_frame (client,
+                                                            data, data_size,
+                                                            deflated,
+                                                            &length_frame);
+            if (websocket_frame)
+            {
+                data = websocket_frame;
+                data_size = length_frame;
+                shared_data = NULL;
+            }
+        }
+        else
         {
-            ptr_data = websocket_frame;
-            data_size = length_frame;
+            /* frame header is sent before data (no copy of data) */
+            buffers[0].iov_base = frame_header;
+            buffers[0].iov_len = relay_websocket_encode_frame_header (
+                client, data_size, deflated, frame_header);
+            num_buffers++;
         }
     }
+    buffers[num_buffers].iov_base = (void *)data;
+    buffers[num_buffers].iov_len = data_size;
+    num_buffers++;
+
+    size = 0;
+    for (i = 0; i < num_buffers; i++)
+    {
+        size += buffers[i].iov_len;
+    }
 
     num_sent = -1;
+    offset = 0;
 
-    /*
-     * if outqueue is not empty, add to outqueue
-     * (because message must be sent *after* messages already in outqueue)
-     */
     if (client->outqueue)
     {
-        relay_client_outqueue_add (client, ptr_data, data_size,
-                                   raw_flags, raw_msg, raw_size);
+        /*
+         * if outqueue is not empty, add to outqueue
+         * (because message must be sent *after* messages already in outqueue)
+         */
+        if (relay_client_outqueue_full (client, size))
+            goto end;
     }
     else
     {
-#ifdef HAVE_GNUTLS
-        if (client->ssl)
-            num_sent = gnutls_record_send (client->gnutls_sess, ptr_data, data_size);
-        else
-#endif
-            num_sent = send (client->sock, ptr_data, data_size, 0);
-
+        num_sent = relay_client_send_buffers (client, buffers, num_buffers);
         if (num_sent >= 0)
         {
             for (i = 0; i < 2; i++)
@@ -794,6 +1303,7 @@ relay_client_send (struct t_relay_client *client, const char *data,
                 {
                     relay_raw_print (client,
                                      raw_flags[i], raw_msg[i], raw_size[i]);
+                    raw_msg[i] = NULL;
                 }
             }
             if (num_sent > 0)
@@ -801,74 +1311,70 @@ relay_client_send (struct t_relay_client *client, const char *data,
                 client->bytes_sent += num_sent;
                 relay_buffer_refresh (NULL);
             }
-            if (num_sent < data_size)
-            {
-                /* some data was not sent, add it to outqueue */
-                relay_client_outqueue_add (client, ptr_data + num_sent,
-                                           data_size - num_sent,
-                                           NULL, NULL, NULL);
-            }
+            offset = num_sent;
         }
-        else if (num_sent < 0)
+        else if (!relay_client_send_check_error (client, num_sent))
         {
-#ifdef HAVE_GNUTLS
-            if (client->ssl)
-            {
-                if ((num_sent == GNUTLS_E_AGAIN)
-                    || (num_sent == GNUTLS_E_INTERRUPTED))
-                {
-                    /* add message to queue (will be sent later) */
-                    relay_client_outqueue_add (client, ptr_data, data_size,
-                                               raw_flags, raw_msg, raw_size);
-                }
-                else
-                {
-                    weechat_printf_tags (NULL, "relay_client",
-                                         _("%s%s: sending data to client %s%s%s: "
-                                           "error %d %s"),
-                                         weechat_prefix ("error"),
-                                         RELAY_PLUGIN_NAME,
-                                         RELAY_COLOR_CHAT_CLIENT,
-                                         client->desc,
-                                         RELAY_COLOR_CHAT,
-                                         num_sent,
-                                         gnutls_strerror (num_sent));
-                    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
-                }
-            }
-            else
-#endif
-            {
-                if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                {
-                    /* add message to queue (will be sent later) */
-                    relay_client_outqueue_add (client, ptr_data, data_size,
-                                               raw_flags, raw_msg, raw_size);
-                }
-                else
-                {
-                    weechat_printf_tags (NULL, "relay_client",
-                                         _("%s%s: sending data to client %s%s%s: "
-                                           "error %d %s"),
-                                         weechat_prefix ("error"),
-                                         RELAY_PLUGIN_NAME,
-                                         RELAY_COLOR_CHAT_CLIENT,
-                                         client->desc,
-                                         RELAY_COLOR_CHAT,
-                                         errno,
-                                         strerror (errno));
-                    relay_client_set_status (client, RELAY_STATUS_DISCONNECTED);
-                }
-            }
+            goto end;
         }
     }
 
+    /* add data not sent in out queue (will be sent later) */
+    if (offset < size)
+    {
+        relay_client_outqueue_add_buffers (client, shared_data,
+                                           buffers, num_buffers, offset,
+                                           raw_flags, raw_msg, raw_size);
+    }
+
+end:
     if (websocket_frame)
         free (websocket_frame);
+    relay_client_outqueue_data_unref (deflated_data);
 
     return num_sent;
 }
 
+/*
+ * Sends data to client (adds in out queue if it's impossible to send now).
+ *
+ * If "message_raw_buffer" is not NULL, it is used for display in raw buffer
+ * and replaces display of data, which is default.
+ *
+ * Returns number of bytes sent to client, -1 if error.
+ */
+
+int
+relay_client_send (struct t_relay_client *client, const char *data,
+                   int data_size, const char *message_raw_buffer)
+{
+    return relay_client_send_message (client, NULL, data, data_size,
+                                      message_raw_buffer);
+}
+
+/*
+ * Sends shared data to client: if it can not be sent now, a reference on
+ * data is added in out queue (data is not copied), so the same data can be
+ * queued for many clients.
+ *
+ * If "message_raw_buffer" is not NULL, it is used for display in raw buffer
+ * and replaces display of data, which is default.
+ *
+ * Returns number of bytes sent to client, -1 if error.
+ */
+
+int
+relay_client_send_data (struct t_relay_client *client,
+                        struct t_relay_client_outqueue_data *data,
+                        const char *message_raw_buffer)
+{
+    if (!data)
+        return -1;
+
+    return relay_client_send_message (client, data, data->data, data->size,
+                                      message_raw_buffer);
+}
+
 /*
  * Timer callback, called each second.
  */
@@ -877,8 +1383,7 @@ int
 relay_client_timer_cb (void *data, int remaining_calls)
 {
     struct t_relay_client *ptr_client, *ptr_next_client;
-    int num_sent, i, purge_delay;
-    char *buf;
+    int purge_delay;
     time_t current_time;
 
     /* make C compiler happy */
@@ -905,130 +1410,7 @@ relay_client_timer_cb (void *data, int remaining_calls)
         }
         else if (ptr_client->sock >= 0)
         {
-            while (ptr_client->outqueue)
-            {
-#ifdef HAVE_GNUTLS
-                if (ptr_client->ssl)
-                {
-                    num_sent = gnutls_record_send (ptr_client->gnutls_sess,
-                                                   ptr_client->outqueue->data,
-                                                   ptr_client->outqueue->data_size);
-                }
-                else
-#endif
-                {
-                    num_sent = send (ptr_client->sock,
-                                     ptr_client->outqueue->data,
-                                     ptr_client->outqueue->data_size, 0);
-                }
-                if (num_sent >= 0)
-                {
-                    for (i = 0; i < 2; i++)
-                    {
-                        if (ptr_client->outqueue->raw_message
-                            && ptr_client->outqueue->raw_message[i])
-                        {
-                            /*
-                             * print raw message and remove it from outqueue
-                             * (so that it is displayed only one time, even if
-                             * message is sent in many chunks)
-                             */
-                            relay_raw_print (ptr_client,
-                                             ptr_client->outqueue->raw_flags[i],
-                                             ptr_client->outqueue->raw_message[i],
-                                             ptr_client->outqueue->raw_size[i]);
-                            ptr_client->outqueue->raw_flags[i] = 0;
-                            free (ptr_client->outqueue->raw_message[i]);
-                            ptr_client->outqueue->raw_message[i] = NULL;
-                            ptr_client->outqueue->raw_size[i] = 0;
-                        }
-                    }
-                    if (num_sent > 0)
-                    {
-                        ptr_client->bytes_sent += num_sent;
-                        relay_buffer_refresh (NULL);
-                    }
-                    if (num_sent == ptr_client->outqueue->data_size)
-                    {
-                        /* whole data sent, remove outqueue */
-                        relay_client_outqueue_free (ptr_client,
-                                                    ptr_client->outqueue);
-                    }
-                    else
-                    {
-                        /*
-                         * some data was not sent, update outqueue and stop
-                         * sending data from outqueue
-                         */
-                        if (num_sent > 0)
-                        {
-                            buf = malloc (ptr_client->outqueue->data_size - num_sent);
-                            if (buf)
-                            {
-                                memcpy (buf,
-                                        ptr_client->outqueue->data + num_sent,
-                                        ptr_client->outqueue->data_size - num_sent);
-                                free (ptr_client->outqueue->data);
-                                ptr_client->outqueue->data = buf;
-                                ptr_client->outqueue->data_size = ptr_client->outqueue->data_size - num_sent;
-                            }
-                        }
-                        break;
-                    }
-                }
-                else if (num_sent < 0)
-                {
-#ifdef HAVE_GNUTLS
-                    if (ptr_client->ssl)
-                    {
-                        if ((num_sent == GNUTLS_E_AGAIN)
-                            || (num_sent == GNUTLS_E_INTERRUPTED))
-                        {
-                            /* we will retry later this client's queue */
-                            break;
-                        }
-                        else
-                        {
-                            weechat_printf_tags (NULL, "relay_client",
-                                                 _("%s%s: sending data to client "
-                                                   "%s%s%s: error %d %s"),
-                                                 weechat_prefix ("error"),
-                                                 RELAY_PLUGIN_NAME,
-                                                 RELAY_COLOR_CHAT_CLIENT,
-                                                 ptr_client->desc,
-                                                 RELAY_COLOR_CHAT,
-                                                 num_sent,
-                                                 gnutls_strerror (num_sent));
-                            relay_client_set_status (ptr_client,
-                                                     RELAY_STATUS_DISCONNECTED);
-                        }
-                    }
-                    else
-#endif
-                    {
-                        if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
-                        {
-                            /* we will retry later this client's queue */
-                            break;
-                        }
-                        else
-                        {
-                            weechat_printf_tags (NULL, "relay_client",
-                                                 _("%s%s: sending data to client "
-                                                   "%s%s%s: error %d %s"),
-                                                 weechat_prefix ("error"),
-                                                 RELAY_PLUGIN_NAME,
-                                                 RELAY_COLOR_CHAT_CLIENT,
-                                                 ptr_client->desc,
-                                                 RELAY_COLOR_CHAT,
-                                                 errno,
-                                                 strerror (errno));
-                            relay_client_set_status (ptr_client,
-                                                     RELAY_STATUS_DISCONNECTED);
-                        }
-                    }
-                }
-            }
+            relay_client_outqueue_flush (ptr_client);
         }
 
         ptr_client = ptr_next_client;
@@ -1059,11 +1441,13 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
         new_client->desc = NULL;
         new_client->sock = sock;
         new_client->ssl = server->ssl;
+        new_client->ssl_resumed = 0;
 #ifdef HAVE_GNUTLS
         new_client->hook_timer_handshake = NULL;
 #endif
         new_client->websocket = 0;
         new_client->http_headers = NULL;
+        new_client->ws_deflate = NULL;
         new_client->address = strdup ((address) ? address : "?");
         new_client->status = RELAY_STATUS_CONNECTED;
         new_client->protocol = server->protocol;
@@ -1134,6 +1518,12 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
             gnutls_init (&(new_client->gnutls_sess), GNUTLS_SERVER);
             if (relay_gnutls_priority_cache)
                 gnutls_priority_set (new_client->gnutls_sess, *relay_gnutls_priority_cache);
+            /* session tickets: let clients resume a previous session */
+            if (relay_gnutls_session_ticket_key.data)
+            {
+                gnutls_session_ticket_enable_server (new_client->gnutls_sess,
+                                                     &relay_gnutls_session_ticket_key);
+            }
             gnutls_credentials_set (new_client->gnutls_sess, GNUTLS_CRD_CERTIFICATE, relay_gnutls_x509_cred);
             gnutls_certificate_server_set_request (new_client->gnutls_sess, GNUTLS_CERT_IGNORE);
             gnutls_transport_set_ptr (new_client->gnutls_sess,
@@ -1163,6 +1553,9 @@ relay_client_new (int sock, const char *address, struct t_relay_server *server)
 
         new_client->outqueue = NULL;
         new_client->last_outqueue = NULL;
+        new_client->hook_fd_write = NULL;
+        new_client->outqueue_size = 0;
+        new_client->outqueue_dropped = 0;
 
         new_client->prev_client = NULL;
         new_client->next_client = relay_clients;
@@ -1226,12 +1619,27 @@ relay_client_new_with_infolist (struct t_infolist *infolist)
         new_client->desc = NULL;
         new_client->sock = weechat_infolist_integer (infolist, "sock");
         new_client->ssl = weechat_infolist_integer (infolist, "ssl");
+        new_client->ssl_resumed = weechat_infolist_integer (infolist, "ssl_resumed");
 #ifdef HAVE_GNUTLS
         new_client->gnutls_sess = NULL;
         new_client->hook_timer_handshake = NULL;
 #endif
         new_client->websocket = weechat_infolist_integer (infolist, "websocket");
         new_client->http_headers = NULL;
+        new_client->ws_deflate = NULL;
+        if (weechat_infolist_integer (infolist, "ws_deflate_enabled"))
+        {
+            /* streams are not saved: new ones are started */
+            new_client->ws_deflate = relay_websocket_deflate_alloc ();
+            if (new_client->ws_deflate)
+            {
+                new_client->ws_deflate->enabled = 1;
+                new_client->ws_deflate->deflate_disabled = weechat_infolist_integer (infolist, "ws_deflate_deflate_disabled");
+                new_client->ws_deflate->server_context_takeover = weechat_infolist_integer (infolist, "ws_deflate_server_context_takeover");
+                new_client->ws_deflate->client_context_takeover = weechat_infolist_integer (infolist, "ws_deflate_client_context_takeover");
+                new_client->ws_deflate->window_bits_deflate = weechat_infolist_integer (infolist, "ws_deflate_window_bits_deflate");
+            }
+        }
         new_client->address = strdup (weechat_infolist_string (infolist, "address"));
         new_client->status = weechat_infolist_integer (infolist, "status");
         new_client->protocol = weechat_infolist_integer (infolist, "protocol");
@@ -1283,6 +1691,12 @@ relay_client_new_with_infolist (struct t_infolist *infolist)
 
         new_client->outqueue = NULL;
         new_client->last_outqueue = NULL;
+        new_client->hook_fd_write = NULL;
+        new_client->outqueue_size = 0;
+        new_client->outqueue_dropped = 0;
+        str = weechat_infolist_string (infolist, "outqueue_dropped");
+        if (str)
+            sscanf (str, "%lu", &(new_client->outqueue_dropped));
 
         new_client->prev_client = NULL;
         new_client->next_client = relay_clients;
@@ -1420,6 +1834,7 @@ relay_client_free (struct t_relay_client *client)
 #endif
     if (client->http_headers)
         weechat_hashtable_free (client->http_headers);
+    relay_websocket_deflate_free (client->ws_deflate);
     if (client->hook_fd)
         weechat_unhook (client->hook_fd);
     if (client->partial_message)
@@ -1524,12 +1939,27 @@ relay_client_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "ssl", client->ssl))
         return 0;
+    if (!weechat_infolist_new_var_integer (ptr_item, "ssl_resumed", client->ssl_resumed))
+        return 0;
 #ifdef HAVE_GNUTLS
     if (!weechat_infolist_new_var_pointer (ptr_item, "hook_timer_handshake", client->hook_timer_handshake))
         return 0;
 #endif
     if (!weechat_infolist_new_var_integer (ptr_item, "websocket", client->websocket))
         return 0;
+    if (client->ws_deflate)
+    {
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_enabled", client->ws_deflate->enabled))
+            return 0;
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_deflate_disabled", client->ws_deflate->deflate_disabled))
+            return 0;
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_server_context_takeover", client->ws_deflate->server_context_takeover))
+            return 0;
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_client_context_takeover", client->ws_deflate->client_context_takeover))
+            return 0;
+        if (!weechat_infolist_new_var_integer (ptr_item, "ws_deflate_window_bits_deflate", client->ws_deflate->window_bits_deflate))
+            return 0;
+    }
     if (!weechat_infolist_new_var_string (ptr_item, "address", client->address))
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "status", client->status))
@@ -1552,6 +1982,8 @@ relay_client_add_to_infolist (struct t_infolist *infolist,
         return 0;
     if (!weechat_infolist_new_var_pointer (ptr_item, "hook_fd", client->hook_fd))
         return 0;
+    if (!weechat_infolist_new_var_pointer (ptr_item, "hook_fd_write", client->hook_fd_write))
+        return 0;
     if (!weechat_infolist_new_var_time (ptr_item, "last_activity", client->last_activity))
         return 0;
     snprintf (value, sizeof (value), "%lu", client->bytes_recv);
@@ -1560,6 +1992,12 @@ relay_client_add_to_infolist (struct t_infolist *infolist,
     snprintf (value, sizeof (value), "%lu", client->bytes_sent);
     if (!weechat_infolist_new_var_string (ptr_item, "bytes_sent", value))
         return 0;
+    snprintf (value, sizeof (value), "%lu", client->outqueue_size);
+    if (!weechat_infolist_new_var_string (ptr_item, "outqueue_size", value))
+        return 0;
+    snprintf (value, sizeof (value), "%lu", client->outqueue_dropped);
+    if (!weechat_infolist_new_var_string (ptr_item, "outqueue_dropped", value))
+        return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "recv_data_type", client->recv_data_type))
         return 0;
     if (!weechat_infolist_new_var_integer (ptr_item, "send_data_type", client->send_data_type))
@@ -1600,6 +2038,7 @@ relay_client_print_log ()
         weechat_log_printf ("  desc. . . . . . . . . : '%s'", ptr_client->desc);
         weechat_log_printf ("  sock. . . . . . . . . : %d",   ptr_client->sock);
         weechat_log_printf ("  ssl . . . . . . . . . : %d",   ptr_client->ssl);
+        weechat_log_printf ("  ssl_resumed . . . . . : %d",   ptr_client->ssl_resumed);
 #ifdef HAVE_GNUTLS
         weechat_log_printf ("  gnutls_sess . . . . . : 0x%lx", ptr_client->gnutls_sess);
         weechat_log_printf ("  hook_timer_handshake. : 0x%lx", ptr_client->hook_timer_handshake);
@@ -1608,6 +2047,18 @@ relay_client_print_log ()
         weechat_log_printf ("  http_headers. . . . . : 0x%lx (hashtable: '%s')",
                             ptr_client->http_headers,
                             weechat_hashtable_get_string (ptr_client->http_headers, "keys_values"));
+        weechat_log_printf ("  ws_deflate. . . . . . : 0x%lx", ptr_client->ws_deflate);
+        if (ptr_client->ws_deflate)
+        {
+            weechat_log_printf ("    enabled . . . . . . . . : %d",   ptr_client->ws_deflate->enabled);
+            weechat_log_printf ("    deflate_disabled. . . . : %d",   ptr_client->ws_deflate->deflate_disabled);
+            weechat_log_printf ("    server_context_takeover : %d",   ptr_client->ws_deflate->server_context_takeover);
+            weechat_log_printf ("    client_context_takeover : %d",   ptr_client->ws_deflate->client_context_takeover);
+            weechat_log_printf ("    window_bits_deflate . . : %d",   ptr_client->ws_deflate->window_bits_deflate);
+            weechat_log_printf ("    inflate_message . . . . : %d",   ptr_client->ws_deflate->inflate_message);
+            weechat_log_printf ("    strm_deflate. . . . . . : 0x%lx", ptr_client->ws_deflate->strm_deflate);
+            weechat_log_printf ("    strm_inflate. . . . . . : 0x%lx", ptr_client->ws_deflate->strm_inflate);
+        }
         weechat_log_printf ("  address . . . . . . . : '%s'", ptr_client->address);
         weechat_log_printf ("  status. . . . . . . . : %d (%s)",
                             ptr_client->status,
@@ -1621,6 +2072,7 @@ relay_client_print_log ()
         weechat_log_printf ("  start_time. . . . . . : %ld",   ptr_client->start_time);
         weechat_log_printf ("  end_time. . . . . . . : %ld",   ptr_client->end_time);
         weechat_log_printf ("  hook_fd . . . . . . . : 0x%lx", ptr_client->hook_fd);
+        weechat_log_printf ("  hook_fd_write . . . . : 0x%lx", ptr_client->hook_fd_write);
         weechat_log_printf ("  last_activity . . . . : %ld",   ptr_client->last_activity);
         weechat_log_printf ("  bytes_recv. . . . . . : %lu",   ptr_client->bytes_recv);
         weechat_log_printf ("  bytes_sent. . . . . . : %lu",   ptr_client->bytes_sent);
@@ -1645,6 +2097,8 @@ relay_client_print_log ()
         }
         weechat_log_printf ("  outqueue. . . . . . . : 0x%lx", ptr_client->outqueue);
         weechat_log_printf ("  last_outqueue . . . . : 0x%lx", ptr_client->last_outqueue);
+        weechat_log_printf ("  outqueue_size . . . . : %lu",   ptr_client->outqueue_size);
+        weechat_log_printf ("  outqueue_dropped. . . : %lu",   ptr_client->outqueue_dropped);
         weechat_log_printf ("  prev_client . . . . . : 0x%lx", ptr_client->prev_client);
         weechat_log_printf ("  next_client . . . . . : 0x%lx", ptr_client->next_client);
     }
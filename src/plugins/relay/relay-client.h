@@ -55,12 +55,37 @@ enum t_relay_client_data_type
     ((client->status == RELAY_STATUS_AUTH_FAILED) ||                    \
      (client->status == RELAY_STATUS_DISCONNECTED))
 
+/* max number of messages in out queue sent with one call to writev */
+
+#define RELAY_CLIENT_OUTQUEUE_MAX_BUFFERS 64
+
+/* actions when out queue of a client is full */
+
+enum t_relay_client_outqueue_full_action
+{
+    RELAY_CLIENT_OUTQUEUE_FULL_DISCONNECT = 0, /* disconnect client         */
+    RELAY_CLIENT_OUTQUEUE_FULL_DROP,   /* drop new messages                 */
+    /* number of actions */
+    RELAY_CLIENT_NUM_OUTQUEUE_FULL_ACTIONS,
+};
+
+/* data of messages in out queue (can be shared by many clients) */
+
+struct t_relay_client_outqueue_data
+{
+    char *data;                         /* data to send                     */
+    int size;                           /* number of bytes                  */
+    int refcount;                       /* number of references             */
+    struct t_relay_client_outqueue_data *deflated; /* data compressed for   */
+                                        /* websocket (no context takeover)  */
+};
+
 /* output queue of messages to client */
 
 struct t_relay_client_outqueue
 {
-    char *data;                         /* data to send                     */
-    int data_size;                      /* number of bytes                  */
+    struct t_relay_client_outqueue_data *data; /* data to send              */
+    int offset;                         /* number of bytes already sent     */
     int raw_flags[2];                   /* flags for raw messages           */
     char *raw_message[2];               /* msgs for raw buffer (can be NULL)*/
     int raw_size[2];                    /* size (in bytes) of raw messages  */
@@ -76,12 +101,14 @@ struct t_relay_client
     char *desc;                        /* description, used for display     */
     int sock;                          /* socket for connection             */
     int ssl;                           /* 1 if SSL is enabled               */
+    int ssl_resumed;                   /* 1 if TLS session was resumed      */
 #ifdef HAVE_GNUTLS
     gnutls_session_t gnutls_sess;      /* gnutls session (only if SSL used) */
     struct t_hook *hook_timer_handshake; /* timer for doing gnutls handshake*/
 #endif
     int websocket;                     /* 0=not a ws, 1=init ws, 2=ws ready */
     struct t_hashtable *http_headers;  /* HTTP headers for websocket        */
+    struct t_relay_websocket_deflate *ws_deflate; /* "permessage-deflate"   */
     char *address;                     /* string with IP address            */
     enum t_relay_status status;        /* status (connecting, active,..)    */
     enum t_relay_protocol protocol;    /* protocol (irc,..)                 */
@@ -92,6 +119,8 @@ struct t_relay_client
     time_t start_time;                 /* time of client connection         */
     time_t end_time;                   /* time of client disconnection      */
     struct t_hook *hook_fd;            /* hook for socket or child pipe     */
+    struct t_hook *hook_fd_write;      /* hook for socket (write), only if  */
+                                       /* out queue is not empty            */
     time_t last_activity;              /* time of last byte received/sent   */
     unsigned long bytes_recv;          /* bytes received from client        */
     unsigned long bytes_sent;          /* bytes sent to client              */
@@ -101,6 +130,8 @@ struct t_relay_client
     void *protocol_data;               /* data depending on protocol used   */
     struct t_relay_client_outqueue *outqueue; /* queue for outgoing msgs    */
     struct t_relay_client_outqueue *last_outqueue; /* last outgoing msg     */
+    unsigned long outqueue_size;       /* bytes waiting in out queue        */
+    unsigned long outqueue_dropped;    /* msgs dropped (out queue full)     */
     struct t_relay_client *prev_client;/* link to previous client           */
     struct t_relay_client *next_client;/* link to next client               */
 };
@@ -116,8 +147,15 @@ extern struct t_relay_client *relay_client_search_by_id (int id);
 extern int relay_client_status_search (const char *name);
 extern void relay_client_set_desc (struct t_relay_client *client);
 extern int relay_client_recv_cb (void *arg_client, int fd);
+extern int relay_client_send_cb (void *arg_client, int fd);
+extern struct t_relay_client_outqueue_data *relay_client_outqueue_data_new (char *data,
+                                                                            int size);
+extern void relay_client_outqueue_data_unref (struct t_relay_client_outqueue_data *data);
 extern int relay_client_send (struct t_relay_client *client, const char *data,
                               int data_size, const char *message_raw_buffer);
+extern int relay_client_send_data (struct t_relay_client *client,
+                                   struct t_relay_client_outqueue_data *data,
+                                   const char *message_raw_buffer);
 extern int relay_client_timer_cb (void *data, int remaining_calls);
 extern struct t_relay_client *relay_client_new (int sock, const char *address,
                                                 struct t_relay_server *server);
@@ -30,6 +30,8 @@
 #include "relay-buffer.h"
 #include "relay-network.h"
 #include "relay-server.h"
+#include "weechat/relay-weechat.h"
+#include "weechat/relay-weechat-msg.h"
 
 
 struct t_config_file *relay_config_file = NULL;
@@ -54,11 +56,18 @@ struct t_config_option *relay_config_network_allowed_ips;
 struct t_config_option *relay_config_network_bind_address;
 struct t_config_option *relay_config_network_clients_purge_delay;
 struct t_config_option *relay_config_network_compression_level;
+struct t_config_option *relay_config_network_compression_level_lz4;
+struct t_config_option *relay_config_network_compression_level_zstd;
+struct t_config_option *relay_config_network_compression_zstd_dict;
 struct t_config_option *relay_config_network_ipv6;
 struct t_config_option *relay_config_network_max_clients;
+struct t_config_option *relay_config_network_max_outqueue_size;
+struct t_config_option *relay_config_network_outqueue_full_action;
 struct t_config_option *relay_config_network_password;
 struct t_config_option *relay_config_network_ssl_cert_key;
 struct t_config_option *relay_config_network_websocket_allowed_origins;
+struct t_config_option *relay_config_network_websocket_permessage_deflate;
+struct t_config_option *relay_config_network_websocket_permessage_deflate_context_takeover;
 
 /* relay config, irc section */
 
@@ -190,6 +199,22 @@ relay_config_change_network_ssl_cert_key (void *data,
         relay_network_set_ssl_cert_key (1);
 }
 
+/*
+ * Callback for changes on options "relay.network.compression_level_zstd" and
+ * "relay.network.compression_zstd_dict".
+ */
+
+void
+relay_config_change_network_compression_zstd (void *data,
+                                              struct t_config_option *option)
+{
+    /* make C compiler happy */
+    (void) data;
+    (void) option;
+
+    relay_weechat_msg_zstd_reset ();
+}
+
 /*
  * Callback for changes on option "relay.network.websocker_allowed_origins".
  */
@@ -620,6 +645,34 @@ relay_config_init ()
            "compression)"),
         NULL, 0, 9, "6", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL);
+    relay_config_network_compression_level_lz4 = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "compression_level_lz4", "integer",
+        N_("compression level for packets sent to client with WeeChat protocol "
+           "and compression \"lz4\" (0 = fast compression, 1 = low "
+           "compression ... 12 = best compression, with algorithm LZ4 HC)"),
+        NULL, 0, 12, "0", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL);
+    relay_config_network_compression_level_zstd = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "compression_level_zstd", "integer",
+        N_("compression level for packets sent to client with WeeChat protocol "
+           "and compression \"zstd\" (0 = disable compression, 1 = low "
+           "compression ... 19 = best compression)"),
+        NULL, 0, 19, "3", NULL, 0,
+        NULL, NULL,
+        &relay_config_change_network_compression_zstd, NULL, NULL, NULL);
+    relay_config_network_compression_zstd_dict = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "compression_zstd_dict", "string",
+        N_("path to a dictionary used for compression \"zstd\" (for example "
+           "trained with \"zstd --train\" on messages of WeeChat protocol); "
+           "client must use the same dictionary to decompress messages; "
+           "\"%h\" will be replaced by WeeChat home (\"~/.weechat\" by "
+           "default); empty value = no dictionary"),
+        NULL, 0, 0, "", NULL, 0,
+        NULL, NULL,
+        &relay_config_change_network_compression_zstd, NULL, NULL, NULL);
     relay_config_network_ipv6 = weechat_config_new_option (
         relay_config_file, ptr_section,
         "ipv6", "boolean",
@@ -634,6 +687,28 @@ relay_config_init ()
         N_("maximum number of clients connecting to a port"),
         NULL, 1, 1024, "5", NULL, 0,
         NULL, NULL, NULL, NULL, NULL, NULL);
+    relay_config_network_max_outqueue_size = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "max_outqueue_size", "integer",
+        N_("maximum size of data waiting to be sent to a client (in "
+           "kilobytes), when the client does not read data fast enough; when "
+           "this size is reached, the action is given by option "
+           "relay.network.outqueue_full_action (0 = unlimited)"),
+        NULL, 0, INT_MAX, "16384", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL);
+    relay_config_network_outqueue_full_action = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "outqueue_full_action", "integer",
+        N_("action when the size of data waiting to be sent to a client "
+           "reaches relay.network.max_outqueue_size: disconnect = disconnect "
+           "the client, drop = drop new messages for this client until there "
+           "is enough space in queue (messages are lost for the client; a "
+           "client using WeeChat protocol with compression \"zlib-stream\" "
+           "or protocol version 2, or a websocket client with extension "
+           "\"permessage-deflate\" and context takeover is always "
+           "disconnected)"),
+        "disconnect|drop", 0, 0, "disconnect", NULL, 0,
+        NULL, NULL, NULL, NULL, NULL, NULL);
     relay_config_network_password = weechat_config_new_option (
         relay_config_file, ptr_section,
         "password", "string",
@@ -657,6 +732,25 @@ relay_config_init ()
            "\"^http://(www\\.)?example\\.(com|org)\""),
         NULL, 0, 0, "", NULL, 0, NULL, NULL,
         &relay_config_change_network_websocket_allowed_origins, NULL, NULL, NULL);
+    relay_config_network_websocket_permessage_deflate = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "websocket_permessage_deflate", "boolean",
+        N_("compress messages sent to websocket clients with extension "
+           "\"permessage-deflate\" (RFC 7692), if the client asks it; the "
+           "compression level is relay.network.compression_level; messages "
+           "sent to a client using WeeChat protocol with a compression other "
+           "than \"off\" are not compressed again (new value is used for "
+           "new websocket clients only)"),
+        NULL, 0, 0, "on", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
+    relay_config_network_websocket_permessage_deflate_context_takeover = weechat_config_new_option (
+        relay_config_file, ptr_section,
+        "websocket_permessage_deflate_context_takeover", "boolean",
+        N_("keep the compression context between messages sent to websocket "
+           "clients using extension \"permessage-deflate\" (better "
+           "compression, but messages are compressed for each client); if "
+           "disabled, a message sent to many clients is compressed only once "
+           "(new value is used for new websocket clients only)"),
+        NULL, 0, 0, "on", NULL, 0, NULL, NULL, NULL, NULL, NULL, NULL);
 
     /* section irc */
     ptr_section = weechat_config_new_section (relay_config_file, "irc",
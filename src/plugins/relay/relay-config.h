@@ -40,11 +40,18 @@ extern struct t_config_option *relay_config_network_allowed_ips;
 extern struct t_config_option *relay_config_network_bind_address;
 extern struct t_config_option *relay_config_network_clients_purge_delay;
 extern struct t_config_option *relay_config_network_compression_level;
+extern struct t_config_option *relay_config_network_compression_level_lz4;
+extern struct t_config_option *relay_config_network_compression_level_zstd;
+extern struct t_config_option *relay_config_network_compression_zstd_dict;
 extern struct t_config_option *relay_config_network_ipv6;
 extern struct t_config_option *relay_config_network_max_clients;
+extern struct t_config_option *relay_config_network_max_outqueue_size;
+extern struct t_config_option *relay_config_network_outqueue_full_action;
 extern struct t_config_option *relay_config_network_password;
 extern struct t_config_option *relay_config_network_ssl_cert_key;
 extern struct t_config_option *relay_config_network_websocket_allowed_origins;
+extern struct t_config_option *relay_config_network_websocket_permessage_deflate;
+extern struct t_config_option *relay_config_network_websocket_permessage_deflate_context_takeover;
 
 extern struct t_config_option *relay_config_irc_backlog_max_minutes;
 extern struct t_config_option *relay_config_irc_backlog_max_number;
@@ -38,6 +38,7 @@ int relay_network_init_ssl_cert_key_ok = 0;
 gnutls_certificate_credentials_t relay_gnutls_x509_cred;
 gnutls_priority_t *relay_gnutls_priority_cache = NULL;
 gnutls_dh_params_t *relay_gnutls_dh_params = NULL;
+gnutls_datum_t relay_gnutls_session_ticket_key = { NULL, 0 };
 #endif
 
 
@@ -130,6 +131,13 @@ relay_network_init ()
             relay_gnutls_priority_cache = NULL;
         }
     }
+
+    /* key for session tickets (resumption of TLS sessions) */
+    if (gnutls_session_ticket_key_generate (&relay_gnutls_session_ticket_key) != GNUTLS_E_SUCCESS)
+    {
+        relay_gnutls_session_ticket_key.data = NULL;
+        relay_gnutls_session_ticket_key.size = 0;
+    }
 #endif
     relay_network_init_ok = 1;
 }
@@ -156,6 +164,14 @@ relay_network_end ()
             free (relay_gnutls_dh_params);
             relay_gnutls_dh_params = NULL;
         }
+        if (relay_gnutls_session_ticket_key.data)
+        {
+            gnutls_memset (relay_gnutls_session_ticket_key.data, 0,
+                           relay_gnutls_session_ticket_key.size);
+            gnutls_free (relay_gnutls_session_ticket_key.data);
+            relay_gnutls_session_ticket_key.data = NULL;
+            relay_gnutls_session_ticket_key.size = 0;
+        }
         gnutls_certificate_free_credentials (relay_gnutls_x509_cred);
 #endif
         relay_network_init_ok = 0;
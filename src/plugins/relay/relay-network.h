@@ -31,6 +31,7 @@ extern int relay_network_init_ssl_cert_key_ok;
 extern gnutls_certificate_credentials_t relay_gnutls_x509_cred;
 extern gnutls_priority_t *relay_gnutls_priority_cache;
 extern gnutls_dh_params_t *relay_gnutls_dh_params;
+extern gnutls_datum_t relay_gnutls_session_ticket_key;
 #endif
 
 extern void relay_network_set_ssl_cert_key (int verbose);
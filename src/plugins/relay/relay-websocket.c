@@ -1,5 +1,6 @@
 /*
- * relay-websocket.c - websocket server functions for relay plugin (RFC 6455)
+ * relay-websocket.c - websocket server functions for relay plugin (RFC 6455),
+ *                     with extension "permessage-deflate" (RFC 7692)
  *
  * Copyright (C) 2013-2014 Sébastien Helleu <flashcode@flashtux.org>
  *
@@ -24,11 +25,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <gcrypt.h>
+#include <zlib.h>
 
 #include "../weechat-plugin.h"
 #include "relay.h"
 #include "relay-client.h"
+#include "weechat/relay-weechat.h"
 #include "relay-config.h"
+#include "relay-websocket.h"
 
 
 /*
@@ -169,6 +173,266 @@ relay_websocket_client_handshake_valid (struct t_relay_client *client)
     return 0;
 }
 
+/*
+ * Allocates a structure for extension "permessage-deflate" (default is
+ * context takeover in both directions, with max window).
+ *
+ * Returns pointer to new structure, NULL if error.
+ */
+
+struct t_relay_websocket_deflate *
+relay_websocket_deflate_alloc ()
+{
+    struct t_relay_websocket_deflate *new_ws_deflate;
+
+    new_ws_deflate = malloc (sizeof (*new_ws_deflate));
+    if (!new_ws_deflate)
+        return NULL;
+
+    new_ws_deflate->enabled = 0;
+    new_ws_deflate->deflate_disabled = 0;
+    new_ws_deflate->server_context_takeover = 1;
+    new_ws_deflate->client_context_takeover = 1;
+    new_ws_deflate->window_bits_deflate = RELAY_WEBSOCKET_DEFLATE_WINDOW_BITS_MAX;
+    new_ws_deflate->inflate_message = 0;
+    new_ws_deflate->strm_deflate = NULL;
+    new_ws_deflate->strm_inflate = NULL;
+
+    return new_ws_deflate;
+}
+
+/*
+ * Frees the deflate stream (a new stream is started on next message sent).
+ */
+
+void
+relay_websocket_deflate_free_deflate (struct t_relay_websocket_deflate *ws_deflate)
+{
+    if (!ws_deflate->strm_deflate)
+        return;
+
+    deflateEnd (ws_deflate->strm_deflate);
+    free (ws_deflate->strm_deflate);
+    ws_deflate->strm_deflate = NULL;
+}
+
+/*
+ * Frees the inflate stream (a new stream is started on next message
+ * received).
+ */
+
+void
+relay_websocket_deflate_free_inflate (struct t_relay_websocket_deflate *ws_deflate)
+{
+    if (!ws_deflate->strm_inflate)
+        return;
+
+    inflateEnd (ws_deflate->strm_inflate);
+    free (ws_deflate->strm_inflate);
+    ws_deflate->strm_inflate = NULL;
+}
+
+/*
+ * Frees a structure for extension "permessage-deflate".
+ */
+
+void
+relay_websocket_deflate_free (struct t_relay_websocket_deflate *ws_deflate)
+{
+    if (!ws_deflate)
+        return;
+
+    relay_websocket_deflate_free_deflate (ws_deflate);
+    relay_websocket_deflate_free_inflate (ws_deflate);
+
+    free (ws_deflate);
+}
+
+/*
+ * Parses parameters of an offer for extension "permessage-deflate" received
+ * from client (params[0] is the extension name), for example:
+ *   permessage-deflate; client_max_window_bits; server_max_window_bits=10
+ *
+ * Returns:
+ *   1: offer accepted (ws_deflate is set with parameters of offer)
+ *   0: offer declined (unknown, duplicated or invalid parameter)
+ */
+
+int
+relay_websocket_deflate_parse_offer (struct t_relay_websocket_deflate *ws_deflate,
+                                     char **params, int num_params,
+                                     int *server_max_window_bits)
+{
+    char *param, *name, *value, *pos, *error;
+    long number;
+    int i, valid, seen[4];
+
+    *server_max_window_bits = 0;
+    memset (seen, 0, sizeof (seen));
+
+    for (i = 1; i < num_params; i++)
+    {
+        param = weechat_string_strip (params[i], 1, 1, " \t");
+        if (!param)
+            return 0;
+        name = param;
+        value = NULL;
+        number = -1;
+        pos = strchr (param, '=');
+        if (pos)
+        {
+            /* value can be quoted (RFC 7692, section 7.1) */
+            value = pos + 1;
+            while (pos > param && ((pos[-1] == ' ') || (pos[-1] == '\t')))
+            {
+                pos--;
+            }
+            pos[0] = '\0';
+            while ((value[0] == ' ') || (value[0] == '\t') || (value[0] == '"'))
+            {
+                value++;
+            }
+            error = NULL;
+            number = strtol (value, &error, 10);
+            if (!error || (error == value) || (error[0] && (error[0] != '"')))
+                number = -1;
+        }
+        valid = 0;
+        if (strcmp (name, "server_no_context_takeover") == 0)
+        {
+            if (!seen[0] && !value)
+            {
+                ws_deflate->server_context_takeover = 0;
+                seen[0] = valid = 1;
+            }
+        }
+        else if (strcmp (name, "client_no_context_takeover") == 0)
+        {
+            /* always answered by server */
+            if (!seen[1] && !value)
+                seen[1] = valid = 1;
+        }
+        else if (strcmp (name, "server_max_window_bits") == 0)
+        {
+            /* 8 is valid but not supported by zlib for a raw deflate */
+            if (!seen[2]
+                && (number >= RELAY_WEBSOCKET_DEFLATE_WINDOW_BITS_MIN)
+                && (number <= RELAY_WEBSOCKET_DEFLATE_WINDOW_BITS_MAX))
+            {
+                ws_deflate->window_bits_deflate = number;
+                *server_max_window_bits = number;
+                seen[2] = valid = 1;
+            }
+        }
+        else if (strcmp (name, "client_max_window_bits") == 0)
+        {
+            /* ignored: messages received are inflated with max window */
+            if (!seen[3] && (!value || ((number >= 8) && (number <= 15))))
+                seen[3] = valid = 1;
+        }
+        free (param);
+        if (!valid)
+            return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Negotiates extension "permessage-deflate" with the HTTP header
+ * "Sec-WebSocket-Extensions" received from client: the first offer accepted
+ * is used (other extensions are ignored).
+ *
+ * The server always asks "client_no_context_takeover" (messages received are
+ * short commands, and the inflate stream can then be reset after each
+ * message, which is needed after /upgrade).
+ *
+ * If the extension is accepted, client->ws_deflate is set and "response" is
+ * set with the header to send in handshake, otherwise "response" is an empty
+ * string.
+ */
+
+void
+relay_websocket_deflate_negotiate (struct t_relay_client *client,
+                                   char *response, int response_size)
+{
+    const char *extensions;
+    char **offers, **params, *param;
+    int num_offers, num_params, i, accepted, server_max_window_bits;
+    struct t_relay_websocket_deflate *ws_deflate;
+
+    response[0] = '\0';
+
+    if (!weechat_config_boolean (relay_config_network_websocket_permessage_deflate)
+        || (weechat_config_integer (relay_config_network_compression_level) == 0))
+    {
+        return;
+    }
+
+    extensions = weechat_hashtable_get (client->http_headers,
+                                        "Sec-WebSocket-Extensions");
+    if (!extensions || !extensions[0])
+        return;
+
+    offers = weechat_string_split (extensions, ",", 0, 0, &num_offers);
+    if (!offers)
+        return;
+
+    accepted = 0;
+    for (i = 0; (i < num_offers) && !accepted; i++)
+    {
+        params = weechat_string_split (offers[i], ";", 0, 0, &num_params);
+        if (!params)
+            continue;
+        param = weechat_string_strip (params[0], 1, 1, " \t");
+        if (param && (strcmp (param, "permessage-deflate") == 0))
+        {
+            ws_deflate = relay_websocket_deflate_alloc ();
+            if (ws_deflate)
+            {
+                if (relay_websocket_deflate_parse_offer (ws_deflate,
+                                                         params, num_params,
+                                                         &server_max_window_bits))
+                {
+                    accepted = 1;
+                    ws_deflate->enabled = 1;
+                    ws_deflate->client_context_takeover = 0;
+                    if (!weechat_config_boolean (relay_config_network_websocket_permessage_deflate_context_takeover))
+                        ws_deflate->server_context_takeover = 0;
+                    relay_websocket_deflate_free (client->ws_deflate);
+                    client->ws_deflate = ws_deflate;
+                }
+                else
+                    relay_websocket_deflate_free (ws_deflate);
+            }
+        }
+        if (param)
+            free (param);
+        weechat_string_free_split (params);
+    }
+
+    weechat_string_free_split (offers);
+
+    if (!accepted)
+        return;
+
+    snprintf (response, response_size,
+              "Sec-WebSocket-Extensions: permessage-deflate; "
+              "client_no_context_takeover%s",
+              (client->ws_deflate->server_context_takeover) ?
+              "" : "; server_no_context_takeover");
+    if (server_max_window_bits > 0)
+    {
+        snprintf (response + strlen (response),
+                  response_size - strlen (response),
+                  "; server_max_window_bits=%d",
+                  client->ws_deflate->window_bits_deflate);
+    }
+    snprintf (response + strlen (response),
+              response_size - strlen (response),
+              "\r\n");
+}
+
 /*
  * Builds the handshake that will be returned to client, to initialize and use
  * the websocket.
@@ -178,6 +442,10 @@ relay_websocket_client_handshake_valid (struct t_relay_client *client)
  *   Upgrade: websocket
  *   Connection: Upgrade
  *   Sec-WebSocket-Accept: 73OzoF/IyV9znm7Tsb4EtlEEmn4=
+ *   Sec-WebSocket-Extensions: permessage-deflate; client_no_context_takeover
+ *
+ * (the last header is sent only if extension "permessage-deflate" is asked by
+ * client and accepted).
  *
  * Note: result must be freed after use.
  */
@@ -186,7 +454,7 @@ char *
 relay_websocket_build_handshake (struct t_relay_client *client)
 {
     const char *sec_websocket_key;
-    char *key, sec_websocket_accept[128], handshake[1024];
+    char *key, sec_websocket_accept[128], extensions[256], handshake[1024];
     unsigned char *result;
     gcry_md_hd_t hd;
     int length;
@@ -214,6 +482,9 @@ relay_websocket_build_handshake (struct t_relay_client *client)
     result = gcry_md_read (hd, GCRY_MD_SHA1);
     weechat_string_encode_base64 ((char *)result, length, sec_websocket_accept);
     gcry_md_close (hd);
+    free (key);
+
+    relay_websocket_deflate_negotiate (client, extensions, sizeof (extensions));
 
     /* build the handshake (it will be sent as-is to client) */
     snprintf (handshake, sizeof (handshake),
@@ -222,8 +493,10 @@ relay_websocket_build_handshake (struct t_relay_client *client)
               "Connection: Upgrade\r\n"
               //"Sec-WebSocket-Protocol: chat\r\n"
               "Sec-WebSocket-Accept: %s\r\n"
+              "%s"
               "\r\n",
-              sec_websocket_accept);
+              sec_websocket_accept,
+              extensions);
 
     return strdup (handshake);
 }
@@ -253,7 +526,272 @@ relay_websocket_send_http (struct t_relay_client *client,
 }
 
 /*
- * Decodes a websocket frame.
+ * Checks if a message sent to client can be compressed with extension
+ * "permessage-deflate": messages already compressed by WeeChat protocol are
+ * sent as-is.
+ *
+ * Returns:
+ *   1: message can be compressed
+ *   0: message must be sent uncompressed
+ */
+
+int
+relay_websocket_deflate_message_allowed (struct t_relay_client *client)
+{
+    if (!client->ws_deflate || !client->ws_deflate->enabled
+        || client->ws_deflate->deflate_disabled)
+    {
+        return 0;
+    }
+
+    if (weechat_config_integer (relay_config_network_compression_level) == 0)
+        return 0;
+
+    if ((client->protocol == RELAY_PROTOCOL_WEECHAT)
+        && client->protocol_data
+        && (RELAY_WEECHAT_DATA(client, compression) != RELAY_WEECHAT_COMPRESSION_OFF))
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Compresses a message with the deflate stream of client (the stream is
+ * created on first call; it is reset after each message if there is no
+ * server context takeover).
+ *
+ * The message ends with a sync flush, and the final 4 bytes 0x00 0x00 0xff
+ * 0xff are removed (RFC 7692, section 7.2.1).
+ *
+ * On error, the stream is destroyed and compression of messages sent is
+ * disabled for the client (next messages are sent uncompressed, so the client
+ * can not be desynchronized); messages received are still inflated, since
+ * the extension remains negotiated.
+ *
+ * Returns:
+ *   1: message compressed (*buffer must be freed after use)
+ *   0: message not compressed
+ */
+
+int
+relay_websocket_deflate (struct t_relay_websocket_deflate *ws_deflate,
+                         const char *data, int data_size,
+                         char **buffer, int *size)
+{
+    z_stream *strm;
+    Bytef *dest;
+    uLong dest_size;
+    int rc;
+
+    *buffer = NULL;
+    *size = 0;
+
+    strm = ws_deflate->strm_deflate;
+    if (!strm)
+    {
+        strm = malloc (sizeof (*strm));
+        if (!strm)
+            return 0;
+        memset (strm, 0, sizeof (*strm));
+        /* negative window bits: raw deflate (no zlib header) */
+        if (deflateInit2 (strm,
+                          weechat_config_integer (relay_config_network_compression_level),
+                          Z_DEFLATED,
+                          -1 * ws_deflate->window_bits_deflate,
+                          8,
+                          Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            free (strm);
+            ws_deflate->deflate_disabled = 1;
+            return 0;
+        }
+        ws_deflate->strm_deflate = strm;
+    }
+
+    /* extra bytes for the sync flush (empty stored block) */
+    dest_size = deflateBound (strm, data_size) + 16;
+    dest = malloc (dest_size);
+    if (!dest)
+        goto error;
+
+    strm->next_in = (Bytef *)data;
+    strm->avail_in = data_size;
+    strm->next_out = dest;
+    strm->avail_out = dest_size;
+    rc = deflate (strm, Z_SYNC_FLUSH);
+    if ((rc != Z_OK) || (strm->avail_in != 0) || (strm->avail_out == 0)
+        || (dest_size - strm->avail_out < 4))
+    {
+        free (dest);
+        goto error;
+    }
+
+    if (!ws_deflate->server_context_takeover)
+        deflateReset (strm);
+
+    *buffer = (char *)dest;
+    *size = (int)(dest_size - strm->avail_out) - 4;
+
+    return 1;
+
+error:
+    relay_websocket_deflate_free_deflate (ws_deflate);
+    ws_deflate->deflate_disabled = 1;
+    return 0;
+}
+
+/*
+ * Compresses a message sent to client with extension "permessage-deflate".
+ *
+ * If "shared_data" is not NULL, it is the message (that can be sent to many
+ * clients): without server context takeover (and with max window), the
+ * compressed message is the same for all clients, so it is compressed only
+ * once and kept in "shared_data".
+ *
+ * Returns a reference on the compressed message (it must be released with
+ * relay_client_outqueue_data_unref), NULL if the message was not compressed.
+ */
+
+struct t_relay_client_outqueue_data *
+relay_websocket_deflate_message (struct t_relay_client *client,
+                                 struct t_relay_client_outqueue_data *shared_data,
+                                 const char *data, int data_size)
+{
+    struct t_relay_websocket_deflate *ws_deflate;
+    struct t_relay_client_outqueue_data *new_data;
+    char *buffer;
+    int size, shareable;
+
+    ws_deflate = client->ws_deflate;
+
+    shareable = (shared_data
+                 && !ws_deflate->server_context_takeover
+                 && (ws_deflate->window_bits_deflate == RELAY_WEBSOCKET_DEFLATE_WINDOW_BITS_MAX));
+
+    if (shareable && shared_data->deflated)
+    {
+        shared_data->deflated->refcount++;
+        return shared_data->deflated;
+    }
+
+    if (!relay_websocket_deflate (ws_deflate, data, data_size, &buffer, &size))
+        return NULL;
+
+    /* buffer is given to data (queued without copy if needed) */
+    new_data = relay_client_outqueue_data_new (buffer, size);
+    if (!new_data)
+    {
+        /*
+         * the message is in the compression context but will not be sent:
+         * next messages can not be compressed any more
+         */
+        relay_websocket_deflate_free_deflate (ws_deflate);
+        ws_deflate->deflate_disabled = 1;
+        return NULL;
+    }
+    if (shareable)
+    {
+        new_data->refcount++;
+        shared_data->deflated = new_data;
+    }
+
+    return new_data;
+}
+
+/*
+ * Inflates data of a compressed message received from client, and adds it
+ * in buffer "decoded" (which is reallocated if needed, up to
+ * RELAY_WEBSOCKET_INFLATE_MAX_SIZE bytes).
+ *
+ * Returns:
+ *   1: data inflated
+ *   0: error (or inflated data too long)
+ */
+
+int
+relay_websocket_inflate (struct t_relay_websocket_deflate *ws_deflate,
+                         const unsigned char *data, unsigned long long size,
+                         unsigned char **decoded,
+                         unsigned long long *decoded_size,
+                         unsigned long long *decoded_length)
+{
+    z_stream *strm;
+    unsigned char *new_decoded;
+    unsigned long long new_size;
+    int rc;
+
+    strm = ws_deflate->strm_inflate;
+    if (!strm)
+    {
+        strm = malloc (sizeof (*strm));
+        if (!strm)
+            return 0;
+        memset (strm, 0, sizeof (*strm));
+        /* negative window bits: raw deflate (no zlib header) */
+        if (inflateInit2 (strm,
+                          -1 * RELAY_WEBSOCKET_DEFLATE_WINDOW_BITS_MAX) != Z_OK)
+        {
+            free (strm);
+            return 0;
+        }
+        ws_deflate->strm_inflate = strm;
+    }
+
+    strm->next_in = (Bytef *)data;
+    strm->avail_in = size;
+
+    while (1)
+    {
+        /* keep one byte for the final '\0' */
+        if (*decoded_length + 1 >= *decoded_size)
+        {
+            /* too much data inflated (maybe a "deflate bomb") */
+            if (*decoded_size > RELAY_WEBSOCKET_INFLATE_MAX_SIZE)
+                return 0;
+            new_size = *decoded_size * 2;
+            if (new_size > RELAY_WEBSOCKET_INFLATE_MAX_SIZE + 1)
+                new_size = RELAY_WEBSOCKET_INFLATE_MAX_SIZE + 1;
+            new_decoded = realloc (*decoded, new_size);
+            if (!new_decoded)
+                return 0;
+            *decoded = new_decoded;
+            *decoded_size = new_size;
+        }
+        strm->next_out = *decoded + *decoded_length;
+        strm->avail_out = *decoded_size - *decoded_length - 1;
+        rc = inflate (strm, Z_SYNC_FLUSH);
+        *decoded_length = *decoded_size - 1 - strm->avail_out;
+        if (rc == Z_STREAM_END)
+        {
+            /* final block received: data after is a new stream */
+            inflateReset (strm);
+        }
+        else if (rc == Z_BUF_ERROR)
+        {
+            /* no progress possible: all data was inflated */
+            if (strm->avail_out > 0)
+                break;
+        }
+        else if (rc != Z_OK)
+        {
+            relay_websocket_deflate_free_inflate (ws_deflate);
+            return 0;
+        }
+        if ((strm->avail_in == 0) && (strm->avail_out > 0))
+            break;
+    }
+
+    return 1;
+}
+
+/*
+ * Decodes websocket frames received from client (compressed messages are
+ * inflated if extension "permessage-deflate" is used).
+ *
+ * Argument "decoded" is set with a buffer allocated by this function (it
+ * must be freed after use, even if an error is returned).
  *
  * Returns:
  *   1: frame decoded successfully
@@ -261,19 +799,58 @@ relay_websocket_send_http (struct t_relay_client *client,
  */
 
 int
-relay_websocket_decode_frame (const unsigned char *buffer,
+relay_websocket_decode_frame (struct t_relay_client *client,
+                              const unsigned char *buffer,
                               unsigned long long buffer_length,
-                              unsigned char *decoded,
+                              unsigned char **decoded,
                               unsigned long long *decoded_length)
 {
     unsigned long long i, index_buffer, length_frame_size, length_frame;
+    unsigned long long decoded_size;
+    unsigned char masks[4], *payload;
+    int opcode, fin, compressed, rc;
+    struct t_relay_websocket_deflate *ws_deflate;
+
+    ws_deflate = client->ws_deflate;
 
     *decoded_length = 0;
     index_buffer = 0;
 
+    /* decoded data is never longer than frames, except if inflated */
+    decoded_size = buffer_length + 1;
+    *decoded = malloc (decoded_size);
+    if (!*decoded)
+        return 0;
+    (*decoded)[0] = '\0';
+
     /* loop to decode all frames in message */
     while (index_buffer + 2 <= buffer_length)
     {
+        fin = buffer[index_buffer] & 0x80;
+        opcode = buffer[index_buffer] & 0x0F;
+
+        /*
+         * bit RSV1 is set on the first frame of a compressed message
+         * (it must not be set on control frames and continuation frames)
+         */
+        compressed = buffer[index_buffer] & 0x40;
+        if (compressed
+            && ((opcode == 0) || (opcode >= 8)
+                || !ws_deflate || !ws_deflate->enabled))
+        {
+            return 0;
+        }
+        if (opcode == 0)
+        {
+            compressed = (ws_deflate && ws_deflate->inflate_message);
+            if (compressed && fin)
+                ws_deflate->inflate_message = 0;
+        }
+        else if ((opcode < 8) && compressed && !fin)
+        {
+            ws_deflate->inflate_message = 1;
+        }
+
         /*
          * check if frame is masked: client MUST send a masked frame; if frame is
          * not masked, we MUST reject it and close the connection (see RFC 6455)
@@ -288,7 +865,7 @@ relay_websocket_decode_frame (const unsigned char *buffer,
         if ((length_frame == 126) || (length_frame == 127))
         {
             length_frame_size = (length_frame == 126) ? 2 : 8;
-            if (buffer_length < 1 + length_frame_size)
+            if (buffer_length < index_buffer + length_frame_size)
                 return 0;
             length_frame = 0;
             for (i = 0; i < length_frame_size; i++)
@@ -298,24 +875,70 @@ relay_websocket_decode_frame (const unsigned char *buffer,
             index_buffer += length_frame_size;
         }
 
-        if (buffer_length < 1 + length_frame_size + 4 + length_frame)
+        if ((buffer_length < index_buffer + 4)
+            || (buffer_length - index_buffer - 4 < length_frame))
+        {
             return 0;
+        }
 
         /* read masks (4 bytes) */
-        int masks[4];
         for (i = 0; i < 4; i++)
         {
-            masks[i] = (int)((unsigned char)buffer[index_buffer + i]);
+            masks[i] = buffer[index_buffer + i];
         }
         index_buffer += 4;
 
-        /* decode data using masks */
-        for (i = 0; i < length_frame; i++)
+        if (compressed)
+        {
+            /*
+             * unmask data and inflate it; the final 4 bytes 0x00 0x00 0xff
+             * 0xff removed by client are added at the end of message
+             */
+            payload = malloc (length_frame + 4);
+            if (!payload)
+                return 0;
+            for (i = 0; i < length_frame; i++)
+            {
+                payload[i] = buffer[index_buffer + i] ^ masks[i % 4];
+            }
+            if (fin)
+            {
+                payload[length_frame] = 0x00;
+                payload[length_frame + 1] = 0x00;
+                payload[length_frame + 2] = 0xFF;
+                payload[length_frame + 3] = 0xFF;
+            }
+            rc = relay_websocket_inflate (ws_deflate, payload,
+                                          length_frame + ((fin) ? 4 : 0),
+                                          decoded, &decoded_size,
+                                          decoded_length);
+            free (payload);
+            if (!rc)
+                return 0;
+            if (fin && !ws_deflate->client_context_takeover
+                && ws_deflate->strm_inflate)
+            {
+                inflateReset (ws_deflate->strm_inflate);
+            }
+        }
+        else
         {
-            decoded[*decoded_length + i] = (int)((unsigned char)buffer[index_buffer + i]) ^ masks[i % 4];
+            /* decode data using masks */
+            if (*decoded_length + length_frame + 1 > decoded_size)
+            {
+                decoded_size = *decoded_length + length_frame + 1;
+                payload = realloc (*decoded, decoded_size);
+                if (!payload)
+                    return 0;
+                *decoded = payload;
+            }
+            for (i = 0; i < length_frame; i++)
+            {
+                (*decoded)[*decoded_length + i] = buffer[index_buffer + i] ^ masks[i % 4];
+            }
+            *decoded_length += length_frame;
         }
-        decoded[*decoded_length + length_frame] = '\0';
-        *decoded_length += length_frame;
+        (*decoded)[*decoded_length] = '\0';
         index_buffer += length_frame;
     }
 
@@ -323,7 +946,59 @@ relay_websocket_decode_frame (const unsigned char *buffer,
 }
 
 /*
- * Encodes data in a websocket frame.
+ * Encodes header of a websocket frame (without masking key) for data of
+ * "length" bytes ("deflated" is 1 if data is compressed with extension
+ * "permessage-deflate").
+ *
+ * Argument "header" must have at least RELAY_WEBSOCKET_FRAME_HEADER_MAX bytes.
+ *
+ * Returns length of header (2, 4 or 10 bytes).
+ */
+
+int
+relay_websocket_encode_frame_header (struct t_relay_client *client,
+                                     unsigned long long length,
+                                     int deflated,
+                                     unsigned char *header)
+{
+    header[0] = (client->send_data_type == RELAY_CLIENT_DATA_TEXT) ? 0x81 : 0x82;
+
+    /* bit RSV1: message compressed */
+    if (deflated)
+        header[0] |= 0x40;
+
+    if (length <= 125)
+    {
+        /* length on one byte */
+        header[1] = length;
+        return 2;
+    }
+
+    if ((length >= 126) && (length <= 65535))
+    {
+        /* length on 2 bytes */
+        header[1] = 126;
+        header[2] = (length >> 8) & 0xFF;
+        header[3] = length & 0xFF;
+        return 4;
+    }
+
+    /* length on 8 bytes */
+    header[1] = 127;
+    header[2] = (length >> 56) & 0xFF;
+    header[3] = (length >> 48) & 0xFF;
+    header[4] = (length >> 40) & 0xFF;
+    header[5] = (length >> 32) & 0xFF;
+    header[6] = (length >> 24) & 0xFF;
+    header[7] = (length >> 16) & 0xFF;
+    header[8] = (length >> 8) & 0xFF;
+    header[9] = length & 0xFF;
+    return 10;
+}
+
+/*
+ * Encodes data in a websocket frame ("deflated" is 1 if data is compressed
+ * with extension "permessage-deflate").
  *
  * Returns websocket frame, NULL if error.
  * Argument "length_frame" is set with the length of frame built.
@@ -335,47 +1010,20 @@ char *
 relay_websocket_encode_frame (struct t_relay_client *client,
                               const char *buffer,
                               unsigned long long length,
+                              int deflated,
                               unsigned long long *length_frame)
 {
     unsigned char *frame;
-    unsigned long long index;
+    int index;
 
     *length_frame = 0;
 
-    frame = malloc (length + 10);
+    frame = malloc (length + RELAY_WEBSOCKET_FRAME_HEADER_MAX);
     if (!frame)
         return NULL;
 
-    frame[0] = (client->send_data_type == RELAY_CLIENT_DATA_TEXT) ? 0x81 : 0x82;
-
-    if (length <= 125)
-    {
-        /* length on one byte */
-        frame[1] = length;
-        index = 2;
-    }
-    else if ((length >= 126) && (length <= 65535))
-    {
-        /* length on 2 bytes */
-        frame[1] = 126;
-        frame[2] = (length >> 8) & 0xFF;
-        frame[3] = length & 0xFF;
-        index = 4;
-    }
-    else
-    {
-        /* length on 8 bytes */
-        frame[1] = 127;
-        frame[2] = (length >> 56) & 0xFF;
-        frame[3] = (length >> 48) & 0xFF;
-        frame[4] = (length >> 40) & 0xFF;
-        frame[5] = (length >> 32) & 0xFF;
-        frame[6] = (length >> 24) & 0xFF;
-        frame[7] = (length >> 16) & 0xFF;
-        frame[8] = (length >> 8) & 0xFF;
-        frame[9] = length & 0xFF;
-        index = 10;
-    }
+    index = relay_websocket_encode_frame_header (client, length, deflated,
+                                                 frame);
 
     /* copy buffer after length */
     memcpy (frame + index, buffer, length);
@@ -20,6 +20,46 @@
 #ifndef WEECHAT_RELAY_WEBSOCKET_H
 #define WEECHAT_RELAY_WEBSOCKET_H 1
 
+/* max size of a websocket frame header sent to client (no masking key) */
+#define RELAY_WEBSOCKET_FRAME_HEADER_MAX 10
+
+/* window bits for extension "permessage-deflate" (RFC 7692) */
+#define RELAY_WEBSOCKET_DEFLATE_WINDOW_BITS_MIN 9
+#define RELAY_WEBSOCKET_DEFLATE_WINDOW_BITS_MAX 15
+
+/*
+ * max size of data inflated from one read on client socket (16 times the
+ * size of read buffer): above, the connection is closed
+ */
+#define RELAY_WEBSOCKET_INFLATE_MAX_SIZE (16 * 4096)
+
+/*
+ * messages compressed with context takeover depend on messages sent before:
+ * they can not be dropped
+ */
+#define RELAY_WEBSOCKET_DEFLATE_CONTEXT(client)                         \
+    (client->ws_deflate && client->ws_deflate->enabled                  \
+     && !client->ws_deflate->deflate_disabled                           \
+     && client->ws_deflate->server_context_takeover)
+
+/* websocket extension "permessage-deflate" (RFC 7692) */
+
+struct t_relay_websocket_deflate
+{
+    int enabled;                       /* 1 if extension is used            */
+    int deflate_disabled;              /* 1 if compression of messages sent */
+                                       /* failed: they are sent as-is (but  */
+                                       /* messages received are inflated)   */
+    int server_context_takeover;       /* 0 if server_no_context_takeover   */
+    int client_context_takeover;       /* 0 if client_no_context_takeover   */
+    int window_bits_deflate;           /* server_max_window_bits (9-15)     */
+    int inflate_message;               /* 1 if receiving a compressed msg   */
+    struct z_stream_s *strm_deflate;   /* stream for messages sent          */
+    struct z_stream_s *strm_inflate;   /* stream for messages received      */
+};
+
+struct t_relay_client_outqueue_data;
+
 extern int relay_websocket_is_http_get_weechat (const char *message);
 extern void relay_websocket_save_header (struct t_relay_client *client,
                                          const char *message);
@@ -27,13 +67,26 @@ extern int relay_websocket_client_handshake_valid (struct t_relay_client *client
 extern char *relay_websocket_build_handshake (struct t_relay_client *client);
 extern void relay_websocket_send_http (struct t_relay_client *client,
                                        const char *http);
-extern int relay_websocket_decode_frame (const unsigned char *buffer,
+extern struct t_relay_websocket_deflate *relay_websocket_deflate_alloc ();
+extern void relay_websocket_deflate_free (struct t_relay_websocket_deflate *ws_deflate);
+extern int relay_websocket_deflate_message_allowed (struct t_relay_client *client);
+extern struct t_relay_client_outqueue_data *relay_websocket_deflate_message (struct t_relay_client *client,
+                                                                             struct t_relay_client_outqueue_data *shared_data,
+                                                                             const char *data,
+                                                                             int data_size);
+extern int relay_websocket_decode_frame (struct t_relay_client *client,
+                                         const unsigned char *buffer,
                                          unsigned long long length,
-                                         unsigned char *decoded,
+                                         unsigned char **decoded,
                                          unsigned long long *decoded_length);
+extern int relay_websocket_encode_frame_header (struct t_relay_client *client,
+                                                unsigned long long length,
+                                                int deflated,
+                                                unsigned char *header);
 extern char *relay_websocket_encode_frame (struct t_relay_client *client,
                                            const char *buffer,
                                            unsigned long long length,
+                                           int deflated,
                                            unsigned long long *length_frame);
 
 #endif /* WEECHAT_RELAY_WEBSOCKET_H */
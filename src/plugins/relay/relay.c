@@ -34,6 +34,8 @@
 #include "relay-raw.h"
 #include "relay-server.h"
 #include "relay-upgrade.h"
+#include "weechat/relay-weechat.h"
+#include "weechat/relay-weechat-msg.h"
 
 
 WEECHAT_PLUGIN_NAME(RELAY_PLUGIN_NAME);
@@ -259,6 +261,8 @@ weechat_plugin_end (struct t_weechat_plugin *plugin)
 
     relay_network_end ();
 
+    relay_weechat_msg_end ();
+
     relay_config_free ();
 
     return WEECHAT_RC_OK;
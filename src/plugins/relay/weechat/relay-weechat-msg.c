@@ -29,6 +29,13 @@
 #include <errno.h>
 #include <arpa/inet.h>
 #include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
 
 #include "../../weechat-plugin.h"
 #include "../relay.h"
@@ -41,6 +48,13 @@
 #include "../relay-raw.h"
 
 
+#ifdef HAVE_ZSTD
+ZSTD_CCtx *relay_weechat_msg_zstd_cctx = NULL; /* context for compression  */
+ZSTD_CDict *relay_weechat_msg_zstd_cdict = NULL; /* dictionary (optional)  */
+int relay_weechat_msg_zstd_dict_loaded = 0;    /* 1 if dict. was loaded    */
+#endif
+
+
 /*
  * Builds a new message (for sending to client).
  *
@@ -51,6 +65,7 @@ struct t_relay_weechat_msg *
 relay_weechat_msg_new (const char *id)
 {
     struct t_relay_weechat_msg *new_msg;
+    int i;
 
     new_msg = malloc (sizeof (*new_msg));
     if (!new_msg)
@@ -65,6 +80,12 @@ relay_weechat_msg_new (const char *id)
     }
     new_msg->data_alloc = RELAY_WEECHAT_MSG_INITIAL_ALLOC;
     new_msg->data_size = 0;
+    for (i = 0; i < RELAY_WEECHAT_NUM_COMPRESSIONS; i++)
+    {
+        new_msg->compressed[i] = NULL;
+        new_msg->compressed_size[i] = 0;
+        new_msg->compression_time[i] = 0;
+    }
 
     /* add size and compression flag (they will be set later) */
     relay_weechat_msg_add_int (new_msg, 0);
@@ -248,6 +269,194 @@ relay_weechat_msg_add_time (struct t_relay_weechat_msg *msg, time_t time)
     relay_weechat_msg_add_bytes (msg, str_time, length);
 }
 
+/*
+ * Adds an unsigned integer encoded as varint to a message (protocol version
+ * 2): 7 bits per byte, least significant bits first, high bit set if more
+ * bytes follow.
+ */
+
+void
+relay_weechat_msg_add_varint (struct t_relay_weechat_msg *msg,
+                              unsigned long long value)
+{
+    unsigned char buffer[10];
+    int length;
+
+    length = 0;
+    while (value >= 0x80)
+    {
+        buffer[length++] = (unsigned char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buffer[length++] = (unsigned char)value;
+    relay_weechat_msg_add_bytes (msg, buffer, length);
+}
+
+/*
+ * Adds a signed integer encoded as varint to a message (protocol version 2),
+ * with "zigzag" encoding: 0, -1, 1, -2, 2, ... are sent as 0, 1, 2, 3, 4, ...
+ */
+
+void
+relay_weechat_msg_add_varint_signed (struct t_relay_weechat_msg *msg,
+                                     long long value)
+{
+    relay_weechat_msg_add_varint (
+        msg,
+        ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+}
+
+/*
+ * Adds a reference to a string in a message (protocol version 2):
+ *   0: NULL string
+ *   1: new string (varint length + string), added in strings of client if
+ *      the max number of strings is not reached
+ *   N (>= 2): string with index N - 2 in strings of client.
+ */
+
+void
+relay_weechat_msg_add_string_ref (struct t_relay_weechat_msg *msg,
+                                  struct t_relay_client *client,
+                                  const char *string)
+{
+    struct t_hashtable *strings;
+    int *ptr_index, index, length;
+
+    if (!string)
+    {
+        relay_weechat_msg_add_varint (msg, 0);
+        return;
+    }
+
+    strings = RELAY_WEECHAT_DATA(client, strings);
+    ptr_index = weechat_hashtable_get (strings, string);
+    if (ptr_index)
+    {
+        relay_weechat_msg_add_varint (msg, (unsigned long long)(*ptr_index) + 2);
+        return;
+    }
+
+    length = strlen (string);
+    relay_weechat_msg_add_varint (msg, 1);
+    relay_weechat_msg_add_varint (msg, length);
+    relay_weechat_msg_add_bytes (msg, string, length);
+
+    index = weechat_hashtable_get_integer (strings, "items_count");
+    if (index < RELAY_WEECHAT_STRINGS_MAX)
+        weechat_hashtable_set (strings, string, &index);
+}
+
+/*
+ * Adds lines in a compact object "lin" (protocol version 2): "count" lines
+ * starting with "line" (pointer to a line, not line data).
+ *
+ * Fields of each line are described by RELAY_WEECHAT_MSG_LINES_SCHEMA; dates
+ * are sent as difference with date of previous line sent to client.
+ */
+
+void
+relay_weechat_msg_add_lines (struct t_relay_weechat_msg *msg,
+                             struct t_relay_client *client,
+                             void *line, int count)
+{
+    struct t_hdata *ptr_hdata_line, *ptr_hdata_line_data;
+    void *ptr_line, *ptr_line_data, *ptr_buffer;
+    const char **tags_array, *message;
+    char str_pointer[64];
+    int i, pos_count, num_lines, tags_count, length;
+    time_t date, date_printed;
+    uint32_t count32;
+
+    ptr_hdata_line = weechat_hdata_get ("line");
+    ptr_hdata_line_data = weechat_hdata_get ("line_data");
+    if (!ptr_hdata_line || !ptr_hdata_line_data)
+        return;
+
+    relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_LINES);
+    pos_count = msg->data_size;
+    relay_weechat_msg_add_int (msg, 0);
+
+    num_lines = 0;
+    ptr_line = line;
+    while (ptr_line && (num_lines < count))
+    {
+        ptr_line_data = weechat_hdata_pointer (ptr_hdata_line, ptr_line,
+                                               "data");
+        if (ptr_line_data)
+        {
+            /* id */
+            relay_weechat_msg_add_varint (
+                msg,
+                (unsigned int)weechat_hdata_integer (ptr_hdata_line_data,
+                                                     ptr_line_data, "id"));
+
+            /* buffer */
+            ptr_buffer = weechat_hdata_pointer (ptr_hdata_line_data,
+                                                ptr_line_data, "buffer");
+            snprintf (str_pointer, sizeof (str_pointer),
+                      "0x%lx", (long unsigned int)ptr_buffer);
+            relay_weechat_msg_add_string_ref (msg, client, str_pointer);
+
+            /* date and date printed */
+            date = weechat_hdata_time (ptr_hdata_line_data, ptr_line_data,
+                                       "date");
+            date_printed = weechat_hdata_time (ptr_hdata_line_data,
+                                               ptr_line_data, "date_printed");
+            relay_weechat_msg_add_varint_signed (
+                msg, (long long)date - RELAY_WEECHAT_DATA(client, last_date));
+            relay_weechat_msg_add_varint_signed (
+                msg, (long long)date_printed - date);
+            RELAY_WEECHAT_DATA(client, last_date) = date;
+
+            /* flags: displayed, highlight */
+            relay_weechat_msg_add_char (
+                msg,
+                (weechat_hdata_char (ptr_hdata_line_data, ptr_line_data,
+                                     "displayed") ? 1 : 0)
+                | (weechat_hdata_char (ptr_hdata_line_data, ptr_line_data,
+                                       "highlight") ? 2 : 0));
+
+            /* tags */
+            tags_count = weechat_hdata_integer (ptr_hdata_line_data,
+                                                ptr_line_data, "tags_count");
+            tags_array = weechat_hdata_pointer (ptr_hdata_line_data,
+                                                ptr_line_data, "tags_array");
+            if (!tags_array)
+                tags_count = 0;
+            relay_weechat_msg_add_varint (msg, tags_count);
+            for (i = 0; i < tags_count; i++)
+            {
+                relay_weechat_msg_add_string_ref (msg, client, tags_array[i]);
+            }
+
+            /* prefix */
+            relay_weechat_msg_add_string_ref (
+                msg, client,
+                weechat_hdata_string (ptr_hdata_line_data, ptr_line_data,
+                                      "prefix"));
+
+            /* message: varint length + 1 (0 for NULL), then string */
+            message = weechat_hdata_string (ptr_hdata_line_data,
+                                            ptr_line_data, "message");
+            if (message)
+            {
+                length = strlen (message);
+                relay_weechat_msg_add_varint (msg,
+                                              (unsigned long long)length + 1);
+                relay_weechat_msg_add_bytes (msg, message, length);
+            }
+            else
+                relay_weechat_msg_add_varint (msg, 0);
+
+            num_lines++;
+        }
+        ptr_line = weechat_hdata_move (ptr_hdata_line, ptr_line, 1);
+    }
+
+    count32 = htonl ((uint32_t)num_lines);
+    relay_weechat_msg_set_bytes (msg, pos_count, &count32, 4);
+}
+
 /*
  * Adds items of hashtable to a message.
  */
@@ -987,79 +1196,517 @@ relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
 }
 
 /*
- * Sends a message.
+ * Returns difference between two timeval structures (in microseconds).
+ */
+
+long
+relay_weechat_msg_time_usec (struct timeval *tv1, struct timeval *tv2)
+{
+    return ((tv2->tv_sec - tv1->tv_sec) * 1000000) +
+        (tv2->tv_usec - tv1->tv_usec);
+}
+
+#ifdef HAVE_ZSTD
+/*
+ * Loads the zstd dictionary (option relay.network.compression_zstd_dict),
+ * only once (it is loaded again after a change of zstd options).
  */
 
 void
-relay_weechat_msg_send (struct t_relay_client *client,
-                        struct t_relay_weechat_msg *msg)
+relay_weechat_msg_zstd_load_dict ()
+{
+    char *path, *path2, *buffer;
+    FILE *file;
+    long size;
+
+    if (relay_weechat_msg_zstd_dict_loaded)
+        return;
+
+    relay_weechat_msg_zstd_dict_loaded = 1;
+
+    if (!weechat_config_string (relay_config_network_compression_zstd_dict)[0])
+        return;
+
+    path = weechat_string_expand_home (weechat_config_string (relay_config_network_compression_zstd_dict));
+    if (!path)
+        return;
+    path2 = weechat_string_replace (path, "%h",
+                                    weechat_info_get ("weechat_dir", NULL));
+    free (path);
+    if (!path2)
+        return;
+
+    buffer = NULL;
+    size = 0;
+    file = fopen (path2, "rb");
+    if (file)
+    {
+        if ((fseek (file, 0, SEEK_END) == 0) && ((size = ftell (file)) > 0)
+            && (fseek (file, 0, SEEK_SET) == 0))
+        {
+            buffer = malloc (size);
+            if (buffer && (fread (buffer, 1, size, file) != (size_t)size))
+            {
+                free (buffer);
+                buffer = NULL;
+            }
+        }
+        fclose (file);
+    }
+
+    if (buffer)
+    {
+        relay_weechat_msg_zstd_cdict = ZSTD_createCDict (
+            buffer, size,
+            weechat_config_integer (relay_config_network_compression_level_zstd));
+        free (buffer);
+    }
+
+    if (!relay_weechat_msg_zstd_cdict)
+    {
+        weechat_printf (NULL,
+                        _("%s%s: unable to load zstd dictionary \"%s\" "
+                          "(option relay.network.compression_zstd_dict), "
+                          "messages are compressed without dictionary"),
+                        weechat_prefix ("error"), RELAY_PLUGIN_NAME, path2);
+    }
+
+    free (path2);
+}
+#endif
+
+/*
+ * Resets zstd context: dictionary will be loaded again on next compression
+ * (called when zstd options are changed).
+ */
+
+void
+relay_weechat_msg_zstd_reset ()
+{
+#ifdef HAVE_ZSTD
+    if (relay_weechat_msg_zstd_cdict)
+    {
+        ZSTD_freeCDict (relay_weechat_msg_zstd_cdict);
+        relay_weechat_msg_zstd_cdict = NULL;
+    }
+    relay_weechat_msg_zstd_dict_loaded = 0;
+#endif
+}
+
+/*
+ * Returns max size of data compressed with a compression.
+ */
+
+int
+relay_weechat_msg_compress_bound (int compression, int size)
+{
+    switch (compression)
+    {
+        case RELAY_WEECHAT_COMPRESSION_ZLIB:
+            return (int)compressBound (size);
+#ifdef HAVE_ZSTD
+        case RELAY_WEECHAT_COMPRESSION_ZSTD:
+            return (int)ZSTD_compressBound (size);
+#endif
+#ifdef HAVE_LZ4
+        case RELAY_WEECHAT_COMPRESSION_LZ4:
+            /* uncompressed size (4 bytes) + lz4 block */
+            return 4 + LZ4_compressBound (size);
+#endif
+        default:
+            break;
+    }
+
+    return -1;
+}
+
+/*
+ * Compresses data with a compression (zlib, zstd or lz4).
+ *
+ * Returns size of compressed data in "dest", -1 if error.
+ */
+
+int
+relay_weechat_msg_compress_data (int compression,
+                                 const char *src, int src_size,
+                                 char *dest, int dest_size)
+{
+    uLongf zlib_size;
+    int level;
+#ifdef HAVE_ZSTD
+    size_t zstd_size;
+#endif
+#ifdef HAVE_LZ4
+    uint32_t size32;
+    int lz4_size;
+#endif
+
+    switch (compression)
+    {
+        case RELAY_WEECHAT_COMPRESSION_ZLIB:
+            level = weechat_config_integer (relay_config_network_compression_level);
+            if (level == 0)
+                return -1;
+            zlib_size = dest_size;
+            if (compress2 ((Bytef *)dest, &zlib_size,
+                           (Bytef *)src, src_size, level) != Z_OK)
+            {
+                return -1;
+            }
+            return (int)zlib_size;
+#ifdef HAVE_ZSTD
+        case RELAY_WEECHAT_COMPRESSION_ZSTD:
+            level = weechat_config_integer (relay_config_network_compression_level_zstd);
+            if (level == 0)
+                return -1;
+            if (!relay_weechat_msg_zstd_cctx)
+            {
+                relay_weechat_msg_zstd_cctx = ZSTD_createCCtx ();
+                if (!relay_weechat_msg_zstd_cctx)
+                    return -1;
+            }
+            relay_weechat_msg_zstd_load_dict ();
+            if (relay_weechat_msg_zstd_cdict)
+            {
+                zstd_size = ZSTD_compress_usingCDict (relay_weechat_msg_zstd_cctx,
+                                                      dest, dest_size,
+                                                      src, src_size,
+                                                      relay_weechat_msg_zstd_cdict);
+            }
+            else
+            {
+                zstd_size = ZSTD_compressCCtx (relay_weechat_msg_zstd_cctx,
+                                               dest, dest_size,
+                                               src, src_size, level);
+            }
+            return (ZSTD_isError (zstd_size)) ? -1 : (int)zstd_size;
+#endif
+#ifdef HAVE_LZ4
+        case RELAY_WEECHAT_COMPRESSION_LZ4:
+            level = weechat_config_integer (relay_config_network_compression_level_lz4);
+            /* lz4 block does not contain uncompressed size: add it before */
+            size32 = htonl ((uint32_t)src_size);
+            memcpy (dest, &size32, 4);
+            if (level == 0)
+            {
+                lz4_size = LZ4_compress_default (src, dest + 4, src_size,
+                                                 dest_size - 4);
+            }
+            else
+            {
+                lz4_size = LZ4_compress_HC (src, dest + 4, src_size,
+                                            dest_size - 4, level);
+            }
+            return (lz4_size > 0) ? 4 + lz4_size : -1;
+#endif
+        default:
+            break;
+    }
+
+    return -1;
+}
+
+/*
+ * Compresses a message with zlib, zstd or lz4 (only once: the compressed
+ * message is kept in message and reused when the same message is sent to
+ * other clients with same compression).
+ *
+ * Returns:
+ *   1: message compressed
+ *   0: message not compressed (error or compressed data not smaller)
+ */
+
+int
+relay_weechat_msg_compress (struct t_relay_weechat_msg *msg, int compression)
 {
     uint32_t size32;
-    char compression, raw_message[1024];
+    int dest_size;
+    char *dest;
+    struct timeval tv1, tv2;
+
+    if (msg->compressed_size[compression] != 0)
+        return (msg->compressed_size[compression] > 0) ? 1 : 0;
+
+    msg->compressed_size[compression] = -1;
+
+    dest_size = relay_weechat_msg_compress_bound (compression,
+                                                  msg->data_size - 5);
+    if (dest_size <= 0)
+        return 0;
+    dest = malloc (dest_size + 5);
+    if (!dest)
+        return 0;
+
+    gettimeofday (&tv1, NULL);
+    dest_size = relay_weechat_msg_compress_data (compression,
+                                                 msg->data + 5,
+                                                 msg->data_size - 5,
+                                                 dest + 5, dest_size);
+    gettimeofday (&tv2, NULL);
+    if ((dest_size < 0) || (dest_size + 5 >= msg->data_size))
+    {
+        free (dest);
+        return 0;
+    }
+
+    /* set size and compression flag */
+    size32 = htonl ((uint32_t)(dest_size + 5));
+    memcpy (dest, &size32, 4);
+    dest[4] = compression;
+
+    msg->compressed[compression] = relay_client_outqueue_data_new (
+        dest, dest_size + 5);
+    if (!msg->compressed[compression])
+        return 0;
+    msg->compressed_size[compression] = dest_size + 5;
+    msg->compression_time[compression] = relay_weechat_msg_time_usec (&tv1,
+                                                                      &tv2);
+
+    return 1;
+}
+
+/*
+ * Compresses a message with the deflate stream of client (the stream is
+ * created on first call and kept for whole connection; each message ends with
+ * a sync flush, so that the client can inflate it immediately).
+ *
+ * Data after compression depends on messages previously sent to client, so
+ * the result can not be shared with other clients.
+ *
+ * On error, the stream is destroyed and compression of client is changed to
+ * "zlib" (a message compressed with stream is never sent after that, so the
+ * client can not be desynchronized).
+ *
+ * Returns:
+ *   1: message compressed (*buffer must be freed after use)
+ *   0: message not compressed
+ */
+
+int
+relay_weechat_msg_compress_zlib_stream (struct t_relay_client *client,
+                                        struct t_relay_weechat_msg *msg,
+                                        char **buffer, int *size,
+                                        long *time_usec)
+{
+    z_stream *stream;
+    uint32_t size32;
     int rc;
     Bytef *dest;
-    uLongf dest_size;
+    uLong dest_size;
     struct timeval tv1, tv2;
-    long time_diff;
 
-    if (weechat_config_integer (relay_config_network_compression_level) > 0)
+    *buffer = NULL;
+    *size = 0;
+    *time_usec = 0;
+
+    stream = RELAY_WEECHAT_DATA(client, zlib_stream);
+    if (!stream)
     {
-        switch (RELAY_WEECHAT_DATA(client, compression))
+        stream = malloc (sizeof (*stream));
+        if (!stream)
+            return 0;
+        memset (stream, 0, sizeof (*stream));
+        if (deflateInit (stream,
+                         weechat_config_integer (relay_config_network_compression_level)) != Z_OK)
         {
-            case RELAY_WEECHAT_COMPRESSION_ZLIB:
-                dest_size = compressBound (msg->data_size - 5);
-                dest = malloc (dest_size + 5);
-                if (dest)
+            free (stream);
+            return 0;
+        }
+        RELAY_WEECHAT_DATA(client, zlib_stream) = stream;
+    }
+
+    /* extra bytes for the sync flush (empty stored block) */
+    dest_size = deflateBound (stream, msg->data_size - 5) + 16;
+    dest = malloc (dest_size + 5);
+    if (!dest)
+        return 0;
+
+    gettimeofday (&tv1, NULL);
+    stream->next_in = (Bytef *)(msg->data + 5);
+    stream->avail_in = msg->data_size - 5;
+    stream->next_out = dest + 5;
+    stream->avail_out = dest_size;
+    rc = deflate (stream, Z_SYNC_FLUSH);
+    gettimeofday (&tv2, NULL);
+    if ((rc != Z_OK) || (stream->avail_in != 0) || (stream->avail_out == 0))
+    {
+        free (dest);
+        relay_weechat_zlib_stream_free (client);
+        RELAY_WEECHAT_DATA(client, compression) = RELAY_WEECHAT_COMPRESSION_ZLIB;
+        return 0;
+    }
+
+    /* set size and compression flag */
+    *size = (int)(dest_size - stream->avail_out) + 5;
+    size32 = htonl ((uint32_t)(*size));
+    memcpy (dest, &size32, 4);
+    dest[4] = RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM;
+
+    *buffer = (char *)dest;
+    *time_usec = relay_weechat_msg_time_usec (&tv1, &tv2);
+
+    return 1;
+}
+
+/*
+ * Adds a compressed message in compression statistics of client and displays
+ * it in raw buffer.
+ */
+
+void
+relay_weechat_msg_send_compressed (struct t_relay_client *client,
+                                   struct t_relay_weechat_msg *msg,
+                                   struct t_relay_client_outqueue_data *data,
+                                   long time_usec)
+{
+    char raw_message[1024];
+    int size;
+
+    size = data->size;
+
+    RELAY_WEECHAT_DATA(client, compression_bytes_in) += msg->data_size;
+    RELAY_WEECHAT_DATA(client, compression_bytes_out) += size;
+    RELAY_WEECHAT_DATA(client, compression_time) += time_usec;
+
+    snprintf (raw_message, sizeof (raw_message),
+              "obj: %d/%d bytes (%d%%, %ldus, total: %d%%), id: %s",
+              size,
+              msg->data_size,
+              100 - ((size * 100) / msg->data_size),
+              time_usec,
+              relay_weechat_compression_ratio (client),
+              msg->id);
+
+    relay_client_send_data (client, data, raw_message);
+}
+
+/*
+ * Sends a message.
+ *
+ * The same message can be sent to many clients: with compressions "zlib",
+ * "zstd" and "lz4", it is compressed only once for each compression (on first
+ * send to a client asking this compression).
+ */
+
+void
+relay_weechat_msg_send (struct t_relay_client *client,
+                        struct t_relay_weechat_msg *msg)
+{
+    uint32_t size32;
+    char compression, raw_message[1024], *buffer;
+    int client_compression, compressed_now, size;
+    long time_usec;
+    struct t_relay_client_outqueue_data *data;
+
+    client_compression = RELAY_WEECHAT_DATA(client, compression);
+
+    switch (client_compression)
+    {
+        case RELAY_WEECHAT_COMPRESSION_ZLIB:
+        case RELAY_WEECHAT_COMPRESSION_ZSTD:
+        case RELAY_WEECHAT_COMPRESSION_LZ4:
+            compressed_now = (msg->compressed_size[client_compression] == 0);
+            if (relay_weechat_msg_compress (msg, client_compression))
+            {
+                relay_weechat_msg_send_compressed (
+                    client, msg,
+                    msg->compressed[client_compression],
+                    (compressed_now) ?
+                    msg->compression_time[client_compression] : 0);
+                return;
+            }
+            break;
+        case RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM:
+            if ((weechat_config_integer (relay_config_network_compression_level) > 0)
+                && relay_weechat_msg_compress_zlib_stream (client, msg,
+                                                           &buffer, &size,
+                                                           &time_usec))
+            {
+                /* buffer is given to data (queued without copy if needed) */
+                data = relay_client_outqueue_data_new (buffer, size);
+                if (!data)
                 {
-                    gettimeofday (&tv1, NULL);
-                    rc = compress2 (dest + 5, &dest_size,
-                                    (Bytef *)(msg->data + 5), msg->data_size - 5,
-                                    weechat_config_integer (relay_config_network_compression_level));
-                    gettimeofday (&tv2, NULL);
-                    time_diff = weechat_util_timeval_diff (&tv1, &tv2);
-                    if ((rc == Z_OK) && ((int)dest_size + 5 < msg->data_size))
-                    {
-                        /* set size and compression flag */
-                        size32 = htonl ((uint32_t)(dest_size + 5));
-                        memcpy (dest, &size32, 4);
-                        dest[4] = RELAY_WEECHAT_COMPRESSION_ZLIB;
-
-                        /* display message in raw buffer */
-                        snprintf (raw_message, sizeof (raw_message),
-                                  "obj: %d/%d bytes (%d%%, %ldms), id: %s",
-                                  (int)dest_size + 5,
-                                  msg->data_size,
-                                  100 - ((((int)dest_size + 5) * 100) / msg->data_size),
-                                  time_diff,
-                                  msg->id);
-
-                        /* send compressed data */
-                        relay_client_send (client, (const char *)dest, dest_size + 5,
-                                           raw_message);
-
-                        free (dest);
-                        return;
-                    }
-                    free (dest);
+                    /*
+                     * the message is in the compression stream but will not
+                     * be sent: the client can not decompress next messages
+                     */
+                    weechat_printf_tags (NULL, "relay_client",
+                                         _("%s%s: not enough memory to send "
+                                           "message to client %s%s%s"),
+                                         weechat_prefix ("error"),
+                                         RELAY_PLUGIN_NAME,
+                                         RELAY_COLOR_CHAT_CLIENT,
+                                         client->desc,
+                                         RELAY_COLOR_CHAT);
+                    relay_client_set_status (client,
+                                             RELAY_STATUS_DISCONNECTED);
+                    return;
                 }
-                break;
-            default:
-                break;
-        }
+                relay_weechat_msg_send_compressed (client, msg, data,
+                                                   time_usec);
+                relay_client_outqueue_data_unref (data);
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+
+    /* compression asked but not done: count message as uncompressed */
+    if (client_compression != RELAY_WEECHAT_COMPRESSION_OFF)
+    {
+        RELAY_WEECHAT_DATA(client, compression_bytes_in) += msg->data_size;
+        RELAY_WEECHAT_DATA(client, compression_bytes_out) += msg->data_size;
     }
 
     /* compression failed (or not asked), send uncompressed message */
 
-    /* set size and compression flag */
-    size32 = htonl ((uint32_t)msg->data_size);
-    relay_weechat_msg_set_bytes (msg, 0, &size32, 4);
-    compression = RELAY_WEECHAT_COMPRESSION_OFF;
-    relay_weechat_msg_set_bytes (msg, 4, &compression, 1);
+    if (!msg->data)
+        return;
+
+    if (!msg->compressed[RELAY_WEECHAT_COMPRESSION_OFF])
+    {
+        /* set size and compression flag */
+        size32 = htonl ((uint32_t)msg->data_size);
+        relay_weechat_msg_set_bytes (msg, 0, &size32, 4);
+        compression = RELAY_WEECHAT_COMPRESSION_OFF;
+        relay_weechat_msg_set_bytes (msg, 4, &compression, 1);
+
+        /* buffer "data" is now owned by the shared data */
+        msg->compressed[RELAY_WEECHAT_COMPRESSION_OFF] =
+            relay_client_outqueue_data_new (msg->data, msg->data_size);
+        if (!msg->compressed[RELAY_WEECHAT_COMPRESSION_OFF])
+        {
+            msg->data = NULL;
+            msg->data_alloc = 0;
+            msg->data_size = 0;
+            return;
+        }
+    }
 
     /* send uncompressed data */
     snprintf (raw_message, sizeof (raw_message),
               "obj: %d bytes, id: %s", msg->data_size, msg->id);
-    relay_client_send (client, msg->data, msg->data_size, raw_message);
+    relay_client_send_data (client,
+                            msg->compressed[RELAY_WEECHAT_COMPRESSION_OFF],
+                            raw_message);
+}
+
+/*
+ * Frees all compression contexts (called when plugin is unloaded).
+ */
+
+void
+relay_weechat_msg_end ()
+{
+    relay_weechat_msg_zstd_reset ();
+#ifdef HAVE_ZSTD
+    if (relay_weechat_msg_zstd_cctx)
+    {
+        ZSTD_freeCCtx (relay_weechat_msg_zstd_cctx);
+        relay_weechat_msg_zstd_cctx = NULL;
+    }
+#endif
 }
 
 /*
@@ -1069,10 +1716,17 @@ relay_weechat_msg_send (struct t_relay_client *client,
 void
 relay_weechat_msg_free (struct t_relay_weechat_msg *msg)
 {
+    int i;
+
     if (msg->id)
         free (msg->id);
-    if (msg->data)
+    /* with compression "off", buffer "data" is owned by the shared data */
+    if (msg->data && !msg->compressed[RELAY_WEECHAT_COMPRESSION_OFF])
         free (msg->data);
+    for (i = 0; i < RELAY_WEECHAT_NUM_COMPRESSIONS; i++)
+    {
+        relay_client_outqueue_data_unref (msg->compressed[i]);
+    }
 
     free (msg);
 }
@@ -20,7 +20,9 @@
 #ifndef WEECHAT_RELAY_WEECHAT_MSG_H
 #define WEECHAT_RELAY_WEECHAT_MSG_H 1
 
+struct t_relay_client;
 struct t_relay_weechat_nicklist;
+struct t_relay_client_outqueue_data;
 
 #define RELAY_WEECHAT_MSG_INITIAL_ALLOC 4096
 
@@ -37,6 +39,12 @@ struct t_relay_weechat_nicklist;
 #define RELAY_WEECHAT_MSG_OBJ_INFO      "inf"
 #define RELAY_WEECHAT_MSG_OBJ_INFOLIST  "inl"
 #define RELAY_WEECHAT_MSG_OBJ_ARRAY     "arr"
+#define RELAY_WEECHAT_MSG_OBJ_LINES     "lin"
+
+/* fields of lines in object "lin" (protocol version 2), sent in "_protocol" */
+#define RELAY_WEECHAT_MSG_LINES_SCHEMA                                  \
+    "id:vint,buffer:sref,date:dtim,date_printed:dtim,flags:chr,"        \
+    "tags_array:sarr,prefix:sref,message:vstr"
 
 struct t_relay_weechat_msg
 {
@@ -44,6 +52,13 @@ struct t_relay_weechat_msg
     char *data;                        /* binary buffer                     */
     int data_alloc;                    /* currently allocated size          */
     int data_size;                     /* current size of buffer            */
+    /* message for each compression (built on first send, then shared by  */
+    /* all clients, even in their out queue); for compression "off", it   */
+    /* is the buffer "data" (which must not be changed after first send)   */
+    struct t_relay_client_outqueue_data *compressed[RELAY_WEECHAT_NUM_COMPRESSIONS];
+    int compressed_size[RELAY_WEECHAT_NUM_COMPRESSIONS]; /* 0: not built,   */
+                                       /* -1: message sent uncompressed     */
+    long compression_time[RELAY_WEECHAT_NUM_COMPRESSIONS]; /* in usec       */
 };
 
 extern struct t_relay_weechat_msg *relay_weechat_msg_new (const char *id);
@@ -68,6 +83,16 @@ extern void relay_weechat_msg_add_pointer (struct t_relay_weechat_msg *msg,
                                            void *pointer);
 extern void relay_weechat_msg_add_time (struct t_relay_weechat_msg *msg,
                                         time_t time);
+extern void relay_weechat_msg_add_varint (struct t_relay_weechat_msg *msg,
+                                          unsigned long long value);
+extern void relay_weechat_msg_add_varint_signed (struct t_relay_weechat_msg *msg,
+                                                 long long value);
+extern void relay_weechat_msg_add_string_ref (struct t_relay_weechat_msg *msg,
+                                              struct t_relay_client *client,
+                                              const char *string);
+extern void relay_weechat_msg_add_lines (struct t_relay_weechat_msg *msg,
+                                         struct t_relay_client *client,
+                                         void *line, int count);
 extern void relay_weechat_msg_add_hdata (struct t_relay_weechat_msg *msg,
                                          const char *path, const char *keys);
 extern void relay_weechat_msg_add_infolist (struct t_relay_weechat_msg *msg,
@@ -80,5 +105,7 @@ extern void relay_weechat_msg_add_nicklist (struct t_relay_weechat_msg *msg,
 extern void relay_weechat_msg_send (struct t_relay_client *client,
                                     struct t_relay_weechat_msg *msg);
 extern void relay_weechat_msg_free (struct t_relay_weechat_msg *msg);
+extern void relay_weechat_msg_zstd_reset ();
+extern void relay_weechat_msg_end ();
 
 #endif /* WEECHAT_RELAY_WEECHAT_MSG_H */
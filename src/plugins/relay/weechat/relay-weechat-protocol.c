@@ -142,19 +142,54 @@ relay_weechat_protocol_is_sync (struct t_relay_client *ptr_client,
     return 0;
 }
 
+/*
+ * Sends message "_protocol" to client (protocol version 2) with: protocol
+ * version, fields of lines in objects "lin" and max number of strings kept by
+ * client.
+ *
+ * Strings known by client and date of last line are reset (the client must
+ * do the same when it receives this message).
+ */
+
+void
+relay_weechat_protocol_send_schema (struct t_relay_client *client)
+{
+    struct t_relay_weechat_msg *msg;
+
+    weechat_hashtable_remove_all (RELAY_WEECHAT_DATA(client, strings));
+    RELAY_WEECHAT_DATA(client, last_date) = 0;
+    RELAY_WEECHAT_DATA(client, schema_sent) = 1;
+
+    msg = relay_weechat_msg_new ("_protocol");
+    if (msg)
+    {
+        relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_INT);
+        relay_weechat_msg_add_int (msg,
+                                   RELAY_WEECHAT_DATA(client, protocol_version));
+        relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_STRING);
+        relay_weechat_msg_add_string (msg, RELAY_WEECHAT_MSG_LINES_SCHEMA);
+        relay_weechat_msg_add_type (msg, RELAY_WEECHAT_MSG_OBJ_INT);
+        relay_weechat_msg_add_int (msg, RELAY_WEECHAT_STRINGS_MAX);
+        relay_weechat_msg_send (client, msg);
+        relay_weechat_msg_free (msg);
+    }
+}
+
 /*
  * Callback for command "init" (from client).
  *
  * Message looks like:
  *   init password=mypass
  *   init password=mypass,compression=zlib
+ *   init password=mypass,compression=zlib-stream
  *   init password=mypass,compression=off
  */
 
 RELAY_WEECHAT_PROTOCOL_CALLBACK(init)
 {
-    char **options, *pos, *password;
+    char **options, *pos, *password, *error;
     int num_options, i, compression;
+    long number;
 
     RELAY_WEECHAT_PROTOCOL_MIN_ARGS(1);
 
@@ -188,13 +223,35 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(init)
                 {
                     compression = relay_weechat_compression_search (pos);
                     if (compression >= 0)
+                    {
                         RELAY_WEECHAT_DATA(client, compression) = compression;
+                        /* start a new deflate stream on next message */
+                        relay_weechat_zlib_stream_free (client);
+                    }
+                }
+                else if (strcmp (options[i], "protocol") == 0)
+                {
+                    error = NULL;
+                    number = strtol (pos, &error, 10);
+                    if (error && !error[0]
+                        && (number >= RELAY_WEECHAT_PROTOCOL_VERSION_MIN)
+                        && (number <= RELAY_WEECHAT_PROTOCOL_VERSION_MAX))
+                    {
+                        RELAY_WEECHAT_DATA(client, protocol_version) = number;
+                    }
                 }
             }
         }
         weechat_string_free_split (options);
     }
 
+    /* protocol version 2: send schema (and reset strings known by client) */
+    if (RELAY_WEECHAT_DATA(client, password_ok)
+        && (RELAY_WEECHAT_DATA(client, protocol_version) >= 2))
+    {
+        relay_weechat_protocol_send_schema (client);
+    }
+
     return WEECHAT_RC_OK;
 }
 
@@ -224,6 +281,211 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(hdata)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Extracts range of line ids from a string:
+ *   "N"  : lines with id > N
+ *   "N-M": lines with N <= id <= M
+ *
+ * Returns:
+ *   1: range OK (id_max is set to -1 if there is no upper limit)
+ *   0: invalid range
+ */
+
+int
+relay_weechat_protocol_lines_range (const char *range, int *id_min,
+                                    int *id_max)
+{
+    char *error, *error2;
+    long number, number2;
+
+    if (!range || !range[0])
+        return 0;
+
+    error = NULL;
+    number = strtol (range, &error, 10);
+    if (!error || (error == range) || (number < 0))
+        return 0;
+
+    if (!error[0])
+    {
+        *id_min = (int)number + 1;
+        *id_max = -1;
+        return 1;
+    }
+
+    if ((error[0] != '-') || !error[1])
+        return 0;
+
+    error2 = NULL;
+    number2 = strtol (error + 1, &error2, 10);
+    if (!error2 || error2[0] || (number2 < number))
+        return 0;
+
+    *id_min = (int)number;
+    *id_max = (int)number2;
+    return 1;
+}
+
+/*
+ * Adds lines of a buffer with id in range [id_min, id_max] (id_max == -1 for
+ * no upper limit) in a message, as a "line_data" hdata (or an object "lin"
+ * with protocol version 2, in this case keys are ignored).
+ *
+ * Lines are read from the end of buffer, so the cost depends only on the
+ * number of lines after id_min. Nothing is added if no line matches.
+ *
+ * Buffers with free content are ignored: the id of their lines is the line
+ * position (y), it is neither unique nor increasing.
+ */
+
+void
+relay_weechat_protocol_add_lines (struct t_relay_client *client,
+                                  struct t_relay_weechat_msg *msg,
+                                  struct t_gui_buffer *buffer,
+                                  int id_min, int id_max, const char *keys)
+{
+    struct t_hdata *ptr_hdata_buffer, *ptr_hdata_lines, *ptr_hdata_line;
+    struct t_hdata *ptr_hdata_line_data;
+    void *ptr_lines, *ptr_line, *ptr_line_data, *ptr_first_line;
+    int id, count;
+    char path[128];
+
+    ptr_hdata_buffer = weechat_hdata_get ("buffer");
+    ptr_hdata_lines = weechat_hdata_get ("lines");
+    ptr_hdata_line = weechat_hdata_get ("line");
+    ptr_hdata_line_data = weechat_hdata_get ("line_data");
+    if (!ptr_hdata_buffer || !ptr_hdata_lines || !ptr_hdata_line
+        || !ptr_hdata_line_data)
+        return;
+
+    /* buffer with free content */
+    if (weechat_buffer_get_integer (buffer, "type") == 1)
+        return;
+
+    ptr_lines = weechat_hdata_pointer (ptr_hdata_buffer, buffer, "own_lines");
+    if (!ptr_lines)
+        return;
+
+    ptr_first_line = NULL;
+    count = 0;
+    ptr_line = weechat_hdata_pointer (ptr_hdata_lines, ptr_lines, "last_line");
+    while (ptr_line)
+    {
+        ptr_line_data = weechat_hdata_pointer (ptr_hdata_line, ptr_line,
+                                               "data");
+        if (ptr_line_data)
+        {
+            id = weechat_hdata_integer (ptr_hdata_line_data, ptr_line_data,
+                                        "id");
+            if (id < id_min)
+                break;
+            if ((id_max < 0) || (id <= id_max))
+            {
+                ptr_first_line = ptr_line;
+                count++;
+            }
+        }
+        ptr_line = weechat_hdata_pointer (ptr_hdata_line, ptr_line,
+                                          "prev_line");
+    }
+
+    if (!ptr_first_line)
+        return;
+
+    if (RELAY_WEECHAT_DATA(client, protocol_version) >= 2)
+    {
+        relay_weechat_msg_add_lines (msg, client, ptr_first_line, count);
+        return;
+    }
+
+    snprintf (path, sizeof (path),
+              "line:0x%lx(%d)/data",
+              (long unsigned int)ptr_first_line, count);
+    relay_weechat_msg_add_hdata (msg, path, keys);
+}
+
+/*
+ * Callback for command "lines" (from client): gets lines of one or more
+ * buffers using line ids (for incremental synchronization).
+ *
+ * Message looks like:
+ *   lines core.weechat
+ *   lines irc.freenode.#weechat:1234,irc.freenode.#test:100-200
+ *   lines *:1234 id,date,prefix,message
+ */
+
+RELAY_WEECHAT_PROTOCOL_CALLBACK(lines)
+{
+    struct t_relay_weechat_msg *msg;
+    struct t_hdata *ptr_hdata;
+    struct t_gui_buffer *ptr_buffer;
+    char **buffers, *pos;
+    const char *keys;
+    int i, num_buffers, id_min, id_max;
+
+    RELAY_WEECHAT_PROTOCOL_MIN_ARGS(1);
+
+    keys = (argc > 1) ?
+        argv_eol[1] :
+        "id,buffer,date,date_printed,displayed,highlight,tags_array,"
+        "prefix,message";
+
+    buffers = weechat_string_split (argv[0], ",", 0, 0, &num_buffers);
+    if (!buffers)
+        return WEECHAT_RC_OK;
+
+    if ((RELAY_WEECHAT_DATA(client, protocol_version) >= 2)
+        && !RELAY_WEECHAT_DATA(client, schema_sent))
+    {
+        relay_weechat_protocol_send_schema (client);
+    }
+
+    msg = relay_weechat_msg_new (id);
+    if (msg)
+    {
+        ptr_hdata = weechat_hdata_get ("buffer");
+        for (i = 0; i < num_buffers; i++)
+        {
+            id_min = 0;
+            id_max = -1;
+            pos = strrchr (buffers[i], ':');
+            if (pos
+                && relay_weechat_protocol_lines_range (pos + 1,
+                                                       &id_min, &id_max))
+            {
+                pos[0] = '\0';
+            }
+            if (strcmp (buffers[i], "*") == 0)
+            {
+                ptr_buffer = weechat_hdata_get_list (ptr_hdata, "gui_buffers");
+                while (ptr_buffer)
+                {
+                    relay_weechat_protocol_add_lines (client, msg,
+                                                      ptr_buffer,
+                                                      id_min, id_max, keys);
+                    ptr_buffer = weechat_hdata_move (ptr_hdata, ptr_buffer, 1);
+                }
+            }
+            else
+            {
+                ptr_buffer = relay_weechat_protocol_get_buffer (buffers[i]);
+                if (ptr_buffer)
+                {
+                    relay_weechat_protocol_add_lines (client, msg,
+                                                      ptr_buffer,
+                                                      id_min, id_max, keys);
+                }
+            }
+        }
+        relay_weechat_msg_send (client, msg);
+        relay_weechat_msg_free (msg);
+    }
+
+    weechat_string_free_split (buffers);
+
+    return WEECHAT_RC_OK;
+}
+
 /*
  * Callback for command "info" (from client).
  *
@@ -405,8 +667,34 @@ RELAY_WEECHAT_PROTOCOL_CALLBACK(input)
     return WEECHAT_RC_OK;
 }
 
+/*
+ * Sends a line to a client using protocol version 2 (object "lin").
+ */
+
+void
+relay_weechat_protocol_send_line (struct t_relay_client *client,
+                                  const char *id, void *line)
+{
+    struct t_relay_weechat_msg *msg;
+
+    if (!RELAY_WEECHAT_DATA(client, schema_sent))
+        relay_weechat_protocol_send_schema (client);
+
+    msg = relay_weechat_msg_new (id);
+    if (msg)
+    {
+        relay_weechat_msg_add_lines (msg, client, line, 1);
+        relay_weechat_msg_send (client, msg);
+        relay_weechat_msg_free (msg);
+    }
+}
+
 /*
  * Callback for signals "buffer_*".
+ *
+ * Signals are hooked once for all clients: the message is built (and
+ * compressed) only once, then sent to all clients synchronized with the
+ * buffer (except lines sent to clients using protocol version 2).
  */
 
 int
@@ -420,228 +708,71 @@ relay_weechat_protocol_signal_buffer_cb (void *data, const char *signal,
     struct t_gui_line_data *ptr_line_data;
     struct t_gui_buffer *ptr_buffer;
     struct t_relay_weechat_msg *msg;
+    const char *keys;
     char cmd_hdata[64], str_signal[128];
+    int flags, closing;
 
     /* make C compiler happy */
+    (void) data;
     (void) type_data;
 
-    ptr_client = (struct t_relay_client *)data;
-    if (!ptr_client || !relay_client_valid (ptr_client))
-        return WEECHAT_RC_OK;
-
-    snprintf (str_signal, sizeof (str_signal), "_%s", signal);
+    ptr_buffer = (struct t_gui_buffer *)signal_data;
+    ptr_line = NULL;
+    ptr_line_data = NULL;
+    keys = NULL;
+    flags = 0;
+    closing = 0;
 
     if (strcmp (signal, "buffer_opened") == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
         /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (long unsigned int)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,short_name,"
-                                             "nicklist,title,local_variables,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
+            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+        keys = "number,full_name,short_name,nicklist,title,local_variables,"
+            "prev_buffer,next_buffer";
     }
     else if (strcmp (signal, "buffer_type_changed") == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
         /* send signal only if sync with flag "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (long unsigned int)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,type");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+        keys = "number,full_name,type";
     }
-    else if (strcmp (signal, "buffer_moved") == 0)
-    {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (long unsigned int)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
-    }
-    else if ((strcmp (signal, "buffer_merged") == 0)
-             || (strcmp (signal, "buffer_unmerged") == 0))
-    {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
-        /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (long unsigned int)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
-    }
-    else if ((strcmp (signal, "buffer_hidden") == 0)
+    else if ((strcmp (signal, "buffer_moved") == 0)
+             || (strcmp (signal, "buffer_merged") == 0)
+             || (strcmp (signal, "buffer_unmerged") == 0)
+             || (strcmp (signal, "buffer_hidden") == 0)
              || (strcmp (signal, "buffer_unhidden") == 0))
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
         /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (long unsigned int)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,"
-                                             "prev_buffer,next_buffer");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
+            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+        keys = "number,full_name,prev_buffer,next_buffer";
     }
     else if (strcmp (signal, "buffer_renamed") == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
         /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (long unsigned int)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,short_name,"
-                                             "local_variables");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
+            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+        keys = "number,full_name,short_name,local_variables";
     }
     else if (strcmp (signal, "buffer_title_changed") == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
         /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (long unsigned int)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,title");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
+            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+        keys = "number,full_name,title";
     }
     else if (strcmp (signal, "buffer_cleared") == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
         /* send signal only if sync with flag "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (long unsigned int)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+        keys = "number,full_name";
     }
     else if (strncmp (signal, "buffer_localvar_", 16) == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
         /* send signal only if sync with flag "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (long unsigned int)ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name,local_variables");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+        keys = "number,full_name,local_variables";
     }
     else if (strcmp (signal, "buffer_line_added") == 0)
     {
@@ -663,54 +794,77 @@ relay_weechat_protocol_signal_buffer_cb (void *data, const char *signal,
 
         ptr_buffer = weechat_hdata_pointer (ptr_hdata_line_data, ptr_line_data,
                                             "buffer");
-        if (!ptr_buffer || (relay_raw_buffer && (ptr_buffer == relay_raw_buffer)))
+        if (relay_raw_buffer && (ptr_buffer == relay_raw_buffer))
             return WEECHAT_RC_OK;
 
         /* send signal only if sync with flag "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
-        {
-            msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "line_data:0x%lx",
-                          (long unsigned int)ptr_line_data);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "buffer,date,date_printed,"
-                                             "displayed,highlight,tags_array,"
-                                             "prefix,message");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
-        }
+        flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+        keys = "id,buffer,date,date_printed,displayed,highlight,tags_array,"
+            "prefix,message";
     }
     else if (strcmp (signal, "buffer_closing") == 0)
     {
-        ptr_buffer = (struct t_gui_buffer *)signal_data;
-        if (!ptr_buffer)
-            return WEECHAT_RC_OK;
-
         /* send signal only if sync with flag "buffers" or "buffer" */
-        if (relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER))
+        flags = RELAY_WEECHAT_PROTOCOL_SYNC_BUFFERS |
+            RELAY_WEECHAT_PROTOCOL_SYNC_BUFFER;
+        keys = "number,full_name";
+        closing = 1;
+    }
+
+    if (!keys || !ptr_buffer)
+        return WEECHAT_RC_OK;
+
+    snprintf (str_signal, sizeof (str_signal), "_%s", signal);
+    if (ptr_line_data)
+    {
+        snprintf (cmd_hdata, sizeof (cmd_hdata),
+                  "line_data:0x%lx", (long unsigned int)ptr_line_data);
+    }
+    else
+    {
+        snprintf (cmd_hdata, sizeof (cmd_hdata),
+                  "buffer:0x%lx", (long unsigned int)ptr_buffer);
+    }
+
+    /* build message on first client synchronized, send it to all of them */
+    msg = NULL;
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
+    {
+        if (!RELAY_WEECHAT_CLIENT_HOOKED(ptr_client)
+            || !relay_weechat_protocol_is_sync (ptr_client, ptr_buffer, flags))
+        {
+            continue;
+        }
+        if (closing)
+        {
+            weechat_hashtable_remove (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
+                                      ptr_buffer);
+        }
+        if (ptr_line_data
+            && (RELAY_WEECHAT_DATA(ptr_client, protocol_version) >= 2))
+        {
+            /*
+             * protocol version 2: the line depends on strings and date sent
+             * before to this client, so the message is built for each client
+             */
+            relay_weechat_protocol_send_line (ptr_client, str_signal,
+                                              ptr_line);
+            continue;
+        }
+        if (!msg)
         {
             msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                snprintf (cmd_hdata, sizeof (cmd_hdata),
-                          "buffer:0x%lx", (long unsigned int)ptr_buffer);
-                weechat_hashtable_remove (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
-                                          ptr_buffer);
-                relay_weechat_msg_add_hdata (msg, cmd_hdata,
-                                             "number,full_name");
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
+            if (!msg)
+                break;
+            relay_weechat_msg_add_hdata (msg, cmd_hdata, keys);
         }
+        relay_weechat_msg_send (ptr_client, msg);
     }
 
+    if (msg)
+        relay_weechat_msg_free (msg);
+
     return WEECHAT_RC_OK;
 }
 
@@ -797,6 +951,9 @@ relay_weechat_protocol_timer_nicklist_cb (void *data, int remaining_calls)
 
 /*
  * Callback for hsignals "nicklist_*".
+ *
+ * Nicklist diffs are stored for each client synchronized with the buffer,
+ * and sent later by a timer.
  */
 
 int
@@ -810,16 +967,10 @@ relay_weechat_protocol_hsignal_nicklist_cb (void *data, const char *signal,
     struct t_relay_weechat_nicklist *ptr_nicklist;
     char diff;
 
-    ptr_client = (struct t_relay_client *)data;
-    if (!ptr_client || !relay_client_valid (ptr_client))
-        return WEECHAT_RC_OK;
+    /* make C compiler happy */
+    (void) data;
 
-    /* check if buffer is synchronized with flag "nicklist" */
     ptr_buffer = weechat_hashtable_get (hashtable, "buffer");
-    if (!relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
-                                         RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST))
-        return WEECHAT_RC_OK;
-
     parent_group = weechat_hashtable_get (hashtable, "parent_group");
     group = weechat_hashtable_get (hashtable, "group");
     nick = weechat_hashtable_get (hashtable, "nick");
@@ -828,21 +979,6 @@ relay_weechat_protocol_hsignal_nicklist_cb (void *data, const char *signal,
     if (!parent_group)
         return WEECHAT_RC_OK;
 
-    ptr_nicklist = weechat_hashtable_get (RELAY_WEECHAT_DATA(ptr_client,
-                                                             buffers_nicklist),
-                                          ptr_buffer);
-    if (!ptr_nicklist)
-    {
-        ptr_nicklist = relay_weechat_nicklist_new ();
-        if (!ptr_nicklist)
-            return WEECHAT_RC_OK;
-        ptr_nicklist->nicklist_count = weechat_buffer_get_integer (ptr_buffer,
-                                                                   "nicklist_count");
-        weechat_hashtable_set (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
-                               ptr_buffer,
-                               ptr_nicklist);
-    }
-
     /* set diff type */
     diff = RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN;
     if ((strcmp (signal, "nicklist_group_added") == 0)
@@ -861,28 +997,55 @@ relay_weechat_protocol_hsignal_nicklist_cb (void *data, const char *signal,
         diff = RELAY_WEECHAT_NICKLIST_DIFF_CHANGED;
     }
 
-    if (diff != RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN)
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
     {
-        /*
-         * add items if nicklist was not empty or very small (otherwise we will
-         * send full nicklist)
-         */
-        if (ptr_nicklist->nicklist_count > 1)
+        /* check if buffer is synchronized with flag "nicklist" */
+        if (!RELAY_WEECHAT_CLIENT_HOOKED(ptr_client)
+            || !relay_weechat_protocol_is_sync (ptr_client, ptr_buffer,
+                                                RELAY_WEECHAT_PROTOCOL_SYNC_NICKLIST))
         {
-            /* add nicklist item for parent group and group/nick */
-            relay_weechat_nicklist_add_item (ptr_nicklist,
-                                             RELAY_WEECHAT_NICKLIST_DIFF_PARENT,
-                                             parent_group, NULL);
-            relay_weechat_nicklist_add_item (ptr_nicklist, diff, group, nick);
+            continue;
         }
 
-        /* add timer to send nicklist */
-        if (RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist))
+        ptr_nicklist = weechat_hashtable_get (RELAY_WEECHAT_DATA(ptr_client,
+                                                                 buffers_nicklist),
+                                              ptr_buffer);
+        if (!ptr_nicklist)
         {
-            weechat_unhook (RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist));
-            RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist) = NULL;
+            ptr_nicklist = relay_weechat_nicklist_new ();
+            if (!ptr_nicklist)
+                continue;
+            ptr_nicklist->nicklist_count = weechat_buffer_get_integer (ptr_buffer,
+                                                                       "nicklist_count");
+            weechat_hashtable_set (RELAY_WEECHAT_DATA(ptr_client, buffers_nicklist),
+                                   ptr_buffer,
+                                   ptr_nicklist);
+        }
+
+        if (diff != RELAY_WEECHAT_NICKLIST_DIFF_UNKNOWN)
+        {
+            /*
+             * add items if nicklist was not empty or very small (otherwise we
+             * will send full nicklist)
+             */
+            if (ptr_nicklist->nicklist_count > 1)
+            {
+                /* add nicklist item for parent group and group/nick */
+                relay_weechat_nicklist_add_item (ptr_nicklist,
+                                                 RELAY_WEECHAT_NICKLIST_DIFF_PARENT,
+                                                 parent_group, NULL);
+                relay_weechat_nicklist_add_item (ptr_nicklist, diff, group, nick);
+            }
+
+            /* add timer to send nicklist */
+            if (RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist))
+            {
+                weechat_unhook (RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist));
+                RELAY_WEECHAT_DATA(ptr_client, hook_timer_nicklist) = NULL;
+            }
+            relay_weechat_hook_timer_nicklist (ptr_client);
         }
-        relay_weechat_hook_timer_nicklist (ptr_client);
     }
 
     return WEECHAT_RC_OK;
@@ -902,31 +1065,41 @@ relay_weechat_protocol_signal_upgrade_cb (void *data, const char *signal,
     char str_signal[128];
 
     /* make C compiler happy */
+    (void) data;
     (void) type_data;
     (void) signal_data;
 
-    ptr_client = (struct t_relay_client *)data;
-    if (!ptr_client || !relay_client_valid (ptr_client))
+    if ((strcmp (signal, "upgrade") != 0)
+        && (strcmp (signal, "upgrade_ended") != 0))
+    {
         return WEECHAT_RC_OK;
+    }
 
     snprintf (str_signal, sizeof (str_signal), "_%s", signal);
 
-    if ((strcmp (signal, "upgrade") == 0)
-        || (strcmp (signal, "upgrade_ended") == 0))
+    msg = NULL;
+    for (ptr_client = relay_clients; ptr_client;
+         ptr_client = ptr_client->next_client)
     {
         /* send signal only if client is synchronized with flag "upgrade" */
-        if (relay_weechat_protocol_is_sync (ptr_client, NULL,
-                                            RELAY_WEECHAT_PROTOCOL_SYNC_UPGRADE))
+        if (!RELAY_WEECHAT_CLIENT_HOOKED(ptr_client)
+            || !relay_weechat_protocol_is_sync (ptr_client, NULL,
+                                                RELAY_WEECHAT_PROTOCOL_SYNC_UPGRADE))
+        {
+            continue;
+        }
+        if (!msg)
         {
             msg = relay_weechat_msg_new (str_signal);
-            if (msg)
-            {
-                relay_weechat_msg_send (ptr_client, msg);
-                relay_weechat_msg_free (msg);
-            }
+            if (!msg)
+                break;
         }
+        relay_weechat_msg_send (ptr_client, msg);
     }
 
+    if (msg)
+        relay_weechat_msg_free (msg);
+
     return WEECHAT_RC_OK;
 }
 
@@ -1242,6 +1415,7 @@ relay_weechat_protocol_recv (struct t_relay_client *client, const char *data)
     struct t_relay_weechat_protocol_cb protocol_cb[] =
         { { "init", &relay_weechat_protocol_cb_init },
           { "hdata", &relay_weechat_protocol_cb_hdata },
+          { "lines", &relay_weechat_protocol_cb_lines },
           { "info", &relay_weechat_protocol_cb_info },
           { "infolist", &relay_weechat_protocol_cb_infolist },
           { "nicklist", &relay_weechat_protocol_cb_nicklist },
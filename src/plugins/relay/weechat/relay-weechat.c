@@ -29,6 +29,7 @@
 #include <sys/time.h>
 #include <errno.h>
 #include <arpa/inet.h>
+#include <zlib.h>
 
 #include "../../weechat-plugin.h"
 #include "../relay.h"
@@ -41,14 +42,57 @@
 
 
 char *relay_weechat_compression_string[] = /* strings for compressions      */
-{ "off", "zlib" };
+{ "off", "zlib", "zlib-stream", "zstd", "lz4" };
 
+/*
+ * signals are hooked once for all WeeChat clients (hooks are created with
+ * first client and removed with last one): each event is then built once
+ * and sent to all clients synchronized with this event
+ */
+struct t_hook *relay_weechat_hook_signal_buffer = NULL;
+struct t_hook *relay_weechat_hook_hsignal_nicklist = NULL;
+struct t_hook *relay_weechat_hook_signal_upgrade = NULL;
+int relay_weechat_hook_signals_count = 0; /* number of clients hooked      */
+
+
+/*
+ * Checks if a compression is available (zstd and lz4 are optional).
+ *
+ * Returns:
+ *   1: compression is available
+ *   0: compression is not available
+ */
+
+int
+relay_weechat_compression_available (int compression)
+{
+    switch (compression)
+    {
+        case RELAY_WEECHAT_COMPRESSION_ZSTD:
+#ifdef HAVE_ZSTD
+            return 1;
+#else
+            return 0;
+#endif
+        case RELAY_WEECHAT_COMPRESSION_LZ4:
+#ifdef HAVE_LZ4
+            return 1;
+#else
+            return 0;
+#endif
+        default:
+            break;
+    }
+
+    return ((compression >= 0)
+            && (compression < RELAY_WEECHAT_NUM_COMPRESSIONS)) ? 1 : 0;
+}
 
 /*
  * Searches for a compression.
  *
  * Returns index of compression in enum t_relay_weechat_compression, -1 if
- * compression is not found.
+ * compression is not found (or not available in this build).
  */
 
 int
@@ -59,13 +103,44 @@ relay_weechat_compression_search (const char *compression)
     for (i = 0; i < RELAY_WEECHAT_NUM_COMPRESSIONS; i++)
     {
         if (weechat_strcasecmp (relay_weechat_compression_string[i], compression) == 0)
-            return i;
+            return (relay_weechat_compression_available (i)) ? i : -1;
     }
 
     /* compression not found */
     return -1;
 }
 
+/*
+ * Returns compression ratio for a client: percentage of bytes saved by
+ * compression (0 if nothing was compressed).
+ */
+
+int
+relay_weechat_compression_ratio (struct t_relay_client *client)
+{
+    if (RELAY_WEECHAT_DATA(client, compression_bytes_in) == 0)
+        return 0;
+
+    return 100 - (int)((RELAY_WEECHAT_DATA(client, compression_bytes_out) * 100) /
+                       RELAY_WEECHAT_DATA(client, compression_bytes_in));
+}
+
+/*
+ * Frees the deflate stream of a client (a new stream is started on next
+ * message sent with compression "zlib-stream").
+ */
+
+void
+relay_weechat_zlib_stream_free (struct t_relay_client *client)
+{
+    if (!RELAY_WEECHAT_DATA(client, zlib_stream))
+        return;
+
+    deflateEnd (RELAY_WEECHAT_DATA(client, zlib_stream));
+    free (RELAY_WEECHAT_DATA(client, zlib_stream));
+    RELAY_WEECHAT_DATA(client, zlib_stream) = NULL;
+}
+
 /*
  * Hooks signals for a client.
  */
@@ -73,41 +148,67 @@ relay_weechat_compression_search (const char *compression)
 void
 relay_weechat_hook_signals (struct t_relay_client *client)
 {
-    RELAY_WEECHAT_DATA(client, hook_signal_buffer) =
-        weechat_hook_signal ("buffer_*",
-                             &relay_weechat_protocol_signal_buffer_cb,
-                             client);
-    RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) =
-        weechat_hook_hsignal ("nicklist_*",
-                              &relay_weechat_protocol_hsignal_nicklist_cb,
-                              client);
-    RELAY_WEECHAT_DATA(client, hook_signal_upgrade) =
-        weechat_hook_signal ("upgrade*",
-                             &relay_weechat_protocol_signal_upgrade_cb,
-                             client);
+    if (RELAY_WEECHAT_DATA(client, signals_hooked))
+        return;
+
+    RELAY_WEECHAT_DATA(client, signals_hooked) = 1;
+    relay_weechat_hook_signals_count++;
+
+    if (!relay_weechat_hook_signal_buffer)
+    {
+        relay_weechat_hook_signal_buffer =
+            weechat_hook_signal ("buffer_*",
+                                 &relay_weechat_protocol_signal_buffer_cb,
+                                 NULL);
+    }
+    if (!relay_weechat_hook_hsignal_nicklist)
+    {
+        relay_weechat_hook_hsignal_nicklist =
+            weechat_hook_hsignal ("nicklist_*",
+                                  &relay_weechat_protocol_hsignal_nicklist_cb,
+                                  NULL);
+    }
+    if (!relay_weechat_hook_signal_upgrade)
+    {
+        relay_weechat_hook_signal_upgrade =
+            weechat_hook_signal ("upgrade*",
+                                 &relay_weechat_protocol_signal_upgrade_cb,
+                                 NULL);
+    }
 }
 
 /*
- * Unhooks signals for a client.
+ * Unhooks signals for a client (signals are unhooked when there are no more
+ * clients hooked).
  */
 
 void
 relay_weechat_unhook_signals (struct t_relay_client *client)
 {
-    if (RELAY_WEECHAT_DATA(client, hook_signal_buffer))
+    if (!RELAY_WEECHAT_DATA(client, signals_hooked))
+        return;
+
+    RELAY_WEECHAT_DATA(client, signals_hooked) = 0;
+    relay_weechat_hook_signals_count--;
+
+    if (relay_weechat_hook_signals_count > 0)
+        return;
+
+    relay_weechat_hook_signals_count = 0;
+    if (relay_weechat_hook_signal_buffer)
     {
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_buffer));
-        RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
+        weechat_unhook (relay_weechat_hook_signal_buffer);
+        relay_weechat_hook_signal_buffer = NULL;
     }
-    if (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist))
+    if (relay_weechat_hook_hsignal_nicklist)
     {
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist));
-        RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
+        weechat_unhook (relay_weechat_hook_hsignal_nicklist);
+        relay_weechat_hook_hsignal_nicklist = NULL;
     }
-    if (RELAY_WEECHAT_DATA(client, hook_signal_upgrade))
+    if (relay_weechat_hook_signal_upgrade)
     {
-        weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
-        RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
+        weechat_unhook (relay_weechat_hook_signal_upgrade);
+        relay_weechat_hook_signal_upgrade = NULL;
     }
 }
 
@@ -142,6 +243,7 @@ void
 relay_weechat_close_connection (struct t_relay_client *client)
 {
     relay_weechat_unhook_signals (client);
+    relay_weechat_zlib_stream_free (client);
 }
 
 /*
@@ -177,15 +279,26 @@ relay_weechat_alloc (struct t_relay_client *client)
     {
         RELAY_WEECHAT_DATA(client, password_ok) = (password && password[0]) ? 0 : 1;
         RELAY_WEECHAT_DATA(client, compression) = RELAY_WEECHAT_COMPRESSION_ZLIB;
+        RELAY_WEECHAT_DATA(client, zlib_stream) = NULL;
+        RELAY_WEECHAT_DATA(client, compression_bytes_in) = 0;
+        RELAY_WEECHAT_DATA(client, compression_bytes_out) = 0;
+        RELAY_WEECHAT_DATA(client, compression_time) = 0;
+        RELAY_WEECHAT_DATA(client, protocol_version) = RELAY_WEECHAT_PROTOCOL_VERSION_MIN;
+        RELAY_WEECHAT_DATA(client, schema_sent) = 0;
+        RELAY_WEECHAT_DATA(client, strings) =
+            weechat_hashtable_new (256,
+                                   WEECHAT_HASHTABLE_STRING,
+                                   WEECHAT_HASHTABLE_INTEGER,
+                                   NULL,
+                                   NULL);
+        RELAY_WEECHAT_DATA(client, last_date) = 0;
         RELAY_WEECHAT_DATA(client, buffers_sync) =
             weechat_hashtable_new (32,
                                    WEECHAT_HASHTABLE_STRING,
                                    WEECHAT_HASHTABLE_INTEGER,
                                    NULL,
                                    NULL);
-        RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
-        RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
-        RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
+        RELAY_WEECHAT_DATA(client, signals_hooked) = 0;
         RELAY_WEECHAT_DATA(client, buffers_nicklist) =
             weechat_hashtable_new (32,
                                    WEECHAT_HASHTABLE_POINTER,
@@ -217,7 +330,7 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
     struct t_relay_weechat_data *weechat_data;
     int index, value;
     char name[64];
-    const char *key;
+    const char *key, *str;
 
     client->protocol_data = malloc (sizeof (*weechat_data));
     if (client->protocol_data)
@@ -225,6 +338,50 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
         /* general stuff */
         RELAY_WEECHAT_DATA(client, password_ok) = weechat_infolist_integer (infolist, "password_ok");
         RELAY_WEECHAT_DATA(client, compression) = weechat_infolist_integer (infolist, "compression");
+        /*
+         * the deflate stream is lost on upgrade: the client still has the
+         * inflate stream, so a new stream can not be started; fallback to
+         * compression of each message with zlib (same if compression is not
+         * available any more in new binary)
+         */
+        if ((RELAY_WEECHAT_DATA(client, compression) == RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM)
+            || !relay_weechat_compression_available (RELAY_WEECHAT_DATA(client, compression)))
+        {
+            RELAY_WEECHAT_DATA(client, compression) = RELAY_WEECHAT_COMPRESSION_ZLIB;
+        }
+        RELAY_WEECHAT_DATA(client, zlib_stream) = NULL;
+        RELAY_WEECHAT_DATA(client, compression_bytes_in) = 0;
+        RELAY_WEECHAT_DATA(client, compression_bytes_out) = 0;
+        RELAY_WEECHAT_DATA(client, compression_time) = 0;
+        str = weechat_infolist_string (infolist, "compression_bytes_in");
+        if (str)
+            sscanf (str, "%lu", &(RELAY_WEECHAT_DATA(client, compression_bytes_in)));
+        str = weechat_infolist_string (infolist, "compression_bytes_out");
+        if (str)
+            sscanf (str, "%lu", &(RELAY_WEECHAT_DATA(client, compression_bytes_out)));
+        str = weechat_infolist_string (infolist, "compression_time");
+        if (str)
+            sscanf (str, "%lu", &(RELAY_WEECHAT_DATA(client, compression_time)));
+
+        /*
+         * protocol version: strings known by client are lost on upgrade, so
+         * message "_protocol" will be sent again before next lines (the
+         * client then forgets its strings)
+         */
+        RELAY_WEECHAT_DATA(client, protocol_version) = RELAY_WEECHAT_PROTOCOL_VERSION_MIN;
+        if (weechat_infolist_search_var (infolist, "protocol_version"))
+        {
+            RELAY_WEECHAT_DATA(client, protocol_version) =
+                weechat_infolist_integer (infolist, "protocol_version");
+        }
+        RELAY_WEECHAT_DATA(client, schema_sent) = 0;
+        RELAY_WEECHAT_DATA(client, strings) =
+            weechat_hashtable_new (256,
+                                   WEECHAT_HASHTABLE_STRING,
+                                   WEECHAT_HASHTABLE_INTEGER,
+                                   NULL,
+                                   NULL);
+        RELAY_WEECHAT_DATA(client, last_date) = 0;
 
         /* sync of buffers */
         RELAY_WEECHAT_DATA(client, buffers_sync) = weechat_hashtable_new (32,
@@ -246,9 +403,7 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
                                    &value);
             index++;
         }
-        RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
-        RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
-        RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
+        RELAY_WEECHAT_DATA(client, signals_hooked) = 0;
         RELAY_WEECHAT_DATA(client, buffers_nicklist) =
             weechat_hashtable_new (32,
                                    WEECHAT_HASHTABLE_POINTER,
@@ -260,13 +415,7 @@ relay_weechat_alloc_with_infolist (struct t_relay_client *client,
                                        &relay_weechat_free_buffers_nicklist);
         RELAY_WEECHAT_DATA(client, hook_timer_nicklist) = NULL;
 
-        if (RELAY_CLIENT_HAS_ENDED(client))
-        {
-            RELAY_WEECHAT_DATA(client, hook_signal_buffer) = NULL;
-            RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist) = NULL;
-            RELAY_WEECHAT_DATA(client, hook_signal_upgrade) = NULL;
-        }
-        else
+        if (!RELAY_CLIENT_HAS_ENDED(client))
             relay_weechat_hook_signals (client);
     }
 }
@@ -282,12 +431,10 @@ relay_weechat_free (struct t_relay_client *client)
     {
         if (RELAY_WEECHAT_DATA(client, buffers_sync))
             weechat_hashtable_free (RELAY_WEECHAT_DATA(client, buffers_sync));
-        if (RELAY_WEECHAT_DATA(client, hook_signal_buffer))
-            weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_buffer));
-        if (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist))
-            weechat_unhook (RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist));
-        if (RELAY_WEECHAT_DATA(client, hook_signal_upgrade))
-            weechat_unhook (RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
+        relay_weechat_unhook_signals (client);
+        relay_weechat_zlib_stream_free (client);
+        if (RELAY_WEECHAT_DATA(client, strings))
+            weechat_hashtable_free (RELAY_WEECHAT_DATA(client, strings));
         if (RELAY_WEECHAT_DATA(client, buffers_nicklist))
             weechat_hashtable_free (RELAY_WEECHAT_DATA(client, buffers_nicklist));
 
@@ -309,6 +456,8 @@ int
 relay_weechat_add_to_infolist (struct t_infolist_item *item,
                                struct t_relay_client *client)
 {
+    char value[128];
+
     if (!item || !client)
         return 0;
 
@@ -316,6 +465,24 @@ relay_weechat_add_to_infolist (struct t_infolist_item *item,
         return 0;
     if (!weechat_infolist_new_var_integer (item, "compression", RELAY_WEECHAT_DATA(client, compression)))
         return 0;
+    snprintf (value, sizeof (value), "%lu", RELAY_WEECHAT_DATA(client, compression_bytes_in));
+    if (!weechat_infolist_new_var_string (item, "compression_bytes_in", value))
+        return 0;
+    snprintf (value, sizeof (value), "%lu", RELAY_WEECHAT_DATA(client, compression_bytes_out));
+    if (!weechat_infolist_new_var_string (item, "compression_bytes_out", value))
+        return 0;
+    if (!weechat_infolist_new_var_integer (item, "compression_ratio",
+                                           relay_weechat_compression_ratio (client)))
+        return 0;
+    snprintf (value, sizeof (value), "%lu", RELAY_WEECHAT_DATA(client, compression_time));
+    if (!weechat_infolist_new_var_string (item, "compression_time", value))
+        return 0;
+    if (!weechat_infolist_new_var_integer (item, "protocol_version", RELAY_WEECHAT_DATA(client, protocol_version)))
+        return 0;
+    if (!weechat_infolist_new_var_integer (item, "strings_count",
+                                           weechat_hashtable_get_integer (RELAY_WEECHAT_DATA(client, strings),
+                                                                          "items_count")))
+        return 0;
     if (!weechat_hashtable_add_to_infolist (RELAY_WEECHAT_DATA(client, buffers_sync), item, "buffers_sync"))
         return 0;
 
@@ -333,13 +500,22 @@ relay_weechat_print_log (struct t_relay_client *client)
     {
         weechat_log_printf ("    password_ok. . . . . . : %d",   RELAY_WEECHAT_DATA(client, password_ok));
         weechat_log_printf ("    compression. . . . . . : %d",   RELAY_WEECHAT_DATA(client, compression));
+        weechat_log_printf ("    zlib_stream. . . . . . : 0x%lx", RELAY_WEECHAT_DATA(client, zlib_stream));
+        weechat_log_printf ("    compression_bytes_in . : %lu",  RELAY_WEECHAT_DATA(client, compression_bytes_in));
+        weechat_log_printf ("    compression_bytes_out. : %lu",  RELAY_WEECHAT_DATA(client, compression_bytes_out));
+        weechat_log_printf ("    compression_time . . . : %lu",  RELAY_WEECHAT_DATA(client, compression_time));
+        weechat_log_printf ("    protocol_version . . . : %d",   RELAY_WEECHAT_DATA(client, protocol_version));
+        weechat_log_printf ("    schema_sent. . . . . . : %d",   RELAY_WEECHAT_DATA(client, schema_sent));
+        weechat_log_printf ("    strings. . . . . . . . : 0x%lx (%d items)",
+                            RELAY_WEECHAT_DATA(client, strings),
+                            weechat_hashtable_get_integer (RELAY_WEECHAT_DATA(client, strings),
+                                                           "items_count"));
+        weechat_log_printf ("    last_date. . . . . . . : %ld",  (long)RELAY_WEECHAT_DATA(client, last_date));
         weechat_log_printf ("    buffers_sync . . . . . : 0x%lx (hashtable: '%s')",
                             RELAY_WEECHAT_DATA(client, buffers_sync),
                             weechat_hashtable_get_string (RELAY_WEECHAT_DATA(client, buffers_sync),
                                                           "keys_values"));
-        weechat_log_printf ("    hook_signal_buffer . . : 0x%lx", RELAY_WEECHAT_DATA(client, hook_signal_buffer));
-        weechat_log_printf ("    hook_hsignal_nicklist. : 0x%lx", RELAY_WEECHAT_DATA(client, hook_hsignal_nicklist));
-        weechat_log_printf ("    hook_signal_upgrade. . : 0x%lx", RELAY_WEECHAT_DATA(client, hook_signal_upgrade));
+        weechat_log_printf ("    signals_hooked . . . . : %d",   RELAY_WEECHAT_DATA(client, signals_hooked));
         weechat_log_printf ("    buffers_nicklist . . . : 0x%lx (hashtable: '%s')",
                             RELAY_WEECHAT_DATA(client, buffers_nicklist),
                             weechat_hashtable_get_string (RELAY_WEECHAT_DATA(client, buffers_nicklist),
@@ -21,14 +21,40 @@
 #define WEECHAT_RELAY_WEECHAT_H 1
 
 struct t_relay_client;
+struct z_stream_s;
 
 #define RELAY_WEECHAT_DATA(client, var)                          \
     (((struct t_relay_weechat_data *)client->protocol_data)->var)
 
+/* versions of weechat protocol (negotiated with command "init") */
+#define RELAY_WEECHAT_PROTOCOL_VERSION_MIN 1
+#define RELAY_WEECHAT_PROTOCOL_VERSION_MAX 2
+
+/* max number of strings kept by client (protocol version 2) */
+#define RELAY_WEECHAT_STRINGS_MAX 4096
+
+/* messages sent to client depend on previous ones (none can be dropped) */
+#define RELAY_WEECHAT_CLIENT_STATEFUL(client)                    \
+    ((client->protocol == RELAY_PROTOCOL_WEECHAT)                \
+     && client->protocol_data                                    \
+     && ((RELAY_WEECHAT_DATA(client, compression)                \
+          == RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM)              \
+         || (RELAY_WEECHAT_DATA(client, protocol_version) >= 2)))
+
+/* client receives events from signals hooked for all WeeChat clients */
+#define RELAY_WEECHAT_CLIENT_HOOKED(client)                      \
+    ((client->protocol == RELAY_PROTOCOL_WEECHAT)                \
+     && client->protocol_data                                    \
+     && RELAY_WEECHAT_DATA(client, signals_hooked))
+
 enum t_relay_weechat_compression
 {
     RELAY_WEECHAT_COMPRESSION_OFF = 0, /* no compression of binary objects  */
     RELAY_WEECHAT_COMPRESSION_ZLIB,    /* zlib compression                  */
+    RELAY_WEECHAT_COMPRESSION_ZLIB_STREAM, /* zlib stream (one deflate      */
+                                       /* stream for whole connection)      */
+    RELAY_WEECHAT_COMPRESSION_ZSTD,    /* zstd compression (optional dict.) */
+    RELAY_WEECHAT_COMPRESSION_LZ4,     /* lz4 compression                   */
     /* number of compressions */
     RELAY_WEECHAT_NUM_COMPRESSIONS,
 };
@@ -37,18 +63,35 @@ struct t_relay_weechat_data
 {
     int password_ok;                   /* password received and OK?         */
     enum t_relay_weechat_compression compression; /* compression type       */
+    struct z_stream_s *zlib_stream;    /* deflate stream (for compression   */
+                                       /* "zlib-stream")                    */
+    unsigned long compression_bytes_in;  /* bytes before compression        */
+    unsigned long compression_bytes_out; /* bytes after compression         */
+    unsigned long compression_time;    /* time spent to compress (in usec)  */
+    int protocol_version;              /* protocol version (1 or 2)         */
+    int schema_sent;                   /* 1 if "_protocol" has been sent    */
+    struct t_hashtable *strings;       /* strings known by client, with     */
+                                       /* their index (protocol version 2)  */
+    time_t last_date;                  /* date of last line sent (v2)       */
 
     /* sync of buffers */
     struct t_hashtable *buffers_sync;  /* buffers synchronized (events      */
                                        /* received for these buffers)       */
-    struct t_hook *hook_signal_buffer;    /* hook for signals "buffer_*"    */
-    struct t_hook *hook_hsignal_nicklist; /* hook for hsignals "nicklist_*" */
-    struct t_hook *hook_signal_upgrade;   /* hook for signals "upgrade*"    */
+    int signals_hooked;                /* 1 if client receives events from  */
+                                       /* signals "buffer_*", "upgrade*"    */
+                                       /* and hsignals "nicklist_*"         */
     struct t_hashtable *buffers_nicklist; /* send nicklist for these buffers*/
     struct t_hook *hook_timer_nicklist;   /* timer for sending nicklist     */
 };
 
+extern struct t_hook *relay_weechat_hook_signal_buffer;
+extern struct t_hook *relay_weechat_hook_hsignal_nicklist;
+extern struct t_hook *relay_weechat_hook_signal_upgrade;
+
+extern int relay_weechat_compression_available (int compression);
 extern int relay_weechat_compression_search (const char *compression);
+extern int relay_weechat_compression_ratio (struct t_relay_client *client);
+extern void relay_weechat_zlib_stream_free (struct t_relay_client *client);
 extern void relay_weechat_hook_signals (struct t_relay_client *client);
 extern void relay_weechat_unhook_signals (struct t_relay_client *client);
 extern void relay_weechat_hook_timer_nicklist (struct t_relay_client *client);
@@ -57,7 +57,7 @@ struct timeval;
  * please change the date with current one; for a second change at same
  * date, increment the 01, otherwise please keep 01.
  */
-#define WEECHAT_PLUGIN_API_VERSION "20140313-01"
+#define WEECHAT_PLUGIN_API_VERSION "20261019-04"
 
 /* macros for defining plugin infos */
 #define WEECHAT_PLUGIN_NAME(__name)                                     \
@@ -152,9 +152,14 @@ struct timeval;
 #define WEECHAT_HOOK_CONNECT_TIMEOUT                9
 #define WEECHAT_HOOK_CONNECT_SOCKET_ERROR           10
 
-/* action for gnutls callback: verify or set certificate */
+/* action for gnutls callback: verify/set certificate, init session */
 #define WEECHAT_HOOK_CONNECT_GNUTLS_CB_VERIFY_CERT  0
 #define WEECHAT_HOOK_CONNECT_GNUTLS_CB_SET_CERT     1
+#define WEECHAT_HOOK_CONNECT_GNUTLS_CB_INIT_SESSION 2
+
+/* status for thread callback */
+#define WEECHAT_HOOK_THREAD_OK                      0
+#define WEECHAT_HOOK_THREAD_CANCELLED               1
 
 /* type of data for signal hooked */
 #define WEECHAT_HOOK_SIGNAL_STRING                  "string"
@@ -305,6 +310,8 @@ struct t_weechat_plugin
     void (*util_timeval_add) (struct timeval *tv, long interval);
     char *(*util_get_time_string) (const time_t *date);
     int (*util_version_number) (const char *version);
+    void (*memory_add) (struct t_weechat_plugin *plugin, const char *category,
+                        long long bytes, long objects);
 
     /* sorted lists */
     struct t_weelist *(*list_new) ();
@@ -508,6 +515,8 @@ struct t_weechat_plugin
     void (*printf_y) (struct t_gui_buffer *buffer, int y,
                       const char *message, ...);
     void (*log_printf) (const char *message, ...);
+    void (*trace_event) (struct t_weechat_plugin *plugin, const char *name,
+                         int begin);
 
     /* hooks */
     struct t_hook *(*hook_command) (struct t_weechat_plugin *plugin,
@@ -678,6 +687,13 @@ struct t_weechat_plugin
                                   struct t_hashtable *(*callback)(void *data,
                                                                   struct t_hashtable *info),
                                   void *callback_data);
+    struct t_hook *(*hook_thread) (struct t_weechat_plugin *plugin,
+                                   void *(*function)(void *arg),
+                                   void *function_arg,
+                                   int (*callback)(void *data,
+                                                   void *result,
+                                                   int status),
+                                   void *callback_data);
     void (*hook_set) (struct t_hook *hook, const char *property,
                       const char *value);
     void (*unhook) (struct t_hook *hook);
@@ -1118,6 +1134,9 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
     weechat_plugin->util_get_time_string(__date)
 #define weechat_util_version_number(__version)                          \
     weechat_plugin->util_version_number(__version)
+#define weechat_memory_add(__category, __bytes, __objects)              \
+    weechat_plugin->memory_add(weechat_plugin, __category, __bytes,     \
+                               __objects)
 
 /* sorted list */
 #define weechat_list_new()                                              \
@@ -1355,6 +1374,10 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
     weechat_plugin->printf_y(__buffer, __y, __message, ##__argz)
 #define weechat_log_printf(__message, __argz...)                        \
     weechat_plugin->log_printf(__message, ##__argz)
+#define weechat_trace_begin(__name)                                     \
+    weechat_plugin->trace_event(weechat_plugin, __name, 1)
+#define weechat_trace_end()                                             \
+    weechat_plugin->trace_event(weechat_plugin, NULL, 0)
 
 /* hooks */
 #define weechat_hook_command(__command, __description, __args,          \
@@ -1462,6 +1485,10 @@ extern int weechat_plugin_end (struct t_weechat_plugin *plugin);
 #define weechat_hook_focus(__area, __callback, __data)                  \
     weechat_plugin->hook_focus(weechat_plugin, __area, __callback,      \
                                __data)
+#define weechat_hook_thread(__function, __function_arg, __callback,     \
+                            __data)                                     \
+    weechat_plugin->hook_thread(weechat_plugin, __function,             \
+                                __function_arg, __callback, __data)
 #define weechat_hook_set(__hook, __property, __value)                   \
     weechat_plugin->hook_set(__hook, __property, __value)
 #define weechat_unhook(__hook)                                          \
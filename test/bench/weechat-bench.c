@@ -0,0 +1,700 @@
+/*
+ * weechat-bench.c - micro-benchmarks for core functions
+ *
+ * Copyright (C) 2026 Sébastien Helleu <flashcode@flashtux.org>
+ *
+ * This file is part of WeeChat, the extensible chat client.
+ *
+ * WeeChat is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * WeeChat is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * This program initializes WeeChat with the headless GUI (in a temporary
+ * home), then measures the time and number of memory allocations per call
+ * of functions used for each line displayed, on a generated corpus (always
+ * the same for a given size).
+ *
+ * Results can be saved in a file and compared with a previous run.
+ */
+
+#define _XOPEN_SOURCE 700
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <ftw.h>
+#include <sys/time.h>
+
+#include "../../src/core/weechat.h"
+#include "../../src/core/wee-hashtable.h"
+#include "../../src/core/wee-string.h"
+#include "../../src/core/wee-utf8.h"
+#include "../../src/core/wee-util.h"
+#include "../../src/core/wee-version.h"
+#include "../../src/gui/gui-color.h"
+#include "../../src/plugins/plugin.h"
+
+
+#define BENCH_CORPUS_SIZE 1024
+#define BENCH_HIGHLIGHT_WORDS "bench,flashcode,weechat"
+
+struct t_bench
+{
+    char *name;                        /* name of benchmark                 */
+    void (*function)(int index);       /* function called (on corpus item)  */
+    int need_irc;                      /* 1 if irc plugin is needed         */
+    double ns_per_call;                /* result: time per call             */
+    double allocs_per_call;            /* result: allocations per call      */
+};
+
+typedef void (t_irc_message_parse)(void *server, const char *message,
+                                   char **tags, char **message_without_tags,
+                                   char **nick, char **host, char **command,
+                                   char **channel, char **arguments);
+typedef char *(t_irc_color_decode)(const char *string, int keep_colors);
+
+char *bench_home = NULL;               /* temporary WeeChat home            */
+char *bench_messages[BENCH_CORPUS_SIZE];     /* messages (UTF-8)            */
+char *bench_colored[BENCH_CORPUS_SIZE];      /* messages with WeeChat colors*/
+char *bench_hosts[BENCH_CORPUS_SIZE];        /* nick!user@host              */
+char *bench_nicks[BENCH_CORPUS_SIZE];        /* nicks                       */
+char *bench_irc_lines[BENCH_CORPUS_SIZE];    /* raw IRC messages            */
+char *bench_irc_colored[BENCH_CORPUS_SIZE];  /* messages with IRC colors    */
+struct t_hashtable *bench_hashtable = NULL;  /* hashtable (keys = nicks)    */
+t_irc_message_parse *bench_irc_message_parse = NULL;
+t_irc_color_decode *bench_irc_color_decode = NULL;
+unsigned long bench_random_seed = 1;
+
+/* allocations counter */
+volatile int bench_count_allocs = 0;
+volatile unsigned long bench_allocs = 0;
+
+char *bench_words[] =
+{ "hello", "world", "the", "a", "is", "of", "and", "to", "in", "that",
+  "it", "with", "for", "on", "this", "weechat", "irc", "server", "channel",
+  "message", "https://weechat.org/files/doc/devel/weechat_user.en.html",
+  "café", "naïve", "ça", "déjà", "Привет", "мир", "日本語", "テスト",
+  "中文", "한국어", "Ελληνικά", "☺", "→", "…", "😀", "🎉", "lol", ":)",
+  "#weechat", "--", "42", NULL };
+
+char *bench_masks[] =
+{ "*!*@*.example.net", "nick*!*@*", "*!user*@*", "*!*@192.168.*",
+  "*bench*", "*!*@*", "x*!*@*.org", NULL };
+
+char *bench_color_names[] =
+{ "red", "lightblue", "bold", "_green", "*yellow", "!magenta",
+  "lightcyan,blue", "214", "bar_fg", "reset", NULL };
+
+char *bench_irc_colors[] =
+{ "\x03" "04", "\x03" "12,01", "\x02", "\x1F", "\x16", "\x0F", "\x1D",
+  "\x03" "3", NULL };
+
+
+#ifdef __GLIBC__
+/*
+ * Functions replacing malloc/calloc/realloc to count allocations (glibc
+ * allows replacement of these functions, for the program and all libraries).
+ */
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+void *
+malloc (size_t size)
+{
+    if (bench_count_allocs)
+        bench_allocs++;
+    return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+    if (bench_count_allocs)
+        bench_allocs++;
+    return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+    if (bench_count_allocs)
+        bench_allocs++;
+    return __libc_realloc (ptr, size);
+}
+#endif /* __GLIBC__ */
+
+/*
+ * Returns a pseudo-random number (same sequence on all systems).
+ */
+
+unsigned long
+bench_random (unsigned long max)
+{
+    bench_random_seed = (bench_random_seed * 1103515245UL + 12345UL) %
+        2147483648UL;
+    return (bench_random_seed >> 8) % max;
+}
+
+/*
+ * Returns a random item of a NULL-terminated array of strings.
+ */
+
+const char *
+bench_random_item (char **items)
+{
+    int count;
+
+    for (count = 0; items[count]; count++)
+    {
+    }
+    return items[bench_random (count)];
+}
+
+/*
+ * Builds a random message with words, with optional prefix between words
+ * (color codes).
+ */
+
+char *
+bench_build_message (char **prefixes, int prefix_frequency)
+{
+    char message[4096];
+    int i, num_words;
+
+    message[0] = '\0';
+    num_words = 3 + bench_random (40);
+    if (bench_random (100) == 0)
+        strcat (message, "bench: ");
+    for (i = 0; i < num_words; i++)
+    {
+        if (i > 0)
+            strcat (message, " ");
+        if (prefixes && (bench_random (prefix_frequency) == 0))
+            strcat (message, bench_random_item (prefixes));
+        strcat (message, bench_random_item (bench_words));
+    }
+
+    return strdup (message);
+}
+
+/*
+ * Builds the corpus used by benchmarks.
+ */
+
+void
+bench_corpus_init ()
+{
+    char str[4096], *colors[16], *message;
+    const char *ptr_color;
+    int i, num_colors;
+
+    /* WeeChat colors (returned in a static buffer, so they are copied) */
+    num_colors = 0;
+    for (i = 0; bench_color_names[i] && (num_colors < 15); i++)
+    {
+        ptr_color = gui_color_get_custom (bench_color_names[i]);
+        if (ptr_color && ptr_color[0])
+            colors[num_colors++] = strdup (ptr_color);
+    }
+    colors[num_colors] = NULL;
+
+    bench_hashtable = hashtable_new (32,
+                                     WEECHAT_HASHTABLE_STRING,
+                                     WEECHAT_HASHTABLE_STRING,
+                                     NULL, NULL);
+
+    for (i = 0; i < BENCH_CORPUS_SIZE; i++)
+    {
+        snprintf (str, sizeof (str), "%s%lu",
+                  bench_random_item (bench_words),
+                  (unsigned long)i);
+        bench_nicks[i] = strdup (str);
+        snprintf (str, sizeof (str), "%s!~user%lu@host-%lu.%s",
+                  bench_nicks[i], bench_random (1000), bench_random (100000),
+                  (bench_random (2)) ? "example.net" : "192.168.1.1");
+        bench_hosts[i] = strdup (str);
+
+        bench_messages[i] = bench_build_message (NULL, 0);
+
+        message = bench_build_message ((num_colors > 0) ? colors : NULL, 4);
+        snprintf (str, sizeof (str), "%s%s%s%s",
+                  GUI_COLOR(GUI_COLOR_CHAT_NICK), bench_nicks[i],
+                  GUI_COLOR(GUI_COLOR_CHAT), message);
+        bench_colored[i] = strdup (str);
+        free (message);
+
+        bench_irc_colored[i] = bench_build_message (bench_irc_colors, 5);
+
+        snprintf (str, sizeof (str), "%s:%s %s #weechat :%s",
+                  (bench_random (4) == 0) ?
+                  "@time=2014-03-13T12:34:56.789Z;account=bench " : "",
+                  bench_hosts[i],
+                  (bench_random (10) == 0) ? "NOTICE" : "PRIVMSG",
+                  bench_irc_colored[i]);
+        bench_irc_lines[i] = strdup (str);
+
+        hashtable_set (bench_hashtable, bench_nicks[i], bench_hosts[i]);
+
+        /* keep a reference on shared string (like nicks in buffer lines) */
+        (void) string_shared_get (bench_nicks[i]);
+    }
+
+    for (i = 0; i < num_colors; i++)
+    {
+        free (colors[i]);
+    }
+}
+
+/*
+ * Benchmark functions (called with an index in corpus).
+ */
+
+void
+bench_gui_color_decode (int index)
+{
+    free (gui_color_decode (bench_colored[index], NULL));
+}
+
+void
+bench_string_has_highlight (int index)
+{
+    (void) string_has_highlight (bench_messages[index],
+                                 BENCH_HIGHLIGHT_WORDS);
+}
+
+void
+bench_string_match (int index)
+{
+    (void) string_match (bench_hosts[index],
+                         bench_masks[index % 7], 0);
+}
+
+void
+bench_string_split (int index)
+{
+    char **argv;
+    int argc;
+
+    argv = string_split (bench_messages[index], " ", 0, 0, &argc);
+    string_free_split (argv);
+}
+
+void
+bench_utf8_strlen_screen (int index)
+{
+    (void) utf8_strlen_screen (bench_messages[index]);
+}
+
+void
+bench_utf8_is_valid (int index)
+{
+    (void) utf8_is_valid (bench_messages[index], NULL);
+}
+
+void
+bench_hashtable_get (int index)
+{
+    (void) hashtable_get (bench_hashtable, bench_nicks[index]);
+}
+
+void
+bench_hashtable_set (int index)
+{
+    (void) hashtable_set (bench_hashtable, bench_nicks[index],
+                          bench_hosts[(index + 1) % BENCH_CORPUS_SIZE]);
+}
+
+void
+bench_string_shared_get (int index)
+{
+    string_shared_free (string_shared_get (bench_nicks[index]));
+}
+
+void
+bench_irc_message_parse_cb (int index)
+{
+    char *tags, *message_without_tags, *nick, *host, *command, *channel;
+    char *arguments;
+
+    bench_irc_message_parse (NULL, bench_irc_lines[index],
+                             &tags, &message_without_tags, &nick, &host,
+                             &command, &channel, &arguments);
+    free (tags);
+    free (message_without_tags);
+    free (nick);
+    free (host);
+    free (command);
+    free (channel);
+    free (arguments);
+}
+
+void
+bench_irc_color_decode_cb (int index)
+{
+    free (bench_irc_color_decode (bench_irc_colored[index], 1));
+}
+
+struct t_bench bench_list[] =
+{ { "gui_color_decode", &bench_gui_color_decode, 0, 0, 0 },
+  { "string_has_highlight", &bench_string_has_highlight, 0, 0, 0 },
+  { "string_match", &bench_string_match, 0, 0, 0 },
+  { "string_split", &bench_string_split, 0, 0, 0 },
+  { "utf8_strlen_screen", &bench_utf8_strlen_screen, 0, 0, 0 },
+  { "utf8_is_valid", &bench_utf8_is_valid, 0, 0, 0 },
+  { "hashtable_get", &bench_hashtable_get, 0, 0, 0 },
+  { "hashtable_set", &bench_hashtable_set, 0, 0, 0 },
+  { "string_shared_get", &bench_string_shared_get, 0, 0, 0 },
+  { "irc_message_parse", &bench_irc_message_parse_cb, 1, 0, 0 },
+  { "irc_color_decode", &bench_irc_color_decode_cb, 1, 0, 0 },
+  { NULL, NULL, 0, 0, 0 },
+};
+
+/*
+ * Runs a benchmark during (at least) "duration" milliseconds.
+ *
+ * The corpus is used many times: the fastest pass on the whole corpus is
+ * kept, to reduce noise (other processes, CPU frequency).
+ */
+
+void
+bench_run (struct t_bench *bench, long duration)
+{
+    struct timeval tv_start, tv_pass, tv_now;
+    long long elapsed, elapsed_pass, best_pass;
+    unsigned long calls;
+    int i;
+
+    /* warm up */
+    for (i = 0; i < BENCH_CORPUS_SIZE; i++)
+    {
+        bench->function (i);
+    }
+
+    calls = 0;
+    best_pass = -1;
+    bench_allocs = 0;
+    bench_count_allocs = 1;
+    gettimeofday (&tv_start, NULL);
+    while (1)
+    {
+        gettimeofday (&tv_pass, NULL);
+        for (i = 0; i < BENCH_CORPUS_SIZE; i++)
+        {
+            bench->function (i);
+        }
+        calls += BENCH_CORPUS_SIZE;
+        gettimeofday (&tv_now, NULL);
+        elapsed_pass = util_timeval_diff_usec (&tv_pass, &tv_now);
+        if ((best_pass < 0) || (elapsed_pass < best_pass))
+            best_pass = elapsed_pass;
+        elapsed = util_timeval_diff_usec (&tv_start, &tv_now);
+        if (elapsed >= duration * 1000)
+            break;
+    }
+    bench_count_allocs = 0;
+
+    bench->ns_per_call = ((double)best_pass * 1000) / BENCH_CORPUS_SIZE;
+    bench->allocs_per_call = ((double)bench_allocs) / calls;
+}
+
+/*
+ * Reads result of a benchmark in a baseline file.
+ *
+ * Returns 1 if found, 0 if not found.
+ */
+
+int
+bench_baseline_read (const char *filename, const char *name,
+                     double *ns_per_call, double *allocs_per_call)
+{
+    FILE *file;
+    char line[1024], bench_name[256];
+    int found;
+
+    file = fopen (filename, "r");
+    if (!file)
+        return 0;
+
+    found = 0;
+    while (fgets (line, sizeof (line), file))
+    {
+        if (line[0] == '#')
+            continue;
+        if ((sscanf (line, "%255s %lf %lf",
+                     bench_name, ns_per_call, allocs_per_call) == 3)
+            && (strcmp (bench_name, name) == 0))
+        {
+            found = 1;
+            break;
+        }
+    }
+    fclose (file);
+
+    return found;
+}
+
+/*
+ * Removes a file (callback for nftw).
+ */
+
+int
+bench_remove_file_cb (const char *path, const struct stat *statinfo,
+                      int flag, struct FTW *ftw)
+{
+    /* make C compiler happy */
+    (void) statinfo;
+    (void) flag;
+    (void) ftw;
+
+    return remove (path);
+}
+
+/*
+ * Removes temporary WeeChat home (called on exit).
+ */
+
+void
+bench_remove_home ()
+{
+    if (bench_home)
+        nftw (bench_home, &bench_remove_file_cb, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/*
+ * Creates temporary WeeChat home with configuration for plugins.
+ *
+ * Returns 1 if OK, 0 if error.
+ */
+
+int
+bench_create_home (const char *plugin_path)
+{
+    char template[] = "/tmp/weechat-bench-XXXXXX", *path;
+    FILE *file;
+    int length;
+
+    path = mkdtemp (template);
+    if (!path)
+        return 0;
+    bench_home = strdup (path);
+    if (!bench_home)
+        return 0;
+
+    length = strlen (bench_home) + 64;
+    path = malloc (length);
+    if (!path)
+        return 0;
+    snprintf (path, length, "%s/weechat.conf", bench_home);
+    file = fopen (path, "w");
+    free (path);
+    if (!file)
+        return 0;
+    fprintf (file,
+             "[startup]\n"
+             "display_logo = off\n"
+             "display_version = off\n"
+             "[plugin]\n"
+             "autoload = \"irc\"\n"
+             "path = \"%s\"\n",
+             (plugin_path) ? plugin_path : "");
+    fclose (file);
+
+    return 1;
+}
+
+/*
+ * Displays help.
+ */
+
+void
+bench_display_help (const char *program)
+{
+    printf ("Usage: %s [option...]\n"
+            "\n"
+            "Micro-benchmarks for WeeChat core functions.\n"
+            "\n"
+            "  -b <file>      compare with results in file (baseline)\n"
+            "  -d <ms>        duration of each benchmark (default: 500)\n"
+            "  -f <mask>      run only benchmarks matching mask "
+            "(example: \"string_*\")\n"
+            "  -h             display this help\n"
+            "  -o <file>      save results in file\n"
+            "  -p <dir>       directory with irc plugin (irc benchmarks "
+            "are skipped if not set)\n"
+            "  -t <percent>   tolerance for comparison with baseline "
+            "(default: 10)\n"
+            "\n"
+            "Exit code is 1 if a benchmark is slower than baseline "
+            "(with tolerance).\n",
+            program);
+}
+
+/*
+ * Entry point for benchmarks.
+ */
+
+int
+main (int argc, char *argv[])
+{
+    char *baseline, *mask, *output, *plugin_path, *weechat_argv[5];
+    struct t_weechat_plugin *ptr_plugin;
+    struct t_bench *ptr_bench;
+    double tolerance, ns_base, allocs_base, diff;
+    long duration;
+    int opt, regressions;
+    FILE *file;
+
+    baseline = NULL;
+    mask = NULL;
+    output = NULL;
+    plugin_path = NULL;
+    duration = 500;
+    tolerance = 10;
+
+    while ((opt = getopt (argc, argv, "b:d:f:ho:p:t:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b':
+                baseline = optarg;
+                break;
+            case 'd':
+                duration = atol (optarg);
+                break;
+            case 'f':
+                mask = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            case 'p':
+                plugin_path = optarg;
+                break;
+            case 't':
+                tolerance = atof (optarg);
+                break;
+            case 'h':
+                bench_display_help (argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                bench_display_help (argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (duration <= 0)
+        duration = 500;
+
+    /* init WeeChat in a temporary home (removed on exit) */
+    if (!bench_create_home (plugin_path))
+    {
+        fprintf (stderr, "Error: unable to create temporary home\n");
+        return EXIT_FAILURE;
+    }
+    atexit (&bench_remove_home);
+    weechat_argv[0] = argv[0];
+    weechat_argv[1] = "--dir";
+    weechat_argv[2] = bench_home;
+    weechat_argv[3] = (plugin_path) ? NULL : "--no-plugin";
+    weechat_argv[4] = NULL;
+    weechat_init ((plugin_path) ? 3 : 4, weechat_argv);
+
+    /* get irc functions in irc plugin (if loaded) */
+    ptr_plugin = plugin_search ("irc");
+    if (ptr_plugin && ptr_plugin->handle)
+    {
+        bench_irc_message_parse = dlsym (ptr_plugin->handle,
+                                         "irc_message_parse");
+        bench_irc_color_decode = dlsym (ptr_plugin->handle,
+                                        "irc_color_decode");
+    }
+
+    bench_corpus_init ();
+
+    file = NULL;
+    if (output)
+    {
+        file = fopen (output, "w");
+        if (!file)
+        {
+            fprintf (stderr, "Error: unable to write file \"%s\"\n", output);
+            weechat_shutdown (EXIT_FAILURE, 0);
+        }
+        fprintf (file, "# weechat-bench %s: name, ns/call, allocs/call\n",
+                 version_get_version ());
+    }
+
+    printf ("%-22s %12s %12s", "benchmark", "ns/call", "allocs/call");
+    if (baseline)
+        printf (" %12s %9s", "base ns", "diff");
+    printf ("\n");
+
+    regressions = 0;
+    for (ptr_bench = bench_list; ptr_bench->name; ptr_bench++)
+    {
+        if (mask && !string_match (ptr_bench->name, mask, 0))
+            continue;
+        if (ptr_bench->need_irc
+            && (!bench_irc_message_parse || !bench_irc_color_decode))
+        {
+            printf ("%-22s %12s\n", ptr_bench->name, "(skipped)");
+            continue;
+        }
+        bench_run (ptr_bench, duration);
+        printf ("%-22s %12.1f %12.2f",
+                ptr_bench->name,
+                ptr_bench->ns_per_call,
+                ptr_bench->allocs_per_call);
+        if (baseline
+            && bench_baseline_read (baseline, ptr_bench->name,
+                                    &ns_base, &allocs_base)
+            && (ns_base > 0))
+        {
+            diff = ((ptr_bench->ns_per_call - ns_base) * 100) / ns_base;
+            printf (" %12.1f %+8.1f%%", ns_base, diff);
+            if ((diff > tolerance)
+                || (ptr_bench->allocs_per_call > allocs_base + 0.005))
+            {
+                printf ("  REGRESSION");
+                regressions++;
+            }
+        }
+        printf ("\n");
+        fflush (stdout);
+        if (file)
+        {
+            fprintf (file, "%s %.1f %.2f\n",
+                     ptr_bench->name,
+                     ptr_bench->ns_per_call,
+                     ptr_bench->allocs_per_call);
+        }
+    }
+
+    if (file)
+        fclose (file);
+
+    if (regressions > 0)
+        weechat_shutdown (EXIT_FAILURE, 0);
+
+    weechat_end ();
+
+    return EXIT_SUCCESS;
+}
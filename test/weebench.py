@@ -0,0 +1,633 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2026 Sébastien Helleu <flashcode@flashtux.org>
+#
+# This file is part of WeeChat, the extensible chat client.
+#
+# WeeChat is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# WeeChat is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with WeeChat.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+"""
+weebench - end-to-end flood benchmark for WeeChat
+
+For each scenario, a fresh WeeChat (preferably the headless binary) is started
+with a temporary home, connected to a local IRC server (built on weercd) which
+sends a reproducible flood of IRC messages.
+
+Measured for each scenario:
+- messages/second processed by WeeChat
+- latency per message (p50/p99/max): a PING is sent after each block of
+  messages, the PONG is sent by WeeChat when all messages before the PING
+  have been processed; the time spent on the block (from the time it was
+  sent, or the PONG of previous block if WeeChat was still busy) is divided
+  by the number of messages in block
+- end-to-end latency of lines received by relay clients (if relay clients are
+  attached): this includes the time spent in queues, so it is meaningful only
+  with a limited rate of messages (option --rate).
+- peak RSS and CPU time (user/system) of WeeChat process.
+
+Results are displayed in JSON format; they can be compared with a previous
+result (option --baseline), the exit code is 1 if a regression is detected.
+
+Example, with a cmake build directory:
+  python weebench.py -b ~/src/weechat/build
+"""
+
+from __future__ import division, print_function
+
+import argparse
+import json
+import os
+import random
+import re
+import shlex
+import shutil
+import signal
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+from weercd import fuzzy_host, fuzzy_string
+
+NAME = 'weebench'
+VERSION = '0.1'
+
+SCENARIOS = ('privmsg', 'netsplit', 'names', 'nicks', 'relay')
+
+# metrics compared with baseline: (name, True if higher is better)
+METRICS = (('messages_per_sec', True),
+           ('latency_p99_ms', False),
+           ('peak_rss_kb', False),
+           ('cpu_sec', False))
+
+
+def percentile(values, pct):
+    """Return percentile of a list of values (None if list is empty)."""
+    if not values:
+        return None
+    values = sorted(values)
+    index = int(round((pct / 100) * (len(values) - 1)))
+    return values[index]
+
+
+def latency_stats(prefix, values):
+    """Return a dict with p50/p99/max (in milliseconds) of latencies."""
+    return {
+        '{0}_p50_ms'.format(prefix): round_ms(percentile(values, 50)),
+        '{0}_p99_ms'.format(prefix): round_ms(percentile(values, 99)),
+        '{0}_max_ms'.format(prefix): round_ms(max(values) if values else None),
+    }
+
+
+def round_ms(value):
+    """Convert a delay in seconds to milliseconds (rounded)."""
+    if value is None:
+        return None
+    return round(value * 1000, 4)
+
+
+def free_port():
+    """Return a free TCP port on localhost."""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    sock.bind(('127.0.0.1', 0))
+    port = sock.getsockname()[1]
+    sock.close()
+    return port
+
+
+class Scenario(object):
+    """Messages sent by IRC server to WeeChat (setup and timed flood)."""
+
+    channel = '#bench'
+
+    def __init__(self, name, args):
+        self.name = name
+        self.args = args
+        self.nick = 'bench'
+        self.relay_clients = args.relay_clients if name == 'relay' else 0
+        self.nicknumber = 0
+        self.setup = []
+        self.flood = []
+        random.seed(args.seed)
+        getattr(self, 'build_{0}'.format(
+            'privmsg' if name == 'relay' else name))()
+
+    def new_nick(self):
+        """Return a new unique nick."""
+        self.nicknumber += 1
+        return '{0}{1}'.format(fuzzy_string(1, 5), self.nicknumber)
+
+    def join(self, nicks):
+        """Return messages for self join of channel with nicks."""
+        msgs = [':{0}!{0}@localhost JOIN :{1}'.format(self.nick,
+                                                      self.channel)]
+        names = ['@{0}'.format(self.nick)] + nicks
+        for i in range(0, len(names), 30):
+            msgs.append(':weercd 353 {0} = {1} :{2}'
+                        ''.format(self.nick, self.channel,
+                                  ' '.join(names[i:i + 30])))
+        msgs.append(':weercd 366 {0} {1} :End of /NAMES list.'
+                    ''.format(self.nick, self.channel))
+        return msgs
+
+    def build_privmsg(self):
+        """Flood of messages in a channel."""
+        nicks = [self.new_nick() for i in range(self.args.nicks)]
+        hosts = dict((nick, fuzzy_host()) for nick in nicks)
+        self.setup = self.join(nicks)
+        for seq in range(self.args.messages):
+            nick = random.choice(nicks)
+            msg = fuzzy_string(10, 300, spaces=True)
+            if random.randint(1, 100) == 100:
+                msg = '{0}: {1}'.format(self.nick, msg)
+            self.flood.append(':{0}!{1} PRIVMSG {2} :{3} bench:{4}'
+                              ''.format(nick, hosts[nick], self.channel,
+                                        msg, seq))
+
+    def build_netsplit(self):
+        """Quit of many users (netsplit)."""
+        nicks = [self.new_nick() for i in range(self.args.users)]
+        self.setup = self.join(nicks)
+        for nick in nicks:
+            self.flood.append(':{0}!{1} QUIT :irc1.example.net '
+                              'irc2.example.net'.format(nick, fuzzy_host()))
+
+    def build_names(self):
+        """Join of a channel with a huge list of nicks (NAMES)."""
+        nicks = [self.new_nick() for i in range(self.args.names)]
+        self.flood = self.join(nicks)
+
+    def build_nicks(self):
+        """Mass nick changes in a channel."""
+        nicks = [self.new_nick() for i in range(self.args.users)]
+        self.setup = self.join(nicks)
+        for i in range(2):
+            for index, nick in enumerate(nicks):
+                newnick = self.new_nick()
+                self.flood.append(':{0}!{1} NICK :{2}'
+                                  ''.format(nick, fuzzy_host(), newnick))
+                nicks[index] = newnick
+
+
+class IrcServer(object):
+    """IRC server sending scenario messages to WeeChat."""
+
+    def __init__(self, args):
+        self.args = args
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.sock.bind(('127.0.0.1', 0))
+        self.sock.listen(1)
+        self.port = self.sock.getsockname()[1]
+        self.client = None
+        self.pongs = {}
+        self.lock = threading.Condition()
+        self.thread = None
+
+    def accept(self, timeout):
+        """Wait for connection of WeeChat and register the client."""
+        self.sock.settimeout(timeout)
+        self.client = self.sock.accept()[0]
+        self.client.settimeout(None)
+        self.thread = threading.Thread(target=self.read_loop)
+        self.thread.daemon = True
+        self.thread.start()
+        self.send([':weercd 001 bench :Welcome to the WeeChat IRC server',
+                   ':weercd 002 bench :Your host is weercd',
+                   ':weercd 003 bench :Are you solid like a rock?',
+                   ':weercd 004 bench :Let\'s see!'])
+
+    def read_loop(self):
+        """Read messages from WeeChat, record time of PONG received."""
+        buf = b''
+        while True:
+            try:
+                data = self.client.recv(65536)
+            except Exception:
+                break
+            if not data:
+                break
+            now = time.time()
+            buf += data
+            while b'\r\n' in buf:
+                line, buf = buf.split(b'\r\n', 1)
+                match = re.match(br'^PONG :?(.*)$', line)
+                if match:
+                    with self.lock:
+                        self.pongs[match.group(1).decode('UTF-8')] = now
+                        self.lock.notify_all()
+
+    def send(self, msgs):
+        """Send messages to WeeChat, return time of send."""
+        data = ''.join('{0}\r\n'.format(msg) for msg in msgs)
+        now = time.time()
+        self.client.sendall(data.encode('UTF-8'))
+        return now
+
+    def wait_pong(self, token, timeout):
+        """Wait for a PONG, return time of reception (None if timeout)."""
+        end = time.time() + timeout
+        with self.lock:
+            while token not in self.pongs:
+                remaining = end - time.time()
+                if remaining <= 0:
+                    return None
+                self.lock.wait(remaining)
+            return self.pongs[token]
+
+    def close(self):
+        """Close sockets."""
+        for sock in (self.client, self.sock):
+            if sock:
+                try:
+                    sock.close()
+                except Exception:
+                    pass
+
+
+class RelayClient(object):
+    """Client of WeeChat relay (weechat protocol, without compression)."""
+
+    def __init__(self, port, password, timeout):
+        self.sock = None
+        end = time.time() + timeout
+        while not self.sock:
+            try:
+                self.sock = socket.create_connection(('127.0.0.1', port), 1)
+            except socket.error:
+                if time.time() >= end:
+                    raise
+                time.sleep(0.1)
+        self.sock.settimeout(None)
+        self.lines = {}
+        self.messages = 0
+        self.bytes = 0
+        self.pong = threading.Event()
+        self.thread = threading.Thread(target=self.read_loop)
+        self.thread.daemon = True
+        self.thread.start()
+        self.sock.sendall('init password={0},compression=off\nsync\n'
+                          'ping ready\n'.format(password).encode('UTF-8'))
+
+    def read_loop(self):
+        """Read messages, record time of reception of lines."""
+        buf = b''
+        while True:
+            try:
+                data = self.sock.recv(65536)
+            except Exception:
+                break
+            if not data:
+                break
+            now = time.time()
+            buf += data
+            self.bytes += len(data)
+            while len(buf) >= 4:
+                length = ((ord(buf[0:1]) << 24) | (ord(buf[1:2]) << 16) |
+                          (ord(buf[2:3]) << 8) | ord(buf[3:4]))
+                if len(buf) < length:
+                    break
+                msg, buf = buf[:length], buf[length:]
+                self.messages += 1
+                if b'_pong' in msg:
+                    self.pong.set()
+                for match in re.finditer(br'bench:(\d+)', msg):
+                    self.lines.setdefault(int(match.group(1)), now)
+
+    def close(self):
+        """Close connection with relay."""
+        try:
+            self.sock.sendall(b'quit\n')
+            self.sock.close()
+        except Exception:
+            pass
+
+
+class Bench(object):
+    """Run of one scenario with a fresh WeeChat."""
+
+    def __init__(self, scenario, args):
+        self.scenario = scenario
+        self.args = args
+        self.home = tempfile.mkdtemp(prefix='weebench-')
+        self.server = IrcServer(args)
+        self.relay_port = free_port()
+        self.relays = []
+        self.proc = None
+        self.result = {'messages': len(scenario.flood)}
+
+    def log(self, msg):
+        """Display a message on stderr (if not quiet)."""
+        if not self.args.quiet:
+            sys.stderr.write('{0}: {1}\n'.format(self.scenario.name, msg))
+            sys.stderr.flush()
+
+    def prepare_home(self):
+        """Create configuration and link to plugins in WeeChat home."""
+        plugins = self.args.plugins.split(',')
+        if self.scenario.relay_clients > 0 and 'relay' not in plugins:
+            plugins.append('relay')
+        if self.args.build_dir:
+            plugin_dir = os.path.join(self.home, 'plugins')
+            os.mkdir(plugin_dir)
+            for name in plugins:
+                for ext in ('so', 'dll', 'dylib'):
+                    path = os.path.join(self.args.build_dir, 'src', 'plugins',
+                                        name, '{0}.{1}'.format(name, ext))
+                    if os.path.exists(path):
+                        os.symlink(os.path.abspath(path),
+                                   os.path.join(plugin_dir,
+                                                os.path.basename(path)))
+        with open(os.path.join(self.home, 'weechat.conf'), 'w') as conf:
+            conf.write('[plugin]\nautoload = "{0}"\n'.format(
+                ','.join(plugins)))
+        with open(os.path.join(self.home, 'irc.conf'), 'w') as conf:
+            conf.write('[server_default]\nnicks = "{0}"\n'
+                       'autoreconnect = off\n'.format(self.scenario.nick))
+
+    def start_weechat(self):
+        """Start WeeChat with a temporary home."""
+        commands = ['/set relay.network.password {0}'.format(
+            self.args.relay_password)]
+        if self.scenario.relay_clients > 0:
+            commands.append('/relay add weechat {0}'.format(self.relay_port))
+        commands += ['/server add weercd 127.0.0.1/{0}'.format(
+            self.server.port), '/connect weercd']
+        self.proc = subprocess.Popen(
+            [self.args.weechat, '--dir', self.home, '--no-connect',
+             '--run-command', ';'.join(commands)],
+            stdin=open(os.devnull), stdout=open(os.devnull, 'w'),
+            stderr=subprocess.STDOUT)
+
+    def stop_weechat(self):
+        """Stop WeeChat and get its resource usage."""
+        if not self.proc:
+            return
+        self.proc.send_signal(signal.SIGTERM)
+        end = time.time() + self.args.timeout
+        while True:
+            pid, status, rusage = os.wait4(self.proc.pid, os.WNOHANG)
+            if pid:
+                break
+            if time.time() >= end:
+                self.proc.kill()
+                pid, status, rusage = os.wait4(self.proc.pid, 0)
+                break
+            time.sleep(0.05)
+        self.proc.returncode = status
+        rss = rusage.ru_maxrss
+        if sys.platform == 'darwin':
+            rss //= 1024
+        self.result.update({
+            'peak_rss_kb': rss,
+            'cpu_user_sec': round(rusage.ru_utime, 3),
+            'cpu_sys_sec': round(rusage.ru_stime, 3),
+            'cpu_sec': round(rusage.ru_utime + rusage.ru_stime, 3),
+        })
+        self.proc = None
+
+    def sync(self, token):
+        """Send a PING and wait for the PONG."""
+        self.server.send(['PING :{0}'.format(token)])
+        if self.server.wait_pong(token, self.args.timeout) is None:
+            raise Exception('timeout waiting for PONG {0}'.format(token))
+
+    def flood(self):
+        """Send flood to WeeChat, measure latency with PING/PONG."""
+        msgs = self.scenario.flood
+        probes = []
+        sent = {}
+        block = self.args.block
+        start = time.time()
+        for index in range(0, len(msgs), block):
+            if self.args.rate > 0:
+                delay = start + (index / self.args.rate) - time.time()
+                if delay > 0:
+                    time.sleep(delay)
+            token = 'bench{0}'.format(index)
+            time_sent = self.server.send(msgs[index:index + block] +
+                                         ['PING :{0}'.format(token)])
+            probes.append((token, time_sent,
+                           len(msgs[index:index + block]) + 1))
+            for seq in range(index, min(index + block, len(msgs))):
+                sent[seq] = time_sent
+        latencies = []
+        end = start
+        for token, time_sent, count in probes:
+            time_pong = self.server.wait_pong(token, self.args.timeout)
+            if time_pong is None:
+                raise Exception('timeout waiting for PONG {0}'.format(token))
+            latencies.append((time_pong - max(time_sent, end)) / count)
+            end = max(end, time_pong)
+        elapsed = end - start
+        self.result.update({
+            'elapsed_sec': round(elapsed, 3),
+            'messages_per_sec': (round(len(msgs) / elapsed, 1)
+                                 if elapsed > 0 else None),
+        })
+        self.result.update(latency_stats('latency', latencies))
+        return sent
+
+    def relay_stats(self, sent):
+        """Wait for lines on relay clients and compute latency."""
+        expected = len(self.scenario.flood)
+        end = time.time() + self.args.timeout
+        while (any(len(relay.lines) < expected for relay in self.relays) and
+               time.time() < end):
+            time.sleep(0.05)
+        latencies = []
+        for relay in self.relays:
+            for seq, time_recv in relay.lines.items():
+                if seq in sent:
+                    latencies.append(time_recv - sent[seq])
+        self.result.update({
+            'relay_clients': len(self.relays),
+            'relay_lines': sum(len(relay.lines) for relay in self.relays),
+            'relay_messages': sum(relay.messages for relay in self.relays),
+            'relay_bytes': sum(relay.bytes for relay in self.relays),
+        })
+        self.result.update(latency_stats('relay_latency', latencies))
+
+    def run(self):
+        """Run the scenario, return results."""
+        try:
+            self.prepare_home()
+            self.start_weechat()
+            self.server.accept(self.args.timeout)
+            self.log('connected, {0} relay client(s)'.format(
+                self.scenario.relay_clients))
+            for i in range(self.scenario.relay_clients):
+                relay = RelayClient(self.relay_port, self.args.relay_password,
+                                    self.args.timeout)
+                if not relay.pong.wait(self.args.timeout):
+                    raise Exception('relay client not ready')
+                self.relays.append(relay)
+            if self.scenario.setup:
+                self.server.send(self.scenario.setup)
+            self.sync('setup')
+            self.log('sending {0} messages'.format(len(self.scenario.flood)))
+            sent = self.flood()
+            if self.relays:
+                self.relay_stats(sent)
+            self.log('{0} messages/s, p99 latency: {1} ms'.format(
+                self.result['messages_per_sec'],
+                self.result['latency_p99_ms']))
+        except Exception as exc:
+            self.result['error'] = str(exc)
+            self.log('error: {0}'.format(exc))
+        finally:
+            for relay in self.relays:
+                relay.close()
+            self.stop_weechat()
+            self.server.close()
+            if not self.args.keep_home:
+                shutil.rmtree(self.home, ignore_errors=True)
+        return self.result
+
+
+def compare(results, baseline, tolerance):
+    """Compare results with baseline, return list of regressions."""
+    regressions = []
+    for name, result in sorted(results['scenarios'].items()):
+        base = baseline.get('scenarios', {}).get(name)
+        if not base:
+            continue
+        for metric, higher_is_better in METRICS:
+            value, ref = result.get(metric), base.get(metric)
+            if not value or not ref:
+                continue
+            change = (value - ref) * 100 / ref
+            regression = ((higher_is_better and change < -tolerance) or
+                          (not higher_is_better and change > tolerance))
+            sys.stderr.write('{0:<10} {1:<18} {2:>12} -> {3:>12} '
+                             '({4:+.1f}%){5}\n'
+                             ''.format(name, metric, ref, value, change,
+                                       '  REGRESSION' if regression else ''))
+            if regression:
+                regressions.append((name, metric))
+    return regressions
+
+
+def main():
+    """Main function."""
+    parser = argparse.ArgumentParser(
+        formatter_class=argparse.ArgumentDefaultsHelpFormatter,
+        fromfile_prefix_chars='@',
+        description='End-to-end flood benchmark for WeeChat.',
+        epilog='Note: the environment variable "WEEBENCH_OPTIONS" can be '
+        'set with default options. Argument "@file.txt" can be used to read '
+        'default options in a file.')
+    parser.add_argument('-w', '--weechat',
+                        help='path to WeeChat binary (default: '
+                        'weechat-headless in build directory, or '
+                        '"weechat-headless" in PATH)')
+    parser.add_argument('-b', '--build-dir',
+                        help='cmake build directory (binary and plugins are '
+                        'used from this directory)')
+    parser.add_argument('-s', '--scenarios', default=','.join(SCENARIOS),
+                        help='comma-separated list of scenarios to run '
+                        '({0})'.format(', '.join(SCENARIOS)))
+    parser.add_argument('-p', '--plugins', default='irc',
+                        help='comma-separated list of plugins to load '
+                        '(relay is added if needed)')
+    parser.add_argument('-m', '--messages', type=int, default=50000,
+                        help='number of messages (scenarios privmsg/relay)')
+    parser.add_argument('-n', '--nicks', type=int, default=100,
+                        help='number of nicks in channel (scenarios '
+                        'privmsg/relay)')
+    parser.add_argument('-u', '--users', type=int, default=5000,
+                        help='number of users in channel (scenarios '
+                        'netsplit/nicks)')
+    parser.add_argument('-N', '--names', type=int, default=20000,
+                        help='number of nicks in NAMES (scenario names)')
+    parser.add_argument('-r', '--relay-clients', type=int, default=2,
+                        help='number of relay clients (scenario relay)')
+    parser.add_argument('--relay-password', default='bench',
+                        help='password for relay')
+    parser.add_argument('-B', '--block', type=int, default=100,
+                        help='number of messages sent before each PING '
+                        '(latency probe)')
+    parser.add_argument('-R', '--rate', type=float, default=0,
+                        help='max number of messages sent per second (0 = '
+                        'as fast as possible)')
+    parser.add_argument('-S', '--seed', type=int, default=1,
+                        help='seed for random generator')
+    parser.add_argument('-t', '--timeout', type=float, default=120,
+                        help='timeout for each step (in seconds)')
+    parser.add_argument('-o', '--output',
+                        help='write results (JSON) in this file')
+    parser.add_argument('-c', '--baseline', type=argparse.FileType('r'),
+                        help='compare results with this file (JSON written '
+                        'by a previous run)')
+    parser.add_argument('-T', '--tolerance', type=float, default=10,
+                        help='tolerance for comparison with baseline '
+                        '(percent)')
+    parser.add_argument('-k', '--keep-home', action='store_true',
+                        help='do not delete WeeChat home after each scenario')
+    parser.add_argument('-q', '--quiet', action='store_true',
+                        help='do not display progress on stderr')
+    parser.add_argument('-v', '--version', action='version', version=VERSION)
+    args = parser.parse_args(shlex.split(os.getenv('WEEBENCH_OPTIONS') or '') +
+                             sys.argv[1:])
+
+    if not args.weechat:
+        args.weechat = 'weechat-headless'
+        if args.build_dir:
+            args.weechat = os.path.join(args.build_dir, 'src', 'gui',
+                                        'curses', 'headless',
+                                        'weechat-headless')
+
+    try:
+        version = subprocess.check_output([args.weechat, '--version'])
+        version = version.decode('UTF-8').strip()
+    except Exception as exc:
+        sys.stderr.write('Unable to run {0}: {1}\n'.format(args.weechat, exc))
+        sys.exit(2)
+
+    results = {
+        'weechat': args.weechat,
+        'version': version,
+        'time': time.strftime('%Y-%m-%dT%H:%M:%S'),
+        'options': dict((key, value) for key, value in vars(args).items()
+                        if key not in ('baseline', 'output')),
+        'scenarios': {},
+    }
+    errors = 0
+    for name in args.scenarios.split(','):
+        if name not in SCENARIOS:
+            sys.stderr.write('Unknown scenario: {0}\n'.format(name))
+            sys.exit(2)
+        bench = Bench(Scenario(name, args), args)
+        results['scenarios'][name] = bench.run()
+        if 'error' in results['scenarios'][name]:
+            errors += 1
+
+    output = json.dumps(results, indent=2, sort_keys=True)
+    if args.output:
+        with open(args.output, 'w') as out:
+            out.write(output + '\n')
+    print(output)
+
+    if args.baseline:
+        if compare(results, json.load(args.baseline), args.tolerance):
+            sys.exit(1)
+    if errors:
+        sys.exit(1)
+
+if __name__ == "__main__":
+    main()